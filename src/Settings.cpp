@@ -398,8 +398,8 @@ void Settings::addItemsToMenu (Globals& world, PopupMenu& menu)
     index = 0; sub.clear();
     for (const auto& device : MidiOutput::getDevices())
         sub.addItem (MidiOutputDevice + index++, device, true, 
-            device == midi.getDefaultMidiOutputName());
-    menu.addSubMenu ("MIDI Ouptut Device", sub);
+            midi.isMidiOutputEnabled (device));
+    menu.addSubMenu ("MIDI Output Devices", sub);
 
     if (auto* type = devices.getCurrentDeviceTypeObject())
     {
@@ -476,10 +476,8 @@ bool Settings::performMenuResult (Globals& world, const int result)
     {
         // MIDI Output device
         const auto device = MidiOutput::getDevices()[result - MidiOutputDevice];
-        if (device.isNotEmpty() && device == midi.getDefaultMidiOutputName())
-            midi.setDefaultMidiOutput ({});
-        else if (device.isNotEmpty())
-            midi.setDefaultMidiOutput (device);
+        if (device.isNotEmpty())
+            midi.setMidiOutputEnabled (device, ! midi.isMidiOutputEnabled (device));
     }
     else if (settingResultIsFor (result, AudioInputDevice))
     {
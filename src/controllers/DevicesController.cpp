@@ -170,6 +170,7 @@ void DevicesController::refresh()
     auto& midi (getWorld().getMidiEngine());
     auto session = getWorld().getSession();
     mapping.clear();
+    mapping.beginUpdate();
 
     for (int i = 0; i < session->getNumControllerDevices(); ++i)
         mapping.addInput (session->getControllerDevice (i), midi);
@@ -194,6 +195,7 @@ void DevicesController::refresh()
         }
     }
 
+    mapping.endUpdate();
     mapping.startMapping();
 }
 
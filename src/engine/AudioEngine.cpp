@@ -23,6 +23,7 @@
 #include "engine/MidiClock.h"
 #include "engine/MidiChannelMap.h"
 #include "engine/MidiEngine.h"
+#include "engine/MidiInputQueue.h"
 #include "engine/MidiTranspose.h"
 #include "engine/Transport.h"
 #include "Globals.h"
@@ -467,6 +468,7 @@ public:
                                 const int numSamples) override
     {
         jassert (sampleRate > 0 && blockSize > 0);
+        const double callbackTimeMs = Time::getMillisecondCounterHiRes();
         int totalNumChans = 0;
         ScopedNoDenormals denormals;
         if (numInputChannels > numOutputChannels)
@@ -512,37 +514,34 @@ public:
         AudioSampleBuffer buffer (channels, totalNumChans, numSamples);
         processCurrentGraph (buffer, incomingMidi);
 
+        auto& midiOut (engine.world.getMidiEngine().getMidiOutputScheduler());
+        if (midiOut.hasOutputs())
         {
-            ScopedLock lockMidiOut (engine.world.getMidiEngine().getMidiOutputLock());
-            if (auto* const midiOut = engine.world.getMidiEngine().getDefaultMidiOutput())
+           #if defined (EL_PRO)
+            if (sendMidiClockToInput.get() != 1 && generateMidiClock.get() == 1)
             {
-               #if defined (EL_PRO)
-                if (sendMidiClockToInput.get() != 1 && generateMidiClock.get() == 1)
+                if (wasPlaying != transport.isPlaying())
                 {
-                    if (wasPlaying != transport.isPlaying())
+                    if (transport.isPlaying())
                     {
-                        if (transport.isPlaying())
-                        {
-                            incomingMidi.addEvent (transport.getPositionFrames() <= 0 
-                                ? MidiMessage::midiStart() : MidiMessage::midiContinue(), 0);
-                        }
-                        else
-                        {
-                            incomingMidi.addEvent (MidiMessage::midiStop(), 0);
-                        }
+                        incomingMidi.addEvent (transport.getPositionFrames() <= 0 
+                            ? MidiMessage::midiStart() : MidiMessage::midiContinue(), 0);
+                    }
+                    else
+                    {
+                        incomingMidi.addEvent (MidiMessage::midiStop(), 0);
                     }
-
-                    midiClockMaster.setTempo (transport.getTempo());
-                    midiClockMaster.render (incomingMidi, numSamples);
                 }
-               #endif
 
-                const double delayMs = 6.0;
-                if (! incomingMidi.isEmpty())
-                {
-                    midiIOMonitor->sent();
-                    midiOut->sendBlockOfMessages (incomingMidi, delayMs + Time::getMillisecondCounterHiRes(), sampleRate);
-                }
+                midiClockMaster.setTempo (transport.getTempo());
+                midiClockMaster.render (incomingMidi, numSamples);
+            }
+           #endif
+
+            if (! incomingMidi.isEmpty())
+            {
+                midiIOMonitor->sent();
+                midiOut.schedule (incomingMidi, numSamples, callbackTimeMs);
             }
         }
         
@@ -552,7 +551,7 @@ public:
     void processCurrentGraph (AudioBuffer<float>& buffer, MidiBuffer& midi)
     {
         const int numSamples = buffer.getNumSamples();
-        messageCollector.removeNextBlockOfMessages (midi, numSamples);
+        inputQueue.removeNextBlockOfMessages (midi, numSamples);
         
         const ScopedLock sl (lock);
         const bool shouldProcess = shouldBeLocked.get() == 0;
@@ -613,6 +612,9 @@ public:
         const int newBlockSize     = device->getCurrentBufferSizeSamples();
         const int numChansIn       = device->getActiveInputChannels().countNumberOfSetBits();
         const int numChansOut      = device->getActiveOutputChannels().countNumberOfSetBits();
+        inputQueue.setLatencySamples (device->getInputLatencyInSamples());
+        engine.world.getMidiEngine().getMidiOutputScheduler().prepare (
+            newSampleRate, device->getOutputLatencyInSamples());
         audioAboutToStart (newSampleRate, newBlockSize, numChansIn, numChansOut);
     }
     
@@ -627,8 +629,9 @@ public:
         numOutputChans  = numChansOut;
         
         midiClock.reset (sampleRate, blockSize);
-        messageCollector.reset (sampleRate);
-        keyboardState.addListener (&messageCollector);
+        inputQueue.prepare (sampleRate, blockSize);
+        incomingMidi.ensureSize ((size_t) MidiInputQueue::capacity * 8);
+        keyboardState.addListener (&inputQueue);
         channels.calloc ((size_t) jmax (numChansIn, numChansOut) + 2);
         
         graphs.prepareBuffers (numInputChans, numOutputChans, blockSize);
@@ -651,7 +654,7 @@ public:
     void audioStopped()
     {
         const ScopedLock sl (lock);
-        keyboardState.removeListener (&messageCollector);
+        keyboardState.removeListener (&inputQueue);
         if (isPrepared)
             releaseResources();
         isPrepared  = false;
@@ -665,7 +668,7 @@ public:
     {
         if (! message.isActiveSense() && ! message.isMidiClock())
             midiIOMonitor->received();
-        messageCollector.addMessageToQueue (message);
+        inputQueue.addMessageToQueue (message);
         const bool clockWanted = processMidiClock.get() > 0 && sessionWantsExternalClock.get() > 0;
         if (clockWanted && message.isMidiClock())
         {
@@ -800,7 +803,7 @@ private:
     HeapBlock<float*> channels;
     AudioSampleBuffer tempBuffer;
     MidiBuffer incomingMidi;
-    MidiMessageCollector messageCollector;
+    MidiInputQueue inputQueue;
     MidiKeyboardState keyboardState;
 
     AudioSampleBuffer graphBuffer;
@@ -836,6 +839,7 @@ private:
     {
         midiClockMaster.setSampleRate (sampleRate);
         midiClockMaster.setTempo (transport.getTempo());
+        midiClockMaster.reset();
         for (int i = 0; i < graphs.size(); ++i)
             prepareGraph (graphs.getGraph(i), sampleRate, estimatedBlockSize);
     }
@@ -919,7 +923,7 @@ void AudioEngine::addMidiMessage (const MidiMessage msg, bool handleOnDeviceQueu
     if (handleOnDeviceQueue)
         priv->handleIncomingMidiMessage (nullptr, msg);
     else
-        priv->messageCollector.addMessageToQueue (msg);
+        priv->inputQueue.addMessageToQueue (msg);
 }
     
 void AudioEngine::setActiveGraph (const int index)
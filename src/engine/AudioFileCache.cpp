@@ -0,0 +1,234 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/AudioFileCache.h"
+
+namespace Element {
+
+/** Reads an entry's samples straight from memory */
+class AudioFileCache::Reader : public AudioFormatReader
+{
+public:
+    explicit Reader (Entry::Ptr e)
+        : AudioFormatReader (nullptr, "RAM"),
+          entry (e)
+    {
+        sampleRate              = entry->getSampleRate();
+        bitsPerSample           = 32;
+        lengthInSamples         = entry->getBuffer().getNumSamples();
+        numChannels             = (unsigned int) entry->getBuffer().getNumChannels();
+        usesFloatingPointData   = true;
+    }
+
+    bool readSamples (int** destSamples, int numDestChannels, int startOffsetInDestBuffer,
+                      int64 startSampleInFile, int numSamples) override
+    {
+        clearSamplesBeyondAvailableLength (destSamples, numDestChannels, startOffsetInDestBuffer,
+                                           startSampleInFile, numSamples, lengthInSamples);
+        if (numSamples <= 0)
+            return true;
+
+        const auto& buffer = entry->getBuffer();
+        for (int c = 0; c < numDestChannels; ++c)
+        {
+            auto* dest = reinterpret_cast<float*> (destSamples[c]);
+            if (dest == nullptr)
+                continue;
+
+            dest += startOffsetInDestBuffer;
+            if (c < buffer.getNumChannels())
+                FloatVectorOperations::copy (dest, buffer.getReadPointer (c, (int) startSampleInFile), numSamples);
+            else
+                FloatVectorOperations::clear (dest, numSamples);
+        }
+
+        return true;
+    }
+
+private:
+    Entry::Ptr entry;
+};
+
+//==============================================================================
+AudioFileCache::AudioFileCache (AudioFormatManager& f)
+    : formats (f)
+{
+    // a quarter of physical memory, up to 1 GB
+    const auto systemBytes = (size_t) jmax (0, SystemStats::getMemorySizeInMegabytes()) * 1024 * 1024;
+    budget = jmin ((size_t) 1024 * 1024 * 1024, systemBytes / 4);
+}
+
+AudioFileCache::~AudioFileCache()
+{
+    pool.removeAllJobs (true, 5000);
+    masterReference.clear();
+}
+
+AudioFileCache::Entry::Ptr AudioFileCache::find (const File& file)
+{
+    ScopedLock sl (lock);
+    for (int i = entries.size(); --i >= 0;)
+    {
+        auto* const entry = entries.getObjectPointerUnchecked (i);
+        if (entry->file != file)
+            continue;
+
+        // stale if the file was written since it was loaded
+        if (entry->modified != file.getLastModificationTime())
+        {
+            bytesUsed -= entry->getSizeInBytes();
+            entries.remove (i);
+            break;
+        }
+
+        entry->lastUsed = ++useCounter;
+        ++hits;
+        return entry;
+    }
+
+    ++misses;
+    return nullptr;
+}
+
+void AudioFileCache::preload (const File& file)
+{
+    {
+        ScopedLock sl (lock);
+        if (pending.contains (file.getFullPathName()))
+            return;
+        for (auto* entry : entries)
+            if (entry->file == file && entry->modified == file.getLastModificationTime())
+                return;
+        pending.add (file.getFullPathName());
+    }
+
+    WeakReference<AudioFileCache> ref (this);
+    pool.addJob ([this, ref, file]()
+    {
+        auto entry = decode (file);
+        if (entry != nullptr)
+            insert (entry);
+
+        {
+            ScopedLock sl (lock);
+            pending.removeString (file.getFullPathName());
+        }
+
+        if (entry == nullptr)
+            return;
+
+        MessageManager::callAsync ([ref, file]()
+        {
+            if (auto* cache = ref.get())
+                cache->listeners.call ([&file](Listener& l) { l.audioFilePreloaded (file); });
+        });
+    });
+}
+
+AudioFileCache::Entry::Ptr AudioFileCache::decode (const File& file)
+{
+    std::unique_ptr<AudioFormatReader> reader (formats.createReaderFor (file));
+    if (reader == nullptr || reader->lengthInSamples <= 0
+        || reader->lengthInSamples > (int64) std::numeric_limits<int>::max())
+        return nullptr;
+
+    const auto bytes = sizeof (float) * (size_t) reader->numChannels * (size_t) reader->lengthInSamples;
+    if (bytes > getMemoryBudget())
+        return nullptr;
+
+    Entry::Ptr entry = new Entry();
+    entry->file         = file;
+    entry->modified     = file.getLastModificationTime();
+    entry->sampleRate   = reader->sampleRate;
+    entry->buffer.setSize ((int) reader->numChannels, (int) reader->lengthInSamples);
+    if (! reader->read (&entry->buffer, 0, (int) reader->lengthInSamples, 0, true, true))
+        return nullptr;
+
+    return entry;
+}
+
+void AudioFileCache::insert (Entry::Ptr entry)
+{
+    ScopedLock sl (lock);
+    evict (entry->getSizeInBytes());
+    entry->lastUsed = ++useCounter;
+    entries.add (entry);
+    bytesUsed += entry->getSizeInBytes();
+}
+
+void AudioFileCache::evict (size_t bytesNeeded)
+{
+    while (bytesUsed + bytesNeeded > budget)
+    {
+        // least recently used entry nobody is playing
+        int oldest = -1;
+        for (int i = 0; i < entries.size(); ++i)
+        {
+            auto* const entry = entries.getObjectPointerUnchecked (i);
+            if (entry->getReferenceCount() > 1)
+                continue;
+            if (oldest < 0 || entry->lastUsed < entries.getObjectPointerUnchecked(oldest)->lastUsed)
+                oldest = i;
+        }
+
+        if (oldest < 0)
+            break;
+
+        bytesUsed -= entries.getObjectPointerUnchecked(oldest)->getSizeInBytes();
+        entries.remove (oldest);
+    }
+}
+
+AudioFormatReader* AudioFileCache::createReader (Entry::Ptr entry)
+{
+    return entry != nullptr ? new Reader (entry) : nullptr;
+}
+
+bool AudioFileCache::isPreloaded (const AudioFormatReader& reader)
+{
+    return dynamic_cast<const Reader*> (&reader) != nullptr;
+}
+
+void AudioFileCache::setMemoryBudget (size_t bytes)
+{
+    ScopedLock sl (lock);
+    budget = bytes;
+    evict (0);
+}
+
+size_t AudioFileCache::getMemoryBudget() const
+{
+    ScopedLock sl (lock);
+    return budget;
+}
+
+AudioFileCache::Stats AudioFileCache::getStats() const
+{
+    ScopedLock sl (lock);
+    Stats stats;
+    stats.hits          = hits;
+    stats.misses        = misses;
+    stats.numEntries    = entries.size();
+    stats.numPending    = pending.size();
+    stats.bytesUsed     = bytesUsed;
+    stats.budget        = budget;
+    return stats;
+}
+
+}
@@ -0,0 +1,123 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+
+namespace Element {
+
+/** Audio files decoded fully into RAM, shared by every player.
+
+    Files are decoded on a background pool and kept within a memory budget.
+    When a new file doesn't fit, the least recently used entries which no
+    player is holding are evicted. An entry in use is never freed: the
+    players holding it keep it alive even after it leaves the cache.
+ */
+class AudioFileCache
+{
+public:
+    class Entry : public ReferenceCountedObject
+    {
+    public:
+        using Ptr = ReferenceCountedObjectPtr<Entry>;
+
+        const File& getFile() const noexcept                    { return file; }
+        const AudioBuffer<float>& getBuffer() const noexcept    { return buffer; }
+        double getSampleRate() const noexcept                   { return sampleRate; }
+        size_t getSizeInBytes() const noexcept
+        {
+            return sizeof (float) * (size_t) buffer.getNumChannels() * (size_t) buffer.getNumSamples();
+        }
+
+    private:
+        friend class AudioFileCache;
+        File file;
+        Time modified;
+        AudioBuffer<float> buffer;
+        double sampleRate = 0.0;
+        uint32 lastUsed = 0;
+    };
+
+    struct Stats
+    {
+        int64 hits          = 0;
+        int64 misses        = 0;
+        int numEntries      = 0;
+        int numPending      = 0;
+        size_t bytesUsed    = 0;
+        size_t budget       = 0;
+    };
+
+    class Listener
+    {
+    public:
+        virtual ~Listener() { }
+
+        /** Called on the message thread when a file finished preloading */
+        virtual void audioFilePreloaded (const File& file) =0;
+    };
+
+    explicit AudioFileCache (AudioFormatManager& formats);
+    ~AudioFileCache();
+
+    /** Returns the cached entry for a file, or null if it isn't loaded or
+        changed on disk since. Counts as a hit or miss */
+    Entry::Ptr find (const File& file);
+
+    /** Starts decoding a file in the background if not cached or pending */
+    void preload (const File& file);
+
+    /** Creates a reader which plays an entry from memory. The reader holds
+        a reference to the entry. */
+    static AudioFormatReader* createReader (Entry::Ptr entry);
+
+    /** Returns true if a reader was created by createReader() */
+    static bool isPreloaded (const AudioFormatReader& reader);
+
+    void setMemoryBudget (size_t bytes);
+    size_t getMemoryBudget() const;
+
+    Stats getStats() const;
+
+    void addListener (Listener* listener)       { listeners.add (listener); }
+    void removeListener (Listener* listener)    { listeners.remove (listener); }
+
+private:
+    class Reader;
+    AudioFormatManager& formats;
+    mutable CriticalSection lock;
+    ReferenceCountedArray<Entry> entries;
+    StringArray pending;
+    size_t budget = 0;
+    size_t bytesUsed = 0;
+    uint32 useCounter = 0;
+    int64 hits = 0, misses = 0;
+    ThreadPool pool { 2 };
+    ListenerList<Listener> listeners;
+
+    Entry::Ptr decode (const File& file);
+    void insert (Entry::Ptr entry);
+    void evict (size_t bytesNeeded);
+
+    JUCE_DECLARE_WEAK_REFERENCEABLE (AudioFileCache)
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioFileCache)
+};
+
+}
@@ -0,0 +1,123 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/AudioFileStreamer.h"
+
+namespace Element {
+
+AudioFileStreamer::AudioFileStreamer()
+{
+    formats.registerBasicFormats();
+
+    const int numThreads = jlimit (1, 4, SystemStats::getNumCpus() / 2);
+    for (int i = 0; i < numThreads; ++i)
+    {
+        auto* thread = threads.add (new TimeSliceThread ("Element Disk I/O"));
+        thread->startThread (6);
+    }
+}
+
+AudioFileStreamer::~AudioFileStreamer()
+{
+    for (auto* thread : threads)
+        thread->stopThread (1000);
+    threads.clear();
+}
+
+AudioFormatReader* AudioFileStreamer::createReaderFor (const File& file)
+{
+    ScopedLock sl (lock);
+
+    for (int i = 0; i < formats.getNumKnownFormats(); ++i)
+    {
+        auto* format = formats.getKnownFormat (i);
+        if (! format->canHandleFile (file))
+            continue;
+
+        std::unique_ptr<MemoryMappedAudioFormatReader> mapped (format->createMemoryMappedReader (file));
+        if (mapped != nullptr && mapped->mapEntireFile())
+            return mapped.release();
+        break;
+    }
+
+    return formats.createReaderFor (file);
+}
+
+TimeSliceThread* AudioFileStreamer::getThread()
+{
+    ScopedLock sl (lock);
+    TimeSliceThread* best = nullptr;
+
+    // start after the last pick so equally loaded threads take turns
+    for (int i = 0; i < threads.size(); ++i)
+    {
+        auto* thread = threads.getUnchecked ((nextThread + i) % threads.size());
+        if (best == nullptr || thread->getNumClients() < best->getNumClients())
+            best = thread;
+    }
+
+    nextThread = (threads.indexOf (best) + 1) % jmax (1, threads.size());
+    return best;
+}
+
+int AudioFileStreamer::getReadAheadSamples (const AudioFormatReader& reader,
+                                            double playbackRate, int blockSize)
+{
+    if (playbackRate <= 0.0)
+        playbackRate = 44100.0;
+    if (blockSize <= 0)
+        blockSize = 512;
+
+    const bool mapped = isMemoryMapped (reader);
+    const double seconds = mapped ? 0.1 : 0.5;
+    const int minBlocks  = mapped ? 4 : 8;
+
+    // blocks are in device samples, the buffer is in file samples
+    const double ratio = reader.sampleRate > 0.0 ? reader.sampleRate / playbackRate : 1.0;
+    const auto samples = jmax (seconds * reader.sampleRate,
+                               (double) minBlocks * (double) blockSize * ratio);
+    return nextPowerOfTwo (roundToInt (samples));
+}
+
+void AudioFileStreamer::setSource (AudioTransportSource& transport, AudioFormatReaderSource* source,
+                                   double playbackRate, int blockSize)
+{
+    auto* reader = source != nullptr ? source->getAudioFormatReader() : nullptr;
+    if (reader == nullptr)
+    {
+        transport.setSource (nullptr);
+        return;
+    }
+
+    if (AudioFileCache::isPreloaded (*reader))
+    {
+        transport.setSource (source, 0, nullptr, reader->sampleRate, 2);
+        return;
+    }
+
+    transport.setSource (source, getReadAheadSamples (*reader, playbackRate, blockSize),
+                         getThread(), reader->sampleRate, 2);
+}
+
+bool AudioFileStreamer::isMemoryMapped (const AudioFormatReader& reader)
+{
+    return dynamic_cast<const MemoryMappedAudioFormatReader*> (&reader) != nullptr;
+}
+
+}
@@ -0,0 +1,83 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+#include "engine/AudioFileCache.h"
+
+namespace Element {
+
+/** Disk streaming shared by every file player.
+
+    Holds a small pool of I/O threads which players hand to their
+    AudioTransportSource instead of running a thread each, and creates
+    readers which map uncompressed files into memory. Players of the same
+    mapped file share its pages through the OS rather than each decoding
+    into a private buffer. Files can also be preloaded into RAM through the
+    cache so they play with no disk access at all.
+
+    Use it through a SharedResourcePointer so it lives as long as any player.
+ */
+class AudioFileStreamer
+{
+public:
+    AudioFileStreamer();
+    ~AudioFileStreamer();
+
+    /** Creates a reader for a file, memory mapped if the format supports it.
+        The caller owns the result, which is null if the file can't be read.
+        Call from the message thread.
+     */
+    AudioFormatReader* createReaderFor (const File& file);
+
+    /** Returns the least busy I/O thread */
+    TimeSliceThread* getThread();
+
+    /** Returns a read-ahead size in source samples for a reader played at
+        a rate and block size. Mapped readers only copy memory so they get a
+        short buffer. Decoded formats buffer more to ride out slow reads.
+     */
+    static int getReadAheadSamples (const AudioFormatReader& reader,
+                                    double playbackRate, int blockSize);
+
+    /** Returns true if the reader reads from a memory mapped file */
+    static bool isMemoryMapped (const AudioFormatReader& reader);
+
+    /** Sets a transport's source. Preloaded readers are read directly on the
+        audio thread, others are buffered on one of the I/O threads */
+    void setSource (AudioTransportSource& transport, AudioFormatReaderSource* source,
+                    double playbackRate, int blockSize);
+
+    /** Returns the RAM cache for preloaded files */
+    AudioFileCache& getCache() noexcept { return cache; }
+
+    int getNumThreads() const noexcept { return threads.size(); }
+
+private:
+    CriticalSection lock;
+    AudioFormatManager formats;
+    AudioFileCache cache { formats };
+    OwnedArray<TimeSliceThread> threads;
+    int nextThread = 0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioFileStreamer)
+};
+
+}
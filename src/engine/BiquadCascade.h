@@ -0,0 +1,287 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+#include "engine/nodes/EQFilterProcessor.h"
+
+namespace Element {
+
+/** A cascade of biquad sections run across channels in parallel.
+
+    Channels are processed four at a time, one lane each, so the compiler
+    can vectorize a section across lanes. New coefficients are reached by
+    interpolating linearly per sample, which keeps a section stable since
+    stable biquads form a convex set.
+    Sections left at unity are not processed at all.
+ */
+class BiquadCascade
+{
+public:
+    enum { maxSections = 12, numLanes = 4 };
+
+    struct Coefficients
+    {
+        float b0 = 1.f, b1 = 0.f, b2 = 0.f, a1 = 0.f, a2 = 0.f;
+
+        bool isUnity() const noexcept
+        {
+            return b0 == 1.f && b1 == 0.f && b2 == 0.f && a1 == 0.f && a2 == 0.f;
+        }
+
+        bool operator== (const Coefficients& o) const noexcept
+        {
+            return b0 == o.b0 && b1 == o.b1 && b2 == o.b2 && a1 == o.a1 && a2 == o.a2;
+        }
+
+        bool operator!= (const Coefficients& o) const noexcept { return ! operator== (o); }
+    };
+
+    /** Designs a section with the Audio EQ Cookbook. Shapes whose response
+        depends on gain come out as unity at 0 dB */
+    static Coefficients design (EQFilter::Shape shape, double sampleRate,
+                                float frequency, float q, float gainDB)
+    {
+        Coefficients c;
+        const bool usesGain = shape == EQFilter::Bell || shape == EQFilter::LowShelf || shape == EQFilter::HighShelf;
+        if (sampleRate <= 0.0 || (usesGain && gainDB == 0.f))
+            return c;
+
+        const double fc    = jlimit (10.0, sampleRate * 0.49, (double) frequency);
+        const double w     = MathConstants<double>::twoPi * fc / sampleRate;
+        const double cosw  = std::cos (w);
+        const double alpha = std::sin (w) / (2.0 * jmax (0.01, (double) q));
+        const double A     = std::pow (10.0, (double) gainDB / 40.0);
+        double b0, b1, b2, a0, a1, a2;
+
+        switch (shape)
+        {
+            case EQFilter::Bell:
+                b0 = 1.0 + alpha * A;   b1 = -2.0 * cosw;   b2 = 1.0 - alpha * A;
+                a0 = 1.0 + alpha / A;   a1 = -2.0 * cosw;   a2 = 1.0 - alpha / A;
+                break;
+
+            case EQFilter::Notch:
+                b0 = 1.0;               b1 = -2.0 * cosw;   b2 = 1.0;
+                a0 = 1.0 + alpha;       a1 = -2.0 * cosw;   a2 = 1.0 - alpha;
+                break;
+
+            case EQFilter::LowShelf:
+            {
+                const double beta = 2.0 * std::sqrt (A) * alpha;
+                b0 = A * ((A + 1.0) - (A - 1.0) * cosw + beta);
+                b1 = 2.0 * A * ((A - 1.0) - (A + 1.0) * cosw);
+                b2 = A * ((A + 1.0) - (A - 1.0) * cosw - beta);
+                a0 = (A + 1.0) + (A - 1.0) * cosw + beta;
+                a1 = -2.0 * ((A - 1.0) + (A + 1.0) * cosw);
+                a2 = (A + 1.0) + (A - 1.0) * cosw - beta;
+                break;
+            }
+
+            case EQFilter::HighShelf:
+            {
+                const double beta = 2.0 * std::sqrt (A) * alpha;
+                b0 = A * ((A + 1.0) + (A - 1.0) * cosw + beta);
+                b1 = -2.0 * A * ((A - 1.0) + (A + 1.0) * cosw);
+                b2 = A * ((A + 1.0) + (A - 1.0) * cosw - beta);
+                a0 = (A + 1.0) - (A - 1.0) * cosw + beta;
+                a1 = 2.0 * ((A - 1.0) - (A + 1.0) * cosw);
+                a2 = (A + 1.0) - (A - 1.0) * cosw - beta;
+                break;
+            }
+
+            case EQFilter::HighPass:
+                b0 = (1.0 + cosw) * 0.5;    b1 = -(1.0 + cosw);     b2 = b0;
+                a0 = 1.0 + alpha;           a1 = -2.0 * cosw;       a2 = 1.0 - alpha;
+                break;
+
+            case EQFilter::LowPass:
+            default:
+                b0 = (1.0 - cosw) * 0.5;    b1 = 1.0 - cosw;        b2 = b0;
+                a0 = 1.0 + alpha;           a1 = -2.0 * cosw;       a2 = 1.0 - alpha;
+                break;
+        }
+
+        c.b0 = (float) (b0 / a0);   c.b1 = (float) (b1 / a0);   c.b2 = (float) (b2 / a0);
+        c.a1 = (float) (a1 / a0);   c.a2 = (float) (a2 / a0);
+        return c;
+    }
+
+    /** Sizes state for a channel count and sets the coefficient ramp length.
+        This allocates */
+    void prepare (int newNumChannels, int newRampLength)
+    {
+        numChannels = jmax (1, newNumChannels);
+        rampLength  = jmax (1, newRampLength);
+        numGroups   = (numChannels + numLanes - 1) / numLanes;
+        states.allocate ((size_t) (numGroups * maxSections * 2 * numLanes), true);
+        reset();
+    }
+
+    /** Jumps every section to its target and clears the filter state */
+    void reset() noexcept
+    {
+        for (auto& s : sections)
+        {
+            s.current = s.target;
+            s.rampLeft = 0;
+        }
+
+        if (states != nullptr)
+            zeromem (states.getData(), sizeof (float) * (size_t) (numGroups * maxSections * 2 * numLanes));
+    }
+
+    /** Sets where a section should ramp to. Call from the audio thread
+        before process() */
+    void setTarget (int index, const Coefficients& target) noexcept
+    {
+        jassert (isPositiveAndBelow (index, (int) maxSections));
+        auto& s = sections [index];
+        if (s.target == target)
+            return;
+
+        if (s.current.isUnity() && s.rampLeft == 0)
+            clearState (index); // was skipped, start it clean
+
+        s.target = target;
+        s.rampLeft = rampLength;
+        const float scale = 1.f / (float) rampLength;
+        s.step.b0 = (target.b0 - s.current.b0) * scale;
+        s.step.b1 = (target.b1 - s.current.b1) * scale;
+        s.step.b2 = (target.b2 - s.current.b2) * scale;
+        s.step.a1 = (target.a1 - s.current.a1) * scale;
+        s.step.a2 = (target.a2 - s.current.a2) * scale;
+    }
+
+    /** Returns true if a section does any work */
+    bool isActive (int index) const noexcept
+    {
+        const auto& s = sections [index];
+        return s.rampLeft > 0 || ! s.current.isUnity();
+    }
+
+    /** Filters channels in place */
+    void process (float* const* channels, int numChannelsToProcess, int numSamples) noexcept
+    {
+        int active [maxSections];
+        int numActive = 0;
+        for (int i = 0; i < maxSections; ++i)
+            if (isActive (i))
+                active [numActive++] = i;
+
+        if (numActive == 0 || numSamples <= 0)
+            return;
+
+        const int numChans = jmin (numChannels, numChannelsToProcess);
+        for (int group = 0; group < numGroups && group * numLanes < numChans; ++group)
+        {
+            float* lanes [numLanes] = { };
+            for (int l = 0; l < numLanes && group * numLanes + l < numChans; ++l)
+                lanes[l] = channels [group * numLanes + l];
+            processGroup (lanes, states + group * maxSections * 2 * numLanes, active, numActive, numSamples);
+        }
+
+        // advance ramps once for all groups
+        for (int a = 0; a < numActive; ++a)
+        {
+            auto& s = sections [active [a]];
+            if (s.rampLeft <= 0)
+                continue;
+
+            if (s.rampLeft <= numSamples)
+            {
+                s.current = s.target;
+                s.rampLeft = 0;
+            }
+            else
+            {
+                s.current = at (s, numSamples - 1);
+                s.rampLeft -= numSamples;
+            }
+        }
+    }
+
+private:
+    struct Section
+    {
+        Coefficients current, target, step;
+        int rampLeft = 0;
+    };
+
+    Section sections [maxSections];
+    HeapBlock<float> states;    // z1 then z2 lanes, per group and section
+    int numChannels = 0;
+    int numGroups = 0;
+    int rampLength = 64;
+
+    void clearState (int index) noexcept
+    {
+        for (int group = 0; group < numGroups; ++group)
+            zeromem (states + (group * maxSections + index) * 2 * numLanes, sizeof (float) * 2 * numLanes);
+    }
+
+    /** Coefficients 'sample' samples into a ramp */
+    static inline Coefficients at (const Section& s, int sample) noexcept
+    {
+        if (sample >= s.rampLeft - 1)
+            return s.target;
+        const float t = (float) (sample + 1);
+        Coefficients c;
+        c.b0 = s.current.b0 + s.step.b0 * t;
+        c.b1 = s.current.b1 + s.step.b1 * t;
+        c.b2 = s.current.b2 + s.step.b2 * t;
+        c.a1 = s.current.a1 + s.step.a1 * t;
+        c.a2 = s.current.a2 + s.step.a2 * t;
+        return c;
+    }
+
+    void processGroup (float* const* lanes, float* state, const int* active, int numActive, int numSamples) const noexcept
+    {
+        for (int i = 0; i < numSamples; ++i)
+        {
+            float x [numLanes];
+            for (int l = 0; l < numLanes; ++l)
+                x[l] = lanes[l] != nullptr ? lanes[l][i] : 0.f;
+
+            for (int a = 0; a < numActive; ++a)
+            {
+                const auto& s = sections [active[a]];
+                const auto c = s.rampLeft > 0 ? at (s, i) : s.current;
+                float* const z1 = state + active[a] * 2 * numLanes;
+                float* const z2 = z1 + numLanes;
+
+                // transposed direct form II on every lane
+                for (int l = 0; l < numLanes; ++l)
+                {
+                    const float y = c.b0 * x[l] + z1[l];
+                    z1[l] = c.b1 * x[l] - c.a1 * y + z2[l];
+                    z2[l] = c.b2 * x[l] - c.a2 * y;
+                    x[l] = y;
+                }
+            }
+
+            for (int l = 0; l < numLanes; ++l)
+                if (lanes[l] != nullptr)
+                    lanes[l][i] = x[l];
+        }
+    }
+};
+
+}
@@ -0,0 +1,301 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace Element {
+
+/** A controller value decoded from one or more MIDI 1.0 messages. Values are
+    32 bit regardless of the source resolution, scaled the way MIDI 2.0
+    translates 7 and 14 bit data so that 0, center and max are preserved.
+ */
+struct ControllerEvent
+{
+    enum Type
+    {
+        Controller = 0,     // plain 7 bit CC
+        Controller14Bit,    // CC 0-31 paired with LSB CC 32-63
+        NRPN,
+        RPN,
+        numTypes
+    };
+
+    Type type       = Controller;
+    int channel     = 1;
+    int number      = 0;
+    uint32 value    = 0;
+
+    /** Returns the value normalized 0 to 1 */
+    float getNormalizedValue() const noexcept { return (float) ((double) value / 4294967295.0); }
+
+    /** Returns the value truncated to 7 bits */
+    int get7BitValue() const noexcept { return (int) (value >> 25); }
+
+    /** Scales a 7 or 14 bit value to 32 bits (MIDI 2.0 min-center-max) */
+    static uint32 scaleTo32Bit (uint32 value, int sourceBits) noexcept
+    {
+        jassert (sourceBits > 1 && sourceBits < 32);
+        const int scaleBits = 32 - sourceBits;
+        uint32 shifted = value << scaleBits;
+        const uint32 center = 1u << (sourceBits - 1);
+        if (value <= center)
+            return shifted;
+
+        const int repeatBits = sourceBits - 1;
+        uint32 repeat = value & ((1u << repeatBits) - 1u);
+        repeat = scaleBits > repeatBits ? repeat << (scaleBits - repeatBits)
+                                        : repeat >> (repeatBits - scaleBits);
+        while (repeat != 0)
+        {
+            shifted |= repeat;
+            repeat >>= repeatBits;
+        }
+
+        return shifted;
+    }
+};
+
+/** Turns a stream of MIDI 1.0 controller messages into ControllerEvents.
+
+    Every CC produces a plain Controller event. In addition:
+    - CCs 0-31 (MSB) and 32-63 (LSB) produce a Controller14Bit event for the
+      MSB number. An MSB is held until its LSB arrives so the pair produces
+      one event. If no LSB follows within lsbTimeoutMs the MSB is emitted on
+      its own with an LSB of zero, either by the next process() or flush().
+    - Data entry (6/38) and increment/decrement (96/97) produce NRPN or RPN
+      events for the parameter selected with CCs 98-101. RPN null (127/127)
+      deselects. A data entry MSB is held for its LSB the same way.
+
+    State is kept per channel in fixed size tables so process() never
+    allocates. Use one parser per input thread, calls to flush() from another
+    thread need to be serialized with process().
+ */
+class ControllerEventParser
+{
+public:
+    /** How long a 14 bit or data entry MSB waits for its LSB */
+    enum { lsbTimeoutMs = 10 };
+
+    ControllerEventParser()     { reset(); }
+
+    /** Clears all running status */
+    void reset()
+    {
+        for (auto& state : channels)
+        {
+            zerostruct (state.msb);
+            state.parameterMsb = state.parameterLsb = 127;
+            state.selected = None;
+            state.data = 0;
+            state.heldMsbs = 0;
+            state.dataHeld = false;
+        }
+
+        numHeld = 0;
+    }
+
+    /** Parses a message, calling the callback for every event it produces.
+        @returns true if the message was a controller
+     */
+    template<class Callback>
+    bool process (const MidiMessage& message, Callback&& callback)
+    {
+        return process (message, Time::getMillisecondCounterHiRes(), callback);
+    }
+
+    /** Parses a message received at nowMs, calling the callback for every
+        event it produces. Held MSBs which timed out are emitted first.
+        @returns true if the message was a controller
+     */
+    template<class Callback>
+    bool process (const MidiMessage& message, double nowMs, Callback&& callback)
+    {
+        flush (nowMs, callback);
+
+        if (! message.isController())
+            return false;
+
+        const int channel = message.getChannel();
+        const int number  = message.getControllerNumber();
+        const int value   = message.getControllerValue();
+        auto& state = channels [channel - 1];
+
+        emit (callback, ControllerEvent::Controller, channel, number,
+              ControllerEvent::scaleTo32Bit ((uint32) value, 7));
+
+        // a held data entry MSB belongs to the parameter selected before
+        if (state.dataHeld && number >= 98 && number <= 101)
+            releaseData (state, channel, callback);
+
+        switch (number)
+        {
+            case 99: state.selected = NRPN; state.parameterMsb = value; return true;
+            case 98: state.selected = NRPN; state.parameterLsb = value; return true;
+            case 101: state.selected = RPN; state.parameterMsb = value; return true;
+            case 100: state.selected = RPN; state.parameterLsb = value; return true;
+            default: break;
+        }
+
+        if (state.selected != None && (number == 6 || number == 38 || number == 96 || number == 97))
+        {
+            if (state.selected == RPN && state.parameterMsb == 127 && state.parameterLsb == 127)
+                return true;
+
+            if (number == 6)
+            {
+                if (state.dataHeld)
+                    releaseData (state, channel, callback);
+
+                state.data = value << 7;
+                state.dataTime = nowMs;
+                state.dataHeld = true;
+                ++numHeld;
+                return true;
+            }
+
+            if (state.dataHeld)
+            {
+                state.dataHeld = false;
+                --numHeld;
+            }
+
+            if (number == 38)
+                state.data = (state.data & 0x3f80) | value;
+            else if (number == 96)
+                state.data = jmin (16383, state.data + 1);
+            else
+                state.data = jmax (0, state.data - 1);
+
+            emitData (state, channel, callback);
+            return true;
+        }
+
+        if (number < 32)
+        {
+            // a second MSB means the first one isn't getting an LSB
+            if (isHeld (state, number))
+                release (state, channel, number, callback);
+
+            state.msb [number] = (uint8) value;
+            state.msbTime [number] = nowMs;
+            state.heldMsbs |= (1u << number);
+            ++numHeld;
+        }
+        else if (number < 64)
+        {
+            const int msbNumber = number - 32;
+            if (isHeld (state, msbNumber))
+            {
+                state.heldMsbs &= ~(1u << msbNumber);
+                --numHeld;
+            }
+
+            emit (callback, ControllerEvent::Controller14Bit, channel, msbNumber,
+                  ControllerEvent::scaleTo32Bit ((uint32) ((state.msb [msbNumber] << 7) | value), 14));
+        }
+
+        return true;
+    }
+
+    /** Emits held MSBs which have waited lsbTimeoutMs or longer by nowMs */
+    template<class Callback>
+    void flush (double nowMs, Callback&& callback)
+    {
+        if (numHeld <= 0)
+            return;
+
+        for (int channel = 1; channel <= 16; ++channel)
+        {
+            auto& state = channels [channel - 1];
+            if (state.dataHeld && nowMs - state.dataTime >= (double) lsbTimeoutMs)
+                releaseData (state, channel, callback);
+            for (int number = 0; state.heldMsbs != 0 && number < 32; ++number)
+                if (isHeld (state, number) && nowMs - state.msbTime [number] >= (double) lsbTimeoutMs)
+                    release (state, channel, number, callback);
+        }
+    }
+
+    /** Returns true if an MSB is waiting for its LSB */
+    bool hasHeldControllers() const noexcept { return numHeld > 0; }
+
+private:
+    enum Selected { None, NRPN, RPN };
+
+    struct ChannelState
+    {
+        uint8 msb [32];
+        int parameterMsb, parameterLsb;
+        Selected selected;
+        int data;
+        uint32 heldMsbs;
+        double msbTime [32];
+        bool dataHeld;
+        double dataTime;
+    };
+
+    ChannelState channels [16];
+    int numHeld = 0;
+
+    static bool isHeld (const ChannelState& state, int number) noexcept
+    {
+        return (state.heldMsbs & (1u << number)) != 0;
+    }
+
+    template<class Callback>
+    void release (ChannelState& state, int channel, int number, Callback& callback)
+    {
+        state.heldMsbs &= ~(1u << number);
+        --numHeld;
+        emit (callback, ControllerEvent::Controller14Bit, channel, number,
+              ControllerEvent::scaleTo32Bit ((uint32) (state.msb [number] << 7), 14));
+    }
+
+    template<class Callback>
+    void releaseData (ChannelState& state, int channel, Callback& callback)
+    {
+        state.dataHeld = false;
+        --numHeld;
+        emitData (state, channel, callback);
+    }
+
+    template<class Callback>
+    static void emitData (const ChannelState& state, int channel, Callback& callback)
+    {
+        emit (callback, state.selected == NRPN ? ControllerEvent::NRPN : ControllerEvent::RPN,
+              channel, (state.parameterMsb << 7) | state.parameterLsb,
+              ControllerEvent::scaleTo32Bit ((uint32) state.data, 14));
+    }
+
+    template<class Callback>
+    static void emit (Callback& callback, ControllerEvent::Type type, int channel, int number, uint32 value)
+    {
+        ControllerEvent event;
+        event.type      = type;
+        event.channel   = channel;
+        event.number    = number;
+        event.value     = value;
+        callback (event);
+    }
+
+    JUCE_DECLARE_NON_COPYABLE (ControllerEventParser)
+};
+
+}
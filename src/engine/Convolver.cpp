@@ -0,0 +1,330 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/Convolver.h"
+
+namespace Element {
+
+static int fftOrderFor (int blockSize)
+{
+    // partitions are zero padded to twice their length
+    int order = 0;
+    while ((1 << order) < 2 * blockSize)
+        ++order;
+    return order;
+}
+
+/** acc += a * b over interleaved complex bins */
+static inline void multiplyAdd (float* __restrict acc, const float* __restrict a,
+                                const float* __restrict b, int numBins) noexcept
+{
+    for (int k = 0; k < numBins; ++k)
+    {
+        const float re = a[2 * k] * b[2 * k]     - a[2 * k + 1] * b[2 * k + 1];
+        const float im = a[2 * k] * b[2 * k + 1] + a[2 * k + 1] * b[2 * k];
+        acc[2 * k]     += re;
+        acc[2 * k + 1] += im;
+    }
+}
+
+static void partition (ConvolutionKernel::Partitions& parts, const float* impulse,
+                       int length, int blockSize)
+{
+    dsp::FFT fft (fftOrderFor (blockSize));
+    const int numBins = blockSize + 1;
+    HeapBlock<float> work ((size_t) (4 * blockSize));
+
+    parts.numPartitions = (length + blockSize - 1) / blockSize;
+    parts.spectra.allocate ((size_t) (parts.numPartitions * 2 * numBins), true);
+
+    for (int p = 0; p < parts.numPartitions; ++p)
+    {
+        const int count = jmin (blockSize, length - p * blockSize);
+        FloatVectorOperations::clear (work, 4 * blockSize);
+        FloatVectorOperations::copy (work, impulse + p * blockSize, count);
+        fft.performRealOnlyForwardTransform (work, true);
+        FloatVectorOperations::copy (parts.spectra + p * 2 * numBins, work, 2 * numBins);
+    }
+}
+
+ConvolutionKernel::Ptr ConvolutionKernel::create (const AudioBuffer<float>& impulse, double sampleRate)
+{
+    if (impulse.getNumChannels() <= 0 || impulse.getNumSamples() <= 0)
+        return nullptr;
+
+    Ptr kernel (new ConvolutionKernel());
+    kernel->length = impulse.getNumSamples();
+    kernel->sampleRate = sampleRate;
+
+    const int headSamples = jmin ((int) headLength, kernel->length);
+    for (int c = 0; c < impulse.getNumChannels(); ++c)
+    {
+        auto* channel = kernel->channels.add (new Channel());
+        partition (channel->head, impulse.getReadPointer (c), headSamples, headBlockSize);
+        if (kernel->length > headLength)
+            partition (channel->tail, impulse.getReadPointer (c, headLength),
+                       kernel->length - headLength, tailBlockSize);
+    }
+
+    return kernel;
+}
+
+size_t ConvolutionKernel::getSizeInBytes() const noexcept
+{
+    size_t size = 0;
+    for (auto* channel : channels)
+        size += sizeof (float) * 2 * (size_t) (channel->head.numPartitions * (headBlockSize + 1)
+                                             + channel->tail.numPartitions * (tailBlockSize + 1));
+    return size;
+}
+
+//==============================================================================
+Convolver::Stage::Stage (const ConvolutionKernel::Partitions& p, int size)
+    : parts (p), blockSize (size), numBins (size + 1),
+      fft (fftOrderFor (size))
+{
+    segments.allocate ((size_t) (parts.numPartitions * 2 * numBins), true);
+    accumulated.allocate ((size_t) (2 * numBins), true);
+    work.allocate ((size_t) (4 * blockSize), true);
+    overlap.allocate ((size_t) blockSize, true);
+    input.allocate ((size_t) blockSize, true);
+}
+
+void Convolver::Stage::reset() noexcept
+{
+    zeromem (segments, sizeof (float) * (size_t) (parts.numPartitions * 2 * numBins));
+    zeromem (accumulated, sizeof (float) * (size_t) (2 * numBins));
+    zeromem (overlap, sizeof (float) * (size_t) blockSize);
+    zeromem (input, sizeof (float) * (size_t) blockSize);
+    current = inputFill = 0;
+}
+
+void Convolver::Stage::process (const float* in, float* out, int numSamples) noexcept
+{
+    for (int done = 0; done < numSamples;)
+    {
+        const int count = jmin (numSamples - done, blockSize - inputFill);
+        processPartial (in + done, out + done, count);
+        done += count;
+    }
+}
+
+void Convolver::Stage::processPartial (const float* in, float* out, int numSamples) noexcept
+{
+    const int numParts = parts.numPartitions;
+    const int position = inputFill;
+    FloatVectorOperations::copy (input + inputFill, in, numSamples);
+    inputFill += numSamples;
+
+    // spectrum of the block so far, newest in the ring
+    float* const segment = segments + current * 2 * numBins;
+    FloatVectorOperations::copy (work, input, blockSize);
+    FloatVectorOperations::clear (work + blockSize, 3 * blockSize);
+    fft.performRealOnlyForwardTransform (work, true);
+    FloatVectorOperations::copy (segment, work, 2 * numBins);
+
+    // older blocks only change when a new block starts
+    if (position == 0)
+    {
+        FloatVectorOperations::clear (accumulated, 2 * numBins);
+        for (int i = 1; i < numParts; ++i)
+            multiplyAdd (accumulated, segments + ((current + i) % numParts) * 2 * numBins,
+                         parts.spectra + i * 2 * numBins, numBins);
+    }
+
+    FloatVectorOperations::copy (work, accumulated, 2 * numBins);
+    multiplyAdd (work, segment, parts.spectra, numBins);
+    fft.performRealOnlyInverseTransform (work);
+
+    FloatVectorOperations::add (out, work + position, numSamples);
+    FloatVectorOperations::add (out, overlap + position, numSamples);
+
+    if (inputFill == blockSize)
+    {
+        FloatVectorOperations::copy (overlap, work + blockSize, blockSize);
+        FloatVectorOperations::clear (input, blockSize);
+        inputFill = 0;
+        current = current > 0 ? current - 1 : numParts - 1;
+    }
+}
+
+//==============================================================================
+Convolver::Convolver (ConvolutionKernel::Ptr k, int channel)
+    : kernel (k)
+{
+    jassert (kernel != nullptr);
+    const auto& parts = kernel->getChannel (channel);
+    head.reset (new Stage (parts.head, ConvolutionKernel::headBlockSize));
+
+    if (parts.tail.numPartitions > 0)
+    {
+        tail.reset (new Stage (parts.tail, ConvolutionKernel::tailBlockSize));
+        for (auto* block : { &tailInput, &tailOutput, &jobInput, &jobOutput })
+            block->allocate ((size_t) ConvolutionKernel::tailBlockSize, true);
+    }
+}
+
+Convolver::~Convolver()
+{
+    // remove from the worker first
+    jassert (worker == nullptr);
+}
+
+void Convolver::reset() noexcept
+{
+    head->reset();
+    if (tail == nullptr)
+        return;
+
+    tail->reset();
+    for (auto* block : { &tailInput, &tailOutput, &jobInput, &jobOutput })
+        zeromem (block->getData(), sizeof (float) * (size_t) ConvolutionKernel::tailBlockSize);
+    tailPosition = 0;
+    restartTail = resetTail = false;
+    tailState.set (Idle);
+}
+
+void Convolver::process (const float* input, float* output, int numSamples) noexcept
+{
+    if (tail == nullptr)
+    {
+        head->process (input, output, numSamples);
+        return;
+    }
+
+    for (int done = 0; done < numSamples;)
+    {
+        const int count = jmin (numSamples - done, ConvolutionKernel::tailBlockSize - tailPosition);
+        head->process (input + done, output + done, count);
+        FloatVectorOperations::copy (tailInput + tailPosition, input + done, count);
+        FloatVectorOperations::add (output + done, tailOutput + tailPosition, count);
+
+        done += count;
+        tailPosition += count;
+        if (tailPosition == ConvolutionKernel::tailBlockSize)
+        {
+            tailPosition = 0;
+            swapTail();
+        }
+    }
+}
+
+void Convolver::swapTail() noexcept
+{
+    const int numSamples = ConvolutionKernel::tailBlockSize;
+
+    // with no worker, as when rendering offline, the tail runs here. A whole
+    // tail is too much for one callback though, so with a worker one it
+    // never started is skipped like one it's still running
+    bool late = false;
+    if (worker == nullptr)
+        runPendingTail();
+    else
+        late = tailState.compareAndSetBool (Idle, Pending);
+
+    if (late || tailState.get() == Busy)
+    {
+        // can't wait, skip this block and start the tail over once free
+        overruns.set (overruns.get() + 1);
+        restartTail = true;
+        FloatVectorOperations::clear (tailOutput, numSamples);
+        if (! late)
+            return;
+    }
+
+    if (restartTail)
+    {
+        // the history is cleared by whoever runs the next tail
+        resetTail = true;
+        restartTail = false;
+        FloatVectorOperations::clear (tailOutput, numSamples);
+    }
+    else if (tailState.get() == Done)
+    {
+        FloatVectorOperations::copy (tailOutput, jobOutput, numSamples);
+    }
+
+    tailInput.swapWith (jobInput);
+    tailState.set (Pending);
+    if (worker != nullptr)
+        worker->wake();
+}
+
+bool Convolver::runPendingTail() noexcept
+{
+    if (! tailState.compareAndSetBool (Busy, Pending))
+        return false;
+
+    if (resetTail)
+    {
+        tail->reset();
+        resetTail = false;
+    }
+
+    FloatVectorOperations::clear (jobOutput, ConvolutionKernel::tailBlockSize);
+    tail->process (jobInput, jobOutput, ConvolutionKernel::tailBlockSize);
+    tailState.set (Done);
+    return true;
+}
+
+//==============================================================================
+ConvolutionWorker::ConvolutionWorker()
+    : Thread ("Convolution")
+{
+    startThread (7);
+}
+
+ConvolutionWorker::~ConvolutionWorker()
+{
+    signalThreadShouldExit();
+    wakeup.signal();
+    stopThread (5000);
+}
+
+void ConvolutionWorker::add (Convolver* convolver)
+{
+    if (! convolver->hasTail())
+        return;
+    ScopedLock sl (lock);
+    convolver->worker = this;
+    convolvers.addIfNotAlreadyThere (convolver);
+}
+
+void ConvolutionWorker::remove (Convolver* convolver)
+{
+    // waits for a tail in progress
+    ScopedLock sl (lock);
+    convolvers.removeFirstMatchingValue (convolver);
+    convolver->worker = nullptr;
+}
+
+void ConvolutionWorker::run()
+{
+    while (! threadShouldExit())
+    {
+        if (! wakeup.wait())
+            continue;
+
+        ScopedLock sl (lock);
+        for (auto* convolver : convolvers)
+            convolver->runPendingTail();
+    }
+}
+
+}
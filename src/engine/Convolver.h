@@ -0,0 +1,171 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+#include "engine/WorkerWakeup.h"
+
+namespace Element {
+
+class ConvolutionWorker;
+
+/** An impulse response split into FFT partitions for the Convolver.
+
+    The first headLength samples are cut into small partitions which are
+    convolved on the audio thread. The rest is cut into large partitions
+    for the background tail. Kernels are immutable once made, so every
+    node using the same impulse response shares one.
+ */
+class ConvolutionKernel : public ReferenceCountedObject
+{
+public:
+    using Ptr = ReferenceCountedObjectPtr<ConvolutionKernel>;
+
+    enum
+    {
+        headBlockSize   = 64,
+        tailBlockSize   = 1024,
+        headLength      = 2 * tailBlockSize  // leaves the tail a block to finish in
+    };
+
+    /** Partitions an impulse response. This allocates and runs FFTs, so
+        don't call it on the audio thread */
+    static Ptr create (const AudioBuffer<float>& impulse, double sampleRate);
+
+    int getNumChannels() const noexcept         { return channels.size(); }
+    int getLength() const noexcept              { return length; }
+    double getSampleRate() const noexcept       { return sampleRate; }
+    size_t getSizeInBytes() const noexcept;
+
+    struct Partitions
+    {
+        HeapBlock<float> spectra;   // interleaved complex, numBins per partition
+        int numPartitions = 0;
+    };
+
+    struct Channel
+    {
+        Partitions head, tail;
+    };
+
+    const Channel& getChannel (int index) const noexcept { return *channels.getUnchecked (index % channels.size()); }
+
+private:
+    ConvolutionKernel() = default;
+    OwnedArray<Channel> channels;
+    int length = 0;
+    double sampleRate = 0.0;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ConvolutionKernel)
+};
+
+//==============================================================================
+/** Convolves one channel with a kernel channel, with no added latency.
+
+    The head of the kernel runs as a uniformly partitioned overlap-add on
+    the audio thread. Every tailBlockSize samples a block of input is handed
+    to the ConvolutionWorker, which convolves it with the tail while the
+    head covers the samples it needs. A tail which isn't finished by the
+    time it is due is dropped and counted as an overrun, and the tail
+    starts over. Without a worker the tail runs inline.
+ */
+class Convolver
+{
+public:
+    Convolver (ConvolutionKernel::Ptr kernel, int channel);
+    ~Convolver();
+
+    /** Adds the convolution of input to output. Realtime safe */
+    void process (const float* input, float* output, int numSamples) noexcept;
+
+    /** Clears all state. Not safe while a worker is running the tail */
+    void reset() noexcept;
+
+    bool hasTail() const noexcept                   { return tail != nullptr; }
+    int getNumOverruns() const noexcept             { return overruns.get(); }
+
+private:
+    friend class ConvolutionWorker;
+
+    /** Uniformly partitioned overlap-add */
+    class Stage
+    {
+    public:
+        Stage (const ConvolutionKernel::Partitions& parts, int blockSize);
+
+        /** Adds the convolution of input to output without latency. Partial
+            blocks are transformed as they are, so a full block costs the
+            least */
+        void process (const float* input, float* output, int numSamples) noexcept;
+
+        void reset() noexcept;
+
+    private:
+        const ConvolutionKernel::Partitions& parts;
+        const int blockSize, numBins;
+        dsp::FFT fft;
+        HeapBlock<float> segments, accumulated, work, overlap, input;
+        int current = 0, inputFill = 0;
+
+        void processPartial (const float* input, float* output, int numSamples) noexcept;
+    };
+
+    enum TailState { Idle = 0, Pending, Busy, Done };
+
+    ConvolutionKernel::Ptr kernel;
+    std::unique_ptr<Stage> head, tail;
+    HeapBlock<float> tailInput, tailOutput, jobInput, jobOutput;
+    int tailPosition = 0;
+    bool restartTail = false;
+    bool resetTail = false;     // owned by whoever runs the next tail
+    Atomic<int> tailState { Idle };
+    Atomic<int> overruns;
+    ConvolutionWorker* worker = nullptr;
+
+    void swapTail() noexcept;
+    bool runPendingTail() noexcept;
+};
+
+//==============================================================================
+/** Runs convolver tails in the background. Shared by every convolution
+    node through a SharedResourcePointer */
+class ConvolutionWorker : private Thread
+{
+public:
+    ConvolutionWorker();
+    ~ConvolutionWorker();
+
+    /** Starts running a convolver's tail. Call before it processes */
+    void add (Convolver* convolver);
+
+    /** Stops running a convolver's tail, waiting if it is in progress */
+    void remove (Convolver* convolver);
+
+    /** Tells the worker a tail is pending. Call from the audio thread */
+    void wake() noexcept            { wakeup.wake(); }
+
+private:
+    CriticalSection lock;
+    WorkerWakeup wakeup;
+    Array<Convolver*> convolvers;
+    void run() override;
+};
+
+}
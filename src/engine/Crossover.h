@@ -0,0 +1,245 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+
+namespace Element {
+
+/** Splits audio into bands with fourth order Linkwitz-Riley crossovers.
+
+    Each crossover is a pair of cascaded Butterworth low and high passes.
+    Bands below a crossover get that crossover's all-pass too, so summing
+    every band gives back the input with only phase shifted. Coefficients
+    are computed when a frequency or the rate changes, not per block.
+
+    Channels are filtered four at a time. Each group is copied in chunks of
+    chunkSize frames into a buffer with the four lanes of a frame adjacent,
+    every section runs over the chunk in place, then the bands are copied
+    back out to their channels.
+ */
+class Crossover
+{
+public:
+    enum { maxBands = 8, numLanes = 4, chunkSize = 64 };
+
+    Crossover() = default;
+
+    /** Sizes filter state for a channel and band count. This allocates */
+    void setup (int newNumChannels, int newNumBands)
+    {
+        numChannels = jmax (1, newNumChannels);
+        numBands = jlimit (2, (int) maxBands, newNumBands);
+        numGroups = (numChannels + numLanes - 1) / numLanes;
+        // low pass and high pass twice per crossover, all-passes for lower bands
+        states.allocate ((size_t) (numGroups * numStatesPerGroup()), true);
+        for (int i = 0; i < numBands - 1; ++i)
+            if (frequencies[i] <= 0.f)
+                frequencies[i] = 100.f * std::pow (100.f, (float) (i + 1) / (float) numBands);
+        updateCoefficients();
+    }
+
+    void setSampleRate (double newSampleRate)
+    {
+        if (newSampleRate > 0.0 && newSampleRate != sampleRate)
+        {
+            sampleRate = newSampleRate;
+            updateCoefficients();
+        }
+    }
+
+    /** Sets a crossover frequency, index 0 being between the lowest bands */
+    void setFrequency (int index, float hz)
+    {
+        if (isPositiveAndBelow (index, numBands - 1) && frequencies[index] != hz)
+        {
+            frequencies[index] = hz;
+            updateCoefficients();
+        }
+    }
+
+    float getFrequency (int index) const noexcept   { return frequencies [jlimit (0, maxBands - 2, index)]; }
+    int getNumBands() const noexcept                { return numBands; }
+    int getNumChannels() const noexcept             { return numChannels; }
+
+    /** Clears filter state */
+    void reset() noexcept
+    {
+        if (states != nullptr)
+            zeromem (states.getData(), sizeof (State) * (size_t) (numGroups * numStatesPerGroup()));
+    }
+
+    /** Splits a block. bands holds numBands * numChannels pointers, band
+        major, so a channel of band b is bands[b * numChannels + ch].
+        The input may be any of the band pointers of its channel */
+    void process (const float* const* input, float* const* bands, int numSamples) noexcept
+    {
+        float* const top = chunks[0];
+        float* const low = chunks[1];
+
+        for (int group = 0; group < numGroups; ++group)
+        {
+            const int first = group * numLanes;
+            const int count = jmin ((int) numLanes, numChannels - first);
+            State* const groupStates = states + group * numStatesPerGroup();
+
+            for (int start = 0; start < numSamples; start += chunkSize)
+            {
+                const int n = jmin ((int) chunkSize, numSamples - start);
+                interleave (input + first, count, start, top, n);
+
+                // the top band carries what's left above each crossover
+                State* state = groupStates;
+                for (int x = 0; x < numBands - 1; ++x)
+                {
+                    const auto& c = coefficients[x];
+                    run (c.lowPass,  *state++, top, low, n);
+                    run (c.lowPass,  *state++, low, low, n);
+                    run (c.highPass, *state++, top, top, n);
+                    run (c.highPass, *state++, top, top, n);
+
+                    for (int a = x + 1; a < numBands - 1; ++a)
+                        run (coefficients[a].allPass, *state++, low, low, n);
+
+                    deinterleave (low, bands + x * numChannels + first, count, start, n);
+                }
+
+                deinterleave (top, bands + (numBands - 1) * numChannels + first, count, start, n);
+            }
+        }
+    }
+
+private:
+    struct Biquad
+    {
+        float b0 = 1.f, b1 = 0.f, b2 = 0.f, a1 = 0.f, a2 = 0.f;
+    };
+
+    struct State
+    {
+        float z1 [numLanes], z2 [numLanes];
+    };
+
+    struct Coefficients
+    {
+        Biquad lowPass, highPass, allPass;
+    };
+
+    int numChannels = 0;
+    int numGroups = 0;
+    int numBands = 0;
+    double sampleRate = 44100.0;
+    float frequencies [maxBands - 1] = { };
+    Coefficients coefficients [maxBands - 1];
+    HeapBlock<State> states;    // per group of lanes
+    float chunks [2][chunkSize * numLanes];
+
+    int numStatesPerGroup() const noexcept
+    {
+        // four per crossover, plus one all-pass per crossover above each band
+        const int numCrossovers = numBands - 1;
+        return numCrossovers * 4 + (numCrossovers * (numCrossovers - 1)) / 2;
+    }
+
+    void updateCoefficients()
+    {
+        // RBJ cookbook sections at Q = 1/sqrt(2)
+        float lastHz = 10.f;
+        for (int i = 0; i < numBands - 1; ++i)
+        {
+            const auto hz = jlimit (lastHz, (float) sampleRate * 0.45f, frequencies[i]);
+            lastHz = hz;
+
+            const auto w     = MathConstants<double>::twoPi * (double) hz / sampleRate;
+            const auto cosw  = std::cos (w);
+            const auto alpha = std::sin (w) / std::sqrt (2.0); // sin (w) / 2Q
+            const auto a0    = 1.0 + alpha;
+            const auto a1    = (float) (-2.0 * cosw / a0);
+            const auto a2    = (float) ((1.0 - alpha) / a0);
+
+            auto& c = coefficients[i];
+            c.lowPass.b0  = c.lowPass.b2 = (float) ((1.0 - cosw) * 0.5 / a0);
+            c.lowPass.b1  = (float) ((1.0 - cosw) / a0);
+            c.highPass.b0 = c.highPass.b2 = (float) ((1.0 + cosw) * 0.5 / a0);
+            c.highPass.b1 = (float) (-(1.0 + cosw) / a0);
+            c.allPass.b0  = a2;
+            c.allPass.b1  = a1;
+            c.allPass.b2  = 1.f;
+
+            c.lowPass.a1 = c.highPass.a1 = c.allPass.a1 = a1;
+            c.lowPass.a2 = c.highPass.a2 = c.allPass.a2 = a2;
+        }
+    }
+
+    /** Copies a chunk of up to numLanes channels into lanes, silent lanes
+        are zeroed */
+    static inline void interleave (const float* const* input, int count, int start,
+                                   float* lanes, int numSamples) noexcept
+    {
+        for (int l = 0; l < numLanes; ++l)
+        {
+            if (l < count)
+                for (int i = 0; i < numSamples; ++i)
+                    lanes [i * numLanes + l] = input[l][start + i];
+            else
+                for (int i = 0; i < numSamples; ++i)
+                    lanes [i * numLanes + l] = 0.f;
+        }
+    }
+
+    static inline void deinterleave (const float* lanes, float* const* output, int count,
+                                     int start, int numSamples) noexcept
+    {
+        for (int l = 0; l < count; ++l)
+            for (int i = 0; i < numSamples; ++i)
+                output[l][start + i] = lanes [i * numLanes + l];
+    }
+
+    /** Transposed direct form II on every lane, in place is fine */
+    static inline void run (const Biquad& c, State& s, const float* in, float* out, int numSamples) noexcept
+    {
+        float z1 [numLanes], z2 [numLanes];
+        for (int l = 0; l < numLanes; ++l)
+        {
+            z1[l] = s.z1[l];
+            z2[l] = s.z2[l];
+        }
+
+        for (int i = 0; i < numSamples; ++i)
+        {
+            for (int l = 0; l < numLanes; ++l)
+            {
+                const auto x = in [i * numLanes + l];
+                const auto y = c.b0 * x + z1[l];
+                z1[l] = c.b1 * x - c.a1 * y + z2[l];
+                z2[l] = c.b2 * x - c.a2 * y;
+                out [i * numLanes + l] = y;
+            }
+        }
+
+        for (int l = 0; l < numLanes; ++l)
+        {
+            s.z1[l] = z1[l];
+            s.z2[l] = z2[l];
+        }
+    }
+};
+
+}
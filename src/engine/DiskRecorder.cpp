@@ -0,0 +1,596 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/DiskRecorder.h"
+
+namespace Element {
+
+// largest write handed to the format writer at once
+static const int writeChunkSize = 32768;
+
+DiskRecorder::DiskRecorder (TimeSliceThread& t)
+    : thread (t)
+{
+    directory = File::getSpecialLocation (File::userMusicDirectory);
+}
+
+DiskRecorder::~DiskRecorder()
+{
+    release();
+}
+
+//==============================================================================
+void DiskRecorder::prepare (int newNumChannels, double newSampleRate, int maxBlockSize)
+{
+    release();
+    allocate (newNumChannels, newSampleRate, maxBlockSize);
+    swapBuffers();
+    start();
+}
+
+void DiskRecorder::allocate (int newNumChannels, double newSampleRate, int maxBlockSize)
+{
+    jassert (prepared.get() == 0);
+    next.numChannels    = jmax (1, newNumChannels);
+    next.sampleRate     = newSampleRate > 0.0 ? newSampleRate : 44100.0;
+    maxBlockSize        = jmax (1, maxBlockSize);
+
+    {
+        ScopedLock sl (lock);
+        next.preRollSamples = (int64) (preRollSeconds * next.sampleRate);
+    }
+
+    // pre-roll plus a block still arriving, then at least four seconds for
+    // the disk to catch up
+    next.retainSamples = next.preRollSamples + maxBlockSize;
+    const auto headroom = jmax ((int64) (4.0 * next.sampleRate), (int64) maxBlockSize * 16);
+    const int capacity = (int) (next.retainSamples + headroom + 1);
+
+    next.ring.setSize (next.numChannels, capacity, false, false, false);
+    next.ring.clear();
+    next.channels.allocate ((size_t) next.numChannels, true);
+
+    if (midiEvents == nullptr)
+        midiEvents.allocate ((size_t) midiFifo.getTotalSize(), true);
+    if (silence == nullptr)
+        silence.allocate ((size_t) writeChunkSize, true);
+}
+
+void DiskRecorder::swapBuffers() noexcept
+{
+    jassert (prepared.get() == 0 && ! takeOpen);
+    std::swap (ring, next.ring);
+    channels.swapWith (next.channels);
+    std::swap (numChannels, next.numChannels);
+    std::swap (sampleRate, next.sampleRate);
+    preRollSamples = next.preRollSamples;
+    retainSamples = next.retainSamples;
+
+    fifo.setTotalSize (ring.getNumSamples());
+    fifo.reset();
+    eventFifo.reset();
+    midiFifo.reset();
+
+    written = readPosition = takeStart = 0;
+    gapLength = 0;
+    recording.set (0);
+    prepared.set (1);
+}
+
+void DiskRecorder::start()
+{
+    // the ring that was swapped out
+    next.ring.setSize (0, 0);
+    next.channels.free();
+
+    midiPending.clear();
+    thread.addTimeSliceClient (this);
+}
+
+void DiskRecorder::release()
+{
+    if (prepared.get() == 0)
+        return;
+
+    thread.removeTimeSliceClient (this);
+    flush();
+    if (takeOpen)
+        closeTake();
+
+    prepared.set (0);
+    recording.set (0);
+}
+
+void DiskRecorder::setDirectory (const File& dir)
+{
+    ScopedLock sl (lock);
+    directory = dir;
+}
+
+File DiskRecorder::getDirectory() const
+{
+    ScopedLock sl (lock);
+    return directory;
+}
+
+void DiskRecorder::setBaseName (const String& name)
+{
+    ScopedLock sl (lock);
+    baseName = File::createLegalFileName (name);
+    if (baseName.isEmpty())
+        baseName = "Recording";
+}
+
+String DiskRecorder::getBaseName() const
+{
+    ScopedLock sl (lock);
+    return baseName;
+}
+
+void DiskRecorder::setFormat (Format newFormat, int newBitsPerSample)
+{
+    ScopedLock sl (lock);
+    format = newFormat;
+    bitsPerSample = newBitsPerSample <= 16 ? 16 : newBitsPerSample <= 24 ? 24 : 32;
+}
+
+DiskRecorder::Format DiskRecorder::getFormat() const
+{
+    ScopedLock sl (lock);
+    return format;
+}
+
+int DiskRecorder::getBitsPerSample() const
+{
+    ScopedLock sl (lock);
+    return bitsPerSample;
+}
+
+void DiskRecorder::setPreRollSeconds (double seconds)
+{
+    ScopedLock sl (lock);
+    preRollSeconds = jlimit (0.0, 30.0, seconds);
+}
+
+double DiskRecorder::getPreRollSeconds() const
+{
+    ScopedLock sl (lock);
+    return preRollSeconds;
+}
+
+File DiskRecorder::getLastTake() const
+{
+    ScopedLock sl (lock);
+    return lastTake;
+}
+
+DiskRecorder::Stats DiskRecorder::getStats() const
+{
+    Stats stats;
+    stats.recording         = recording.get() != 0;
+    stats.numTakes          = numTakes.get();
+    stats.overruns          = overruns.get();
+    stats.errors            = errors.get();
+    stats.droppedSamples    = droppedSamples.get();
+    stats.droppedMidi       = droppedMidi.get();
+    stats.takeSamples       = takeSamples.get();
+    stats.bufferUsage       = prepared.get() != 0 ? (float) fifo.getNumReady() / (float) fifo.getTotalSize() : 0.f;
+    return stats;
+}
+
+//==============================================================================
+void DiskRecorder::punchIn (int frame) noexcept
+{
+    if (prepared.get() != 0 && recording.get() == 0 && pushEvent (Event::In, written + frame))
+        recording.set (1);
+}
+
+void DiskRecorder::punchOut (int frame) noexcept
+{
+    if (prepared.get() != 0 && recording.get() != 0 && pushEvent (Event::Out, written + frame))
+        recording.set (0);
+}
+
+void DiskRecorder::write (const AudioBuffer<float>& audio, const MidiBuffer& midi) noexcept
+{
+    const int numSamples = audio.getNumSamples();
+    if (prepared.get() == 0 || numSamples <= 0)
+        return;
+
+    MidiBuffer::Iterator iter (midi);
+    const uint8* data = nullptr;
+    int size = 0, frame = 0;
+    while (iter.getNextEvent (data, size, frame))
+    {
+        int start1, size1, start2, size2;
+        if (size > 3 || midiFifo.getFreeSpace() < 1)
+        {
+            droppedMidi += 1;
+            continue;
+        }
+
+        midiFifo.prepareToWrite (1, start1, size1, start2, size2);
+        auto& event = midiEvents [size1 > 0 ? start1 : start2];
+        event.position = written + frame;
+        event.size = size;
+        memcpy (event.data, data, (size_t) size);
+        midiFifo.finishedWrite (1);
+    }
+
+    if (! closeGap() || fifo.getFreeSpace() < numSamples)
+    {
+        // the disk fell behind, lose this block rather than wait. The
+        // writer fills the gap with silence once it's closed
+        overruns += 1;
+        droppedSamples += (int64) numSamples;
+        gapLength += numSamples;
+        written += numSamples;
+        return;
+    }
+
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite (numSamples, start1, size1, start2, size2);
+    for (int c = 0; c < numChannels; ++c)
+    {
+        if (c < audio.getNumChannels())
+        {
+            if (size1 > 0)
+                ring.copyFrom (c, start1, audio, c, 0, size1);
+            if (size2 > 0)
+                ring.copyFrom (c, start2, audio, c, size1, size2);
+        }
+        else
+        {
+            if (size1 > 0)
+                ring.clear (c, start1, size1);
+            if (size2 > 0)
+                ring.clear (c, start2, size2);
+        }
+    }
+
+    fifo.finishedWrite (size1 + size2);
+    written += numSamples;
+}
+
+bool DiskRecorder::closeGap() noexcept
+{
+    // events stay in stream order, so a gap is queued before anything after it
+    if (gapLength > 0 && pushEvent (Event::Gap, written - gapLength, gapLength))
+        gapLength = 0;
+    return gapLength == 0;
+}
+
+bool DiskRecorder::pushEvent (Event::Type type, int64 position, int64 length) noexcept
+{
+    if ((type != Event::Gap && ! closeGap()) || eventFifo.getFreeSpace() < 1)
+    {
+        errors += 1;
+        return false;
+    }
+
+    int start1, size1, start2, size2;
+    eventFifo.prepareToWrite (1, start1, size1, start2, size2);
+    auto& event = events [size1 > 0 ? start1 : start2];
+    event.type = type;
+    event.position = position;
+    event.length = length;
+    eventFifo.finishedWrite (1);
+    return true;
+}
+
+bool DiskRecorder::peekEvent (Event& event) const noexcept
+{
+    if (eventFifo.getNumReady() < 1)
+        return false;
+    int start1, size1, start2, size2;
+    eventFifo.prepareToRead (1, start1, size1, start2, size2);
+    event = events [size1 > 0 ? start1 : start2];
+    return true;
+}
+
+void DiskRecorder::popEvent() noexcept
+{
+    eventFifo.finishedRead (1);
+}
+
+//==============================================================================
+int DiskRecorder::useTimeSlice()
+{
+    return process() ? 0 : 20;
+}
+
+void DiskRecorder::flush()
+{
+    if (prepared.get() != 0)
+        while (process()) { }
+}
+
+bool DiskRecorder::process()
+{
+    drainMidi();
+
+    bool didWork = false;
+    for (;;)
+    {
+        const auto ready = (int64) fifo.getNumReady();
+        Event event;
+        const bool hasEvent = peekEvent (event);
+
+        if (hasEvent && event.type == Event::Gap)
+        {
+            // what came before the gap, then silence in its place
+            const auto before = jmin (ready, event.position - readPosition);
+            if (before > 0)
+            {
+                if (takeOpen)
+                    writeToTake ((int) jmin ((int64) writeChunkSize, before));
+                else
+                    discard (before);
+            }
+            else if (readPosition < event.position)
+            {
+                break;
+            }
+            else
+            {
+                if (takeOpen)
+                    writeSilence (event.length);
+                readPosition += event.length;
+                popEvent();
+            }
+        }
+        else if (takeOpen)
+        {
+            // write up to the punch out, then close
+            auto limit = ready;
+            if (hasEvent && event.type == Event::Out)
+                limit = jmin (limit, event.position - readPosition);
+
+            if (limit > 0)
+            {
+                writeToTake ((int) jmin ((int64) writeChunkSize, limit));
+            }
+            else if (hasEvent && event.type == Event::Out)
+            {
+                closeTake();
+                popEvent();
+            }
+            else
+            {
+                break;
+            }
+        }
+        else if (hasEvent && event.type == Event::In)
+        {
+            // skip to the start of the pre-roll, then open
+            const auto start = jmax (readPosition, event.position - preRollSamples);
+            discard (jmin (ready, start - readPosition));
+            if (readPosition < start)
+                break;
+            openTake (start);
+            popEvent();
+        }
+        else if (hasEvent)
+        {
+            popEvent();
+        }
+        else
+        {
+            // idle: keep only what a punch in could still need
+            const auto excess = ready - retainSamples;
+            if (excess <= 0)
+                break;
+            discard (excess);
+        }
+
+        didWork = true;
+    }
+
+    if (! takeOpen && midiPending.getNumEvents() > 0
+        && midiPending.getStartTime() < (double) readPosition)
+    {
+        MidiMessageSequence kept;
+        for (int i = 0; i < midiPending.getNumEvents(); ++i)
+            if (midiPending.getEventTime (i) >= (double) readPosition)
+                kept.addEvent (midiPending.getEventPointer (i)->message);
+        midiPending.swapWith (kept);
+    }
+
+    return didWork;
+}
+
+void DiskRecorder::drainMidi()
+{
+    const int ready = midiFifo.getNumReady();
+    if (ready <= 0)
+        return;
+
+    int start1, size1, start2, size2;
+    midiFifo.prepareToRead (ready, start1, size1, start2, size2);
+    for (int i = 0; i < size1 + size2; ++i)
+    {
+        const auto& event = midiEvents [i < size1 ? start1 + i : start2 + i - size1];
+        midiPending.addEvent (MidiMessage (event.data, event.size, (double) event.position));
+    }
+    midiFifo.finishedRead (size1 + size2);
+}
+
+void DiskRecorder::discard (int64 numSamples)
+{
+    if (numSamples <= 0)
+        return;
+    fifo.finishedRead ((int) numSamples);
+    readPosition += numSamples;
+}
+
+void DiskRecorder::writeToTake (int numSamples)
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToRead (numSamples, start1, size1, start2, size2);
+
+    if (writer != nullptr)
+    {
+        const int starts[] = { start1, start2 };
+        const int sizes[]  = { size1, size2 };
+        for (int i = 0; i < 2 && writer != nullptr; ++i)
+        {
+            if (sizes[i] <= 0)
+                continue;
+            for (int c = 0; c < numChannels; ++c)
+                channels[c] = ring.getReadPointer (c, starts[i]);
+            if (! writer->writeFromFloatArrays (channels, numChannels, sizes[i]))
+            {
+                // disk full or similar, keep draining so the take can end
+                errors += 1;
+                writer.reset();
+            }
+        }
+    }
+
+    fifo.finishedRead (size1 + size2);
+    readPosition += size1 + size2;
+    takeSamples += (int64) (size1 + size2);
+}
+
+void DiskRecorder::writeSilence (int64 numSamples)
+{
+    for (int c = 0; c < numChannels; ++c)
+        channels[c] = silence.getData();
+
+    for (auto remaining = numSamples; remaining > 0 && writer != nullptr;)
+    {
+        const int chunk = (int) jmin ((int64) writeChunkSize, remaining);
+        if (! writer->writeFromFloatArrays (channels, numChannels, chunk))
+        {
+            errors += 1;
+            writer.reset();
+        }
+        remaining -= chunk;
+    }
+
+    takeSamples += numSamples;
+}
+
+void DiskRecorder::openTake (int64 start)
+{
+    takeOpen    = true;
+    takeStart   = start;
+    takeFile    = File();
+    takeSamples.set (0);
+
+    File dir; String name; Format takeFormat; int bits;
+    {
+        ScopedLock sl (lock);
+        dir = directory;
+        name = baseName;
+        takeFormat = format;
+        bits = bitsPerSample;
+    }
+
+    std::unique_ptr<AudioFormat> audioFormat;
+   #if JUCE_USE_FLAC
+    if (takeFormat == FLAC && numChannels <= 8)
+    {
+        audioFormat.reset (new FlacAudioFormat());
+        bits = jmin (24, bits);
+    }
+   #endif
+    if (audioFormat == nullptr && takeFormat == AIFF)
+        audioFormat.reset (new AiffAudioFormat());
+    if (audioFormat == nullptr)
+        audioFormat.reset (new WavAudioFormat());
+
+    if (! dir.isDirectory() && ! dir.createDirectory())
+    {
+        errors += 1;
+        return;
+    }
+
+    String fileName = name;
+    fileName << "-" << String (numTakes.get() + 1).paddedLeft ('0', 3)
+             << audioFormat->getFileExtensions()[0];
+    const auto file = dir.getChildFile (fileName).getNonexistentSibling (false);
+
+    // a large stream buffer keeps writes big and sequential on disk
+    std::unique_ptr<FileOutputStream> stream (new FileOutputStream (file, 1 << 20));
+    if (stream->openedOk())
+        writer.reset (audioFormat->createWriterFor (stream.get(), sampleRate,
+            (unsigned int) numChannels, bits, {}, 0));
+
+    if (writer == nullptr)
+    {
+        stream.reset();
+        file.deleteFile();
+        errors += 1;
+        return;
+    }
+
+    stream.release();
+    takeFile = file;
+    numTakes += 1;
+}
+
+void DiskRecorder::closeTake()
+{
+    writer.reset();
+    writeMidiFile (readPosition);
+    takeOpen = false;
+
+    if (takeFile != File())
+    {
+        ScopedLock sl (lock);
+        lastTake = takeFile;
+    }
+}
+
+void DiskRecorder::writeMidiFile (int64 end)
+{
+    MidiMessageSequence take, kept;
+    for (int i = 0; i < midiPending.getNumEvents(); ++i)
+    {
+        const auto& message = midiPending.getEventPointer (i)->message;
+        const auto position = message.getTimeStamp();
+        if (position >= (double) end)
+        {
+            kept.addEvent (message);
+        }
+        else if (position >= (double) takeStart)
+        {
+            // SMPTE 25 x 40 is a millisecond per tick
+            MidiMessage msg (message);
+            msg.setTimeStamp (1000.0 * (position - (double) takeStart) / sampleRate);
+            take.addEvent (msg);
+        }
+    }
+
+    midiPending.swapWith (kept);
+    if (take.getNumEvents() <= 0 || takeFile == File())
+        return;
+
+    take.updateMatchedPairs();
+    MidiFile file;
+    file.setSmpteTimeFormat (25, 40);
+    file.addTrack (take);
+
+    FileOutputStream stream (takeFile.withFileExtension ("mid"));
+    if (! stream.openedOk() || ! file.writeTo (stream))
+        errors += 1;
+}
+
+}
@@ -0,0 +1,209 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+
+namespace Element {
+
+/** Records multichannel audio and MIDI to disk without blocking the audio thread.
+
+    The audio thread copies every block into a preallocated ring and marks
+    punch in/out points by their position in that stream. A time slice on a
+    disk thread drains the ring, opening a new take at each punch in and
+    closing it at the punch out. While not recording the writer keeps the
+    last few seconds in the ring so a take can start with pre-roll.
+
+    If the writer falls behind and a block doesn't fit, the block is dropped
+    and counted as an overrun rather than waiting on the disk. The take gets
+    silence in its place, so what follows stays in time.
+ */
+class DiskRecorder : private TimeSliceClient
+{
+public:
+    enum Format
+    {
+        WAV = 0,
+        AIFF,
+        FLAC
+    };
+
+    struct Stats
+    {
+        bool recording          = false;
+        int numTakes            = 0;
+        int overruns            = 0;
+        int errors              = 0;
+        int64 droppedSamples    = 0;
+        int64 droppedMidi       = 0;
+        int64 takeSamples       = 0;
+        float bufferUsage       = 0.f;
+    };
+
+    explicit DiskRecorder (TimeSliceThread& thread);
+    ~DiskRecorder();
+
+    //==========================================================================
+    /** Allocates the ring and starts the writer. Finishes a take in progress.
+        Not realtime safe: call while the audio callback is stopped or locked */
+    void prepare (int numChannels, double sampleRate, int maxBlockSize);
+
+    /** Stops the writer and finishes writing any take in progress */
+    void release();
+
+    /** prepare() in steps, for when the audio callback keeps running. Call
+        release() and allocate() from any thread, then swapBuffers() with the
+        audio callback locked, then start(). Only swapBuffers() has to hold
+        the callback lock, and it doesn't allocate */
+    void allocate (int numChannels, double sampleRate, int maxBlockSize);
+    void swapBuffers() noexcept;
+    void start();
+
+    void setDirectory (const File& dir);
+    File getDirectory() const;
+    void setBaseName (const String& name);
+    String getBaseName() const;
+
+    /** Sets the format and bit depth for new takes. 32 bits writes floats to
+        WAV and AIFF. FLAC takes wider than 8 channels are written as WAV */
+    void setFormat (Format format, int bitsPerSample);
+    Format getFormat() const;
+    int getBitsPerSample() const;
+
+    /** Seconds of audio before each punch in which are included in the take.
+        Takes effect the next time the recorder is prepared */
+    void setPreRollSeconds (double seconds);
+    double getPreRollSeconds() const;
+
+    /** Returns the most recently finished take, if any */
+    File getLastTake() const;
+
+    Stats getStats() const;
+
+    //==========================================================================
+    /** Audio thread: starts a take at a frame in the next block written */
+    void punchIn (int frame) noexcept;
+
+    /** Audio thread: ends the take at a frame in the next block written */
+    void punchOut (int frame) noexcept;
+
+    /** Audio thread: true between a punch in and punch out */
+    bool isRecording() const noexcept { return recording.get() != 0; }
+
+    /** Audio thread: copies a block into the ring. MIDI messages longer than
+        three bytes are dropped */
+    void write (const AudioBuffer<float>& audio, const MidiBuffer& midi) noexcept;
+
+    /** Writes out everything in the ring from the calling thread. For tests
+        and shutdown, when the audio thread is stopped */
+    void flush();
+
+private:
+    TimeSliceThread& thread;
+    mutable CriticalSection lock;
+    Atomic<int> prepared;
+
+    // settings, locked
+    File directory;
+    String baseName { "Recording" };
+    Format format = WAV;
+    int bitsPerSample = 24;
+    double preRollSeconds = 2.0;
+    File lastTake;
+
+    // ring
+    AbstractFifo fifo { 1 };
+    AudioBuffer<float> ring;
+    int numChannels = 0;
+    double sampleRate = 44100.0;
+    int64 preRollSamples = 0;
+    int64 retainSamples = 0;
+
+    // built by allocate(), swapped in by swapBuffers()
+    struct Buffers
+    {
+        AudioBuffer<float> ring;
+        HeapBlock<const float*> channels;
+        int numChannels = 0;
+        double sampleRate = 44100.0;
+        int64 preRollSamples = 0;
+        int64 retainSamples = 0;
+    } next;
+
+    /** Positions are in the stream the audio thread was given, gaps included */
+    struct Event
+    {
+        enum Type { In, Out, Gap };
+        Type type = In;
+        int64 position = 0;
+        int64 length = 0;   // Gap only
+    };
+
+    AbstractFifo eventFifo { 64 };
+    Event events [64];
+
+    struct MidiEvent
+    {
+        int64 position = 0;
+        uint8 data [3] = { 0, 0, 0 };
+        int size = 0;
+    };
+
+    AbstractFifo midiFifo { 4096 };
+    HeapBlock<MidiEvent> midiEvents;
+
+    // audio thread
+    Atomic<int> recording;
+    int64 written = 0;
+    int64 gapLength = 0;    // dropped samples just before 'written'
+
+    // writer thread
+    int64 readPosition = 0;
+    int64 takeStart = 0;
+    bool takeOpen = false;
+    File takeFile;
+    std::unique_ptr<AudioFormatWriter> writer;
+    HeapBlock<const float*> channels;
+    HeapBlock<float> silence;
+    MidiMessageSequence midiPending;
+
+    // counters, written by one thread and read by any
+    Atomic<int> numTakes, overruns, errors;
+    Atomic<int64> droppedSamples, droppedMidi, takeSamples;
+
+    bool pushEvent (Event::Type type, int64 position, int64 length = 0) noexcept;
+    bool closeGap() noexcept;
+    bool peekEvent (Event& event) const noexcept;
+    void popEvent() noexcept;
+
+    int useTimeSlice() override;
+    bool process();
+    void drainMidi();
+    void discard (int64 numSamples);
+    void writeToTake (int numSamples);
+    void writeSilence (int64 numSamples);
+    void openTake (int64 start);
+    void closeTake();
+    void writeMidiFile (int64 end);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DiskRecorder)
+};
+
+}
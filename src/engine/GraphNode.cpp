@@ -309,6 +309,7 @@ void GraphNode::prepare (const double sampleRate, const int blockSize,
 
         const int osFactor = getOversamplingFactor();
         prepareToRender (sampleRate * osFactor, blockSize * osFactor);
+        renderSampleRate.set (sampleRate);
 
         // TODO: move model code out of engine code
         // VERIFY: this portion is actually needed. This was here to ensure
@@ -338,11 +339,29 @@ void GraphNode::prepare (const double sampleRate, const int blockSize,
     }
 }
 
+void GraphNode::queueParameterValue (int index, float value, double rampMillis)
+{
+    auto* param = parameters [index].get();
+    if (param == nullptr)
+        return;
+
+    const double sampleRate = renderSampleRate.get();
+    const int rampSamples = roundToInt (jmax (0.0, rampMillis) * 0.001 * sampleRate);
+    if (sampleRate <= 0.0 || ! parameterQueue.push (index, value, rampSamples))
+        param->setValue (value);
+}
+
+void GraphNode::applyQueuedParameterValues (int numSamples)
+{
+    parameterQueue.process (parameters, numSamples);
+}
+
 void GraphNode::unprepare()
 {
     if (isPrepared)
     {
         isPrepared = false;
+        renderSampleRate.set (0.0);
         inRMS.clear (true);
         outRMS.clear (true);
         resetOversampling();
@@ -21,6 +21,7 @@
 
 #include "ElementApp.h"
 #include "engine/Parameter.h"
+#include "engine/ParameterQueue.h"
 
 namespace Element {
 
@@ -91,6 +92,16 @@ public:
     //=========================================================================
     const ParameterArray& getParameters() const    { return parameters; }
 
+    /** Queue a normalized parameter value to be applied on the render thread.
+        Safe to call from any thread. If the node isn't being rendered the value
+        is applied immediately.
+
+        @param parameter    Index of the parameter
+        @param value        Normalized value 0 to 1
+        @param rampMillis   Time to ramp to the new value, zero to jump
+     */
+    void queueParameterValue (int parameter, float value, double rampMillis = 0.0);
+
     //=========================================================================
     /** Returns the type of port
         
@@ -407,6 +418,8 @@ private:
     String name;
 
     ParameterArray parameters;
+    ParameterQueue parameterQueue;
+    Atomic<double> renderSampleRate { 0.0 };
 
     Atomic<float> gain, lastGain, inputGain, lastInputGain;
     OwnedArray<AtomicValue<float> > inRMS, outRMS;
@@ -459,6 +472,7 @@ private:
     void setParentGraph (GraphProcessor*);
     void prepare (double sampleRate, int blockSize, GraphProcessor*, bool willBeEnabled = false);
     void unprepare();
+    void applyQueuedParameterValues (int numSamples);
     void resetPorts();
     void initOversampling (int numChannels, int blockSize);
     void prepareOversampling (int blockSize);
@@ -232,7 +232,8 @@ public:
         }
 
         AudioSampleBuffer buffer (channels, totalChans, numSamples);
-        
+        node->applyQueuedParameterValues (numSamples);
+
         if (! node->isEnabled())
         {
             for (int ch = numAudioIns; ch < numAudioOuts; ++ch)
@@ -0,0 +1,141 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/ImpulseResponseCache.h"
+
+namespace Element {
+
+ImpulseResponseCache::ImpulseResponseCache()
+{
+    formats.registerBasicFormats();
+}
+
+ImpulseResponseCache::~ImpulseResponseCache()
+{
+    pool.removeAllJobs (true, 5000);
+}
+
+int ImpulseResponseCache::getNumKernels() const
+{
+    ScopedLock sl (lock);
+    return entries.size();
+}
+
+void ImpulseResponseCache::purge()
+{
+    // drop kernels only the cache is holding
+    for (int i = entries.size(); --i >= 0;)
+        if (entries.getReference (i).kernel->getReferenceCount() <= 1)
+            entries.remove (i);
+}
+
+ConvolutionKernel::Ptr ImpulseResponseCache::getKernel (const File& file, double sampleRate)
+{
+    // held while loading so a file wanted twice is only read once
+    ScopedLock sl (lock);
+    purge();
+
+    const auto modified = file.getLastModificationTime();
+    for (const auto& entry : entries)
+        if (entry.file == file && entry.modified == modified && entry.kernel->getSampleRate() == sampleRate)
+            return entry.kernel;
+
+    std::unique_ptr<AudioFormatReader> reader (formats.createReaderFor (file));
+    if (reader == nullptr || reader->lengthInSamples <= 0 || reader->sampleRate <= 0.0)
+        return nullptr;
+
+    const int length = (int) jmin (reader->lengthInSamples, (int64) (reader->sampleRate * maxLengthSeconds));
+    AudioBuffer<float> impulse ((int) reader->numChannels, length);
+    if (! reader->read (&impulse, 0, length, 0, true, true))
+        return nullptr;
+
+    auto kernel = createKernel (impulse, reader->sampleRate, sampleRate);
+    if (kernel != nullptr)
+        entries.add ({ file, modified, kernel });
+    return kernel;
+}
+
+/** Windowed sinc low-pass with no delay. cutoff is a fraction of the rate */
+static void lowPass (AudioBuffer<float>& buffer, double cutoff)
+{
+    // Blackman, rolling off over a tenth of the cutoff so the stopband
+    // starts below the new Nyquist
+    const int half = jlimit (16, 1024, (int) std::ceil (2.75 / (0.1 * cutoff)));
+    HeapBlock<float> taps ((size_t) (2 * half + 1));
+    double sum = 0.0;
+    for (int j = -half; j <= half; ++j)
+    {
+        const double x = double_Pi * j / (half + 1);
+        const double window = 0.42 + 0.5 * std::cos (x) + 0.08 * std::cos (2.0 * x);
+        const double sinc = j == 0 ? 2.0 * cutoff : std::sin (2.0 * double_Pi * cutoff * j) / (double_Pi * j);
+        taps[j + half] = (float) (window * sinc);
+        sum += window * sinc;
+    }
+    FloatVectorOperations::multiply (taps, (float) (1.0 / sum), 2 * half + 1);
+
+    const int numSamples = buffer.getNumSamples();
+    HeapBlock<float> source ((size_t) (numSamples + 2 * half), true);
+    for (int c = 0; c < buffer.getNumChannels(); ++c)
+    {
+        FloatVectorOperations::copy (source + half, buffer.getReadPointer (c), numSamples);
+        auto* const dest = buffer.getWritePointer (c);
+        for (int i = 0; i < numSamples; ++i)
+        {
+            float y = 0.f;
+            for (int j = 0; j <= 2 * half; ++j)
+                y += taps[j] * source[i + j];
+            dest[i] = y;
+        }
+    }
+}
+
+ConvolutionKernel::Ptr ImpulseResponseCache::createKernel (const AudioBuffer<float>& impulse,
+                                                           double impulseRate, double sampleRate)
+{
+    if (impulseRate <= 0.0 || sampleRate <= 0.0 || impulse.getNumSamples() <= 0)
+        return nullptr;
+
+    if (impulseRate == sampleRate)
+        return ConvolutionKernel::create (impulse, sampleRate);
+
+    // scaled by the rate ratio so the response keeps its level
+    const double ratio = impulseRate / sampleRate;
+    const int length = jmax (1, (int) std::ceil (impulse.getNumSamples() / ratio));
+    AudioBuffer<float> padded (impulse.getNumChannels(), impulse.getNumSamples() + 8 + (int) std::ceil (ratio));
+    AudioBuffer<float> resampled (impulse.getNumChannels(), length);
+    padded.clear();
+
+    for (int c = 0; c < impulse.getNumChannels(); ++c)
+        padded.copyFrom (c, 0, impulse, c, 0, impulse.getNumSamples());
+
+    // decimating, take out what would fold back below the new Nyquist
+    if (ratio > 1.0)
+        lowPass (padded, 0.45 / ratio);
+
+    for (int c = 0; c < impulse.getNumChannels(); ++c)
+    {
+        LagrangeInterpolator interpolator;
+        interpolator.process (ratio, padded.getReadPointer (c), resampled.getWritePointer (c), length);
+        resampled.applyGain (c, 0, length, (float) ratio);
+    }
+
+    return ConvolutionKernel::create (resampled, sampleRate);
+}
+
+}
@@ -0,0 +1,71 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "engine/Convolver.h"
+
+namespace Element {
+
+/** Impulse responses partitioned for convolution, shared by every node.
+
+    Files are read, resampled to the session rate and partitioned once per
+    rate. A kernel stays cached while any node holds it, so rooms and
+    cabinets used in several places share their memory.
+ */
+class ImpulseResponseCache
+{
+public:
+    enum { maxLengthSeconds = 20 };
+
+    ImpulseResponseCache();
+    ~ImpulseResponseCache();
+
+    /** Returns the kernel for a file at a sample rate, loading it if needed.
+        This blocks, so call it from the pool */
+    ConvolutionKernel::Ptr getKernel (const File& file, double sampleRate);
+
+    /** Resamples an impulse response and partitions it */
+    static ConvolutionKernel::Ptr createKernel (const AudioBuffer<float>& impulse,
+                                                double impulseRate, double sampleRate);
+
+    /** The pool nodes load on */
+    ThreadPool& getPool() noexcept { return pool; }
+
+    int getNumKernels() const;
+
+private:
+    struct Entry
+    {
+        File file;
+        Time modified;
+        ConvolutionKernel::Ptr kernel;
+    };
+
+    mutable CriticalSection lock;
+    Array<Entry> entries;
+    AudioFormatManager formats;
+    ThreadPool pool { 1 };
+
+    void purge();
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ImpulseResponseCache)
+};
+
+}
@@ -25,6 +25,7 @@
 #include "engine/nodes/ChannelizeProcessor.h"
 #include "engine/nodes/CombFilterProcessor.h"
 #include "engine/nodes/CompressorProcessor.h"
+#include "engine/nodes/DiskRecorderNode.h"
 #include "engine/nodes/EQFilterProcessor.h"
 #include "engine/nodes/FreqSplitterProcessor.h"
 #include "engine/nodes/LuaNode.h"
@@ -34,6 +35,9 @@
 #include "engine/nodes/MidiDeviceProcessor.h"
 #include "engine/nodes/MidiMonitorNode.h"
 #include "engine/nodes/MidiRouterNode.h"
+#include "engine/nodes/MultibandCompressorProcessor.h"
+#include "engine/nodes/ParametricEQProcessor.h"
+#include "engine/nodes/ConvolutionProcessor.h"
 #include "engine/nodes/PlaceholderProcessor.h"
 #include "engine/nodes/OSCReceiverNode.h"
 #include "engine/nodes/OSCSenderNode.h"
@@ -244,14 +248,29 @@ void ElementAudioPluginFormat::findAllTypesForFile (OwnedArray <PluginDescriptio
     }
     else if (fileOrId == EL_INTERNAL_ID_FREQ_SPLITTER)
     {
-        auto* desc = ds.add (new PluginDescription());
-        FreqSplitterProcessor().fillInPluginDescription (*desc);
+        for (int numBands : { 2, 3, 4, 5 })
+            FreqSplitterProcessor (2, numBands).fillInPluginDescription (*ds.add (new PluginDescription()));
     }
     else if (fileOrId == EL_INTERNAL_ID_COMPRESSOR)
     {
         auto* desc = ds.add (new PluginDescription());
         CompressorProcessor().fillInPluginDescription (*desc);
     }
+    else if (fileOrId == EL_INTERNAL_ID_MULTIBAND_COMPRESSOR)
+    {
+        for (int numBands : { 3, 4, 5 })
+            MultibandCompressorProcessor (2, numBands).fillInPluginDescription (*ds.add (new PluginDescription()));
+    }
+    else if (fileOrId == EL_INTERNAL_ID_PARAMETRIC_EQ)
+    {
+        for (int numBands : { 8, 12 })
+            ParametricEQProcessor (2, numBands).fillInPluginDescription (*ds.add (new PluginDescription()));
+    }
+    else if (fileOrId == EL_INTERNAL_ID_CONVOLUTION)
+    {
+        for (int numChannels : { 1, 2, 8, 16 })
+            ConvolutionProcessor (numChannels).fillInPluginDescription (*ds.add (new PluginDescription()));
+    }
 
    #if defined (EL_PRO)
     else if (fileOrId == EL_INTERNAL_ID_GRAPH)
@@ -297,6 +316,11 @@ void ElementAudioPluginFormat::findAllTypesForFile (OwnedArray <PluginDescriptio
         auto* const desc = ds.add (new PluginDescription());
         AudioFilePlayerNode().fillInPluginDescription (*desc);
     }
+    else if (fileOrId == EL_INTERNAL_ID_DISK_RECORDER)
+    {
+        for (int numChannels : { 2, 8, 16, 32, 64 })
+            DiskRecorderNode (numChannels).fillInPluginDescription (*ds.add (new PluginDescription()));
+    }
     else if (fileOrId == EL_INTERNAL_ID_AUDIO_ROUTER)
     {
         auto* const desc = ds.add (new PluginDescription());
@@ -372,7 +396,10 @@ StringArray ElementAudioPluginFormat::searchPathsForPlugins (const FileSearchPat
     StringArray results;
     results.add (EL_INTERNAL_ID_COMB_FILTER);
     results.add (EL_INTERNAL_ID_COMPRESSOR);
+    results.add (EL_INTERNAL_ID_MULTIBAND_COMPRESSOR);
     results.add (EL_INTERNAL_ID_EQ_FILTER);
+    results.add (EL_INTERNAL_ID_PARAMETRIC_EQ);
+    results.add (EL_INTERNAL_ID_CONVOLUTION);
     results.add (EL_INTERNAL_ID_FREQ_SPLITTER);
     results.add ("element.allPass");
     results.add ("element.volume");
@@ -394,6 +421,7 @@ StringArray ElementAudioPluginFormat::searchPathsForPlugins (const FileSearchPat
    #if defined (EL_SOLO) || defined (EL_PRO)
     results.add (EL_INTERNAL_ID_AUDIO_FILE_PLAYER);
     results.add (EL_INTERNAL_ID_AUDIO_ROUTER);
+    results.add (EL_INTERNAL_ID_DISK_RECORDER);
     results.add (EL_INTERNAL_ID_MIDI_ROUTER);
     results.add (EL_INTERNAL_ID_MIDI_PROGRAM_MAP);
     results.add (EL_INTERNAL_ID_MIDI_MONITOR);
@@ -430,10 +458,16 @@ AudioPluginInstance* ElementAudioPluginFormat::instantiatePlugin (const PluginDe
         base = new ReverbProcessor();
     else if (desc.fileOrIdentifier == EL_INTERNAL_ID_EQ_FILTER)
         base = new EQFilterProcessor();
-    else if (desc.fileOrIdentifier == EL_INTERNAL_ID_FREQ_SPLITTER)
-        base = new FreqSplitterProcessor();
+    else if (desc.fileOrIdentifier.startsWith (EL_INTERNAL_ID_FREQ_SPLITTER))
+        base = new FreqSplitterProcessor (2, FreqSplitterProcessor::getNumBandsFor (desc.fileOrIdentifier));
     else if (desc.fileOrIdentifier == EL_INTERNAL_ID_COMPRESSOR)
         base = new CompressorProcessor();
+    else if (desc.fileOrIdentifier.startsWith (EL_INTERNAL_ID_MULTIBAND_COMPRESSOR))
+        base = new MultibandCompressorProcessor (2, MultibandCompressorProcessor::getNumBandsFor (desc.fileOrIdentifier));
+    else if (desc.fileOrIdentifier.startsWith (EL_INTERNAL_ID_PARAMETRIC_EQ))
+        base = new ParametricEQProcessor (2, ParametricEQProcessor::getNumBandsFor (desc.fileOrIdentifier));
+    else if (desc.fileOrIdentifier.startsWith (EL_INTERNAL_ID_CONVOLUTION))
+        base = new ConvolutionProcessor (ConvolutionProcessor::getNumChannelsFor (desc.fileOrIdentifier));
 
    #if defined (EL_PRO)
     else if (desc.fileOrIdentifier == EL_INTERNAL_ID_GRAPH)
@@ -449,6 +483,8 @@ AudioPluginInstance* ElementAudioPluginFormat::instantiatePlugin (const PluginDe
    #if defined (EL_PRO) || defined (EL_SOLO)
     else if (desc.fileOrIdentifier == EL_INTERNAL_ID_AUDIO_FILE_PLAYER)
         base = new AudioFilePlayerNode();
+    else if (desc.fileOrIdentifier.startsWith (EL_INTERNAL_ID_DISK_RECORDER))
+        base = new DiskRecorderNode (DiskRecorderNode::getNumChannelsFor (desc.fileOrIdentifier));
     else if (desc.fileOrIdentifier == EL_INTERNAL_ID_MEDIA_PLAYER)
         base = new MediaPlayerProcessor();
     else if (desc.fileOrIdentifier == EL_INTERNAL_ID_PLACEHOLDER)
@@ -17,6 +17,7 @@
     Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
 */
 
+#include "engine/ControllerEventParser.h"
 #include "engine/GraphNode.h"
 #include "engine/MappingEngine.h"
 #include "engine/MidiEngine.h"
@@ -25,14 +26,134 @@
 
 namespace Element {
 
+/** Returns the controller event type a control responds to
+    @returns false if the control isn't a controller
+ */
+static bool getControllerEventType (const ControllerDevice::Control& control, ControllerEvent::Type& type)
+{
+    if (control.isControllerEvent())
+        type = control.isHighResolution() && control.getEventId() < 32
+             ? ControllerEvent::Controller14Bit : ControllerEvent::Controller;
+    else if (control.isNrpnEvent())
+        type = ControllerEvent::NRPN;
+    else if (control.isRpnEvent())
+        type = ControllerEvent::RPN;
+    else
+        return false;
+    return true;
+}
+
 class ControllerMapHandler
 {
 public:
     ControllerMapHandler() { }
     virtual ~ControllerMapHandler() { }
 
-    virtual bool wants (const MidiMessage& message) const =0;
-    virtual void perform (const MidiMessage& message) =0;
+    /** Called when the channel or number this handler responds to changes */
+    std::function<void()> routingChanged;
+
+    /** Note handlers: returns true if perform should be called */
+    virtual bool wants (const MidiMessage&) const { return false; }
+    /** Note handlers: handle a note message */
+    virtual void perform (const MidiMessage&) { }
+
+    /** Controller handlers: returns true if performController should be called */
+    virtual bool wantsController (const ControllerEvent&) const { return false; }
+    /** Controller handlers: handle a decoded controller value */
+    virtual void performController (const ControllerEvent&) { }
+
+    /** Returns true if this handles notes, false if controllers */
+    virtual bool handlesNotes() const =0;
+
+    /** Returns the controller event type this handles. Only valid if
+        handlesNotes() returns false */
+    virtual ControllerEvent::Type getControllerType() const { return ControllerEvent::Controller; }
+
+    /** Returns the note, controller or parameter number this handles */
+    virtual int getMidiNumber() const =0;
+
+    /** Returns the channel this handles or zero for omni */
+    virtual int getMidiChannel() const =0;
+
+    /** Called periodically on the message thread to notify parameter
+        listeners of changes made by perform() */
+    virtual void updateGestures (uint32 /*now*/) { }
+
+protected:
+    void notifyRoutingChanged()
+    {
+        if (routingChanged)
+            routingChanged();
+    }
+};
+
+/** Sends mapped values to a node's render thread and notifies the parameter's
+    listeners from the message thread.
+
+    send() is called on the MIDI thread. It queues the value on the node and
+    marks it changed, nothing else. update() runs on the message thread, it
+    begins a change gesture on the first change of a burst, sends one value
+    notification per tick and ends the gesture after the controller has been
+    idle for gestureTimeoutMs.
+ */
+class MappedParameter
+{
+public:
+    enum { gestureTimeoutMs = 250 };
+
+    MappedParameter (GraphNodePtr n, Parameter::Ptr p, int i)
+        : node (n), parameter (p), index (i)
+    {
+        lastValue.set (parameter->getValue());
+    }
+
+    ~MappedParameter()
+    {
+        if (gestureActive)
+            parameter->endChangeGesture();
+    }
+
+    /** Returns the last value sent, which may not have been applied yet */
+    float getLastValue() const { return lastValue.get(); }
+
+    /** Returns the parameter's value, including changes made from elsewhere */
+    float getCurrentValue() const { return parameter->getValue(); }
+
+    void send (float value, double rampMillis)
+    {
+        node->queueParameterValue (index, value, rampMillis);
+        lastValue.set (value);
+        lastChangeTime.set (Time::getMillisecondCounter());
+        changed.set (1);
+    }
+
+    void update (const uint32 now)
+    {
+        if (changed.compareAndSetBool (0, 1))
+        {
+            if (! gestureActive)
+            {
+                parameter->beginChangeGesture();
+                gestureActive = true;
+            }
+
+            parameter->sendValueChangedMessageToListeners (lastValue.get());
+        }
+        else if (gestureActive && now - lastChangeTime.get() >= (uint32) gestureTimeoutMs)
+        {
+            parameter->endChangeGesture();
+            gestureActive = false;
+        }
+    }
+
+private:
+    GraphNodePtr node;
+    Parameter::Ptr parameter;
+    const int index;
+    Atomic<float> lastValue { 0.f };
+    Atomic<uint32> lastChangeTime { 0 };
+    Atomic<int> changed { 0 };
+    bool gestureActive = false;
 };
 
 struct MidiNoteControllerMap : public ControllerMapHandler,
@@ -68,6 +189,8 @@ struct MidiNoteControllerMap : public ControllerMapHandler,
         {
             parameter = node->getParameters()[parameterIndex];
             jassert (nullptr != parameter);
+            if (parameter != nullptr)
+                mapped.reset (new MappedParameter (node, parameter, parameterIndex));
         }
     }
 
@@ -75,6 +198,10 @@ struct MidiNoteControllerMap : public ControllerMapHandler,
     {
         channelObject.removeListener (this);
     }
+
+    bool handlesNotes() const override      { return true; }
+    int getMidiNumber() const override      { return noteNumber; }
+    int getMidiChannel() const override     { return channel.get(); }
     
     bool checkNoteAndChannel (const MidiMessage& message) const
     {
@@ -101,20 +228,19 @@ struct MidiNoteControllerMap : public ControllerMapHandler,
 
         jassert (message.isNoteOnOrOff());
        
-        if (parameter != nullptr)
+        if (mapped != nullptr)
         {
-            parameter->beginChangeGesture();
             if (momentary.get() == 0)
             {
-                parameter->setValueNotifyingHost (parameter->getValue() < 0.5 ? 1.f : 0.f);
+                // toggle what the node has, the editor or automation may
+                // have moved it since the last note
+                mapped->send (mapped->getCurrentValue() < 0.5f ? 1.f : 0.f, 0.0);
             }
             else
             {
                 const bool onOrOff = isInverse ? message.isNoteOff() : message.isNoteOn();
-                parameter->setValueNotifyingHost (onOrOff ? 1.f : 0.f);
+                mapped->send (onOrOff ? 1.f : 0.f, 0.0);
             }
-
-            parameter->endChangeGesture();
         }
         else if (parameterIndex == GraphNode::EnabledParameter ||
                  parameterIndex == GraphNode::BypassParameter ||
@@ -124,6 +250,12 @@ struct MidiNoteControllerMap : public ControllerMapHandler,
         }
     }
 
+    void updateGestures (uint32 now) override
+    {
+        if (mapped != nullptr)
+            mapped->update (now);
+    }
+
     void handleAsyncUpdate() override
     {
         MidiMessage event;
@@ -178,6 +310,7 @@ private:
     Node model;
     GraphNodePtr node { nullptr };
     Parameter::Ptr parameter { nullptr };
+    std::unique_ptr<MappedParameter> mapped;
     int parameterIndex = -1;
 
     Value channelObject;
@@ -199,6 +332,7 @@ private:
         if (channelObject.refersToSameSourceAs (value))
         {
             channel.set (jlimit (0, 16, (int) channelObject.getValue()));
+            notifyRoutingChanged();
         }
         else if (momentaryObject.refersToSameSourceAs (value))
         {
@@ -216,15 +350,15 @@ struct MidiCCControllerMapHandler : public ControllerMapHandler,
                                     private Value::Listener
 {
     MidiCCControllerMapHandler (const ControllerDevice::Control& ctl, 
-                                const MidiMessage& message,
+                                const ControllerEvent::Type _type,
                                 const Node& _node,
                                 const int _parameter)
         : control (ctl), model (_node), node (_node.getGraphNode()),
           parameter (nullptr),
-          controllerNumber (message.getControllerNumber()),
+          type (_type),
+          controllerNumber (ctl.getEventId()),
           parameterIndex (_parameter)
     {
-        jassert (message.isController());
         jassert (node != nullptr);
 
         toggleValueObject = control.getToggleValueObject();
@@ -243,10 +377,19 @@ struct MidiCCControllerMapHandler : public ControllerMapHandler,
         channelObject.addListener (this);
         valueChanged (channelObject);
 
+        smoothingObject = control.getSmoothingTimeObject();
+        smoothingObject.addListener (this);
+        valueChanged (smoothingObject);
+
+        highResolutionObject = control.getHighResolutionObject();
+        highResolutionObject.addListener (this);
+
         if (isPositiveAndBelow (parameterIndex, node->getParameters().size()))
         {
             parameter = node->getParameters()[parameterIndex];
             jassert (nullptr != parameter);
+            if (parameter != nullptr)
+                mapped.reset (new MappedParameter (node, parameter, parameterIndex));
         }
         else if (parameterIndex == GraphNode::EnabledParameter)
         {
@@ -260,24 +403,30 @@ struct MidiCCControllerMapHandler : public ControllerMapHandler,
         inverseToggleObject.removeListener (this);
         toggleModeObject.removeListener (this);
         channelObject.removeListener (this);
+        smoothingObject.removeListener (this);
+        highResolutionObject.removeListener (this);
     }
 
-    bool wants (const MidiMessage& message) const override
+    bool handlesNotes() const override      { return false; }
+    ControllerEvent::Type getControllerType() const override { return static_cast<ControllerEvent::Type> (type.get()); }
+    int getMidiNumber() const override      { return controllerNumber; }
+    int getMidiChannel() const override     { return channel.get(); }
+
+    bool wantsController (const ControllerEvent& event) const override
     {
-        return message.isController() && 
-            message.getControllerNumber() == controllerNumber &&
-            (channel.get() == 0 || (channel.get() > 0 && message.getChannel() == channel.get()));
+        return event.type == type.get() &&
+            event.number == controllerNumber &&
+            (channel.get() == 0 || (channel.get() > 0 && event.channel == channel.get()));
     }
 
-    void perform (const MidiMessage& message) override
+    void performController (const ControllerEvent& event) override
     {
-        const auto ccValue = message.getControllerValue();
+        // toggles compare against 7 bit thresholds whatever the resolution
+        const auto ccValue = event.get7BitValue();
 
-        if (nullptr != parameter)
+        if (nullptr != mapped)
         {
-            parameter->beginChangeGesture();
-            parameter->setValueNotifyingHost (static_cast<float> (ccValue) / 127.f);
-            parameter->endChangeGesture();
+            mapped->send (event.getNormalizedValue(), (double) smoothing.get());
         }
         else if (parameterIndex == GraphNode::EnabledParameter ||
                  parameterIndex == GraphNode::BypassParameter ||
@@ -342,6 +491,12 @@ struct MidiCCControllerMapHandler : public ControllerMapHandler,
         lastControllerValue = ccValue;
     }
 
+    void updateGestures (uint32 now) override
+    {
+        if (mapped != nullptr)
+            mapped->update (now);
+    }
+
     void handleAsyncUpdate() override
     {
         const auto mode = toggleMode.get();
@@ -373,7 +528,9 @@ private:
     Node model;
     GraphNodePtr node { nullptr };
     Parameter::Ptr parameter { nullptr };
+    std::unique_ptr<MappedParameter> mapped;
     
+    Atomic<int> type;
     const int controllerNumber { -1 };
     const int parameterIndex { -1 };
     int lastControllerValue = 0;
@@ -390,6 +547,11 @@ private:
     Value channelObject;
     Atomic<int> channel { 0 };
 
+    Value smoothingObject;
+    Atomic<int> smoothing { 0 };
+
+    Value highResolutionObject;
+
     Atomic<int> desiredToggleState { 1 };
 
     void valueChanged (Value& value) override
@@ -410,6 +572,21 @@ private:
         else if (channelObject.refersToSameSourceAs (value))
         {
             channel.set (jlimit (0, 16, (int) channelObject.getValue()));
+            notifyRoutingChanged();
+        }
+        else if (smoothingObject.refersToSameSourceAs (value))
+        {
+            smoothing.set (jmax (0, (int) smoothingObject.getValue()));
+        }
+        else if (highResolutionObject.refersToSameSourceAs (value))
+        {
+            // switches between the 7 and 14 bit tables
+            ControllerEvent::Type newType;
+            if (getControllerEventType (control, newType) && newType != getControllerType())
+            {
+                type.set (static_cast<int> (newType));
+                notifyRoutingChanged();
+            }
         }
     }
 };
@@ -420,35 +597,61 @@ public:
     explicit ControllerMapInput (MappingEngine& owner, MidiEngine& m, const ControllerDevice& device)
         : midi (m), mapping (owner), controllerDevice (device)
     {
-
+        rebuild();
     }
     
     ~ControllerMapInput()
     {
         close();
+        delete table.exchange (nullptr);
+        jassert (numReaders.load() == 0);
+        retired.clear (true);
     }
 
     void handleIncomingMidiMessage (MidiInput*, const MidiMessage& message)
     {
-        if ((! message.isController() || !controllerNumbers [message.getControllerNumber()]) &&
-            (!message.isNoteOnOrOff() || !noteNumbers [message.getNoteNumber()]))
+        if (! message.isController() && ! message.isNoteOnOrOff())
             return;
 
-        // DBG("[EL] handle mapped MIDI: " << message.getControllerNumber() 
-        //     << " : " << message.getControllerValue());
-        if (message.isNoteOn())
-            mapping.captureNextEvent (*this, notes[message.getNoteNumber()], message);
-        else if (message.isController())
-            mapping.captureNextEvent (*this, controls[message.getControllerNumber()], message);
+        ++numReaders;
+        if (auto* const current = table.load())
+        {
+            if (message.isNoteOnOrOff())
+            {
+                current->dispatchNote (*this, message);
+            }
+            else
+            {
+                const SpinLock::ScopedLockType sl (parserLock);
+                parser.process (message, [&](const ControllerEvent& event) {
+                    current->dispatchController (*this, event, message);
+                });
+            }
+        }
+        --numReaders;
+    }
 
-        for (auto* handler : handlers)
-            if (handler->wants (message))
-                handler->perform (message);
+    /** Dispatches 14 bit MSBs whose LSB never arrived */
+    void flushHeldControllers()
+    {
+        ++numReaders;
+        if (auto* const current = table.load())
+        {
+            const SpinLock::ScopedLockType sl (parserLock);
+            if (parser.hasHeldControllers())
+            {
+                parser.flush (Time::getMillisecondCounterHiRes(), [&](const ControllerEvent& event) {
+                    const auto message = MidiMessage::controllerEvent (
+                        event.channel, event.number, event.get7BitValue());
+                    current->dispatchController (*this, event, message);
+                });
+            }
+        }
+        --numReaders;
     }
 
     bool close()
     {
-        const auto deviceName = controllerDevice.getInputDevice().toString();
         midi.removeMidiInputCallback (this);
         return true;
     }
@@ -456,26 +659,9 @@ public:
     bool open()
     {
         close();
-
-        for (int i = controllerDevice.getNumControls(); --i >= 0;)
-        {
-            const auto control (controllerDevice.getControl (i));
-            const auto midi (control.getMidiMessage());
-            if (midi.isController())
-            {
-                controllerNumbers.setBit (midi.getControllerNumber(), true);
-                controls.set (midi.getControllerNumber(), control);
-            }
-            else if (midi.isNoteOn())
-            {
-                noteNumbers.setBit (midi.getNoteNumber(), true);
-                notes.set (midi.getNoteNumber(), control);
-            }
-        }
-
+        rebuild();
         const auto deviceName = controllerDevice.getInputDevice().toString();
         midi.addMidiInputCallback (deviceName, this, true);
-        
         return true;
     }
 
@@ -499,29 +685,282 @@ public:
         return isInputFor (control.getControllerDevice());
     }
 
+    /** Adds a handler. The dispatch table is rebuilt and swapped in without
+        interrupting the input unless updates are deferred.
+        @see setDeferUpdates
+     */
     void addHandler (ControllerMapHandler* handler)
     {
-        stop();
+        handler->routingChanged = std::bind (&ControllerMapInput::rebuild, this);
         handlers.add (handler);
-        start();
+        rebuild();
+    }
+
+    /** Notifies parameter listeners of mapped changes and flushes held 14 bit
+        MSBs. Call this periodically on the message thread */
+    void updateGestures (const uint32 now)
+    {
+        flushHeldControllers();
+        for (auto* const handler : handlers)
+            handler->updateGestures (now);
+    }
+
+    /** While true, changes to handlers don't rebuild the dispatch table.
+        Setting back to false rebuilds it once if anything changed.
+     */
+    void setDeferUpdates (bool defer)
+    {
+        deferUpdates = defer;
+        if (! deferUpdates && rebuildPending)
+            rebuild();
     }
 
 private:
+    /** Immutable lookup of handlers by (type, channel, number). Built on the
+        message thread and swapped in atomically.
+
+        Notes and 7/14 bit controllers are looked up directly. NRPN and RPN
+        numbers are 14 bit so those handlers are kept in a sorted list and
+        found with a binary search.
+     */
+    struct DispatchTable
+    {
+        enum { controllerType = 0, controller14BitType, noteType, numTypes };
+        enum { numChannelSlots = 17 }; // 0 == omni
+
+        struct Range
+        {
+            uint16 start = 0;
+            uint16 size = 0;
+        };
+
+        struct ParameterEntry
+        {
+            uint32 key;
+            ControllerMapHandler* handler;
+            bool operator< (const ParameterEntry& other) const noexcept { return key < other.key; }
+        };
+
+        struct ParameterControl
+        {
+            uint32 key;
+            ControllerDevice::Control control;
+        };
+
+        Range ranges [numTypes][numChannelSlots][128];
+        bool mapped [numTypes][128];
+        ControllerDevice::Control controls [numTypes][128];
+        Array<ControllerMapHandler*> handlers;
+        Array<ParameterEntry> parameterHandlers;
+        Array<ParameterControl> parameterControls;
+
+        DispatchTable()
+        {
+            zerostruct (mapped);
+        }
+
+        static int getDenseType (ControllerEvent::Type type)
+        {
+            return type == ControllerEvent::Controller ? controllerType
+                 : type == ControllerEvent::Controller14Bit ? controller14BitType : -1;
+        }
+
+        static uint32 makeKey (ControllerEvent::Type type, int channelSlot, int number)
+        {
+            return ((uint32) type << 19) | ((uint32) channelSlot << 14) | ((uint32) number & 0x3fff);
+        }
+
+        void dispatchNote (ControllerMapInput& input, const MidiMessage& message) const
+        {
+            const int number = message.getNoteNumber();
+            if (! mapped [noteType][number])
+                return;
+
+            if (message.isNoteOn())
+                input.capture (controls [noteType][number], message);
+
+            const int channel = jlimit (0, 16, message.getChannel());
+            dispatchRange (ranges [noteType][0][number], message);
+            if (channel > 0)
+                dispatchRange (ranges [noteType][channel][number], message);
+        }
+
+        void dispatchController (ControllerMapInput& input, const ControllerEvent& event,
+                                 const MidiMessage& message) const
+        {
+            const int type = getDenseType (event.type);
+            if (type >= 0)
+            {
+                if (! mapped [type][event.number])
+                    return;
+                input.capture (controls [type][event.number], message);
+                dispatchRange (ranges [type][0][event.number], event);
+                dispatchRange (ranges [type][event.channel][event.number], event);
+                return;
+            }
+
+            const uint32 controlKey = makeKey (event.type, 0, event.number);
+            for (const auto& entry : parameterControls)
+            {
+                if (entry.key == controlKey)
+                {
+                    input.capture (entry.control, message);
+                    break;
+                }
+            }
+
+            dispatchParameter (makeKey (event.type, 0, event.number), event);
+            dispatchParameter (makeKey (event.type, event.channel, event.number), event);
+        }
+
+    private:
+        void dispatchRange (const Range& range, const MidiMessage& message) const
+        {
+            for (int i = range.start; i < range.start + range.size; ++i)
+            {
+                auto* const handler = handlers.getUnchecked (i);
+                if (handler->wants (message))
+                    handler->perform (message);
+            }
+        }
+
+        void dispatchRange (const Range& range, const ControllerEvent& event) const
+        {
+            for (int i = range.start; i < range.start + range.size; ++i)
+            {
+                auto* const handler = handlers.getUnchecked (i);
+                if (handler->wantsController (event))
+                    handler->performController (event);
+            }
+        }
+
+        void dispatchParameter (const uint32 key, const ControllerEvent& event) const
+        {
+            const ParameterEntry probe { key, nullptr };
+            for (auto* entry = std::lower_bound (parameterHandlers.begin(), parameterHandlers.end(), probe);
+                 entry != parameterHandlers.end() && entry->key == key; ++entry)
+            {
+                if (entry->handler->wantsController (event))
+                    entry->handler->performController (event);
+            }
+        }
+    };
+
     MidiEngine& midi;
     MappingEngine& mapping;
     ControllerDevice controllerDevice;
-    std::unique_ptr<MidiInput> midiInput;
     OwnedArray<ControllerMapHandler> handlers;
-    BigInteger controllerNumbers, noteNumbers;
-    HashMap<int, ControllerDevice::Control> controls, notes;
+
+    std::atomic<DispatchTable*> table { nullptr };
+    std::atomic<int> numReaders { 0 };
+    OwnedArray<DispatchTable> retired;
+    ControllerEventParser parser;
+    SpinLock parserLock;
+    bool deferUpdates = false;
+    bool rebuildPending = false;
+
+    void capture (const ControllerDevice::Control& control, const MidiMessage& message)
+    {
+        mapping.captureNextEvent (*this, control, message);
+    }
+
+    void rebuild()
+    {
+        if (deferUpdates)
+        {
+            rebuildPending = true;
+            return;
+        }
+
+        rebuildPending = false;
+        std::unique_ptr<DispatchTable> newTable (new DispatchTable());
+
+        for (int i = controllerDevice.getNumControls(); --i >= 0;)
+        {
+            const auto control (controllerDevice.getControl (i));
+            ControllerEvent::Type controllerType;
+            if (control.isNoteEvent())
+            {
+                const int number = control.getEventId() & 127;
+                newTable->mapped [DispatchTable::noteType][number] = true;
+                newTable->controls [DispatchTable::noteType][number] = control;
+            }
+            else if (getControllerEventType (control, controllerType))
+            {
+                const int type = DispatchTable::getDenseType (controllerType);
+                if (type >= 0)
+                {
+                    const int number = control.getEventId() & 127;
+                    newTable->mapped [type][number] = true;
+                    newTable->controls [type][number] = control;
+                }
+                else
+                {
+                    newTable->parameterControls.add ({ DispatchTable::makeKey (controllerType, 0, control.getEventId()), control });
+                }
+            }
+        }
+
+        // lay handlers out contiguously per (type, channel, number) cell
+        auto denseTypeFor = [](const ControllerMapHandler& handler) -> int
+        {
+            return handler.handlesNotes() ? (int) DispatchTable::noteType
+                                          : DispatchTable::getDenseType (handler.getControllerType());
+        };
+
+        auto cellFor = [&newTable, &denseTypeFor](const ControllerMapHandler& handler) -> DispatchTable::Range&
+        {
+            return newTable->ranges [denseTypeFor (handler)][jlimit (0, 16, handler.getMidiChannel())][handler.getMidiNumber() & 127];
+        };
+
+        for (auto* const handler : handlers)
+        {
+            if (denseTypeFor (*handler) >= 0)
+            {
+                ++cellFor (*handler).size;
+            }
+            else
+            {
+                newTable->parameterHandlers.add ({ DispatchTable::makeKey (handler->getControllerType(),
+                    jlimit (0, 16, handler->getMidiChannel()), handler->getMidiNumber()), handler });
+            }
+        }
+
+        std::stable_sort (newTable->parameterHandlers.begin(), newTable->parameterHandlers.end());
+
+        uint16 offset = 0;
+        for (auto& byChannel : newTable->ranges)
+            for (auto& byNumber : byChannel)
+                for (auto& range : byNumber)
+                {
+                    range.start = offset;
+                    offset += range.size;
+                    range.size = 0;
+                }
+
+        newTable->handlers.insertMultiple (0, nullptr, handlers.size());
+        for (auto* const handler : handlers)
+        {
+            if (denseTypeFor (*handler) < 0)
+                continue;
+            auto& range = cellFor (*handler);
+            newTable->handlers.set (range.start + range.size++, handler);
+        }
+
+        if (auto* const oldTable = table.exchange (newTable.release()))
+            retired.add (oldTable);
+        if (numReaders.load() == 0)
+            retired.clear (true);
+    }
+
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR(ControllerMapInput)
 };
 
-class MappingEngine::Inputs
+class MappingEngine::Inputs : private Timer
 {
 public:
     Inputs() { }
-    ~Inputs() { }
+    ~Inputs() { stopTimer(); }
 
     bool add (ControllerMapInput* input)
     {
@@ -561,6 +1000,7 @@ public:
             input->start();
 
         running = true;
+        startTimerHz (30);
     }
 
     void stop()
@@ -568,6 +1008,8 @@ public:
         running = false;
         for (auto* input : inputs)
             input->stop();
+        stopTimer();
+        timerCallback();
     }
 
     ControllerMapInput* findInput (const ControllerDevice& controller) const
@@ -596,6 +1038,13 @@ public:
 private:
     OwnedArray<ControllerMapInput> inputs;
     bool running = false;
+
+    void timerCallback() override
+    {
+        const auto now = Time::getMillisecondCounter();
+        for (auto* const input : inputs)
+            input->updateGestures (now);
+    }
 };
 
 MappingEngine::MappingEngine()
@@ -617,6 +1066,7 @@ bool MappingEngine::addInput (const ControllerDevice& controller, MidiEngine& mi
     
     std::unique_ptr<ControllerMapInput> input;
     input.reset (new ControllerMapInput (*this, midi, controller));
+    input->setDeferUpdates (updateDepth > 0);
 
     DBG("[EL] MappingEngine: added input handler for controller: " << controller.getName().toString());
     return inputs->add (input.release());
@@ -634,13 +1084,13 @@ bool MappingEngine::addHandler (const ControllerDevice::Control& control,
     {
         if (auto* input = inputs->findInput (control.getControllerDevice()))
         {
-            const auto message (control.getMidiMessage());
             std::unique_ptr<ControllerMapHandler> handler;
+            ControllerEvent::Type controllerType;
 
-            if (message.isController())
-                handler.reset (new MidiCCControllerMapHandler (control, message, node, parameter));
-            else if (message.isNoteOn())
-                handler.reset (new MidiNoteControllerMap (control, message, node, parameter));
+            if (control.isNoteEvent())
+                handler.reset (new MidiNoteControllerMap (control, control.getMidiMessage(), node, parameter));
+            else if (getControllerEventType (control, controllerType))
+                handler.reset (new MidiCCControllerMapHandler (control, controllerType, node, parameter));
 
             if (nullptr != handler)
             {
@@ -652,6 +1102,21 @@ bool MappingEngine::addHandler (const ControllerDevice::Control& control,
     return false;
 }
 
+void MappingEngine::beginUpdate()
+{
+    if (updateDepth++ == 0)
+        for (auto* const input : *inputs)
+            input->setDeferUpdates (true);
+}
+
+void MappingEngine::endUpdate()
+{
+    jassert (updateDepth > 0);
+    if (--updateDepth == 0)
+        for (auto* const input : *inputs)
+            input->setDeferUpdates (false);
+}
+
 bool MappingEngine::removeInput (const ControllerDevice& controller)
 {
     if (! inputs->containsInputFor (controller))
@@ -41,6 +41,14 @@ public:
     bool addInput (const ControllerDevice&, MidiEngine&);
     bool addHandler (const ControllerDevice::Control&, const Node&, const int);
 
+    /** Call before adding many handlers at once. Inputs keep running and
+        their dispatch tables are rebuilt once at the matching endUpdate().
+     */
+    void beginUpdate();
+
+    /** Ends a bulk update started with beginUpdate() */
+    void endUpdate();
+
     bool removeInput (const ControllerDevice&);
     bool refreshInput (const ControllerDevice&);
     void clear();
@@ -55,6 +63,7 @@ public:
 private:
     friend class ControllerMapInput;
     class Inputs; std::unique_ptr<Inputs> inputs;
+    int updateDepth = 0;
 
     class CapturedEvent : public AsyncUpdater
     {
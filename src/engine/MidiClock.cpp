@@ -21,47 +21,120 @@
 
 namespace Element
 {
-    
+
 void MidiClock::process (const MidiMessage& msg)
 {
     jassert (sampleRate > 0.0 && blockSize > 0);
     jassert (msg.isMidiClock() || msg.isSongPositionPointer());
-    
+
+    const double time = msg.getTimeStamp();
+
+    // a gap of several periods means the master went away
+    if (midiClockTicks > 0 && time - lastTickTime > jmax (0.25, 8.0 * e2))
+        signalDropped();
+
+    lastTickTime = time;
+
     if (midiClockTicks <= 0)
     {
-        dll.reset (msg.getTimeStamp(), (double)blockSize / sampleRate, 1.0);
-        dll.setParams ((double)blockSize / sampleRate, 1.0);
+        resetLoop (time, 60.0 / (24.0 * tempo.get()));
+        ++midiClockTicks;
+        return;
     }
-    else
+
+    const double error = time - t1;
+
+    if (midiClockTicks == 1)
     {
-        dll.update (msg.getTimeStamp());
+        // second tick gives the first real period estimate
+        resetLoop (time, jmax (1.0e-4, time - t0));
+        ++midiClockTicks;
+        return;
     }
-    
+
+    // track the phase error statistics
+    const double avgCoeff = 1.0 / 96.0;
+    errorMean    += avgCoeff * (error - errorMean);
+    errorSquared += avgCoeff * (error * error - errorSquared);
+    const double rms = std::sqrt (jmax (0.0, errorSquared));
+    jitter.set (rms);
+    drift.set (errorMean);
+
+    // adapt the bandwidth: narrow while the error is within the jitter,
+    // open back up when it is well outside of it
+    double bw = bandwidth.get();
+    if (midiClockTicks > syncPeriodTicks && std::abs (error) > jmax (4.0 * rms, 0.1 * e2))
+        bw = maxBandwidth;
+    else
+        bw = jmax (minBandwidth, bw * 0.98);
+    bandwidth.set (bw);
+
+    const double omega = MathConstants<double>::twoPi * bw * e2;
+    const double b = MathConstants<double>::sqrt2 * omega;
+    const double c = omega * omega;
+
+    t0  = t1;
+    t1 += b * error + e2;
+    e2 += c * error;
+
     if (midiClockTicks == syncPeriodTicks)
+    {
+        locked.set (1);
         for (auto* listener : listeners)
             listener->midiClockSignalAcquired();
-    
-    if (midiClockTicks >= syncPeriodTicks && msg.getTimeStamp() - timeOfLastUpdate >= 1.0)
+    }
+
+    if (midiClockTicks >= syncPeriodTicks && time - timeOfLastUpdate >= bpmUpdateSeconds)
     {
-        lastKnownTimeDiff   = dll.timeDiff();
-        const double bpm    = 60.0 / (lastKnownTimeDiff * 24.0);
-        timeOfLastUpdate    = msg.getTimeStamp();
+        const double bpm    = 60.0 / (e2 * 24.0);
+        timeOfLastUpdate    = time;
         
         if (bpm >= 20.0 && bpm <= 999.0)
+        {
+            tempo.set (bpm);
             for (auto* listener : listeners)
                 listener->midiClockTempoChanged (bpm);
+        }
     }
-    
+
     ++midiClockTicks;
 }
 
+void MidiClock::resetLoop (const double time, const double period)
+{
+    e2 = period;
+    t0 = time;
+    t1 = time + period;
+    bandwidth.set (maxBandwidth);
+}
+
+void MidiClock::signalDropped()
+{
+    const bool wasLocked = isLocked();
+    reset (sampleRate, blockSize);
+    if (wasLocked)
+        for (auto* listener : listeners)
+            listener->midiClockSignalDropped();
+}
+
 void MidiClock::reset (const double sr, const int bs)
 {
     sampleRate          = sr;
     blockSize           = bs;
     timeOfLastUpdate    = 0.0;
-    lastKnownTimeDiff   = 0.0;
     midiClockTicks      = 0;
+    errorMean = errorSquared = 0.0;
+    locked.set (0);
+    jitter.set (0.0);
+    drift.set (0.0);
+    bandwidth.set (maxBandwidth);
+}
+
+void MidiClock::setBandwidthRange (double minHz, double maxHz)
+{
+    jassert (minHz > 0.0 && maxHz >= minHz);
+    minBandwidth = minHz;
+    maxBandwidth = maxHz;
 }
 
 void MidiClock::addListener (Listener* listener)
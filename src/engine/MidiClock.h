@@ -22,7 +22,14 @@
 #include "ElementApp.h"
 
 namespace Element {
-    
+
+/** Follows an external 24 ppq MIDI clock.
+
+    Clock ticks are fed through a second order delay-locked loop. The loop
+    starts with a wide bandwidth so it acquires quickly, then narrows as long
+    as the phase error stays within the measured jitter. A phase error well
+    outside of that (e.g. a tempo change on the master) opens it back up.
+ */
 class MidiClock
 {
 public:
@@ -45,81 +52,138 @@ public:
     
     void addListener (Listener*);
     void removeListener (Listener*);
-    
+
+    /** Set the range the loop bandwidth adapts within, in Hz */
+    void setBandwidthRange (double minHz, double maxHz);
+
+    /** Returns true if the loop is locked to the incoming clock */
+    bool isLocked() const                   { return locked.get() != 0; }
+
+    /** Returns the tempo being tracked */
+    double getTempo() const                 { return tempo.get(); }
+
+    /** Returns the RMS phase error of incoming ticks in seconds */
+    double getJitter() const                { return jitter.get(); }
+
+    /** Returns the average phase error of incoming ticks in seconds. A non zero
+        value means the loop is lagging (positive) or leading the master */
+    double getDrift() const                 { return drift.get(); }
+
+    /** Returns the current loop bandwidth in Hz */
+    double getBandwidth() const             { return bandwidth.get(); }
+
 private:
     double sampleRate = 0.0;
     int blockSize = 0;
-    DelayLockedLoop dll;
     double timeOfLastUpdate = 0.0;
-    double lastKnownTimeDiff = 0.0;
     int midiClockTicks = 0;
     int syncPeriodTicks = 48;
     double bpmUpdateSeconds = 1.0;
-    
+
+    double minBandwidth = 0.05;
+    double maxBandwidth = 2.0;
+
+    // loop state, see F. Adriaensen "Using a DLL to filter time"
+    double t0 = 0.0, t1 = 0.0, e2 = 0.0;
+    double lastTickTime = 0.0;
+    double errorMean = 0.0, errorSquared = 0.0;
+
+    Atomic<int> locked { 0 };
+    Atomic<double> tempo { 120.0 }, jitter { 0.0 }, drift { 0.0 }, bandwidth { 2.0 };
+
     Array<Listener*> listeners;
+
+    void resetLoop (double time, double period);
+    void signalDropped();
 };
 
+/** Generates 24 ppq MIDI clock from the engine.
+
+    The position between clocks is kept as a fraction so rounding never
+    accumulates into drift. Tempo changes are ramped across the block they
+    arrive in rather than applied at the block boundary.
+ */
 class MidiClockMaster
 {
 public:
     MidiClockMaster()
     {
         clockMessage = MidiMessage::midiClock();
-        updateCoefficients();
     }
 
     ~MidiClockMaster() noexcept { }
 
     inline void reset()
     {
-        pos = 0;
-        updateCoefficients();
+        clocksUntilNext = 0.0;
+        lastTempo = tempo;
     }
 
     inline void setTempo (const double newTempo) noexcept
     {
-        if (tempo == newTempo)
-            return;
+        jassert (newTempo > 0.0);
         tempo = newTempo;
-        updateCoefficients();
     }
 
     inline void setSampleRate (const double newSampleRate) noexcept
     {
-        if (sampleRate == newSampleRate)
-            return;
+        jassert (newSampleRate > 0.0);
         sampleRate = newSampleRate;
-        updateCoefficients();
+    }
+
+    /** Returns the position of the next clock in samples relative to the end
+        of the last rendered block */
+    inline double getSamplesUntilNextClock() const noexcept
+    {
+        return clocksUntilNext / clocksPerSample (tempo);
     }
 
     inline void render (MidiBuffer& midi, int numSamples) noexcept
     {
-        if (samplesPerClock <= 0)
+        if (numSamples <= 0)
             return;
 
-        int frame = static_cast<int> (pos % samplesPerClock);
-        if (frame > 0) frame = samplesPerClock - frame;
-        while (frame < numSamples)
+        // clock rate ramps linearly from the last tempo to the current one
+        const double rate0 = clocksPerSample (lastTempo);
+        const double slope = (clocksPerSample (tempo) - rate0) / (double) numSamples;
+
+        double t = 0.0;
+        for (;;)
         {
-            midi.addEvent (clockMessage, frame);
-            frame += samplesPerClock;
+            const double rate = rate0 + slope * t;
+            const double disc = rate * rate + 2.0 * slope * clocksUntilNext;
+            if (disc < 0.0)
+                break;
+
+            // solve integral(rate) = clocksUntilNext for the time of the next clock
+            const double dt = clocksUntilNext <= 0.0 ? 0.0
+                : (2.0 * clocksUntilNext) / (rate + std::sqrt (disc));
+            if (t + dt >= (double) numSamples)
+                break;
+
+            t += dt;
+            midi.addEvent (clockMessage, jlimit (0, numSamples - 1, static_cast<int> (t)));
+            clocksUntilNext = 1.0;
         }
 
-        pos += numSamples;
+        const double remaining = (double) numSamples - t;
+        const double rate = rate0 + slope * t;
+        clocksUntilNext -= remaining * (rate + 0.5 * slope * remaining);
+        if (clocksUntilNext < 0.0)
+            clocksUntilNext = 0.0;
+        lastTempo = tempo;
     }
 
 private:
     MidiMessage clockMessage;
-    int64 pos = 0;
     double tempo = 120.0;
+    double lastTempo = 120.0;
     double sampleRate = 44100.0;
-    int samplesPerClock = 0;
-    double clocksPerMinute = 1.0;
+    double clocksUntilNext = 0.0;
 
-    void updateCoefficients()
+    inline double clocksPerSample (double bpm) const noexcept
     {
-        clocksPerMinute = 24.f * tempo;
-        samplesPerClock = roundToIntAccurate ((60.0 * sampleRate) / clocksPerMinute);
+        return (24.0 * bpm) / (60.0 * sampleRate);
     }
 };
 
@@ -26,6 +26,7 @@ namespace Element {
 void MidiEngine::applySettings (Settings& settings)
 {
     midiInsFromXml.clear();
+    midiOutsFromXml.clear();
 
     if (auto xml = std::unique_ptr<XmlElement> (settings.getUserSettings()->getXmlValue (Settings::midiEngineKey)))
     {
@@ -42,12 +43,21 @@ void MidiEngine::applySettings (Settings& settings)
                         midiInsFromXml.add (child [Tags::name]);
                 }
             }
+            else if (child.hasType ("output"))
+            {
+                if ((bool) child [Tags::active])
+                    midiOutsFromXml.add (child [Tags::name]);
+            }
         }
 
         for (auto& m : MidiInput::getDevices())
             setMidiInputEnabled (m, midiInsFromXml.contains (m));
 
         setDefaultMidiOutput (data ["defaultMidiOutput"].toString());
+
+        for (auto& m : MidiOutput::getDevices())
+            if (m != defaultMidiOutputName)
+                setMidiOutputEnabled (m, midiOutsFromXml.contains (m));
     }
 }
 
@@ -58,7 +68,7 @@ void MidiEngine::writeSettings (Settings& settings)
     {
         ValueTree input ("input");
         input.setProperty (Tags::name, holder->input->getName(), nullptr)
-             .setProperty (Tags::active, holder->active, nullptr);
+             .setProperty (Tags::active, holder->active.load(), nullptr);
         data.appendChild (input, nullptr);
     }
 
@@ -79,6 +89,24 @@ void MidiEngine::writeSettings (Settings& settings)
         }
     }
 
+    StringArray outputNames;
+    for (auto* const output : extraMidiOutputs)
+        outputNames.add (output->getName());
+    
+    // keep enabled outputs which are currently disconnected
+    const StringArray availableMidiOutputs (MidiOutput::getDevices());
+    for (const auto& name : midiOutsFromXml)
+        if (! availableMidiOutputs.contains (name, true))
+            outputNames.addIfNotAlreadyThere (name);
+
+    for (const auto& name : outputNames)
+    {
+        ValueTree output ("output");
+        output.setProperty (Tags::name, name, nullptr)
+              .setProperty (Tags::active, true, nullptr);
+        data.appendChild (output, nullptr);
+    }
+
     data.setProperty ("defaultMidiOutput", defaultMidiOutputName, nullptr);
 
     if (auto xml = std::unique_ptr<XmlElement> (data.createXml()))
@@ -135,22 +163,90 @@ void MidiEngine::MidiInputHolder::handleIncomingMidiMessage (MidiInput* source,
         return;
 
     jassert (source == input.get());
-    const ScopedLock sl (engine.midiCallbackLock);
+    const ScopedCallbackReader reader (engine);
+    const auto* const snapshot = reader.get();
+    if (snapshot == nullptr || ! isPositiveAndBelow (index, snapshot->devices.size()))
+        return;
 
-    for (auto& mc : engine.midiCallbacks)
-        if ((active || mc.consumer) && (mc.deviceName.isEmpty() || mc.deviceName == input->getName()))
-            mc.callback->handleIncomingMidiMessage (input.get(), message);
+    const auto* const device = snapshot->devices.getUnchecked (index);
+    for (auto* const callback : device->consumers)
+        callback->handleIncomingMidiMessage (source, message);
+    if (active.load (std::memory_order_relaxed))
+        for (auto* const callback : device->listeners)
+            callback->handleIncomingMidiMessage (source, message);
 }
 
 //==============================================================================
 MidiEngine::MidiEngine()
 {
     callbackHandler.reset (new CallbackHandler (*this));
+    updateCallbackSnapshot();
 }
 
 MidiEngine::~MidiEngine()
 {
+    outputScheduler.setOutputs ({});
+    extraMidiOutputs.clear();
+    defaultMidiOutput.reset();
     callbackHandler.reset (nullptr);
+
+    for (auto* const holder : openMidiInputs)
+        holder->input->stop();
+    delete callbackSnapshot.exchange (nullptr);
+    jassert (numCallbackReaders[0].load() == 0 && numCallbackReaders[1].load() == 0);
+    retiredSnapshots.clear (true);
+}
+
+thread_local int MidiEngine::ScopedCallbackReader::readDepth = 0;
+
+//==============================================================================
+void MidiEngine::updateCallbackSnapshot()
+{
+    std::unique_ptr<CallbackSnapshot> snapshot (new CallbackSnapshot());
+
+    for (auto* const holder : openMidiInputs)
+    {
+        auto* const device = snapshot->devices.add (new CallbackSnapshot::DeviceCallbacks());
+        device->input = holder->input.get();
+        const auto name = holder->input->getName();
+
+        for (const auto& mc : midiCallbacks)
+        {
+            if (mc.deviceName.isNotEmpty() && mc.deviceName != name)
+                continue;
+            if (mc.consumer)
+                device->consumers.add (mc.callback);
+            else
+                device->listeners.add (mc.callback);
+        }
+    }
+
+    for (const auto& mc : midiCallbacks)
+    {
+        snapshot->all.add (mc.callback);
+        if (mc.consumer || mc.deviceName.isEmpty())
+            snapshot->unfiltered.add (mc.callback);
+    }
+
+    std::unique_ptr<CallbackSnapshot> oldSnapshot (callbackSnapshot.exchange (snapshot.release()));
+
+    // Flip the generation so new readers count separately, then wait for
+    // readers which might still hold the old snapshot. Only this thread ever
+    // waits, MIDI and audio threads never block. If called from within a
+    // callback the wait would never finish, so retire the old one instead.
+    const int oldSlot = callbackGeneration.fetch_add (1) & 1;
+    if (ScopedCallbackReader::readDepth > 0)
+    {
+        if (oldSnapshot != nullptr)
+            retiredSnapshots.add (oldSnapshot.release());
+        return;
+    }
+
+    while (numCallbackReaders[oldSlot].load() > 0)
+        Thread::yield();
+
+    if (numCallbackReaders[0].load() == 0 && numCallbackReaders[1].load() == 0)
+        retiredSnapshots.clear (true);
 }
 
 //==============================================================================
@@ -171,8 +267,11 @@ MidiEngine::MidiInputHolder* MidiEngine::getMidiInput (const String& deviceName,
         if (auto midiIn = MidiInput::openDevice (index, holder.get()))
         {
             holder->input.reset (midiIn.release());
-            holder->input->start();
-            return openMidiInputs.add (holder.release());
+            holder->index = openMidiInputs.size();
+            auto* const added = openMidiInputs.add (holder.release());
+            updateCallbackSnapshot();
+            added->input->start();
+            return added;
         }
     }
 
@@ -224,59 +323,78 @@ void MidiEngine::addMidiInputCallback (const String& name, MidiInputCallback* ca
         mc.deviceName = name;
         mc.callback = callbackToAdd;
         mc.consumer = consumer;
-
-        const ScopedLock sl (midiCallbackLock);
         midiCallbacks.add (mc);
+        updateCallbackSnapshot();
     }
 }
 
 void MidiEngine::removeMidiInputCallback (const String& name, MidiInputCallback* callbackToRemove)
 {
+    bool removed = false;
     for (int i = midiCallbacks.size(); --i >= 0;)
     {
-        auto& mc = midiCallbacks.getReference (i);
-
+        const auto& mc = midiCallbacks.getReference (i);
         if (mc.callback == callbackToRemove && mc.deviceName == name)
         {
-            const ScopedLock sl (midiCallbackLock);
             midiCallbacks.remove (i);
+            removed = true;
         }
     }
+
+    if (removed)
+        updateCallbackSnapshot();
 }
 
 void MidiEngine::removeMidiInputCallback (MidiInputCallback* callbackToRemove)
 {
+    bool removed = false;
     for (int i = midiCallbacks.size(); --i >= 0;)
     {
-        auto& mc = midiCallbacks.getReference (i);
-
-        if (mc.callback == callbackToRemove)
+        if (midiCallbacks.getReference(i).callback == callbackToRemove)
         {
-            const ScopedLock sl (midiCallbackLock);
             midiCallbacks.remove (i);
+            removed = true;
         }
     }
+
+    if (removed)
+        updateCallbackSnapshot();
 }
 
 void MidiEngine::handleIncomingMidiMessageInt (MidiInput* source, const MidiMessage& message)
 {
-    if (! message.isActiveSense())
-    {
-        const ScopedLock sl (midiCallbackLock);
+    if (message.isActiveSense())
+        return;
+
+    const ScopedCallbackReader reader (*this);
+    const auto* const snapshot = reader.get();
+    if (snapshot == nullptr)
+        return;
 
-        for (auto& mc : midiCallbacks)
-            if (mc.consumer || mc.deviceName.isEmpty() || mc.deviceName == source->getName())
-                mc.callback->handleIncomingMidiMessage (source, message);
+    if (const auto* const device = snapshot->findDevice (source))
+    {
+        for (auto* const callback : device->consumers)
+            callback->handleIncomingMidiMessage (source, message);
+        for (auto* const callback : device->listeners)
+            callback->handleIncomingMidiMessage (source, message);
+    }
+    else
+    {
+        for (auto* const callback : snapshot->unfiltered)
+            callback->handleIncomingMidiMessage (source, message);
     }
 }
 
 void MidiEngine::processMidiBuffer (const MidiBuffer& buffer, int nframes, double sampleRate)
 {
+    const ScopedCallbackReader reader (*this);
+    const auto* const snapshot = reader.get();
+    if (snapshot == nullptr || snapshot->all.isEmpty())
+        return;
+
     MidiBuffer::Iterator iter (buffer);
     MidiMessage message; int frame = 0;
     const double timeNow = 1.5 + Time::getMillisecondCounterHiRes();
-    
-    const ScopedLock sl (midiCallbackLock);
 
     while (iter.getNextEvent (message, frame))
     {
@@ -284,8 +402,8 @@ void MidiEngine::processMidiBuffer (const MidiBuffer& buffer, int nframes, doubl
             break;
         
         message.setTimeStamp (timeNow + (1000.0 * (static_cast<double> (frame) / sampleRate)));
-        for (auto& mc : midiCallbacks)
-            mc.callback->handleIncomingMidiMessage (nullptr, message);
+        for (auto* const callback : snapshot->all)
+            callback->handleIncomingMidiMessage (nullptr, message);
     }
 }
 
@@ -305,28 +423,91 @@ void MidiEngine::setDefaultMidiOutput (const String& deviceName)
     {
         std::unique_ptr<MidiOutput> newMidiOut;
 
-        if (deviceName.isNotEmpty())
-            newMidiOut= MidiOutput::openDevice (MidiOutput::getDevices().indexOf (deviceName));
-
-        if (newMidiOut)
+        // an enabled output becoming the default is moved rather than reopened
+        for (int i = extraMidiOutputs.size(); --i >= 0;)
         {
-            newMidiOut->startBackgroundThread();
+            if (extraMidiOutputs.getUnchecked(i)->getName() == deviceName)
             {
-                ScopedLock sl (midiOutputLock);
-                defaultMidiOutput.swap (newMidiOut);
-            }
-
-            if (newMidiOut) // is now the old output
-            {
-                newMidiOut->stopBackgroundThread();
-                newMidiOut.reset();
+                newMidiOut.reset (extraMidiOutputs.removeAndReturn (i));
+                break;
             }
         }
 
+        if (newMidiOut == nullptr && deviceName.isNotEmpty())
+            newMidiOut = MidiOutput::openDevice (MidiOutput::getDevices().indexOf (deviceName));
+
+        defaultMidiOutput.swap (newMidiOut);
+        updateMidiOutputs();
+        newMidiOut.reset(); // is now the old output
+
         defaultMidiOutputName = deviceName;
 
         sendChangeMessage();
     }
 }
 
+void MidiEngine::setMidiOutputEnabled (const String& deviceName, bool enabled)
+{
+    if (deviceName.isEmpty() || enabled == isMidiOutputEnabled (deviceName))
+        return;
+
+    if (deviceName == defaultMidiOutputName)
+    {
+        jassert (! enabled);
+        setDefaultMidiOutput (String());
+        return;
+    }
+
+    if (enabled && defaultMidiOutputName.isEmpty())
+    {
+        setDefaultMidiOutput (deviceName);
+        return;
+    }
+
+    if (enabled)
+    {
+        if (auto newMidiOut = MidiOutput::openDevice (MidiOutput::getDevices().indexOf (deviceName)))
+        {
+            extraMidiOutputs.add (newMidiOut.release());
+            updateMidiOutputs();
+        }
+        midiOutsFromXml.addIfNotAlreadyThere (deviceName);
+    }
+    else
+    {
+        for (int i = extraMidiOutputs.size(); --i >= 0;)
+        {
+            if (extraMidiOutputs.getUnchecked(i)->getName() == deviceName)
+            {
+                std::unique_ptr<MidiOutput> oldMidiOut (extraMidiOutputs.removeAndReturn (i));
+                updateMidiOutputs();
+                oldMidiOut.reset();
+            }
+        }
+        midiOutsFromXml.removeString (deviceName);
+    }
+
+    sendChangeMessage();
+}
+
+bool MidiEngine::isMidiOutputEnabled (const String& deviceName) const
+{
+    if (deviceName.isNotEmpty() && deviceName == defaultMidiOutputName)
+        return true;
+    for (auto* const output : extraMidiOutputs)
+        if (output->getName() == deviceName)
+            return true;
+    return false;
+}
+
+void MidiEngine::updateMidiOutputs()
+{
+    Array<MidiOutput*> outputs;
+    if (defaultMidiOutput)
+        outputs.add (defaultMidiOutput.get());
+    for (auto* const output : extraMidiOutputs)
+        outputs.add (output);
+    outputScheduler.setOutputs (outputs);
+}
+
 }
@@ -18,6 +18,8 @@
 */
 
 #include "JuceHeader.h"
+#include "engine/MidiOutputScheduler.h"
+#include <atomic>
 
 #pragma once
 
@@ -114,9 +116,23 @@ public:
     */
     MidiOutput* getDefaultMidiOutput() const noexcept               { return defaultMidiOutput.get(); }
 
-    void processMidiBuffer (const MidiBuffer& buffer, int nframes, double sampleRate);
+    /** Enables or disables a midi output device.
+
+        Rendered MIDI is sent to the default output and every enabled output.
+        Enabling an output when there is no default makes it the default.
+        Disabling the default output deselects it.
+
+        @see isMidiOutputEnabled, setDefaultMidiOutput
+     */
+    void setMidiOutputEnabled (const String& deviceName, bool enabled);
+
+    /** Returns true if the output is the default or has been enabled */
+    bool isMidiOutputEnabled (const String& deviceName) const;
 
-    CriticalSection& getMidiOutputLock() { return midiOutputLock; }
+    /** Returns the scheduler which sends engine output to the enabled devices */
+    MidiOutputScheduler& getMidiOutputScheduler() noexcept          { return outputScheduler; }
+
+    void processMidiBuffer (const MidiBuffer& buffer, int nframes, double sampleRate);
 
 private:
     struct MidiCallbackInfo
@@ -138,7 +154,8 @@ private:
             : engine (e) { }
 
         std::unique_ptr<MidiInput> input;
-        bool active = false;  // if true, then will feed to audio engine
+        std::atomic<bool> active { false };  // if true, then will feed to audio engine
+        int index = -1;  // position in openMidiInputs and the callback snapshot
 
         void handleIncomingMidiMessage (MidiInput* source, const MidiMessage& message) override;
 
@@ -146,19 +163,98 @@ private:
         MidiEngine& engine;
     };
 
+    /** Immutable view of the registered callbacks, filtered per input. MIDI
+        threads and the audio thread read the current snapshot without locking.
+        The message thread builds a new one whenever callbacks or inputs change
+        and swaps it in. It then waits for readers of the old snapshot to finish
+        so that a removed callback is never called after removal returns.
+     */
+    struct CallbackSnapshot
+    {
+        struct DeviceCallbacks
+        {
+            MidiInput* input = nullptr;
+            Array<MidiInputCallback*> consumers;    // called regardless of active state
+            Array<MidiInputCallback*> listeners;    // called if the input is active
+        };
+
+        OwnedArray<DeviceCallbacks> devices;        // same order as openMidiInputs
+        Array<MidiInputCallback*> all;
+        Array<MidiInputCallback*> unfiltered;       // consumers and callbacks for any device
+
+        const DeviceCallbacks* findDevice (const MidiInput* input) const noexcept
+        {
+            for (auto* const device : devices)
+                if (device->input == input)
+                    return device;
+            return nullptr;
+        }
+    };
+
+    /** Marks the current thread as reading the callback snapshot. Readers
+        register with the current generation, see updateCallbackSnapshot()
+     */
+    struct ScopedCallbackReader
+    {
+        ScopedCallbackReader (const MidiEngine& e)
+            : engine (e), slot (enter (e))
+        {
+            ++readDepth;
+        }
+
+        ~ScopedCallbackReader()
+        {
+            --readDepth;
+            --engine.numCallbackReaders [slot];
+        }
+
+        const CallbackSnapshot* get() const noexcept    { return engine.callbackSnapshot.load(); }
+
+        static thread_local int readDepth;
+
+    private:
+        const MidiEngine& engine;
+        const int slot;
+
+        /** Counts this reader in the current generation's slot. If the
+            generation moved while registering, a writer may already be
+            waiting on the other slot, so register again */
+        static int enter (const MidiEngine& e) noexcept
+        {
+            for (;;)
+            {
+                const int generation = e.callbackGeneration.load();
+                const int s = generation & 1;
+                ++e.numCallbackReaders [s];
+                if (e.callbackGeneration.load() == generation)
+                    return s;
+                --e.numCallbackReaders [s];
+            }
+        }
+    };
+
     StringArray midiInsFromXml;
     OwnedArray<MidiInputHolder> openMidiInputs;
     Array<MidiCallbackInfo> midiCallbacks;
+    std::atomic<CallbackSnapshot*> callbackSnapshot { nullptr };
+    std::atomic<int> callbackGeneration { 0 };
+    mutable std::atomic<int> numCallbackReaders [2] { { 0 }, { 0 } };
+    OwnedArray<CallbackSnapshot> retiredSnapshots;
 
     String defaultMidiOutputName;
     std::unique_ptr<MidiOutput> defaultMidiOutput;
-    CriticalSection audioCallbackLock, midiCallbackLock, midiOutputLock;
+    OwnedArray<MidiOutput> extraMidiOutputs;
+    StringArray midiOutsFromXml;
+    MidiOutputScheduler outputScheduler;
+    CriticalSection audioCallbackLock;
 
     class CallbackHandler;
     std::unique_ptr<CallbackHandler> callbackHandler;
 
     MidiInputHolder* getMidiInput (const String& deviceName, bool openIfNotAlready);
     void handleIncomingMidiMessageInt (MidiInput*, const MidiMessage&);
+    void updateCallbackSnapshot();
+    void updateMidiOutputs();
 };
 
 }
@@ -0,0 +1,254 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+#include <atomic>
+
+namespace Element {
+
+/** A bounded multi-producer/single-consumer queue of time stamped MIDI events.
+
+    This is a replacement for MidiMessageCollector between the MIDI input
+    threads and the audio callback. Producers (device threads, the message thread)
+    never block each other or the audio thread, and the audio thread drains the
+    queue without taking a lock.
+
+    Events are placed in the block using their hardware timestamps so that MIDI
+    which arrived during the previous block period lands at the same relative
+    offset in the current one. This trades the random up-to-one-block jitter of
+    the collector for a constant one block of latency.
+
+    Messages too large to be stored inline (e.g. long SysEx dumps) go through a
+    locked overflow buffer which is only touched when it actually has content.
+ */
+class MidiInputQueue : public MidiKeyboardStateListener
+{
+public:
+    enum
+    {
+        capacity        = 1024,     // must be a power of two
+        maxInlineSize   = 32
+    };
+
+    MidiInputQueue()
+    {
+        static_assert ((capacity & (capacity - 1)) == 0, "capacity must be a power of two");
+        for (uint32 i = 0; i < (uint32) capacity; ++i)
+            slots[i].sequence.store (i, std::memory_order_relaxed);
+    }
+
+    ~MidiInputQueue() { }
+
+    //==========================================================================
+    /** Prepare for playback. Not realtime safe, call before the audio thread
+        starts draining.
+     */
+    void prepare (double newSampleRate, int maxBlockSize)
+    {
+        jassert (newSampleRate > 0.0);
+        sampleRate = newSampleRate;
+        const size_t bytes = (size_t) capacity * (maxInlineSize + 8);
+        pending.ensureSize (bytes);
+        scratch.ensureSize (bytes);
+        pending.clear();
+        scratch.clear();
+        ignoreUnused (maxBlockSize);
+
+        {
+            ScopedLock sl (overflowLock);
+            overflow.clear();
+            overflowPending.store (false, std::memory_order_relaxed);
+        }
+
+        // discard anything that arrived while stopped
+        while (pop ([](const Slot&) {})) {}
+    }
+
+    /** Set the number of samples events should be delayed by so they align
+        with the audio input of the device
+     */
+    void setLatencySamples (int samples)    { latencySamples.store (jmax (0, samples)); }
+
+    /** Returns the latency compensation in samples */
+    int getLatencySamples() const           { return latencySamples.load(); }
+
+    /** Returns the number of events dropped because the queue was full */
+    int getNumDropped() const               { return numDropped.load(); }
+
+    //==========================================================================
+    /** Add a message to the queue. Safe to call from any number of threads.
+        Messages with a zero timestamp are stamped with the current time.
+
+        @returns false if the message was dropped because the queue was full
+     */
+    bool addMessageToQueue (const MidiMessage& message)
+    {
+        const double timestamp = message.getTimeStamp() != 0.0
+            ? message.getTimeStamp() : Time::getMillisecondCounterHiRes() * 0.001;
+        const int size = message.getRawDataSize();
+
+        if (size > (int) maxInlineSize)
+        {
+            ScopedLock sl (overflowLock);
+            overflow.addEvent (message, 0);
+            overflowPending.store (true, std::memory_order_release);
+            return true;
+        }
+
+        uint32 pos = writePos.load (std::memory_order_relaxed);
+        Slot* slot = nullptr;
+
+        for (;;)
+        {
+            slot = &slots [pos & (capacity - 1)];
+            const uint32 seq = slot->sequence.load (std::memory_order_acquire);
+            const int32 diff = (int32) (seq - pos);
+
+            if (diff == 0)
+            {
+                if (writePos.compare_exchange_weak (pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+            {
+                numDropped.fetch_add (1);
+                return false;
+            }
+            else
+            {
+                pos = writePos.load (std::memory_order_relaxed);
+            }
+        }
+
+        slot->timestamp = timestamp;
+        slot->size = (uint16) size;
+        memcpy (slot->data, message.getRawData(), (size_t) size);
+        slot->sequence.store (pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    //==========================================================================
+    /** Adds the next block of messages to the destination buffer. Call this from
+        the audio thread once per block. Does not clear the destination buffer.
+     */
+    void removeNextBlockOfMessages (MidiBuffer& dest, const int numSamples)
+    {
+        jassert (sampleRate > 0.0);
+        if (numSamples <= 0)
+            return;
+
+        const double blockStart = (Time::getMillisecondCounterHiRes() * 0.001)
+                                - ((double) numSamples / sampleRate);
+        const int latency = latencySamples.load (std::memory_order_relaxed);
+
+        if (! pending.isEmpty())
+        {
+            MidiBuffer::Iterator iter (pending);
+            const uint8* data; int size, frame;
+            while (iter.getNextEvent (data, size, frame))
+            {
+                if (frame < numSamples)
+                    dest.addEvent (data, size, frame);
+                else
+                    scratch.addEvent (data, size, frame - numSamples);
+            }
+
+            pending.swapWith (scratch);
+            scratch.clear();
+        }
+
+        while (pop ([&](const Slot& slot)
+        {
+            const int frame = latency + jmax (0, roundToInt ((slot.timestamp - blockStart) * sampleRate));
+            if (frame < numSamples)
+                dest.addEvent (slot.data, (int) slot.size, frame);
+            else
+                pending.addEvent (slot.data, (int) slot.size, frame - numSamples);
+        })) {}
+
+        if (overflowPending.load (std::memory_order_acquire))
+        {
+            ScopedTryLock sl (overflowLock);
+            if (sl.isLocked())
+            {
+                dest.addEvents (overflow, 0, -1, 0);
+                overflow.clear();
+                overflowPending.store (false, std::memory_order_relaxed);
+            }
+        }
+    }
+
+    //==========================================================================
+    /** @internal */
+    void handleNoteOn (MidiKeyboardState*, int midiChannel, int midiNoteNumber, float velocity) override
+    {
+        auto m = MidiMessage::noteOn (midiChannel, midiNoteNumber, velocity);
+        m.setTimeStamp (Time::getMillisecondCounterHiRes() * 0.001);
+        addMessageToQueue (m);
+    }
+
+    /** @internal */
+    void handleNoteOff (MidiKeyboardState*, int midiChannel, int midiNoteNumber, float velocity) override
+    {
+        auto m = MidiMessage::noteOff (midiChannel, midiNoteNumber, velocity);
+        m.setTimeStamp (Time::getMillisecondCounterHiRes() * 0.001);
+        addMessageToQueue (m);
+    }
+
+private:
+    struct Slot
+    {
+        std::atomic<uint32> sequence;
+        double timestamp = 0.0;
+        uint16 size = 0;
+        uint8 data [maxInlineSize];
+    };
+
+    Slot slots [capacity];
+    std::atomic<uint32> writePos { 0 };
+    uint32 readPos = 0;
+
+    double sampleRate = 44100.0;
+    std::atomic<int> latencySamples { 0 };
+    std::atomic<int> numDropped { 0 };
+
+    MidiBuffer pending, scratch;
+
+    CriticalSection overflowLock;
+    MidiBuffer overflow;
+    std::atomic<bool> overflowPending { false };
+
+    template<class Fn>
+    bool pop (Fn&& fn)
+    {
+        auto& slot = slots [readPos & (capacity - 1)];
+        if (slot.sequence.load (std::memory_order_acquire) != readPos + 1)
+            return false;
+        fn (slot);
+        slot.sequence.store (readPos + (uint32) capacity, std::memory_order_release);
+        ++readPos;
+        return true;
+    }
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MidiInputQueue)
+};
+
+}
@@ -0,0 +1,247 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/MidiOutputScheduler.h"
+
+namespace Element {
+
+MidiOutputScheduler::MidiOutputScheduler()
+    : Thread ("Element: MIDI Output")
+{
+    fifoData.calloc ((size_t) fifoSize);
+    pending.ensureStorageAllocated (2048);
+    readBuffer.ensureSize (512);
+    startThread (9);
+}
+
+MidiOutputScheduler::~MidiOutputScheduler()
+{
+    signalThreadShouldExit();
+    notify();
+    stopThread (1000);
+}
+
+//==============================================================================
+void MidiOutputScheduler::prepare (double newSampleRate, int outputLatencySamples)
+{
+    jassert (newSampleRate > 0.0);
+    sampleRate.set (newSampleRate);
+    latencySamples.set (jmax (0, outputLatencySamples));
+}
+
+void MidiOutputScheduler::setOutputs (const Array<MidiOutput*>& newOutputs)
+{
+    {
+        ScopedLock sl (outputLock);
+        outputs = newOutputs;
+        numOutputs.set (outputs.size() + (outputCallback ? 1 : 0));
+    }
+
+    notify();
+}
+
+void MidiOutputScheduler::setOutputCallback (std::function<void (const MidiMessage&)> callback)
+{
+    {
+        ScopedLock sl (outputLock);
+        outputCallback = callback;
+        numOutputs.set (outputs.size() + (outputCallback ? 1 : 0));
+    }
+
+    notify();
+}
+
+//==============================================================================
+void MidiOutputScheduler::schedule (const MidiBuffer& buffer, int numSamples, double callbackTimeMs)
+{
+    if (buffer.isEmpty() || ! hasOutputs())
+        return;
+
+    const double msPerSample = 1000.0 / sampleRate.get();
+    const double blockTimeMs = callbackTimeMs + msPerSample * (double) latencySamples.get();
+
+    const uint8* data; int size, frame;
+    int total = 0, numEvents = 0;
+    for (MidiBuffer::Iterator iter (buffer); iter.getNextEvent (data, size, frame);)
+    {
+        if (frame >= numSamples)
+            break;
+        total += (int) sizeof (EventHeader) + size;
+        ++numEvents;
+    }
+
+    int start1, size1, start2, size2;
+    fifo.prepareToWrite (total, start1, size1, start2, size2);
+    if (size1 + size2 < total)
+    {
+        numDropped.set (numDropped.get() + numEvents);
+        return;
+    }
+
+    int written = 0;
+    auto write = [&](const void* src, int n)
+    {
+        auto* bytes = static_cast<const uint8*> (src);
+        const int first = jlimit (0, n, size1 - written);
+        if (first > 0)
+            memcpy (fifoData + start1 + written, bytes, (size_t) first);
+        if (n > first)
+            memcpy (fifoData + start2 + (written + first - size1), bytes + first, (size_t) (n - first));
+        written += n;
+    };
+
+    for (MidiBuffer::Iterator iter (buffer); iter.getNextEvent (data, size, frame);)
+    {
+        if (frame >= numSamples)
+            break;
+        EventHeader header;
+        header.dueTimeMs = blockTimeMs + msPerSample * (double) frame;
+        header.size = (int32) size;
+        write (&header, (int) sizeof (EventHeader));
+        write (data, size);
+    }
+
+    // commit the whole block at once so the reader never sees a partial event
+    fifo.finishedWrite (written);
+}
+
+//==============================================================================
+MidiOutputScheduler::TimingStats MidiOutputScheduler::getTimingStats() const
+{
+    TimingStats stats;
+    stats.meanErrorMs   = meanError.get();
+    stats.maxErrorMs    = maxError.get();
+    stats.numSent       = numSent.get();
+    stats.numDropped    = numDropped.get();
+    return stats;
+}
+
+void MidiOutputScheduler::resetTimingStats()
+{
+    numDropped.set (0);
+    resetWanted.set (1);
+}
+
+//==============================================================================
+void MidiOutputScheduler::readBytes (void* dest, int size)
+{
+    int start1, size1, start2, size2;
+    fifo.prepareToRead (size, start1, size1, start2, size2);
+    jassert (size1 + size2 == size);
+    if (size1 > 0)
+        memcpy (dest, fifoData + start1, (size_t) size1);
+    if (size2 > 0)
+        memcpy (static_cast<uint8*> (dest) + size1, fifoData + start2, (size_t) size2);
+    fifo.finishedRead (size1 + size2);
+}
+
+void MidiOutputScheduler::readPending()
+{
+    while (fifo.getNumReady() >= (int) sizeof (EventHeader))
+    {
+        EventHeader header;
+        readBytes (&header, (int) sizeof (EventHeader));
+        readBuffer.ensureSize ((size_t) header.size);
+        readBytes (readBuffer.getData(), header.size);
+        insertPending (MidiMessage (readBuffer.getData(), header.size, header.dueTimeMs));
+    }
+}
+
+void MidiOutputScheduler::insertPending (const MidiMessage& message)
+{
+    // blocks arrive in order so this is nearly always an append
+    int index = pending.size();
+    while (index > 0 && pending.getReference (index - 1).getTimeStamp() > message.getTimeStamp())
+        --index;
+    pending.insert (index, message);
+}
+
+void MidiOutputScheduler::sendDue (const double now)
+{
+    int numDue = 0;
+    while (numDue < pending.size() && pending.getReference (numDue).getTimeStamp() <= now)
+        ++numDue;
+
+    if (numDue <= 0)
+        return;
+
+    {
+        ScopedLock sl (outputLock);
+        for (int i = 0; i < numDue; ++i)
+        {
+            const auto& message = pending.getReference (i);
+            for (auto* const output : outputs)
+                output->sendMessageNow (message);
+            if (outputCallback)
+                outputCallback (message);
+
+            const double error = Time::getMillisecondCounterHiRes() - message.getTimeStamp();
+            errorSum += error;
+            errorMax = jmax (errorMax, error);
+            ++errorCount;
+        }
+    }
+
+    pending.removeRange (0, numDue);
+
+    meanError.set (errorSum / (double) errorCount);
+    maxError.set (errorMax);
+    numSent.set (errorCount);
+}
+
+void MidiOutputScheduler::run()
+{
+    while (! threadShouldExit())
+    {
+        if (resetWanted.compareAndSetBool (0, 1))
+        {
+            errorSum = errorMax = 0.0;
+            errorCount = 0;
+            meanError.set (0.0);
+            maxError.set (0.0);
+            numSent.set (0);
+        }
+
+        if (! hasOutputs())
+        {
+            readPending();
+            pending.clearQuick();
+            wait (-1);
+            continue;
+        }
+
+        readPending();
+        sendDue (Time::getMillisecondCounterHiRes());
+
+        if (pending.isEmpty())
+        {
+            wait (1);
+            continue;
+        }
+
+        // sleep until just before the next message is due, then spin the rest
+        const double untilNext = pending.getReference(0).getTimeStamp() - Time::getMillisecondCounterHiRes();
+        if (untilNext > 2.0)
+            wait (jmin (5, roundToInt (untilNext - 1.0)));
+        else if (untilNext > 0.0)
+            Thread::yield();
+    }
+}
+
+}
@@ -0,0 +1,124 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace Element {
+
+/** Sends MIDI rendered by the audio engine to one or more output devices.
+
+    The audio thread hands each block to schedule() which only copies the
+    events into a lock-free FIFO. A dedicated high priority thread pulls them
+    out and sends each message when it is due, which is the time the block
+    will actually be heard: the callback time plus the device's output latency
+    plus the event's sample offset.
+
+    The scheduler measures the difference between when a message was due and
+    when it was actually sent, see getTimingStats()
+ */
+class MidiOutputScheduler : private Thread
+{
+public:
+    struct TimingStats
+    {
+        double meanErrorMs  = 0.0;
+        double maxErrorMs   = 0.0;
+        int64 numSent       = 0;
+        int numDropped      = 0;
+    };
+
+    MidiOutputScheduler();
+    ~MidiOutputScheduler();
+
+    //==========================================================================
+    /** Update the sample rate and output latency used to compute due times */
+    void prepare (double sampleRate, int outputLatencySamples);
+
+    /** Replace the set of devices messages are sent to. The scheduler does not
+        own the outputs, the caller must keep them alive until they have been
+        removed with another call to this method.
+     */
+    void setOutputs (const Array<MidiOutput*>& outputs);
+
+    /** Sets a function which is also given each message when it is sent,
+        on the scheduler thread. It counts as an output */
+    void setOutputCallback (std::function<void (const MidiMessage&)> callback);
+
+    /** Returns true if there is at least one device to send to */
+    bool hasOutputs() const noexcept { return numOutputs.get() > 0; }
+
+    //==========================================================================
+    /** Queue a block of messages for output. Realtime safe, call this from
+        the audio thread once per block.
+
+        @param buffer           The rendered MIDI
+        @param numSamples       Number of samples in the block
+        @param callbackTimeMs   Time the audio callback started in milliseconds
+                                (Time::getMillisecondCounterHiRes)
+     */
+    void schedule (const MidiBuffer& buffer, int numSamples, double callbackTimeMs);
+
+    //==========================================================================
+    /** Returns the measured timing error of sent messages */
+    TimingStats getTimingStats() const;
+
+    /** Clears measured timing error */
+    void resetTimingStats();
+
+private:
+    enum { fifoSize = 32768 };
+    struct EventHeader
+    {
+        double dueTimeMs;
+        int32 size;
+    };
+
+    AbstractFifo fifo { fifoSize };
+    HeapBlock<uint8> fifoData;
+
+    Atomic<double> sampleRate { 44100.0 };
+    Atomic<int> latencySamples { 0 };
+    Atomic<int> numOutputs { 0 };
+
+    CriticalSection outputLock;
+    Array<MidiOutput*> outputs;
+    std::function<void (const MidiMessage&)> outputCallback;
+
+    Array<MidiMessage> pending;
+    MemoryBlock readBuffer;
+
+    Atomic<double> meanError { 0.0 }, maxError { 0.0 };
+    Atomic<int64> numSent { 0 };
+    Atomic<int> numDropped { 0 };
+    Atomic<int> resetWanted { 0 };
+    double errorSum = 0.0, errorMax = 0.0;
+    int64 errorCount = 0;
+
+    void run() override;
+    void readPending();
+    void insertPending (const MidiMessage&);
+    void sendDue (double now);
+    void readBytes (void* data, int size);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MidiOutputScheduler)
+};
+
+}
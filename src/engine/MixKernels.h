@@ -0,0 +1,82 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "ElementApp.h"
+
+namespace Element {
+namespace MixKernels {
+
+/** Scales a channel by a gain ramped linearly from startGain to endGain and
+    adds it to dest, or replaces dest with it. When metering, returns the sum
+    of squares of the scaled signal, otherwise zero.
+
+    Gain, sum and meter happen in one pass over memory, with the meter
+    summed in four independent lanes.
+ */
+template<bool replace, bool meter>
+inline float mix (float* __restrict dest, const float* __restrict src, int numSamples,
+                  float startGain, float endGain) noexcept
+{
+    float sums[4] = { 0.f, 0.f, 0.f, 0.f };
+    const float step = numSamples > 0 ? (endGain - startGain) / (float) numSamples : 0.f;
+    const int numQuads = numSamples / 4;
+
+    for (int q = 0; q < numQuads; ++q)
+    {
+        const int i = q * 4;
+        for (int k = 0; k < 4; ++k)
+        {
+            const float y = src[i + k] * (startGain + step * (float) (i + k));
+            dest[i + k] = replace ? y : dest[i + k] + y;
+            if (meter)
+                sums[k] += y * y;
+        }
+    }
+
+    for (int i = numQuads * 4; i < numSamples; ++i)
+    {
+        const float y = src[i] * (startGain + step * (float) i);
+        dest[i] = replace ? y : dest[i] + y;
+        if (meter)
+            sums[0] += y * y;
+    }
+
+    return (sums[0] + sums[1]) + (sums[2] + sums[3]);
+}
+
+/** Runtime dispatch to the mix() variants */
+inline float mix (float* dest, const float* src, int numSamples, float startGain,
+                  float endGain, bool replace, bool meter) noexcept
+{
+    if (replace)
+        return meter ? mix<true, true>   (dest, src, numSamples, startGain, endGain)
+                     : mix<true, false>  (dest, src, numSamples, startGain, endGain);
+    return meter ? mix<false, true>  (dest, src, numSamples, startGain, endGain)
+                 : mix<false, false> (dest, src, numSamples, startGain, endGain);
+}
+
+/** Converts a sum of squares from mix() to an RMS level */
+inline float rms (float sumOfSquares, int numSamples) noexcept
+{
+    return numSamples > 0 ? std::sqrt (sumOfSquares / (float) numSamples) : 0.f;
+}
+
+}}
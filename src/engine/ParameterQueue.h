@@ -0,0 +1,180 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "engine/Parameter.h"
+#include <atomic>
+
+namespace Element {
+
+/** Delivers parameter changes to a node on its render thread.
+
+    Any number of threads can push normalized values. The render thread pops
+    them at the start of each block and either applies them or ramps towards
+    them over a number of samples. Ramps advance once per block, so the step
+    size depends on the block size, but a ramp always arrives on time.
+ */
+class ParameterQueue
+{
+public:
+    enum
+    {
+        capacity = 256,     // must be a power of two
+        maxRamps = 64
+    };
+
+    ParameterQueue()
+    {
+        static_assert ((capacity & (capacity - 1)) == 0, "capacity must be a power of two");
+        for (uint32 i = 0; i < (uint32) capacity; ++i)
+            slots[i].sequence.store (i, std::memory_order_relaxed);
+        ramps.ensureStorageAllocated (maxRamps);
+    }
+
+    /** Queue a normalized value. Safe to call from any thread.
+        @returns false if the queue was full
+     */
+    bool push (int index, float value, int rampSamples)
+    {
+        uint32 pos = writePos.load (std::memory_order_relaxed);
+        Slot* slot = nullptr;
+
+        for (;;)
+        {
+            slot = &slots [pos & (capacity - 1)];
+            const uint32 seq = slot->sequence.load (std::memory_order_acquire);
+            const int32 diff = (int32) (seq - pos);
+
+            if (diff == 0)
+            {
+                if (writePos.compare_exchange_weak (pos, pos + 1, std::memory_order_relaxed))
+                    break;
+            }
+            else if (diff < 0)
+            {
+                return false;
+            }
+            else
+            {
+                pos = writePos.load (std::memory_order_relaxed);
+            }
+        }
+
+        slot->index = index;
+        slot->value = value;
+        slot->rampSamples = rampSamples;
+        slot->sequence.store (pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    /** Apply queued values and advance active ramps. Call this on the render
+        thread once per block, before processing.
+     */
+    void process (const ParameterArray& params, const int numSamples)
+    {
+        for (;;)
+        {
+            auto& slot = slots [readPos & (capacity - 1)];
+            if (slot.sequence.load (std::memory_order_acquire) != readPos + 1)
+                break;
+
+            const int index = slot.index;
+            const float value = slot.value;
+            const int rampSamples = slot.rampSamples;
+            slot.sequence.store (readPos + (uint32) capacity, std::memory_order_release);
+            ++readPos;
+
+            if (auto* param = params [index].get())
+                startRamp (*param, index, value, rampSamples);
+        }
+
+        for (int i = ramps.size(); --i >= 0;)
+        {
+            auto& ramp = ramps.getReference (i);
+            auto* param = params [ramp.index].get();
+            if (param == nullptr)
+            {
+                ramps.remove (i);
+                continue;
+            }
+
+            const int step = jmin (numSamples, ramp.remaining);
+            ramp.remaining -= step;
+            ramp.current = ramp.remaining > 0 ? ramp.current + ramp.delta * (float) step : ramp.target;
+            param->setValue (ramp.current);
+
+            if (ramp.remaining <= 0)
+                ramps.remove (i);
+        }
+    }
+
+private:
+    struct Slot
+    {
+        std::atomic<uint32> sequence;
+        int index = -1;
+        float value = 0.f;
+        int rampSamples = 0;
+    };
+
+    struct Ramp
+    {
+        int index;
+        float current, target, delta;
+        int remaining;
+    };
+
+    Slot slots [capacity];
+    std::atomic<uint32> writePos { 0 };
+    uint32 readPos = 0;
+    Array<Ramp> ramps;
+
+    void startRamp (Parameter& param, int index, float value, int rampSamples)
+    {
+        int existing = -1;
+        for (int i = 0; i < ramps.size(); ++i)
+            if (ramps.getReference(i).index == index)
+                existing = i;
+
+        if (rampSamples <= 0 || (existing < 0 && ramps.size() >= (int) maxRamps))
+        {
+            if (existing >= 0)
+                ramps.remove (existing);
+            param.setValue (value);
+            return;
+        }
+
+        Ramp ramp;
+        ramp.index = index;
+        ramp.current = existing >= 0 ? ramps.getReference(existing).current : param.getValue();
+        ramp.target = value;
+        ramp.remaining = rampSamples;
+        ramp.delta = (ramp.target - ramp.current) / (float) rampSamples;
+
+        if (existing >= 0)
+            ramps.set (existing, ramp);
+        else
+            ramps.add (ramp);
+    }
+
+    JUCE_DECLARE_NON_COPYABLE (ParameterQueue)
+};
+
+}
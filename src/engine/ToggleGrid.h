@@ -21,18 +21,21 @@
 
 namespace Element {
 
-/** Similar to a kv::MatrixState but is intended to be used in a realtime context */
+/** Similar to a kv::MatrixState but is intended to be used in a realtime context.
+
+    Toggles are packed 64 to a word in one contiguous block, a row of words
+    per input. Whole rows can be cleared, counted and iterated a word at a
+    time, which keeps routers with hundreds of ports cheap to scan.
+ */
 class ToggleGrid
 {
 public:
     /** This ctor will allocate: DO NOT create these on the stack in a realtime 
         thread, use two instances ToggleGrid::swapWith or operator= instead */
     explicit ToggleGrid (const int ins = 4, const int outs = 4)
-        : numIns (ins), numOuts (outs)
     {
         jassert (ins > 0 && outs > 0);
         resize (ins, outs);
-        clear();
     }
 
     ToggleGrid (const MatrixState& matrix)
@@ -40,23 +43,35 @@ public:
         resize (matrix.getNumRows(), matrix.getNumColumns());
         for (int i = 0; i < matrix.getNumRows(); ++i)
             for (int o = 0; o < matrix.getNumColumns(); ++o)
-                toggles[i][o] = matrix.connected (i, o);
+                if (matrix.connected (i, o))
+                    set (i, o, true);
     }
 
-    ~ToggleGrid() noexcept 
+    ToggleGrid (const ToggleGrid& other)
     {
-        free();
+        resize (other.numIns, other.numOuts);
+        *this = other;
     }
 
+    ~ToggleGrid() noexcept { }
+
+    /** Changes the size and clears all toggles. Only allocates when the
+        grid needs more words than it has ever held */
     inline void resize (int ins, int outs)
     {
-        free();
-        jassert(ins > 0 && outs > 0);
+        jassert (ins > 0 && outs > 0);
         numIns = ins;
         numOuts = outs;
-        toggles = new bool* [numIns];
-        for (int i = 0; i < numIns; ++i)
-            toggles[i] = new bool [numOuts];
+        numWordsPerRow = (outs + bitsPerWord - 1) / bitsPerWord;
+        
+        const int numWords = numIns * numWordsPerRow;
+        if (numWords > capacity)
+        {
+            words.allocate ((size_t) numWords, true);
+            capacity = numWords;
+        }
+
+        clear();
     }
 
     inline bool sameSizeAs (const ToggleGrid& other) const noexcept
@@ -71,64 +86,229 @@ public:
 
     inline void clear() noexcept
     {
-        for (int i = 0; i < numIns; ++i)
-            for (int o = 0; o < numOuts; ++o)
-                toggles[i][o] = false;
+        if (capacity > 0)
+            zeromem (words.getData(), sizeof (uint64) * (size_t) capacity);
     }
 
     inline bool get (const int in, const int out) const noexcept
     {
         jassert (isPositiveAndBelow (in, numIns) && isPositiveAndBelow (out, numOuts));
-        return toggles[in][out];
+        return (getRow (in)[out / bitsPerWord] & bit (out)) != 0;
     }
 
     inline void set (const int in, const int out, const bool value) noexcept
     {
         jassert (isPositiveAndBelow (in, numIns) && isPositiveAndBelow (out, numOuts));
-        toggles[in][out] = value;
+        auto& word = getRow (in)[out / bitsPerWord];
+        word = value ? (word | bit (out)) : (word & ~bit (out));
     }
 
     inline int getNumInputs() const noexcept    { return numIns; }
     inline int getNumOutputs() const noexcept   { return numOuts; }
 
+    /** Returns the words of one input's row, output 0 in the lowest bit */
+    inline const uint64* getRow (const int in) const noexcept   { return words + in * numWordsPerRow; }
+    inline uint64* getRow (const int in) noexcept               { return words + in * numWordsPerRow; }
+    inline int getNumWordsPerRow() const noexcept               { return numWordsPerRow; }
+
+    /** Clears every toggle of an input */
+    inline void clearRow (const int in) noexcept
+    {
+        jassert (isPositiveAndBelow (in, numIns));
+        zeromem (getRow (in), sizeof (uint64) * (size_t) numWordsPerRow);
+    }
+
+    /** Returns true if an input is connected to nothing */
+    inline bool isRowEmpty (const int in) const noexcept
+    {
+        const auto* row = getRow (in);
+        for (int w = 0; w < numWordsPerRow; ++w)
+            if (row[w] != 0)
+                return false;
+        return true;
+    }
+
+    /** Returns the number of outputs an input is connected to */
+    inline int countRow (const int in) const noexcept
+    {
+        const auto* row = getRow (in);
+        int count = 0;
+        for (int w = 0; w < numWordsPerRow; ++w)
+            count += countNumberOfBits (row[w]);
+        return count;
+    }
+
+    /** Returns the number of toggles which are on */
+    inline int count() const noexcept
+    {
+        int total = 0;
+        for (int w = 0; w < numIns * numWordsPerRow; ++w)
+            total += countNumberOfBits (words[w]);
+        return total;
+    }
+
+    /** Returns the first output at or after 'from' that an input is
+        connected to, or -1 if there are no more */
+    inline int nextOutput (const int in, const int from) const noexcept
+    {
+        if (from >= numOuts)
+            return -1;
+
+        const auto* row = getRow (in);
+        int w = jmax (0, from) / bitsPerWord;
+        uint64 word = row[w] & (~(uint64) 0 << (jmax (0, from) % bitsPerWord));
+        
+        for (;;)
+        {
+            if (word != 0)
+                return w * bitsPerWord + lowestBit (word);
+            if (++w >= numWordsPerRow)
+                return -1;
+            word = row[w];
+        }
+    }
+
+    /** Calls fn (output) for each output an input is connected to */
+    template<typename Fn>
+    inline void forEachOutput (const int in, Fn&& fn) const
+    {
+        const auto* row = getRow (in);
+        for (int w = 0; w < numWordsPerRow; ++w)
+        {
+            for (uint64 word = row[w]; word != 0; word &= word - 1)
+                fn (w * bitsPerWord + lowestBit (word));
+        }
+    }
+
     inline void swapWith (ToggleGrid& other) noexcept
     {
-        std::swap (toggles, other.toggles);
+        words.swapWith (other.words);
+        std::swap (numIns, other.numIns);
+        std::swap (numOuts, other.numOuts);
+        std::swap (numWordsPerRow, other.numWordsPerRow);
+        std::swap (capacity, other.capacity);
     }
 
-    ToggleGrid& operator= (const ToggleGrid& other)
+    /** Copies toggles without allocating. Grids of different sizes copy
+        the overlapping area and leave this one's size alone */
+    ToggleGrid& operator= (const ToggleGrid& other) noexcept
     {
+        if (this == &other)
+            return *this;
+        
         if (sameSizeAs (other))
         {
-            for (int i = 0; i < numIns; ++i)
-                for (int o = 0; o < numOuts; ++o)
-                    toggles[i][o] = other.toggles[i][o];
+            memcpy (words.getData(), other.words.getData(),
+                    sizeof (uint64) * (size_t) (numIns * numWordsPerRow));
         }
         else
         {
+            clear();
+            const int numCopyWords = jmin (numWordsPerRow, other.numWordsPerRow);
+            const int lastBits = jmin (numOuts, other.numOuts) - (numCopyWords - 1) * bitsPerWord;
+            const uint64 lastMask = lastBits >= bitsPerWord ? ~(uint64) 0 : (bit (lastBits) - 1);
+
             for (int i = 0; i < jmin (numIns, other.numIns); ++i)
-                for (int o = 0; o < jmin (numOuts, other.numOuts); ++o)
-                    toggles[i][o] = other.toggles[i][o];
+            {
+                auto* dst = getRow (i);
+                const auto* src = other.getRow (i);
+                for (int w = 0; w < numCopyWords; ++w)
+                    dst[w] = src[w];
+                dst[numCopyWords - 1] &= lastMask;
+            }
         }
 
         return *this;
     }
 
 private:
-    int numIns, numOuts;
-    bool** toggles = nullptr;
+    enum { bitsPerWord = 64 };
+    int numIns = 0, numOuts = 0;
+    int numWordsPerRow = 0;
+    int capacity = 0;
+    HeapBlock<uint64> words;
+
+    static inline uint64 bit (const int index) noexcept { return (uint64) 1 << (index % bitsPerWord); }
 
-    void free()
+    /** Index of the lowest set bit of a non-zero word */
+    static inline int lowestBit (const uint64 word) noexcept
     {
-        if (toggles != nullptr)
+        jassert (word != 0);
+        return countNumberOfBits ((word & (~word + 1)) - 1);
+    }
+};
+
+/** Double buffers a ToggleGrid between the message thread and the audio
+    thread. The writer edits getPending() with getLock() held, then calls
+    markChanged(). The audio thread calls update() before rendering, which
+    copies pending into current if it gets the lock without waiting. Neither
+    side allocates once constructed: resizing goes through resize(), which
+    allocates a spare grid on the writer's side for update() to swap in.
+ */
+class ToggleGridBuffer
+{
+public:
+    ToggleGridBuffer (const int ins = 4, const int outs = 4)
+        : current (ins, outs), pending (ins, outs), spare (ins, outs) { }
+
+    CriticalSection& getLock() noexcept                 { return lock; }
+    const CriticalSection& getLock() const noexcept     { return lock; }
+
+    /** The grid to edit, only with the lock held */
+    ToggleGrid& getPending() noexcept                   { return pending; }
+    const ToggleGrid& getPending() const noexcept       { return pending; }
+    void markChanged() noexcept                         { changed.set (1); }
+
+    /** Resizes and clears the pending grid, only with the lock held. Don't
+        resize getPending() directly, current couldn't follow it */
+    void resize (const int ins, const int outs)
+    {
+        pending.resize (ins, outs);
+        spare.resize (ins, outs);
+        markChanged();
+    }
+
+    /** The grid the audio thread renders with */
+    const ToggleGrid& getCurrent() const noexcept       { return current; }
+
+    /** Picks up pending changes, returns true if current changed */
+    bool update() noexcept                              { return update ([]() {}); }
+
+    /** Like update(), also calling fn with the lock held when current
+        changes, so state kept beside the grid can be picked up with it */
+    template<typename Fn>
+    bool update (Fn&& fn) noexcept
+    {
+        if (changed.get() == 0)
+            return false;
+        
+        const ScopedTryLock sl (lock);
+        if (! sl.isLocked())
+            return false;
+
+        if (current.sameSizeAs (pending))
         {
-            for (int i = 0; i < numIns; ++i)
-                delete [] toggles [i];
-            delete [] toggles;
-            toggles = nullptr;
+            current = pending;
         }
-        numIns = numOuts = 0;
+        else
+        {
+            // take the resized grid, and hand the writer the spare resize()
+            // allocated so pending keeps holding every toggle
+            current.swapWith (pending);
+            pending.swapWith (spare);
+            jassert (pending.sameSizeAs (current));
+            pending = current;
+        }
+
+        changed.set (0);
+        fn();
+        return true;
     }
+
+private:
+    CriticalSection lock;
+    ToggleGrid current, pending, spare;
+    Atomic<int> changed;
 };
 
 }
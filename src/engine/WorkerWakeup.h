@@ -0,0 +1,69 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace Element {
+
+/** Wakes a worker thread from the audio thread.
+
+    wake() raises a flag and only signals the event if the worker is asleep
+    on it and nobody signalled since, so the audio thread signals at most once
+    per sleep and never while the worker is busy. The event's lock is then
+    uncontended, the worker holds it only inside its own wait.
+ */
+class WorkerWakeup
+{
+public:
+    WorkerWakeup() = default;
+
+    /** Requests the worker runs. Call from the audio thread */
+    void wake() noexcept
+    {
+        if (pending.compareAndSetBool (1, 0) && sleeping.get() != 0)
+            event.signal();
+    }
+
+    /** Wakes the worker without a request, e.g. to stop it or to have it
+        pick up new settings. Not for the audio thread */
+    void signal() noexcept          { event.signal(); }
+
+    /** Blocks the worker until wake(), signal() or the timeout.
+        @returns true if a wake was requested, which also clears it
+     */
+    bool wait (int timeoutMs = -1) noexcept
+    {
+        sleeping.set (1);
+        if (pending.get() == 0)
+            event.wait (timeoutMs);
+        sleeping.set (0);
+        return pending.compareAndSetBool (0, 1);
+    }
+
+private:
+    WaitableEvent event;
+    Atomic<int> pending { 0 };
+    Atomic<int> sleeping { 0 };
+
+    JUCE_DECLARE_NON_COPYABLE (WorkerWakeup)
+};
+
+}
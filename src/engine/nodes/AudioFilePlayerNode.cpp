@@ -64,6 +64,14 @@ public:
         addAndMakeVisible (startStopContinueToggle);
         startStopContinueToggle.setButtonText ("Respond to MIDI start/stop/continue");
 
+        addAndMakeVisible (preloadToggle);
+        preloadToggle.setButtonText ("Preload into RAM");
+
+        addAndMakeVisible (cacheLabel);
+        cacheLabel.setFont (Font (11.f));
+        cacheLabel.setJustificationType (Justification::centredRight);
+        cacheLabel.setTooltip ("Shared RAM cache: memory used / budget, hits and misses");
+
         addAndMakeVisible (position);
         position.setSliderStyle (Slider::LinearBar);
         position.setRange (0.0, 1.0, 0.001);
@@ -77,7 +85,7 @@ public:
         stabilizeComponents();
         bindHandlers();
 
-        setSize (360, 144);
+        setSize (360, 166);
         startTimer (1001);
     }
 
@@ -140,6 +148,16 @@ public:
 
         startStopContinueToggle.setToggleState (processor.respondsToStartStopContinue(),
                                                 dontSendNotification);
+
+        preloadToggle.setToggleState (processor.isPreloadEnabled(), dontSendNotification);
+        const auto stats = processor.getCacheStats();
+        String text;
+        text << String ((double) stats.bytesUsed / (1024.0 * 1024.0), 1) << " / "
+             << String ((double) stats.budget / (1024.0 * 1024.0), 0) << " MB  "
+             << "hits " << stats.hits << "  misses " << stats.misses;
+        if (processor.isPreloadEnabled())
+            text << (processor.isPlayingFromMemory() ? "  (in RAM)" : "  (from disk)");
+        cacheLabel.setText (text, dontSendNotification);
     }
 
     void filenameComponentChanged (FilenameComponent*) override
@@ -168,6 +186,10 @@ public:
         position.setBounds (r.removeFromTop (18));
         r.removeFromTop (4);
         startStopContinueToggle.setBounds (r.removeFromTop (18));
+        r.removeFromTop (4);
+        auto r3 = r.removeFromTop (18);
+        preloadToggle.setBounds (r3.removeFromLeft (130));
+        cacheLabel.setBounds (r3);
     }
 
     void paint (Graphics& g) override
@@ -231,6 +253,8 @@ private:
     TextButton loopButton;
     IconButton watchButton;
     ToggleButton startStopContinueToggle;
+    ToggleButton preloadToggle;
+    Label cacheLabel;
     Atomic<int> startStopContinue { 0 };
 
     bool draggingPos = false;
@@ -289,6 +313,12 @@ private:
             return Util::minutesToString (posInMinutes);
         };
 
+        preloadToggle.onClick = [this]()
+        {
+            processor.setPreloadEnabled (preloadToggle.getToggleState());
+            stabilizeComponents();
+        };
+
         startStopContinueToggle.onClick = [this]()
         {
             processor.setRespondToStartStopContinue (
@@ -307,6 +337,7 @@ private:
         position.textFromValueFunction = nullptr;
         volume.onValueChange = nullptr;
         startStopContinueToggle.onClick = nullptr;
+        preloadToggle.onClick = nullptr;
         processor.getPlayer().removeChangeListener (this);
         chooser->removeListener (this);
         watchButton.onClick = nullptr;
@@ -332,10 +363,12 @@ AudioFilePlayerNode::AudioFilePlayerNode()
 
     for (auto* const param : getParameters())
         param->addListener (this);
+    streamer->getCache().addListener (this);
 }
 
 AudioFilePlayerNode::~AudioFilePlayerNode()
 { 
+    streamer->getCache().removeListener (this);
     for (auto* const param : getParameters())
         param->removeListener (this);
     clearPlayer();
@@ -381,13 +414,26 @@ void AudioFilePlayerNode::openFile (const File& file)
 {
     if (file == audioFile)
         return;
-    if (auto* newReader = formats.createReaderFor (file))
+
+    AudioFormatReader* newReader = nullptr;
+    if (preload)
+    {
+        // on a miss this streams from disk until the preload finishes
+        auto& cache = streamer->getCache();
+        newReader = AudioFileCache::createReader (cache.find (file));
+        if (newReader == nullptr)
+            cache.preload (file);
+    }
+
+    if (newReader == nullptr)
+        newReader = streamer->createReaderFor (file);
+
+    if (newReader != nullptr)
     {
         clearPlayer();
         reader.reset (new AudioFormatReaderSource (newReader, true));
         audioFile = file;
-        player.setSource (reader.get(), 1024 * 8, &thread, 
-                          newReader->sampleRate, 2);
+        streamer->setSource (player, reader.get(), getSampleRate(), getBlockSize());
 
         ScopedLock sl (getCallbackLock());
         reader->setLooping (*looping);
@@ -395,21 +441,70 @@ void AudioFilePlayerNode::openFile (const File& file)
     }
 }
 
+void AudioFilePlayerNode::switchReader (AudioFormatReader* newReader)
+{
+    if (newReader == nullptr)
+        return;
+
+    const auto position = player.getCurrentPosition();
+    const bool wasRunning = player.isPlaying();
+
+    std::unique_ptr<AudioFormatReaderSource> newSource (new AudioFormatReaderSource (newReader, true));
+    newSource->setLooping (*looping);
+    streamer->setSource (player, newSource.get(), getSampleRate(), getBlockSize());
+    reader.swap (newSource);
+
+    player.setPosition (position);
+    if (wasRunning)
+        player.start();
+}
+
+void AudioFilePlayerNode::audioFilePreloaded (const File& file)
+{
+    if (! preload || file != audioFile || reader == nullptr || isPlayingFromMemory())
+        return;
+    switchReader (AudioFileCache::createReader (streamer->getCache().find (file)));
+}
+
+void AudioFilePlayerNode::setPreloadEnabled (bool shouldPreload)
+{
+    if (preload == shouldPreload)
+        return;
+
+    preload = shouldPreload;
+    if (reader == nullptr || ! audioFile.existsAsFile())
+        return;
+
+    if (preload)
+    {
+        auto& cache = streamer->getCache();
+        if (auto* newReader = AudioFileCache::createReader (cache.find (audioFile)))
+            switchReader (newReader);
+        else
+            cache.preload (audioFile);
+    }
+    else if (isPlayingFromMemory())
+    {
+        switchReader (streamer->createReaderFor (audioFile));
+    }
+}
+
+bool AudioFilePlayerNode::isPlayingFromMemory() const
+{
+    auto* const fmtReader = reader != nullptr ? reader->getAudioFormatReader() : nullptr;
+    return fmtReader != nullptr && AudioFileCache::isPreloaded (*fmtReader);
+}
+
 void AudioFilePlayerNode::prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock)
 {
-    thread.startThread();
     formats.registerBasicFormats();
     player.prepareToPlay (maximumExpectedSamplesPerBlock, sampleRate);
 
     if (reader)
     {
-        double readerSampleRate = sampleRate;
-        if (auto* fmtReader = reader->getAudioFormatReader())
-            readerSampleRate = fmtReader->sampleRate;
-
         reader->setLooping (*looping);
         player.setLooping (*looping);
-        player.setSource (reader.get(), 1024 * 8, &thread, readerSampleRate, 2);
+        streamer->setSource (player, reader.get(), sampleRate, maximumExpectedSamplesPerBlock);
         player.setPosition (jmax (0.0, lastTransportPos));
         if (wasPlaying)
             player.start();
@@ -429,7 +524,6 @@ void AudioFilePlayerNode::releaseResources()
     player.releaseResources();
     player.setSource (nullptr);
     formats.clearFormats();
-    thread.stopThread (14);
 }
 
 void AudioFilePlayerNode::processBlock (AudioBuffer<float>& buffer, MidiBuffer& midi)
@@ -542,7 +636,8 @@ void AudioFilePlayerNode::getStateInformation (juce::MemoryBlock& destData)
          .setProperty ("playing", (bool)*playing, nullptr)
          .setProperty ("slave", (bool)*slave, nullptr)
          .setProperty ("loop", (bool)*looping, nullptr)
-         .setProperty ("midiStartStopContinue", midiStartStopContinue.get() == 1, nullptr);
+         .setProperty ("midiStartStopContinue", midiStartStopContinue.get() == 1, nullptr)
+         .setProperty ("preload", preload, nullptr);
     
     if (watchDir.exists())
         state.setProperty ("watchDir", watchDir.getFullPathName(), nullptr);
@@ -556,6 +651,7 @@ void AudioFilePlayerNode::setStateInformation (const void* data, int sizeInBytes
     const auto state = ValueTree::readFromData (data, (size_t) sizeInBytes);
     if (state.isValid())
     {
+        setPreloadEnabled ((bool) state.getProperty ("preload", false));
         if (File::isAbsolutePath (state["audioFile"].toString()))
             openFile (File (state["audioFile"].toString()));
         *playing = (bool) state.getProperty ("playing", false);
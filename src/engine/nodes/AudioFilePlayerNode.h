@@ -20,13 +20,15 @@
 #pragma once
 
 #include "engine/nodes/BaseProcessor.h"
+#include "engine/AudioFileStreamer.h"
 #include "Signals.h"
 
 namespace Element {
 
 class AudioFilePlayerNode : public BaseProcessor,
                             public AudioProcessorParameter::Listener,
-                            public AsyncUpdater
+                            public AsyncUpdater,
+                            private AudioFileCache::Listener
 {
 public:
     enum Parameters { Playing = 0, Slave, Volume, Looping };
@@ -59,6 +61,17 @@ public:
     void setRespondToStartStopContinue (bool);
     bool respondsToStartStopContinue() const;
 
+    /** When enabled, files are decoded into the shared RAM cache and played
+        from memory once loaded. Until then they stream from disk */
+    void setPreloadEnabled (bool);
+    bool isPreloadEnabled() const { return preload; }
+
+    /** Returns true if the current file is playing from the RAM cache */
+    bool isPlayingFromMemory() const;
+
+    /** Returns hit/miss and memory counters of the shared RAM cache */
+    AudioFileCache::Stats getCacheStats() const { return streamer->getCache().getStats(); }
+
     const String getName() const override { return "Audio File Player"; }
     void prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock) override;
     void releaseResources() override;
@@ -127,7 +140,7 @@ protected:
 #endif
 
 private:
-    TimeSliceThread thread { "MediaPlayer" };
+    SharedResourcePointer<AudioFileStreamer> streamer;
     std::unique_ptr<AudioFormatReaderSource> reader;
     AudioFormatManager formats;
     AudioTransportSource player;
@@ -145,8 +158,11 @@ private:
     double lastTransportPos { 0.0 };
     
     File watchDir;
+    bool preload { false };
 
     void clearPlayer();
+    void switchReader (AudioFormatReader* newReader);
+    void audioFilePreloaded (const File& file) override;
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (AudioFilePlayerNode)
 };
 
@@ -18,6 +18,7 @@
 */
 
 #include "engine/nodes/AudioMixerProcessor.h"
+#include "engine/MixKernels.h"
 #include "gui/widgets/HorizontalListBox.h"
 #include "gui/LookAndFeel.h"
 
@@ -28,6 +29,174 @@ namespace Element {
 
 typedef AudioMixerProcessor::MonitorPtr MonitorPtr;
 
+// tracks per chunk before a mix is split across threads
+static const int minTracksPerChunk = 8;
+
+// how long the audio thread waits for a worker before redoing its chunk
+static const double maxSpinSeconds = 0.0001;
+
+/** A few threads shared by every mixer which help the audio thread sum
+    partial mixes. The audio thread claims chunks too, and never waits long
+    for one a worker claimed: if the worker was preempted, the audio thread
+    mixes that chunk again itself and the worker's result is ignored.
+ */
+class AudioMixerProcessor::Workers
+{
+public:
+    using ChunkFunction = void (*) (void* context, int chunk);
+    enum { maxChunks = 4 };
+
+    Workers()
+    {
+        const int numThreads = jlimit (0, (int) maxChunks - 1, SystemStats::getNumCpus() - 1);
+        for (int i = 0; i < numThreads; ++i)
+            threads.add (new Worker (*this))->startThread (9);
+    }
+
+    ~Workers()
+    {
+        for (auto* thread : threads)
+            thread->signalThreadShouldExit();
+        for (auto* thread : threads)
+        {
+            thread->notify();
+            thread->stopThread (500);
+        }
+    }
+
+    int getNumThreads() const noexcept { return threads.size(); }
+
+    /** Calls function (context, chunk) for chunks across the workers and the
+        calling thread. Returns once every chunk is done or, if a worker is
+        still busy with one after a short spin, without it. Check which chunks
+        finished with isDone(), then call release().
+
+        Returns false without calling anything if there are no workers or
+        another job still holds them */
+    bool run (int numChunks, ChunkFunction newFunction, void* newContext) noexcept
+    {
+        jassert (numChunks <= maxChunks);
+        if (numChunks < 2 || threads.isEmpty() || ! busy.compareAndSetBool (1, 0))
+            return false;
+
+        function = newFunction;
+        context.set (newContext);
+        completed.set (0);
+        jobChunks = numChunks;
+        for (int i = 0; i < numChunks; ++i)
+            done[i].set (0);
+
+        // job serial, chunk count and next chunk share one atomic so a
+        // worker can't claim a chunk against a stale job
+        const int64 job = (ticket.get() >> 32) + 1;
+        ticket.set ((job << 32) | ((int64) numChunks << 16));
+
+        for (auto* thread : threads)
+            thread->notify();
+        work();
+
+        // anything left is already running on a worker
+        const auto deadline = Time::getHighResolutionTicks()
+            + Time::secondsToHighResolutionTicks (maxSpinSeconds);
+        while (completed.get() < numChunks && Time::getHighResolutionTicks() < deadline) { }
+
+        return true;
+    }
+
+    bool isDone (int chunk) const noexcept  { return done[chunk].get() != 0; }
+    bool isBusy() const noexcept            { return busy.get() != 0; }
+
+    /** Ends the job started by run(). The workers stay reserved until a
+        chunk still running on one has finished */
+    void release() noexcept
+    {
+        if (++completed == jobChunks + 1)
+            finish();
+    }
+
+    /** Waits until no worker is running a chunk of a job with this context */
+    void waitForJob (void* jobContext) const noexcept
+    {
+        while (busy.get() != 0 && context.get() == jobContext)
+            Thread::yield();
+    }
+
+private:
+    class Worker : public Thread
+    {
+    public:
+        explicit Worker (Workers& w) : Thread ("Element Mixer"), owner (w) { }
+
+        void run() override
+        {
+            while (! threadShouldExit())
+            {
+                wait (-1);
+                if (threadShouldExit())
+                    break;
+                owner.work();
+            }
+        }
+
+    private:
+        Workers& owner;
+    };
+
+    OwnedArray<Worker> threads;
+    Atomic<int> busy;
+    Atomic<int64> ticket;
+    Atomic<int> completed;
+    Atomic<int> done [maxChunks];
+    Atomic<void*> context;
+    int jobChunks = 0;
+    ChunkFunction function = nullptr;
+
+    void work() noexcept
+    {
+        for (;;)
+        {
+            const auto current = ticket.get();
+            const int numChunks = (int) ((current >> 16) & 0xffff);
+            const int chunk     = (int) (current & 0xffff);
+            if (chunk >= numChunks)
+                return;
+            if (! ticket.compareAndSetBool (current + 1, current))
+                continue;
+
+            function (context.get(), chunk);
+            done[chunk].set (1);
+            if (++completed == jobChunks + 1)
+                finish();
+        }
+    }
+
+    void finish() noexcept
+    {
+        context.set (nullptr);
+        busy.set (0);
+    }
+
+    JUCE_DECLARE_NON_COPYABLE (Workers)
+};
+
+struct AudioMixerProcessor::MixJob
+{
+    Track* const* tracks = nullptr;
+    int numTracks = 0;
+    int numChunks = 0;
+    HeapBlock<const float*> inputs;     // copied, the caller's buffer can go away
+    int numInputs = 0, maxInputs = 0;
+    AudioSampleBuffer* dests [Workers::maxChunks];
+    int numSamples = 0;
+    bool meter = false;
+
+    void getRange (int chunk, int& begin, int& end) const noexcept
+    {
+        begin = numTracks * chunk / numChunks;
+        end   = numTracks * (chunk + 1) / numChunks;
+    }
+};
+
 class AudioMixerEditor : public AudioProcessorEditor,
                          private Timer
 {
@@ -40,10 +209,15 @@ public:
         setName ("AudioMixerEditor");
         addAndMakeVisible (channels);
         setSize (330, 210);
+        owner.meterViews += 1;
         startTimerHz (24);
     }
 
-    ~AudioMixerEditor() noexcept { }
+    ~AudioMixerEditor() noexcept
+    {
+        stopTimer();
+        owner.meterViews -= 1;
+    }
 
     void paint (Graphics& g) override 
     {
@@ -360,41 +534,84 @@ private:
     }
 };
 
+AudioMixerProcessor::AudioMixerProcessor (int numTracks, const double sampleRate, const int bufferSize)
+    : BaseProcessor (BusesProperties()
+        .withOutput ("Master",  AudioChannelSet::stereo(), false)),
+      job (new MixJob())
+{
+    while (--numTracks >= 0)
+        addStereoTrack();
+    setRateAndBufferSizeDetails (sampleRate, bufferSize);
+    addParameter (masterMute = new AudioParameterBool ("masterMute", "Master Mute", false));
+    addParameter (masterVolume  = new AudioParameterFloat ("masterVolume",  "Master Volume", -120.0f, 12.0f, 0.f));
+    masterMonitor = new Monitor (-1, 2);
+}
+
 AudioMixerProcessor::~AudioMixerProcessor()
 {
-    Array<Track*> oldTracks;
     {
-        ScopedLock sl (getCallbackLock());
-        masterMute = nullptr;
-        masterVolume = nullptr;
-        tracks.swapWith (oldTracks);
+        ScopedLock sl (publishLock);
+        publish (nullptr);
     }
 
-    for (auto* t : oldTracks)
-        delete t;
+    ScopedLock sl (getCallbackLock());
+    masterMute = nullptr;
+    masterVolume = nullptr;
+}
+
+void AudioMixerProcessor::publish (TrackList* newList)
+{
+    auto* const oldList = activeTracks.exchange (newList);
+
+    // wait out a block still mixing the old list, and a worker which
+    // finishes a chunk late
+    while (oldList != nullptr && tracksInUse.get() == oldList)
+        Thread::yield();
+    workers->waitForJob (job.get());
+
+    delete oldList;
+}
+
+void AudioMixerProcessor::updateChannels (Track& track) const
+{
+    track.channel = isPositiveAndBelow (track.busIdx, getBusCount (true))
+        ? getChannelIndexInProcessBlockBuffer (true, track.busIdx, 0) : -1;
+}
+
+int AudioMixerProcessor::getNumTracks() const
+{
+    ScopedLock sl (publishLock);
+    auto* const list = activeTracks.get();
+    return list != nullptr ? list->tracks.size() : 0;
+}
+
+AudioMixerProcessor::Track::Ptr AudioMixerProcessor::getTrack (const int index) const
+{
+    ScopedLock sl (publishLock);
+    auto* const list = activeTracks.get();
+    return list != nullptr ? list->tracks [index] : nullptr;
 }
 
 AudioMixerProcessor::MonitorPtr AudioMixerProcessor::getMonitor (const int track) const
 {
     if (track < 0)
         return masterMonitor;
-    ScopedLock sl (getCallbackLock());
-    if (! isPositiveAndBelow (track, tracks.size()))
-        return nullptr;
-    return tracks.getUnchecked(track)->monitor;
+    if (auto t = getTrack (track))
+        return t->monitor;
+    return nullptr;
 }
 
 void AudioMixerProcessor::addMonoTrack()
 {
-    auto* track = new Track();
-    track->index = tracks.size();
+    Track::Ptr track = new Track();
+    track->index = getNumTracks();
     track->busIdx = -1;
     track->numInputs = 1;
     track->numOutputs = 2;
     track->lastGain = 1.0;
     track->gain = 1.0;
     track->mute = false;
-    deleteAndZero (track); // mono not yet supported
+    track = nullptr; // mono not yet supported
 }
 
 void AudioMixerProcessor::addStereoTrack()
@@ -402,32 +619,31 @@ void AudioMixerProcessor::addStereoTrack()
     if (! addBus (true))
         return;
 
-    bool wasAdded = false;
     auto* const input = getBus (true, getBusCount (true) - 1);
-    
-    if (input != nullptr)
-        wasAdded = true;
-
-    if (wasAdded)
-    {
-        auto* const track   = new Track();
-        track->index        = tracks.size();
-        track->busIdx       = input->getBusIndex();
-        track->numInputs    = input->getNumberOfChannels();
-        track->numOutputs   = input->getNumberOfChannels();
-        track->lastGain     = 1.0;
-        track->gain         = 1.0;
-        track->mute         = false;
-        track->monitor      = new Monitor (track->index, track->numOutputs);
-
-        ScopedLock sl (getCallbackLock());
-        tracks.add (track);
-        numTracks = tracks.size();
-    }
-    else
+    if (input == nullptr)
     {
         DBG("[EL] AudioMixerProcessor: could not add new track");
+        return;
     }
+
+    ScopedLock sl (publishLock);
+    auto* const newList = new TrackList();
+    if (auto* const current = activeTracks.get())
+        newList->tracks.addArray (current->tracks);
+
+    Track::Ptr track    = new Track();
+    track->index        = newList->tracks.size();
+    track->busIdx       = input->getBusIndex();
+    track->numInputs    = input->getNumberOfChannels();
+    track->numOutputs   = input->getNumberOfChannels();
+    track->lastGain     = 1.0;
+    track->gain         = 1.0;
+    track->mute         = false;
+    track->monitor      = new Monitor (track->index, track->numOutputs);
+    updateChannels (*track);
+    newList->tracks.add (track);
+
+    publish (newList);
 }
 
 AudioProcessorEditor* AudioMixerProcessor::createEditor()
@@ -440,65 +656,193 @@ AudioProcessorEditor* AudioMixerProcessor::createEditor()
 void AudioMixerProcessor::prepareToPlay (const double sampleRate, const int bufferSize)
 {
     setRateAndBufferSizeDetails (sampleRate, bufferSize);
-    jassert (tracks.size() == getBusCount (true));
+    jassert (getNumTracks() == getBusCount (true));
     jassert (1 == getBusCount (false));
-    tempBuffer.setSize (getMainBusNumOutputChannels(), bufferSize, false, true, true);
+
+    const int numChannels = getMainBusNumOutputChannels();
+    workers->waitForJob (job.get());
+    tempBuffer.setSize (numChannels, bufferSize, false, true, true);
+    partials.clearQuick (true);
+    if (workers->getNumThreads() > 0)
+    {
+        for (int i = 0; i < Workers::maxChunks; ++i)
+            partials.add (new AudioSampleBuffer (numChannels, bufferSize));
+        spareBuffer.setSize (numChannels, bufferSize, false, true, true);
+    }
+
+    job->maxInputs = jmax (getTotalNumInputChannels(), getTotalNumOutputChannels());
+    job->inputs.allocate ((size_t) jmax (1, job->maxInputs), true);
+
+    // bus layouts only change while stopped, so channels are safe to update
+    ScopedLock sl (publishLock);
+    if (auto* const list = activeTracks.get())
+        for (auto* const track : list->tracks)
+            updateChannels (*track);
+}
+
+void AudioMixerProcessor::mixTracks (void* context, int chunk)
+{
+    auto& job = *static_cast<MixJob*> (context);
+    int begin, end;
+    job.getRange (chunk, begin, end);
+    mixTracks (job.tracks + begin, end - begin, job.inputs, job.numInputs,
+               *job.dests [chunk], job.numSamples, job.meter);
+}
+
+void AudioMixerProcessor::mixTracks (Track* const* tracks, int numTracks, const float* const* inputs,
+                                     int numInputs, AudioSampleBuffer& dest, int numSamples, bool meter)
+{
+    bool first = true;
+    const int numDestChannels = dest.getNumChannels();
+
+    for (int i = 0; i < numTracks; ++i)
+    {
+        auto* const track = tracks[i];
+        auto& monitor = *track->monitor;
+        const int numChannels = track->mute || track->channel < 0 ? 0
+            : jmin (track->numInputs, numDestChannels, numInputs - track->channel);
+
+        for (int c = 0; c < numChannels; ++c)
+        {
+            // the first track overwrites so dest needs no clearing
+            const auto sum = MixKernels::mix (dest.getWritePointer (c), inputs [track->channel + c],
+                                              numSamples, track->lastGain, track->gain, first, meter);
+            if (meter)
+                monitor.rms.getReference(c).set (MixKernels::rms (sum, numSamples));
+        }
+
+        if (numChannels > 0)
+        {
+            if (first)
+                for (int c = numChannels; c < numDestChannels; ++c)
+                    dest.clear (c, 0, numSamples);
+            first = false;
+        }
+        else if (meter)
+        {
+            for (int c = 0; c < monitor.rms.size(); ++c)
+                monitor.rms.getReference(c).set (0.f);
+        }
+    }
+
+    if (first)
+        dest.clear (0, numSamples);
+}
+
+void AudioMixerProcessor::updateTracks (Track* const* tracks, int numTracks)
+{
+    for (int i = 0; i < numTracks; ++i)
+    {
+        auto* const track = tracks[i];
+        auto& monitor = *track->monitor;
+        track->lastGain = track->gain;
+
+        if (track->gain != monitor.nextGain.get())
+            track->gain = monitor.nextGain.get();
+        monitor.gain.set (track->gain);
+
+        if (static_cast<int> (track->mute) != monitor.nextMute.get())
+            track->mute = monitor.nextMute.get() > 0;
+        monitor.muted.set (track->mute ? 1 : 0);
+    }
 }
 
 void AudioMixerProcessor::processBlock (AudioSampleBuffer& audio, MidiBuffer& midi)
 {
     midi.clear();
 
-    ScopedLock sl (getCallbackLock());
+    TrackList* list = nullptr;
+    do {
+        list = activeTracks.get();
+        tracksInUse.set (list);
+    } while (list != activeTracks.get());
 
-    if (tracks.size() <= 0)
+    if (list == nullptr || list->tracks.size() <= 0)
     {
+        tracksInUse.set (nullptr);
         audio.clear();
         return;
     }
 
     auto output (getBusBuffer<float> (audio, false, 0));
     const int numSamples = audio.getNumSamples();
-    tempBuffer.clear (0, numSamples);
-
-    for (int i = 0; i < tracks.size(); ++i)
+    const bool meter = meterViews.get() > 0;
+
+    // the job isn't touched while a worker might still be reading it
+    auto& mix = *job;
+    const int numChunks = jmin (partials.size(), workers->getNumThreads() + 1,
+                                list->tracks.size() / minTracksPerChunk);
+    bool mixed = false;
+    if (numChunks >= 2 && audio.getNumChannels() <= mix.maxInputs && ! workers->isBusy())
     {
-        auto* const track = tracks.getUnchecked (i);
-        auto input (getBusBuffer<float> (audio, true, track->busIdx));
-        auto& rms = track->monitor->rms;
+        mix.tracks      = list->tracks.begin();
+        mix.numTracks   = list->tracks.size();
+        mix.numChunks   = numChunks;
+        mix.numInputs   = audio.getNumChannels();
+        for (int c = 0; c < mix.numInputs; ++c)
+            mix.inputs[c] = audio.getReadPointer (c);
+        mix.numSamples  = numSamples;
+        mix.meter       = meter;
+        for (int i = 0; i < numChunks; ++i)
+            mix.dests[i] = partials.getUnchecked (i);
+
+        mixed = workers->run (numChunks, mixTracks, &mix);
+    }
 
-        if (track->mute)
-        {
-            for (int c = 0; c < track->numInputs; ++c)
-                rms.getReference(c).set (0.0);
-        }
-        else
+    if (mixed)
+    {
+        // redo any chunk a worker hasn't finished, its result is ignored
+        for (int i = 0; i < numChunks; ++i)
         {
-            for (int c = 0; c < track->numInputs; ++c)
+            const AudioSampleBuffer* partial = mix.dests[i];
+            if (! workers->isDone (i))
             {
-                rms.getReference(c).set (track->gain * input.getRMSLevel (c, 0, numSamples));
-                tempBuffer.addFromWithRamp (c, 0, input.getReadPointer(c), numSamples,
-                                            track->lastGain, track->gain);
+                int begin, end;
+                mix.getRange (i, begin, end);
+                mixTracks (mix.tracks + begin, end - begin, mix.inputs, mix.numInputs,
+                           spareBuffer, numSamples, meter);
+                partial = &spareBuffer;
             }
-        }
 
-        track->lastGain = track->gain;
-
-        if (track->gain != track->monitor->nextGain.get())
-            track->gain = track->monitor->nextGain.get();
-        track->monitor->gain.set (track->gain);
+            for (int c = 0; c < tempBuffer.getNumChannels(); ++c)
+            {
+                if (i == 0)
+                    tempBuffer.copyFrom (c, 0, *partial, c, 0, numSamples);
+                else
+                    tempBuffer.addFrom (c, 0, *partial, c, 0, numSamples);
+            }
+        }
 
-        if (static_cast<int> (track->mute) != track->monitor->nextMute.get())
-            track->mute = track->monitor->nextMute.get() > 0;
-        track->monitor->muted.set (track->mute ? 1 : 0);
+        workers->release();
+    }
+    else
+    {
+        mixTracks (list->tracks.begin(), list->tracks.size(), audio.getArrayOfReadPointers(),
+                   audio.getNumChannels(), tempBuffer, numSamples, meter);
     }
 
-    output.clear (0, numSamples);
+    updateTracks (list->tracks.begin(), list->tracks.size());
+    tracksInUse.set (nullptr);
+
     const float gain = Decibels::decibelsToGain ((float)*masterVolume, (float) EL_FADER_MIN_DB);
-    if (! *masterMute)
+    auto& levels = masterMonitor->rms;
+    if (*masterMute)
+    {
+        output.clear (0, numSamples);
+        if (meter)
+            for (int c = 0; c < levels.size(); ++c)
+                levels.getReference(c).set (0.f);
+    }
+    else
+    {
         for (int c = 0; c < output.getNumChannels(); ++c)
-            output.copyFromWithRamp (c, 0, tempBuffer.getReadPointer(c), numSamples,
-                                     lastGain, gain);
+        {
+            const auto sum = MixKernels::mix (output.getWritePointer (c), tempBuffer.getReadPointer (c),
+                                              numSamples, lastGain, gain, true, meter);
+            if (meter && c < levels.size())
+                levels.getReference(c).set (MixKernels::rms (sum, numSamples));
+        }
+    }
 
     if (gain != masterMonitor->nextGain.get())
         *masterVolume = Decibels::gainToDecibels (masterMonitor->nextGain.get(), (float) EL_FADER_MIN_DB);
@@ -508,16 +852,15 @@ void AudioMixerProcessor::processBlock (AudioSampleBuffer& audio, MidiBuffer& mi
     masterMonitor->muted.set (*masterMute);
     masterMonitor->gain.set (gain);
 
-    for (int i = 0; i < 2; ++i)
-        masterMonitor->rms.getReference(i).set (
-            output.getRMSLevel (i, 0, numSamples));
-
     lastGain = gain;
 }
 
 void AudioMixerProcessor::releaseResources()
 {
+    workers->waitForJob (job.get());
     tempBuffer.setSize (1, 1, false, false, false);
+    spareBuffer.setSize (1, 1, false, false, false);
+    partials.clear (true);
 }
 
 bool AudioMixerProcessor::canApplyBusCountChange (bool isInput, bool isAdding,
@@ -544,63 +887,52 @@ bool AudioMixerProcessor::canApplyBusCountChange (bool isInput, bool isAdding,
 
 void AudioMixerProcessor::setTrackGain (const int track, const float gain)
 {
-    if (! isPositiveAndBelow (track, numTracks))
-        return;
-    ScopedLock sl (getCallbackLock());
-    tracks.getUnchecked(track)->gain = gain;
+    if (auto t = getTrack (track))
+        t->monitor->requestGain (gain);
 }
 
-void AudioMixerProcessor::setTrackMuted (const int track, const bool mute) {
-    if (! isPositiveAndBelow (track, numTracks))
-        return;
-    ScopedLock sl (getCallbackLock());
-    tracks.getUnchecked(track)->mute = mute;
+void AudioMixerProcessor::setTrackMuted (const int track, const bool mute)
+{
+    if (auto t = getTrack (track))
+        t->monitor->requestMute (mute);
 }
 
 bool AudioMixerProcessor::isTrackMuted (const int track) const
 {
-    if (! isPositiveAndBelow (track, numTracks))
-        return false;
-    ScopedLock sl (getCallbackLock());
-    return tracks.getUnchecked(track)->mute;
+    if (auto t = getTrack (track))
+        return t->monitor->nextMute.get() > 0;
+    return false;
 }
 
 float AudioMixerProcessor::getTrackGain (const int track) const
 {
-    if (! isPositiveAndBelow (track, numTracks))
-        return 1.f;
-    ScopedLock sl (getCallbackLock());
-    return tracks.getUnchecked(track)->gain;
+    if (auto t = getTrack (track))
+        return t->monitor->nextGain.get();
+    return 1.f;
 }
 
 void AudioMixerProcessor::getStateInformation (juce::MemoryBlock& block)
 {
-    OwnedArray<Track> t;
-    while (t.size() < numTracks)
-        t.add (new Track());
-    float volume = 0.0f;
-    bool mute = false;
-    {
-        ScopedLock sl (getCallbackLock());
-        for (int i = 0; i < numTracks; ++i)
-            t.getUnchecked(i)->update (tracks.getUnchecked (i));
-        volume = *masterVolume;
-        mute = *masterMute;
+    ReferenceCountedArray<Track> tracks;
+    {
+        ScopedLock sl (publishLock);
+        if (auto* const list = activeTracks.get())
+            tracks.addArray (list->tracks);
     }
 
     ValueTree state ("audiomixer");
-    state.setProperty (Tags::volume, volume, 0)
-         .setProperty ("mute", mute, 0);
-    for (int i = 0; i < numTracks; ++i)
+    state.setProperty (Tags::volume, (float) *masterVolume, 0)
+         .setProperty ("mute", (bool) *masterMute, 0);
+    for (auto* const track : tracks)
     {
+        // the requested values, which the audio thread picks up next block
         ValueTree trk ("track");
-        auto* const track = t.getUnchecked (i);
         trk.setProperty ("index",       track->index, 0)
            .setProperty ("busIdx",      track->busIdx, 0)
            .setProperty ("numInputs",   track->numInputs, 0)
            .setProperty ("numOutputs",  track->numOutputs, 0)
-           .setProperty ("gain",        track->gain, 0)
-           .setProperty ("mute",        track->mute, 0);
+           .setProperty ("gain",        track->monitor->nextGain.get(), 0)
+           .setProperty ("mute",        track->monitor->nextMute.get() > 0, 0);
         state.addChild (trk, -1, 0);
     }
 
@@ -621,11 +953,11 @@ void AudioMixerProcessor::setStateInformation (const void* data, int size)
     if (! state.isValid())
         return;
 
-    Array<Track*> newTracks;
+    auto* const newList = new TrackList();
     for (int i = 0; i < state.getNumChildren(); ++i)
     {
         const ValueTree trk (state.getChild (i));
-        auto* const track   = new Track();
+        Track::Ptr track    = new Track();
         track->index        = trk.getProperty ("index", i);
         track->busIdx       = trk.getProperty ("busIdx", i);
         track->numInputs    = trk.getProperty ("numInputs", 2);
@@ -633,6 +965,7 @@ void AudioMixerProcessor::setStateInformation (const void* data, int size)
         track->gain         = trk.getProperty ("gain", 1.f);
         track->lastGain     = track->gain;
         track->mute         = (bool) trk.getProperty ("mute", false);
+        updateChannels (*track);
 
         track->monitor = new Monitor (track->index, track->numInputs);
         track->monitor->gain.set (track->gain);
@@ -640,24 +973,18 @@ void AudioMixerProcessor::setStateInformation (const void* data, int size)
         track->monitor->muted.set (track->mute ? 1 : 0);
         track->monitor->nextMute.set (track->mute ? 1 : 0);
         
-        newTracks.add (track);
+        newList->tracks.add (track);
     }
 
-    {
-        ScopedLock sl (getCallbackLock());
-        *masterVolume = (float) state.getProperty (Tags::volume, 0.0);
-        *masterMute = (bool) state.getProperty ("mute", false);
-        masterMonitor->nextGain.set (Decibels::decibelsToGain ((float)*masterVolume, (float)EL_FADER_MIN_DB));
-        masterMonitor->gain.set (masterMonitor->nextGain.get());
-        masterMonitor->nextMute.set (*masterMute ? 1 : 0);
-        masterMonitor->muted.set (masterMonitor->nextMute.get());
-        tracks.swapWith (newTracks);
-        numTracks = tracks.size();
-    }
+    *masterVolume = (float) state.getProperty (Tags::volume, 0.0);
+    *masterMute = (bool) state.getProperty ("mute", false);
+    masterMonitor->nextGain.set (Decibels::decibelsToGain ((float)*masterVolume, (float)EL_FADER_MIN_DB));
+    masterMonitor->gain.set (masterMonitor->nextGain.get());
+    masterMonitor->nextMute.set (*masterMute ? 1 : 0);
+    masterMonitor->muted.set (masterMonitor->nextMute.get());
 
-    for (auto* dt : newTracks)
-        delete dt;
-    newTracks.clear();
+    ScopedLock sl (publishLock);
+    publish (newList);
 }
 
 }
@@ -95,44 +95,24 @@ public:
 
     typedef ReferenceCountedObjectPtr<Monitor> MonitorPtr;
 
-    struct Track
+    struct Track : public ReferenceCountedObject
     {
+        using Ptr = ReferenceCountedObjectPtr<Track>;
+
         int index       = -1;
         int busIdx      = -1;
+        int channel     = 0;    // first channel of the bus in the process buffer
         int numInputs   = 0;
         int numOutputs  = 0;
         float lastGain  = 1.0;
         float gain      = 1.0;
         bool mute       = false;
         MonitorPtr      monitor;
-
-        inline void update (const Track* const track)
-        {
-            this->index         = track->index;
-            this->busIdx        = track->busIdx;
-            this->numInputs     = track->numInputs;
-            this->numOutputs    = track->numOutputs;
-            this->gain          = track->gain;
-            this->lastGain      = track->gain;
-            this->mute          = track->mute;
-            this->monitor       = track->monitor;
-        }
     };
 
     explicit AudioMixerProcessor (int numTracks = 4,
                                   const double sampleRate = 44100.0,
-                                  const int bufferSize = 1024)
-        : BaseProcessor (BusesProperties()
-            .withOutput ("Master",  AudioChannelSet::stereo(), false))
-    {
-        tracks.ensureStorageAllocated (16);
-        while (--numTracks >= 0)
-            addStereoTrack();
-        setRateAndBufferSizeDetails (sampleRate, bufferSize);
-        addParameter (masterMute = new AudioParameterBool ("masterMute", "Master Mute", false));
-        addParameter (masterVolume  = new AudioParameterFloat ("masterVolume",  "Master Volume", -120.0f, 12.0f, 0.f));
-        masterMonitor = new Monitor (-1, 2);
-    }
+                                  const int bufferSize = 1024);
 
     ~AudioMixerProcessor();
 
@@ -153,7 +133,7 @@ public:
         desc.version            = "1.0.0";
     }
 
-    int getNumTracks() const { ScopedLock sl (getCallbackLock()); return tracks.size(); }
+    int getNumTracks() const;
     
     MonitorPtr getMonitor (const int track = -1) const;
     
@@ -200,13 +180,45 @@ public:
     void setStateInformation (const void*, int) override;
 
 private:
+    friend class AudioMixerEditor;
+    class Workers;
+    struct MixJob;
+
+    /** An immutable snapshot of the tracks. The audio thread reads whichever
+        list is published and the message thread replaces it whole */
+    struct TrackList
+    {
+        ReferenceCountedArray<Track> tracks;
+    };
+
     MonitorPtr masterMonitor;
-    Array<Track*> tracks;
-    int numTracks = 0;
-    AudioSampleBuffer tempBuffer;
+    CriticalSection publishLock;
+    Atomic<TrackList*> activeTracks { nullptr };
+    Atomic<TrackList*> tracksInUse  { nullptr };
+    AudioSampleBuffer tempBuffer, spareBuffer;
+    OwnedArray<AudioSampleBuffer> partials;
+    SharedResourcePointer<Workers> workers;
+    std::unique_ptr<MixJob> job;
+    Atomic<int> meterViews;
     float lastGain = 0.f;
+
     void addMonoTrack();
     void addStereoTrack();
+
+    /** Replaces the published track list, deleting the old one once the
+        audio thread no longer uses it */
+    void publish (TrackList* newList);
+    Track::Ptr getTrack (int index) const;
+    void updateChannels (Track& track) const;
+
+    /** Mixes tracks into dest without changing them, so a worker which
+        finishes late does no harm */
+    static void mixTracks (void* job, int chunk);
+    static void mixTracks (Track* const* tracks, int numTracks, const float* const* inputs,
+                           int numInputs, AudioSampleBuffer& dest, int numSamples, bool meter);
+
+    /** Moves tracks to the gain and mute requested by their monitors */
+    static void updateTracks (Track* const* tracks, int numTracks);
 };
 
 }
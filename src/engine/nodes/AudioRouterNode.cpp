@@ -19,6 +19,7 @@
 
 #include "engine/nodes/BaseProcessor.h"
 #include "engine/nodes/AudioRouterNode.h"
+#include "engine/MixKernels.h"
 #include "Common.h"
 
 #define TRACE_AUDIO_ROUTER(output) 
@@ -30,17 +31,21 @@ AudioRouterNode::AudioRouterNode (int ins, int outs)
       numSources (ins),
       numDestinations (outs),
       state (ins, outs),
-      toggles (ins, outs),
-      nextToggles (ins, outs)
+      activeCells (ins, outs)
 {
     jassert (metadata.hasType (Tags::node));
     metadata.setProperty (Tags::format, "Element", nullptr);
     metadata.setProperty (Tags::identifier, EL_INTERNAL_ID_AUDIO_ROUTER, nullptr);
-    
-    fadeIn.setFadesIn (true);
-    fadeIn.setLength (fadeLengthSeconds);
-    fadeOut.setFadesIn (false);
-    fadeOut.setLength (fadeLengthSeconds);
+
+    const auto numCells = (size_t) (ins * outs);
+    levels.allocate (numCells, true);
+    nextTargets.allocate (numCells, true);
+    gains.allocate (numCells, true);
+    targets.allocate (numCells, true);
+    steps.allocate (numCells, true);
+    touched.allocate ((size_t) outs, true);
+    for (size_t i = 0; i < numCells; ++i)
+        levels[i] = 1.f;
 
     clearPatches();
 
@@ -83,6 +88,12 @@ AudioRouterNode::AudioRouterNode (int ins, int outs)
 
 AudioRouterNode::~AudioRouterNode() { }
 
+void AudioRouterNode::prepareToRender (double newSampleRate, int maxBufferSize)
+{
+    ignoreUnused (maxBufferSize);
+    sampleRate = newSampleRate > 0.0 ? newSampleRate : 44100.0;
+}
+
 void AudioRouterNode::setCurrentProgram (int index)
 {
     if (auto* program = programs [index])
@@ -95,13 +106,11 @@ void AudioRouterNode::setCurrentProgram (int index)
 void AudioRouterNode::setMatrixState (const MatrixState& matrix)
 {
     jassert (state.sameSizeAs (matrix));
-    state = matrix;
-    ToggleGrid newPatches (state);
 
     {
         ScopedLock sl (getLock());
-        nextToggles.swapWith (newPatches);
-        togglesChanged = true; // initiate the crossfade
+        state = matrix;
+        updateTargets(); // initiate the crossfade
     }
 
     sendChangeMessage();
@@ -112,6 +121,56 @@ MatrixState AudioRouterNode::getMatrixState() const
     return state;
 }
 
+void AudioRouterNode::setGain (int src, int dst, float gain)
+{
+    if (! isPositiveAndBelow (src, numSources) || ! isPositiveAndBelow (dst, numDestinations))
+        return;
+
+    {
+        // unpatching keeps the level for when it's patched again
+        ScopedLock sl (getLock());
+        if (gain > 0.f)
+            levels [cell (src, dst)] = gain;
+        state.set (src, dst, gain > 0.f);
+        updateTargets();
+    }
+
+    sendChangeMessage();
+}
+
+float AudioRouterNode::getGain (int src, int dst) const
+{
+    if (! isPositiveAndBelow (src, numSources) || ! isPositiveAndBelow (dst, numDestinations))
+        return 0.f;
+    ScopedLock sl (lock);
+    return state.connected (src, dst) ? levels [cell (src, dst)] : 0.f;
+}
+
+void AudioRouterNode::updateTargets()
+{
+    for (int src = 0; src < numSources; ++src)
+        for (int dst = 0; dst < numDestinations; ++dst)
+            nextTargets [cell (src, dst)] = state.connected (src, dst) ? levels [cell (src, dst)] : 0.f;
+    targetsChanged.set (1);
+}
+
+void AudioRouterNode::startFade()
+{
+    fadeFramesLeft = jmax (1, roundToInt (fadeLengthSeconds * sampleRate));
+    for (int i = 0; i < numSources * numDestinations; ++i)
+        steps[i] = (targets[i] - gains[i]) / (float) fadeFramesLeft;
+    updateActiveCells();
+}
+
+void AudioRouterNode::updateActiveCells()
+{
+    activeCells.clear();
+    for (int src = 0; src < numSources; ++src)
+        for (int dst = 0; dst < numDestinations; ++dst)
+            if (gains [cell (src, dst)] != 0.f || targets [cell (src, dst)] != 0.f)
+                activeCells.set (src, dst, true);
+}
+
 void AudioRouterNode::render (AudioSampleBuffer& audio, MidiPipe& midi)
 {
     jassert (midi.getNumBuffers() == 1);
@@ -133,136 +192,92 @@ void AudioRouterNode::render (AudioSampleBuffer& audio, MidiPipe& midi)
     const int numChannels = audio.getNumChannels();
 
     tempAudio.setSize (numChannels, numFrames, false, false, true);
-    tempAudio.clear (0, numFrames);
 
-    if (togglesChanged)
+    if (targetsChanged.get() != 0)
     {
-        fadeIn.reset();
-        fadeIn.startFading();
-        fadeOut.reset();
-        fadeOut.startFading();
-        togglesChanged = false;
-        TRACE_AUDIO_ROUTER("fade start");
+        // a change still being written is picked up next block
+        ScopedTryLock sl (lock);
+        if (sl.isLocked())
+        {
+            targetsChanged.set (0);
+            memcpy (targets, nextTargets, sizeof (float) * (size_t) (numSources * numDestinations));
+            startFade();
+            TRACE_AUDIO_ROUTER("fade start");
+        }
     }
 
-    if (fadeIn.isActive() || fadeOut.isActive())
-    {
-        auto framesToProcess = numFrames;
-        int frame = 0;
-        ScopedLock sl (lock);
-        
-        float fadeInGain  = 0.0f;
-        float fadeOutGain = 1.0f;
+    for (int dst = 0; dst < numDestinations; ++dst)
+        touched[dst] = false;
+
+    const int fadeFrames = jmin (numFrames, fadeFramesLeft);
+    const bool fadeEnds  = fadeFramesLeft > 0 && fadeFrames == fadeFramesLeft;
 
-        while (--framesToProcess >= 0)
+    for (int src = 0; src < jmin (numSources, numChannels); ++src)
+    {
+        const float* const input = audio.getReadPointer (src);
+        activeCells.forEachOutput (src, [&](int dst)
         {
-            fadeInGain  = fadeIn.isActive()  ? fadeIn.getNextEnvelopeValue()  : 1.0f;
-            fadeOutGain = fadeOut.isActive() ? fadeOut.getNextEnvelopeValue() : 0.0f;
+            if (dst >= numChannels)
+                return;
 
-            if (!fadeIn.isActive() && !fadeOut.isActive())
+            float* const output = tempAudio.getWritePointer (dst);
+            if (! touched[dst])
             {
-                TRACE_AUDIO_ROUTER("last frame fade in gain  : " << fadeInGain);
-                TRACE_AUDIO_ROUTER("last frame fade out gain : " << fadeOutGain);
+                FloatVectorOperations::clear (output, numFrames);
+                touched[dst] = true;
             }
 
-            for (int i = 0; i < numSources; ++i)
+            const int index = cell (src, dst);
+            float gain = gains[index];
+            if (fadeFrames > 0)
             {
-                for (int j = 0; j < numDestinations; ++j)
-                {
-                    if (toggles.get (i, j) && nextToggles.get (i, j))
-                    {
-                        // no patch change and on means 1 to 1 mix
-                        tempAudio.getWritePointer(j)[frame] += 
-                            audio.getReadPointer(i)[frame];
-                    }
-                    else if (! toggles.get (i, j) && ! nextToggles.get (i, j))
-                    {
-                        // no patch change and off means no fade and zero'd
-                        tempAudio.getWritePointer(j)[frame] += 0.0f;
-                    }
-                    else if (!toggles.get (i, j) && nextToggles.get (i, j))
-                    {
-                        tempAudio.getWritePointer(j)[frame] += 
-                            (audio.getReadPointer(i)[frame] * fadeInGain);
-                    }
-                    else if (toggles.get (i, j) && !nextToggles.get (i, j))
-                    {
-                        tempAudio.getWritePointer(j)[frame] += 
-                            (audio.getReadPointer(i)[frame] * fadeOutGain);
-                    }
-                }
+                // ramp this block's share of the fade, landing exactly on target
+                const float end = fadeEnds ? targets[index] : gain + steps[index] * (float) fadeFrames;
+                MixKernels::mix (output, input, fadeFrames, gain, end, false, false);
+                gains[index] = gain = end;
             }
 
-            ++frame;
-
-            if (!fadeIn.isActive() && !fadeOut.isActive())
-                break;
-        }
+            if (fadeFrames < numFrames && gain != 0.f)
+                MixKernels::mix (output + fadeFrames, input + fadeFrames, numFrames - fadeFrames,
+                                 gain, gain, false, false);
+        });
+    }
 
-        if (!fadeOut.isActive() && !fadeIn.isActive())
+    if (fadeFramesLeft > 0)
+    {
+        fadeFramesLeft -= fadeFrames;
+        if (fadeFramesLeft <= 0)
         {
-            TRACE_AUDIO_ROUTER("fade stopped @ frame: " << (frame));
-            TRACE_AUDIO_ROUTER("fade in level  : " << fadeInGain);
-            TRACE_AUDIO_ROUTER("fade out level : " << fadeOutGain);
-
-            if (framesToProcess > 0)
-            {
-                TRACE_AUDIO_ROUTER("rendering " << framesToProcess << " remainging frames");
-                for (int i = 0; i < numSources; ++i)
-                {
-                    for (int j = 0; j < numDestinations; ++j)
-                    {
-                        if (toggles.get(i, j) && nextToggles.get (i, j))
-                        {
-                            // no patch change and on means 1 to 1 mix
-                            tempAudio.addFrom (j, frame, audio.getReadPointer (i, frame), 
-                                               framesToProcess);
-                        }
-                        else if (! toggles.get (i, j) && ! nextToggles.get (i, j))
-                        {
-                            // patch not changed and of, so clear the out channel.
-                            // nothing to do
-                        }
-                        else if (!toggles.get (i, j) && nextToggles.get (i, j))
-                        {
-                            tempAudio.addFromWithRamp (j, frame, audio.getReadPointer (i, frame), 
-                                                          framesToProcess, fadeInGain, 1.0f);
-                        }
-                        else if (toggles.get (i, j) && !nextToggles.get (i, j))
-                        {
-                            tempAudio.addFromWithRamp (j, frame, audio.getReadPointer (i, frame),
-                                                          framesToProcess, fadeOutGain, 0.0f);
-                        }
-                        else
-                        {
-                            // this would be an unhandled fading scenario
-                            jassertfalse;
-                        }
-                    }
-                }
-            }
-
-            toggles.swapWith (nextToggles);
+            TRACE_AUDIO_ROUTER("fade stopped");
+            updateActiveCells(); // drop cells which faded out
         }
     }
-    else
+
+    for (int c = 0; c < numChannels; ++c)
     {
-        ScopedLock sl (lock);
-        for (int i = 0; i < numSources; ++i)
-            for (int j = 0; j < numDestinations; ++j)
-                if (toggles.get (i, j))
-                    tempAudio.addFrom (j, 0, audio, i, 0, numFrames);
+        if (c < numDestinations && touched[c])
+            audio.copyFrom (c, 0, tempAudio.getReadPointer (c), numFrames);
+        else
+            audio.clear (c, 0, numFrames);
     }
 
-    for (int c = 0; c < numChannels; ++c)
-        audio.copyFrom (c, 0, tempAudio.getReadPointer(c), numFrames);
     midi.clear();
 }
 
 void AudioRouterNode::getState (MemoryBlock& block)
 {
+    auto tree = state.createValueTree();
+
+    String gainList;
+    {
+        ScopedLock sl (lock);
+        for (int i = 0; i < numSources * numDestinations; ++i)
+            gainList << levels[i] << " ";
+    }
+    tree.setProperty ("gains", gainList.trim(), nullptr);
+
     MemoryOutputStream stream (block, false);
-    state.createValueTree().writeToStream (stream);
+    tree.writeToStream (stream);
 }
 
 void AudioRouterNode::setState (const void* data, int sizeInBytes)
@@ -274,6 +289,17 @@ void AudioRouterNode::setState (const void* data, int sizeInBytes)
         kv::MatrixState matrix;
         matrix.restoreFromValueTree (tree);
         jassert (matrix.getNumRows() == numSources && matrix.getNumColumns() == numDestinations);
+
+        StringArray gainList;
+        gainList.addTokens (tree.getProperty ("gains").toString(), " ", String());
+        gainList.removeEmptyStrings();
+        if (gainList.size() == numSources * numDestinations)
+        {
+            ScopedLock sl (lock);
+            for (int i = 0; i < gainList.size(); ++i)
+                levels[i] = jmax (0.f, gainList[i].getFloatValue());
+        }
+
         setMatrixState (matrix);
     }
 }
@@ -281,28 +307,24 @@ void AudioRouterNode::setState (const void* data, int sizeInBytes)
 void AudioRouterNode::setWithoutLocking (int src, int dst, bool set)
 {
     jassert (src >= 0 && src < numSources && dst >= 0 && dst < numDestinations);
-    toggles.set (src, dst, set);
     state.set (src, dst, set);
+    nextTargets [cell (src, dst)] = set ? levels [cell (src, dst)] : 0.f;
+    targetsChanged.set (1);
 }
 
 void AudioRouterNode::set (int src, int dst, bool patched)
 {
-    jassert (src >= 0 && src < numSources && dst >= 0 && numDestinations < 4);
-    toggles.set (src, dst, patched);
-    state.set (src, dst, patched);
+    ScopedLock sl (getLock());
+    setWithoutLocking (src, dst, patched);
 }
 
 void AudioRouterNode::clearPatches()
 {
-    {
-        ScopedLock sl (getLock());
-        toggles.clear();
-        nextToggles.clear();
-    }
-
+    ScopedLock sl (getLock());
     for (int r = 0; r < state.getNumRows(); ++r)
         for (int c = 0; c < state.getNumColumns(); ++c)
             state.set (r, c, false);
+    updateTargets();
 }
 
 }
@@ -20,12 +20,18 @@
 #pragma once
 
 #include "engine/GraphNode.h"
-#include "engine/LinearFade.h"
 #include "engine/ToggleGrid.h"
 #include "engine/nodes/BaseProcessor.h"
 
 namespace Element {
 
+/** Routes inputs to outputs through a matrix of gains.
+
+    Each cell holds a gain, so besides patching on and off a source can be
+    sent to a destination at any level. Changes ramp every affected cell to
+    its new gain over the fade length. Only cells which are non-zero or
+    ramping are mixed, a block at a time.
+ */
 class AudioRouterNode : public GraphNode,
                         public ChangeBroadcaster
 {
@@ -33,7 +39,7 @@ public:
     explicit AudioRouterNode (int ins = 4, int outs = 4);
     ~AudioRouterNode();
 
-    void prepareToRender (double sampleRate, int maxBufferSize) override { ignoreUnused (sampleRate, maxBufferSize); }
+    void prepareToRender (double sampleRate, int maxBufferSize) override;
     void releaseResources() override { }
 
     inline bool wantsMidiPipe() const override { return true; }
@@ -46,6 +52,13 @@ public:
     void setWithoutLocking (int src, int dst, bool set);
     CriticalSection& getLock() { return lock; }
 
+    /** Sets the level of a patch. Zero unpatches it, anything else patches
+        it at that gain. The change ramps over the fade length */
+    void setGain (int src, int dst, float gain);
+
+    /** Returns the level of a patch, zero if unpatched */
+    float getGain (int src, int dst) const;
+
     int getNumPrograms() const override { return jmax (1, programs.size()); }
     int getCurrentProgram() const override { return currentProgram; }
     void setCurrentProgram (int index) override;
@@ -61,8 +74,6 @@ public:
         seconds = jlimit (0.001, 5.0, seconds);
         ScopedLock sl (lock);
         fadeLengthSeconds = seconds;
-        fadeIn.setLength (static_cast<float> (fadeLengthSeconds));
-        fadeOut.setLength (static_cast<float> (fadeLengthSeconds));
     }
 
     void getPluginDescription (PluginDescription& desc) const override
@@ -123,13 +134,26 @@ private:
 
     // used by the UI, but not the rendering
     MatrixState state;
+    HeapBlock<float> levels;        // gain of each cell when patched
 
+    // written under the lock, picked up by render
     double fadeLengthSeconds { 0.001 }; // 1 ms
-    LinearFade fadeIn;
-    LinearFade fadeOut;
-    ToggleGrid toggles;
-    ToggleGrid nextToggles;
-    bool togglesChanged { false };
+    HeapBlock<float> nextTargets;
+    Atomic<int> targetsChanged;
+
+    // render only, cells are src * numDestinations + dst
+    double sampleRate { 44100.0 };
+    HeapBlock<float> gains;
+    HeapBlock<float> targets;
+    HeapBlock<float> steps;
+    ToggleGrid activeCells;         // non-zero or ramping
+    HeapBlock<bool> touched;
+    int fadeFramesLeft { 0 };
+
+    inline int cell (int src, int dst) const noexcept { return src * numDestinations + dst; }
+    void updateTargets();
+    void startFade();
+    void updateActiveCells();
 };
 
 }
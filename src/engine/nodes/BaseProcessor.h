@@ -47,6 +47,10 @@
 #define EL_INTERNAL_ID_LUA                      "element.lua"
 #define EL_INTERNAL_ID_COMPRESSOR               "element.compressor"
 #define EL_INTERNAL_ID_MIDI_ROUTER              "element.midiRouter"
+#define EL_INTERNAL_ID_DISK_RECORDER            "element.diskRecorder"
+#define EL_INTERNAL_ID_MULTIBAND_COMPRESSOR     "element.multibandCompressor"
+#define EL_INTERNAL_ID_PARAMETRIC_EQ            "element.parametricEQ"
+#define EL_INTERNAL_ID_CONVOLUTION              "element.convolution"
 
 #define EL_INTERNAL_UID_AUDIO_FILE_PLAYER        1000
 #define EL_INTERNAL_UID_AUDIO_MIXER              1001
@@ -72,6 +76,10 @@
 #define EL_INTERNAL_UID_LUA                      1021
 #define EL_INTERNAL_UID_COMPRESSOR               1022
 #define EL_INTERNAL_UID_MIDI_ROUTER              1023
+#define EL_INTERNAL_UID_DISK_RECORDER            1024
+#define EL_INTERNAL_UID_MULTIBAND_COMPRESSOR     1025
+#define EL_INTERNAL_UID_PARAMETRIC_EQ            1026
+#define EL_INTERNAL_UID_CONVOLUTION              1027
 
 namespace Element {
 
@@ -24,10 +24,10 @@ namespace Element {
 
 CompressorProcessor::CompressorProcessor (const int _numChannels)
     : BaseProcessor (BusesProperties()
-        .withInput ("Main", AudioChannelSet::canonicalChannelSet (jlimit (1, 2, _numChannels)))
-        .withInput ("Sidechain", AudioChannelSet::canonicalChannelSet (jlimit (1, 2, _numChannels)))
-        .withOutput ("Main", AudioChannelSet::canonicalChannelSet (jlimit (1, 2, _numChannels)))),
-    numChannels (jlimit (1, 2, _numChannels))
+        .withInput ("Main", AudioChannelSet::canonicalChannelSet (jlimit (1, (int) maxChannels, _numChannels)))
+        .withInput ("Sidechain", AudioChannelSet::canonicalChannelSet (jlimit (1, (int) maxChannels, _numChannels)))
+        .withOutput ("Main", AudioChannelSet::canonicalChannelSet (jlimit (1, (int) maxChannels, _numChannels)))),
+    numChannels (jlimit (1, (int) maxChannels, _numChannels))
 {
     setBusesLayout (getBusesLayout());
     setRateAndBufferSizeDetails (44100.0, 1024);
@@ -48,6 +48,7 @@ CompressorProcessor::CompressorProcessor (const int _numChannels)
     addParameter (releaseMs = new AudioParameterFloat ("release",   "Release [ms]",   releaseRange, 100.0f));
     addParameter (makeupDB  = new AudioParameterFloat ("makeup",    "Makeup [dB]",    -18.0f, 18.0f, 0.0f));
     addParameter (sideChain = new AudioParameterFloat ("sidechain", "Side Chain",     0.0f, 1.0f, 0.0f));
+    addParameter (link      = new AudioParameterChoice ("link", "Channels", { "Linked", "Independent" }, 0));
 
     makeupGain.reset (numSteps);
 }
@@ -69,11 +70,15 @@ void CompressorProcessor::fillInPluginDescription (PluginDescription& desc) cons
 
 void CompressorProcessor::updateParams()
 {
-    detector.setAttackMs (*attackMs);
-    detector.setReleaseMs (*releaseMs);
-
-    sideDetector.setAttackMs (*attackMs);
-    sideDetector.setReleaseMs (*releaseMs);
+    const float attack  = *attackMs;
+    const float release = *releaseMs;
+    for (int ch = 0; ch < maxChannels; ++ch)
+    {
+        detectors[ch].setAttackMs (attack);
+        detectors[ch].setReleaseMs (release);
+        sideDetectors[ch].setAttackMs (attack);
+        sideDetectors[ch].setReleaseMs (release);
+    }
 
     gainComputer.setThreshold (*threshDB);
     gainComputer.setRatio (*ratio);
@@ -84,50 +89,126 @@ void CompressorProcessor::updateParams()
 
 void CompressorProcessor::prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock)
 {
-    detector.reset ((float) sampleRate);
-    sideDetector.reset ((float) sampleRate);
+    for (int ch = 0; ch < maxChannels; ++ch)
+    {
+        detectors[ch].reset ((float) sampleRate);
+        sideDetectors[ch].reset ((float) sampleRate);
+    }
     gainComputer.reset();
 
     setBusesLayout (getBusesLayout());
     setRateAndBufferSizeDetails (sampleRate, maximumExpectedSamplesPerBlock);
+
+    work.setSize (numChannels + 3, jmax (1, maximumExpectedSamplesPerBlock));
+    work.clear();
 }
 
-void CompressorProcessor::releaseResources() {}
+void CompressorProcessor::releaseResources()
+{
+    work.setSize (1, 1);
+}
+
+void CompressorProcessor::mixDown (const AudioBuffer<float>& source, int start, int numSamples, float* dest) const noexcept
+{
+    const int numChans = source.getNumChannels();
+    FloatVectorOperations::copy (dest, source.getReadPointer (0, start), numSamples);
+    for (int ch = 1; ch < numChans; ++ch)
+        FloatVectorOperations::add (dest, source.getReadPointer (ch, start), numSamples);
+    if (numChans > 1)
+        FloatVectorOperations::multiply (dest, 1.f / (float) numChans, numSamples);
+}
 
 void CompressorProcessor::processBlock (AudioBuffer<float>& buffer, MidiBuffer&)
 {
     auto mainBuffer = getBusBuffer (buffer, true, 0);
     auto sideBuffer = getBusBuffer (buffer, true, 1);
 
-    auto numBuffChannels = mainBuffer.getNumChannels();
+    const int numSamples = buffer.getNumSamples();
+    const int numChans   = jmin (mainBuffer.getNumChannels(), work.getNumChannels() - 3);
+    if (numSamples <= 0 || numChans <= 0)
+        return;
 
+    // snapshot parameters for the whole block
     updateParams();
-
-    float level = 0.0f;
-    for (int n = 0; n < buffer.getNumSamples(); ++n)
+    const float side    = jlimit (0.f, 1.f, sideChain->get());
+    const bool linked   = link->getIndex() == 0;
+    const int numGains  = linked ? 1 : numChans;
+    const bool useSide  = side > 0.f && sideBuffer.getNumChannels() >= numChans;
+    float curThresh = 1.f, curRatio = 1.f;
+    gainComputer.skip (numSamples, curThresh, curRatio);
+
+    float* const mono   = work.getWritePointer (numChans);
+    float* const levels = work.getWritePointer (numChans + 1);
+    float* const makeup = work.getWritePointer (numChans + 2);
+    float peakLevel = 0.f, minGain = 1.f;
+
+    // blocks larger than prepared for are done in pieces
+    for (int start = 0; start < numSamples; start += work.getNumSamples())
     {
-        // Get Main mono input
-        float mainInput = getSummedMonoSample (mainBuffer, n, numBuffChannels);
+        const int n = jmin (work.getNumSamples(), numSamples - start);
 
-        // Get sidechain mono input
-        float sideInput = getSummedMonoSample (sideBuffer, n, numBuffChannels);
+        if (makeupGain.isSmoothing())
+        {
+            for (int i = 0; i < n; ++i)
+                makeup[i] = makeupGain.getNextValue();
+        }
+        else
+        {
+            FloatVectorOperations::fill (makeup, makeupGain.getTargetValue(), n);
+        }
 
-        // Get level estimate, and compute gain
-        level = detector.process (mainInput) * (1.0f - *sideChain)
-              + sideDetector.process (sideInput) * *sideChain;
-        float gain = gainComputer.process (level);
+        for (int g = 0; g < numGains; ++g)
+        {
+            float* const gains = work.getWritePointer (g);
+
+            // level estimate, then the side chain blended in
+            const float* input = mainBuffer.getReadPointer (g, start);
+            if (linked)
+            {
+                mixDown (mainBuffer, start, n, mono);
+                input = mono;
+            }
+            detectors[g].process (input, gains, n);
+
+            if (useSide)
+            {
+                const float* sideInput = sideBuffer.getReadPointer (g, start);
+                if (linked)
+                {
+                    mixDown (sideBuffer, start, n, mono);
+                    sideInput = mono;
+                }
+                sideDetectors[g].process (sideInput, levels, n);
+                FloatVectorOperations::multiply (gains, 1.f - side, n);
+                FloatVectorOperations::addWithMultiply (gains, levels, side, n);
+            }
+
+            peakLevel = jmax (peakLevel, FloatVectorOperations::findMinAndMax (gains, n).getEnd());
+            gainComputer.process (gains, gains, n, curThresh, curRatio);
+            minGain = jmin (minGain, FloatVectorOperations::findMinimum (gains, n));
+            FloatVectorOperations::multiply (gains, makeup, n);
+        }
 
-        // Apply gain
-        mainBuffer.applyGain (n, 1, gain * makeupGain.getNextValue());
+        for (int ch = 0; ch < numChans; ++ch)
+            FloatVectorOperations::multiply (mainBuffer.getWritePointer (ch, start),
+                                             work.getReadPointer (linked ? 0 : ch), n);
     }
 
-    listeners.call (&Listener::updateInGainDB, Decibels::gainToDecibels (level));
+    inputLevelDB.set (Decibels::gainToDecibels (peakLevel));
+    gainReductionDB.set (Decibels::gainToDecibels (minGain));
 }
 
-float CompressorProcessor::calcGainDB (float db)
+float CompressorProcessor::calcGainDB (float db) const
 {
+    // a private computer so the audio thread's smoothing isn't touched
+    GainComputer curve;
+    curve.setThreshold (*threshDB);
+    curve.setRatio (*ratio);
+    curve.setKnee (*kneeDB);
+    curve.reset();
+
     auto x = Decibels::decibelsToGain (db);
-    auto gain = gainComputer.calcGain (x, gainComputer.thresh.getCurrentValue(), gainComputer.ratio.getCurrentValue());
+    auto gain = curve.calcGain (x, curve.thresh.getCurrentValue(), curve.ratio.getCurrentValue());
     return Decibels::gainToDecibels (gain);
 }
 
@@ -143,6 +224,7 @@ void CompressorProcessor::getStateInformation (juce::MemoryBlock& destData)
     state.setProperty ("release",   (float) *releaseMs, 0);
     state.setProperty ("makeup",    (float) *makeupDB,  0);
     state.setProperty ("sidechain", (float) *sideChain, 0);
+    state.setProperty ("link",      link->getIndex(),   0);
     if (auto e = state.createXml())
         AudioProcessor::copyXmlToBinary (*e, destData);
 }
@@ -161,6 +243,7 @@ void CompressorProcessor::setStateInformation (const void* data, int sizeInBytes
             *releaseMs = (float) state.getProperty ("release",   (float) *releaseMs);
             *makeupDB  = (float) state.getProperty ("makeup",    (float) *makeupDB);
             *sideChain = (float) state.getProperty ("sidechain", (float) *sideChain);
+            *link      = (int)   state.getProperty ("link",      link->getIndex());
         }
     }
 }
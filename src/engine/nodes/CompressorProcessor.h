@@ -74,6 +74,19 @@ public:
         return levelEstimate;
     }
 
+    /* Process a block, writing the level estimate of each sample */
+    inline void process (const float* input, float* levels, int numSamples) noexcept
+    {
+        auto estimate = levelEstimate;
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const auto x = std::abs (input[i]);
+            estimate += (x > estimate ? b0_a : b0_r) * (x - estimate);
+            levels[i] = estimate;
+        }
+        levelEstimate = estimate;
+    }
+
     void setLevelEstimate (float levelEst) { levelEstimate = levelEst; }
     float getLevelEstimate() { return levelEstimate; }
 
@@ -159,6 +172,22 @@ public:
         return calcGain (x, thresh.getNextValue(), ratio.getNextValue());
     }
 
+    /** Advances threshold and ratio smoothing by a block, returning the
+        values to use for all of it */
+    inline void skip (int numSamples, float& curThresh, float& curRatio)
+    {
+        curThresh = thresh.skip (numSamples);
+        curRatio  = ratio.skip (numSamples);
+    }
+
+    /** Turns a block of levels into gains, in place is fine */
+    inline void process (const float* levels, float* gains, int numSamples,
+                         float curThresh, float curRatio) noexcept
+    {
+        for (int i = 0; i < numSamples; ++i)
+            gains[i] = calcGain (levels[i], curThresh, curRatio);
+    }
+
 private:
     // recalculate knee values for a new threshold or knee width
     void recalcKnees()
@@ -189,21 +218,35 @@ private:
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (GainComputer)
 };
 
-/** Compressor Processing */
+/** Compressor Processing
+
+    Each block the parameters are read once, then level detection, gain
+    computation and makeup produce a gain vector which is applied to every
+    channel. Linked mode detects on the channels' mono sum and applies one
+    gain to all, otherwise each channel is detected and compressed alone.
+ */
 class CompressorProcessor : public BaseProcessor
 {
 public:
+    enum { maxChannels = 8 };
+
     explicit CompressorProcessor (const int _numChannels = 2);
 
     const String getName() const override { return "Compressor"; }
 
     void fillInPluginDescription (PluginDescription& desc) const override;
 
-    void updateParams();
     void prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock) override;
     void releaseResources() override;
     void processBlock (AudioBuffer<float>& buffer, MidiBuffer&) override;
-    float calcGainDB (float db);
+
+    /** Returns the gain in dB the current settings apply at a level. Safe to
+        call from the message thread */
+    float calcGainDB (float db) const;
+
+    /** Meters for the editor, written once per block */
+    float getInputLevelDB() const       { return inputLevelDB.get(); }
+    float getGainReductionDB() const    { return gainReductionDB.get(); }
 
     AudioProcessorEditor* createEditor() override;
     bool hasEditor() const override                 { return true; }
@@ -223,16 +266,6 @@ public:
     void setStateInformation (const void* data, int sizeInBytes) override;
     void numChannelsChanged() override;
 
-    class Listener
-    {
-    public:
-        virtual ~Listener() {}
-        virtual void updateInGainDB (float /*inDB*/) {}
-    };
-
-    void addListener (Listener* l) { listeners.add (l); }
-    void removeListener (Listener* l) { listeners.remove (l); }
-
 protected:
     inline bool isBusesLayoutSupported (const BusesLayout& layout) const override 
     {
@@ -249,7 +282,7 @@ protected:
             return false;
 
         const auto nchans = layout.getMainInputChannels();
-        return nchans >= 1 && nchans <= 2;
+        return nchans >= 1 && nchans <= maxChannels;
     }
 
     inline bool canApplyBusesLayout (const BusesLayout& layouts) const override { return isBusesLayoutSupported (layouts); }
@@ -260,14 +293,6 @@ protected:
     }
 
 private:
-    inline float getSummedMonoSample (AudioBuffer<float>& buffer, int idx, int numChans)
-    {
-        float sum = 0.0f;
-        for (int ch = 0; ch < numChans; ++ch)
-            sum += buffer.getSample (ch, idx);
-        return sum / (float) numChans;
-    };
-
     int numChannels = 0;
     AudioParameterFloat* threshDB  = nullptr;
     AudioParameterFloat* ratio     = nullptr;
@@ -276,15 +301,23 @@ private:
     AudioParameterFloat* releaseMs = nullptr;
     AudioParameterFloat* makeupDB  = nullptr;
     AudioParameterFloat* sideChain = nullptr;
+    AudioParameterChoice* link     = nullptr;
 
     SmoothedValue<float, ValueSmoothingTypes::Multiplicative> makeupGain = 1.0f;
     const int numSteps = 200;
 
-    LevelDetector detector;
-    LevelDetector sideDetector;
+    LevelDetector detectors [maxChannels];
+    LevelDetector sideDetectors [maxChannels];
     GainComputer gainComputer;
 
-    ListenerList<Listener> listeners;
+    // gain vector per channel, then mono, side and makeup scratch
+    AudioBuffer<float> work;
+
+    Atomic<float> inputLevelDB { -100.f };
+    Atomic<float> gainReductionDB { 0.f };
+
+    void updateParams();
+    void mixDown (const AudioBuffer<float>& source, int start, int numSamples, float* dest) const noexcept;
 
     JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (CompressorProcessor)
 };
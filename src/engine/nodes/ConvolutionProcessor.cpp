@@ -0,0 +1,403 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/nodes/ConvolutionProcessor.h"
+#include "engine/MixKernels.h"
+#include "gui/LookAndFeel.h"
+
+namespace Element {
+
+static AudioChannelSet channelSetFor (int numChannels)
+{
+    if (numChannels == 1)
+        return AudioChannelSet::mono();
+    if (numChannels == 2)
+        return AudioChannelSet::stereo();
+    return AudioChannelSet::discreteChannels (numChannels);
+}
+
+class ConvolutionEditor : public AudioProcessorEditor,
+                          public FilenameComponentListener,
+                          private Timer
+{
+public:
+    ConvolutionEditor (ConvolutionProcessor& node)
+        : AudioProcessorEditor (&node),
+          processor (node)
+    {
+        setOpaque (true);
+
+        chooser.reset (new FilenameComponent ("Impulse Response", processor.getFile(),
+                                              false, false, false, "*.wav;*.aif;*.aiff;*.flac",
+                                              String(), TRANS("Select Impulse Response")));
+        addAndMakeVisible (chooser.get());
+        chooser->addListener (this);
+
+        for (auto* slider : { &wetSlider, &drySlider })
+        {
+            addAndMakeVisible (slider);
+            slider->setSliderStyle (Slider::LinearBar);
+            slider->setRange (-60.0, 12.0, 0.1);
+            slider->setTextValueSuffix (" dB");
+        }
+
+        wetSlider.onValueChange = [this]() { *processor.getWetParameter() = (float) wetSlider.getValue(); };
+        drySlider.onValueChange = [this]() { *processor.getDryParameter() = (float) drySlider.getValue(); };
+
+        addAndMakeVisible (status);
+        status.setFont (Font (11.f));
+
+        stabilizeComponents();
+        setSize (360, 104);
+        startTimerHz (10);
+    }
+
+    ~ConvolutionEditor() noexcept
+    {
+        stopTimer();
+        chooser->removeListener (this);
+        chooser = nullptr;
+    }
+
+    void stabilizeComponents()
+    {
+        if (! wetSlider.isMouseButtonDown())
+            wetSlider.setValue (processor.getWetParameter()->get(), dontSendNotification);
+        if (! drySlider.isMouseButtonDown())
+            drySlider.setValue (processor.getDryParameter()->get(), dontSendNotification);
+
+        String text;
+        if (processor.isLoading())
+            text = "Loading...";
+        else if (processor.getImpulseLength() > 0)
+            text << String (processor.getTailLengthSeconds(), 2) << " s, "
+                 << processor.getImpulseChannels() << " ch";
+        else
+            text = "No impulse response";
+
+        if (processor.getNumOverruns() > 0)
+            text << ", " << processor.getNumOverruns() << " overruns";
+        status.setText (text, dontSendNotification);
+    }
+
+    void filenameComponentChanged (FilenameComponent*) override
+    {
+        processor.loadImpulseResponse (chooser->getCurrentFile());
+        stabilizeComponents();
+    }
+
+    void paint (Graphics& g) override
+    {
+        g.fillAll (LookAndFeel::widgetBackgroundColor);
+    }
+
+    void resized() override
+    {
+        auto r = getLocalBounds().reduced (4);
+        chooser->setBounds (r.removeFromTop (22));
+        r.removeFromTop (4);
+        wetSlider.setBounds (r.removeFromTop (22));
+        r.removeFromTop (4);
+        drySlider.setBounds (r.removeFromTop (22));
+        r.removeFromTop (4);
+        status.setBounds (r);
+    }
+
+private:
+    ConvolutionProcessor& processor;
+    std::unique_ptr<FilenameComponent> chooser;
+    Slider wetSlider, drySlider;
+    Label status;
+
+    void timerCallback() override { stabilizeComponents(); }
+};
+
+//==============================================================================
+/** The convolvers for a kernel, one per channel */
+struct ConvolutionProcessor::Engine
+{
+    Engine (ConvolutionKernel::Ptr kernel, int numChannels, ConvolutionWorker& w)
+        : worker (w)
+    {
+        for (int ch = 0; ch < numChannels; ++ch)
+            worker.add (convolvers.add (new Convolver (kernel, ch)));
+    }
+
+    ~Engine()
+    {
+        for (auto* convolver : convolvers)
+            worker.remove (convolver);
+    }
+
+    ConvolutionWorker& worker;
+    OwnedArray<Convolver> convolvers;
+};
+
+class ConvolutionProcessor::LoadJob : public ThreadPoolJob
+{
+public:
+    LoadJob (ConvolutionProcessor& p, const File& f, double rate)
+        : ThreadPoolJob ("Load Impulse Response"),
+          processor (p), file (f), sampleRate (rate) { }
+
+    JobStatus runJob() override
+    {
+        auto kernel = processor.cache->getKernel (file, sampleRate);
+        if (! shouldExit() && kernel != nullptr)
+            processor.setKernel (kernel);
+        return jobHasFinished;
+    }
+
+private:
+    ConvolutionProcessor& processor;
+    const File file;
+    const double sampleRate;
+};
+
+//==============================================================================
+ConvolutionProcessor::ConvolutionProcessor (int channels)
+    : BaseProcessor (BusesProperties()
+        .withInput  ("Main", channelSetFor (jlimit (1, (int) maxChannels, channels)), true)
+        .withOutput ("Main", channelSetFor (jlimit (1, (int) maxChannels, channels)), true)),
+      numChannels (jlimit (1, (int) maxChannels, channels))
+{
+    setRateAndBufferSizeDetails (44100.0, 1024);
+    addParameter (wetDB = new AudioParameterFloat ("wet", "Wet [dB]", -60.0f, 12.0f, 0.0f));
+    addParameter (dryDB = new AudioParameterFloat ("dry", "Dry [dB]", -60.0f, 12.0f, -60.0f));
+    tailSeconds.set (0.0);
+}
+
+ConvolutionProcessor::~ConvolutionProcessor()
+{
+    cancelLoad();
+    engine.reset();
+    nextEngine.reset();
+}
+
+int ConvolutionProcessor::getNumChannelsFor (const String& fileOrIdentifier)
+{
+    const int channels = fileOrIdentifier.fromLastOccurrenceOf (".", false, false).getIntValue();
+    return channels > 0 ? channels : 2;
+}
+
+void ConvolutionProcessor::fillInPluginDescription (PluginDescription& desc) const
+{
+    desc.name               = getName();
+    desc.name << " (" << numChannels << "ch)";
+    desc.fileOrIdentifier   = String (EL_INTERNAL_ID_CONVOLUTION) + "." + String (numChannels);
+    desc.descriptiveName    = "Impulse response convolution";
+    desc.numInputChannels   = numChannels;
+    desc.numOutputChannels  = numChannels;
+    desc.hasSharedContainer = false;
+    desc.isInstrument       = false;
+    desc.manufacturerName   = "Element";
+    desc.pluginFormatName   = "Element";
+    desc.version            = "1.0.0";
+    desc.uid                = EL_INTERNAL_UID_CONVOLUTION;
+}
+
+bool ConvolutionProcessor::isLoading() const
+{
+    return loadJob != nullptr && cache->getPool().contains (loadJob.get());
+}
+
+void ConvolutionProcessor::cancelLoad()
+{
+    if (loadJob == nullptr)
+        return;
+    cache->getPool().removeJob (loadJob.get(), true, 10000);
+    loadJob.reset();
+}
+
+void ConvolutionProcessor::loadImpulseResponse (const File& newFile)
+{
+    cancelLoad();
+    file = newFile;
+    memoryImpulse.setSize (0, 0);
+
+    // prepareToPlay loads it at the session rate
+    if (! prepared || ! file.existsAsFile())
+        return;
+
+    loadJob.reset (new LoadJob (*this, file, getSampleRate()));
+    cache->getPool().addJob (loadJob.get(), false);
+}
+
+void ConvolutionProcessor::setImpulseResponse (const AudioBuffer<float>& impulse, double impulseRate)
+{
+    cancelLoad();
+    file = File();
+    memoryImpulse.makeCopyOf (impulse);
+    memoryRate = impulseRate;
+    setKernel (ImpulseResponseCache::createKernel (memoryImpulse, memoryRate, getSampleRate()));
+}
+
+void ConvolutionProcessor::clearImpulseResponse()
+{
+    cancelLoad();
+    file = File();
+    memoryImpulse.setSize (0, 0);
+    setKernel (nullptr);
+}
+
+void ConvolutionProcessor::setKernel (ConvolutionKernel::Ptr newKernel)
+{
+    std::unique_ptr<Engine> newEngine;
+    if (newKernel != nullptr)
+        newEngine.reset (new Engine (newKernel, numChannels, *worker));
+
+    std::unique_ptr<Engine> retired;
+    {
+        ScopedLock sl (lock);
+        retired = std::move (nextEngine);
+        nextEngine = std::move (newEngine);
+        kernel = newKernel;
+        engineChanged.set (1);
+    }
+
+    impulseLength.set (newKernel != nullptr ? newKernel->getLength() : 0);
+    impulseChannels.set (newKernel != nullptr ? newKernel->getNumChannels() : 0);
+    tailSeconds.set (newKernel != nullptr ? newKernel->getLength() / newKernel->getSampleRate() : 0.0);
+    overrunCount.set (0);
+}
+
+void ConvolutionProcessor::prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock)
+{
+    setRateAndBufferSizeDetails (sampleRate, maximumExpectedSamplesPerBlock);
+    wet.setSize (numChannels, jmax (1, maximumExpectedSamplesPerBlock));
+    lastWet = Decibels::decibelsToGain (wetDB->get(), -60.f);
+    lastDry = Decibels::decibelsToGain (dryDB->get(), -60.f);
+    prepared = true;
+
+    ConvolutionKernel::Ptr current;
+    {
+        ScopedLock sl (lock);
+        current = kernel;
+    }
+
+    // fresh convolvers each time, the old ones may have a tail in flight
+    if (file != File())
+    {
+        if (current == nullptr || current->getSampleRate() != sampleRate)
+            loadImpulseResponse (file);
+        else
+            setKernel (current);
+    }
+    else if (memoryImpulse.getNumSamples() > 0)
+    {
+        setKernel (current != nullptr && current->getSampleRate() == sampleRate ? current
+            : ImpulseResponseCache::createKernel (memoryImpulse, memoryRate, sampleRate));
+    }
+}
+
+void ConvolutionProcessor::releaseResources()
+{
+    prepared = false;
+    cancelLoad();
+}
+
+void ConvolutionProcessor::processBlock (AudioBuffer<float>& buffer, MidiBuffer&)
+{
+    if (engineChanged.get() != 0)
+    {
+        ScopedTryLock sl (lock);
+        if (sl.isLocked())
+        {
+            std::swap (engine, nextEngine);
+            engineChanged.set (0);
+        }
+    }
+
+    const int numSamples = buffer.getNumSamples();
+    if (engine == nullptr || numSamples <= 0 || buffer.getNumChannels() < numChannels)
+        return;
+
+    const float wetGain = Decibels::decibelsToGain (wetDB->get(), -60.f);
+    const float dryGain = Decibels::decibelsToGain (dryDB->get(), -60.f);
+    const int blockSize = wet.getNumSamples();
+
+    for (int start = 0; start < numSamples; start += blockSize)
+    {
+        const int n = jmin (blockSize, numSamples - start);
+        const float startWet = lastWet + (wetGain - lastWet) * (float) start / (float) numSamples;
+        const float endWet   = lastWet + (wetGain - lastWet) * (float) (start + n) / (float) numSamples;
+        const float startDry = lastDry + (dryGain - lastDry) * (float) start / (float) numSamples;
+        const float endDry   = lastDry + (dryGain - lastDry) * (float) (start + n) / (float) numSamples;
+
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            float* const out = buffer.getWritePointer (ch, start);
+            float* const convolved = wet.getWritePointer (ch);
+            FloatVectorOperations::clear (convolved, n);
+            engine->convolvers.getUnchecked (ch)->process (out, convolved, n);
+
+            buffer.applyGainRamp (ch, start, n, startDry, endDry);
+            MixKernels::mix (out, convolved, n, startWet, endWet, false, false);
+        }
+    }
+
+    lastWet = wetGain;
+    lastDry = dryGain;
+
+    int overruns = 0;
+    for (auto* convolver : engine->convolvers)
+        overruns += convolver->getNumOverruns();
+    overrunCount.set (overruns);
+}
+
+AudioProcessorEditor* ConvolutionProcessor::createEditor()
+{
+    return new ConvolutionEditor (*this);
+}
+
+void ConvolutionProcessor::getStateInformation (juce::MemoryBlock& destData)
+{
+    ValueTree state (Tags::state);
+    state.setProperty ("file", file.getFullPathName(), nullptr)
+         .setProperty ("wet", wetDB->get(), nullptr)
+         .setProperty ("dry", dryDB->get(), nullptr);
+    if (auto e = state.createXml())
+        AudioProcessor::copyXmlToBinary (*e, destData);
+}
+
+void ConvolutionProcessor::setStateInformation (const void* data, int sizeInBytes)
+{
+    if (auto e = AudioProcessor::getXmlFromBinary (data, sizeInBytes))
+    {
+        auto state = ValueTree::fromXml (*e);
+        if (! state.isValid())
+            return;
+
+        *wetDB = (float) state.getProperty ("wet", wetDB->get());
+        *dryDB = (float) state.getProperty ("dry", dryDB->get());
+
+        const String path = state.getProperty ("file").toString();
+        if (path.isNotEmpty() && File::isAbsolutePath (path))
+            loadImpulseResponse (File (path));
+    }
+}
+
+bool ConvolutionProcessor::isBusesLayoutSupported (const BusesLayout& layout) const
+{
+    return layout.inputBuses.size() == 1 && layout.outputBuses.size() == 1
+        && layout.getMainInputChannels() == numChannels
+        && layout.getMainOutputChannels() == numChannels;
+}
+
+}
@@ -0,0 +1,129 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "engine/nodes/BaseProcessor.h"
+#include "engine/ImpulseResponseCache.h"
+
+namespace Element {
+
+/** Convolves its inputs with an impulse response, for rooms and cabinets.
+
+    Impulse responses load on a background pool, are resampled to the
+    session rate and shared between nodes using the same file. The early
+    part is convolved on the audio thread with no latency and the rest on
+    the shared ConvolutionWorker. Each channel uses the matching channel of
+    the impulse response, wrapping around when it has fewer.
+ */
+class ConvolutionProcessor : public BaseProcessor
+{
+public:
+    enum { maxChannels = 16 };
+
+    explicit ConvolutionProcessor (int numChannels = 2);
+    ~ConvolutionProcessor();
+
+    /** Returns the channel count encoded in an identifier */
+    static int getNumChannelsFor (const String& fileOrIdentifier);
+
+    /** Loads an impulse response file in the background */
+    void loadImpulseResponse (const File& file);
+
+    /** Uses an impulse response from memory. It is resampled and
+        partitioned on the calling thread */
+    void setImpulseResponse (const AudioBuffer<float>& impulse, double impulseRate);
+
+    /** Removes the impulse response, audio then passes through */
+    void clearImpulseResponse();
+
+    const File& getFile() const noexcept                { return file; }
+    bool isLoading() const;
+    int getImpulseLength() const noexcept               { return impulseLength.get(); }
+    int getImpulseChannels() const noexcept             { return impulseChannels.get(); }
+    int getNumOverruns() const noexcept                 { return overrunCount.get(); }
+
+    AudioParameterFloat* getWetParameter() const noexcept   { return wetDB; }
+    AudioParameterFloat* getDryParameter() const noexcept   { return dryDB; }
+
+    const String getName() const override { return "Convolution"; }
+    void fillInPluginDescription (PluginDescription& desc) const override;
+
+    void prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock) override;
+    void releaseResources() override;
+    void processBlock (AudioBuffer<float>& buffer, MidiBuffer&) override;
+
+    bool canAddBus (bool isInput) const override                     { ignoreUnused (isInput); return false; }
+    bool canRemoveBus (bool isInput) const override                  { ignoreUnused (isInput); return false; }
+
+    AudioProcessorEditor* createEditor() override;
+    bool hasEditor() const override                 { return true; }
+
+    double getTailLengthSeconds() const override    { return tailSeconds.get(); };
+    bool acceptsMidi() const override               { return false; }
+    bool producesMidi() const override              { return false; }
+
+    int getNumPrograms() override                                      { return 1; };
+    int getCurrentProgram() override                                   { return 1; };
+    void setCurrentProgram (int index) override                        { ignoreUnused (index); };
+    const String getProgramName (int index) override                   { ignoreUnused (index); return "Parameter"; }
+    void changeProgramName (int index, const String& newName) override { ignoreUnused (index, newName); }
+
+    void getStateInformation (juce::MemoryBlock& destData) override;
+    void setStateInformation (const void* data, int sizeInBytes) override;
+
+protected:
+    bool isBusesLayoutSupported (const BusesLayout&) const override;
+
+private:
+    class LoadJob;
+    struct Engine;
+
+    const int numChannels;
+    SharedResourcePointer<ImpulseResponseCache> cache;
+    SharedResourcePointer<ConvolutionWorker> worker;
+    AudioParameterFloat* wetDB = nullptr;
+    AudioParameterFloat* dryDB = nullptr;
+
+    // message thread
+    File file;
+    AudioBuffer<float> memoryImpulse;
+    double memoryRate = 0.0;
+    std::unique_ptr<LoadJob> loadJob;
+    bool prepared = false;
+
+    CriticalSection lock;
+    ConvolutionKernel::Ptr kernel;
+    std::unique_ptr<Engine> engine, nextEngine;
+    Atomic<int> engineChanged;
+
+    // audio thread
+    AudioBuffer<float> wet;
+    float lastWet = 1.f, lastDry = 0.f;
+
+    Atomic<int> impulseLength, impulseChannels, overrunCount;
+    Atomic<double> tailSeconds;
+
+    void cancelLoad();
+    void setKernel (ConvolutionKernel::Ptr newKernel);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ConvolutionProcessor)
+};
+
+}
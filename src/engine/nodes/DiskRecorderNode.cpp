@@ -0,0 +1,373 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/nodes/DiskRecorderNode.h"
+#include "gui/LookAndFeel.h"
+#include "Utils.h"
+
+namespace Element {
+
+static AudioChannelSet channelSetFor (int numChannels)
+{
+    if (numChannels == 1)
+        return AudioChannelSet::mono();
+    if (numChannels == 2)
+        return AudioChannelSet::stereo();
+    return AudioChannelSet::discreteChannels (numChannels);
+}
+
+class DiskRecorderEditor : public AudioProcessorEditor,
+                           public FilenameComponentListener,
+                           private Timer
+{
+public:
+    DiskRecorderEditor (DiskRecorderNode& node)
+        : AudioProcessorEditor (&node),
+          processor (node)
+    {
+        setOpaque (true);
+
+        directory.reset (new FilenameComponent ("Directory", processor.getRecorder().getDirectory(),
+                                                false, true, false, String(), String(),
+                                                TRANS("Select Recording Folder")));
+        addAndMakeVisible (directory.get());
+        directory->addListener (this);
+
+        addAndMakeVisible (recordButton);
+        recordButton.setButtonText ("Record");
+        recordButton.setColour (TextButton::buttonOnColourId, Colors::toggleRed);
+        recordButton.onClick = [this]()
+        {
+            processor.setRecording (! processor.isRecordEnabled());
+            stabilizeComponents();
+        };
+
+        addAndMakeVisible (syncToggle);
+        syncToggle.setButtonText ("Sync to transport");
+        syncToggle.onClick = [this]() { processor.setSyncToTransport (syncToggle.getToggleState()); };
+
+        addAndMakeVisible (punchToggle);
+        punchToggle.setButtonText ("Punch");
+        punchToggle.onClick = [this]() { processor.setPunchEnabled (punchToggle.getToggleState()); };
+
+        for (auto* slider : { &punchIn, &punchOut, &preRoll })
+        {
+            addAndMakeVisible (slider);
+            slider->setSliderStyle (Slider::LinearBar);
+            slider->setTextValueSuffix (" s");
+        }
+
+        punchIn.setRange (0.0, 3600.0, 0.01);
+        punchOut.setRange (0.0, 3600.0, 0.01);
+        punchIn.setSkewFactorFromMidPoint (60.0);
+        punchOut.setSkewFactorFromMidPoint (60.0);
+        punchIn.onValueChange = punchOut.onValueChange = [this]()
+        {
+            processor.setPunchRange (punchIn.getValue(), punchOut.getValue());
+        };
+
+        preRoll.setRange (0.0, 30.0, 0.5);
+        preRoll.onDragEnd = [this]() { processor.setPreRollSeconds (preRoll.getValue()); };
+
+        addAndMakeVisible (formatBox);
+        formatBox.addItem ("WAV 16-bit", 1);
+        formatBox.addItem ("WAV 24-bit", 2);
+        formatBox.addItem ("WAV 32-bit float", 3);
+        formatBox.addItem ("AIFF 24-bit", 4);
+       #if JUCE_USE_FLAC
+        formatBox.addItem ("FLAC 16-bit", 5);
+        formatBox.addItem ("FLAC 24-bit", 6);
+       #endif
+        formatBox.onChange = [this]()
+        {
+            static const int bits[] = { 16, 24, 32, 24, 16, 24 };
+            const int index = jlimit (0, 5, formatBox.getSelectedId() - 1);
+            const auto format = index < 3 ? DiskRecorder::WAV : index < 4 ? DiskRecorder::AIFF : DiskRecorder::FLAC;
+            processor.getRecorder().setFormat (format, bits [index]);
+        };
+
+        addAndMakeVisible (status);
+        status.setFont (Font (11.f));
+
+        stabilizeComponents();
+        setSize (360, 184);
+        startTimerHz (10);
+    }
+
+    ~DiskRecorderEditor() noexcept
+    {
+        stopTimer();
+        directory->removeListener (this);
+        directory = nullptr;
+    }
+
+    void stabilizeComponents()
+    {
+        recordButton.setToggleState (processor.isRecordEnabled(), dontSendNotification);
+        syncToggle.setToggleState (processor.isSyncedToTransport(), dontSendNotification);
+        punchToggle.setToggleState (processor.isPunchEnabled(), dontSendNotification);
+
+        if (! punchIn.isMouseButtonDown())
+            punchIn.setValue (processor.getPunchIn(), dontSendNotification);
+        if (! punchOut.isMouseButtonDown())
+            punchOut.setValue (processor.getPunchOut(), dontSendNotification);
+        if (! preRoll.isMouseButtonDown())
+            preRoll.setValue (processor.getRecorder().getPreRollSeconds(), dontSendNotification);
+
+        auto& recorder = processor.getRecorder();
+        const int bits = recorder.getBitsPerSample();
+        int id = 0;
+        switch (recorder.getFormat())
+        {
+            case DiskRecorder::WAV:  id = bits <= 16 ? 1 : bits <= 24 ? 2 : 3; break;
+            case DiskRecorder::AIFF: id = 4; break;
+            case DiskRecorder::FLAC: id = bits <= 16 ? 5 : 6; break;
+        }
+        formatBox.setSelectedId (id, dontSendNotification);
+
+        const auto stats = recorder.getStats();
+        String text;
+        text << (stats.recording ? "Recording " : "Stopped ")
+             << Util::secondsToString ((double) stats.takeSamples / jmax (1.0, processor.getSampleRate()))
+             << "  takes " << stats.numTakes
+             << "  buffer " << roundToInt (stats.bufferUsage * 100.f) << "%"
+             << "  overruns " << stats.overruns;
+        if (stats.errors > 0)
+            text << "  errors " << stats.errors;
+        status.setText (text, dontSendNotification);
+        status.setColour (Label::textColourId, stats.overruns > 0 || stats.errors > 0
+            ? Colors::toggleRed : LookAndFeel::textColor);
+    }
+
+    void filenameComponentChanged (FilenameComponent*) override
+    {
+        const auto dir = directory->getCurrentFile();
+        if (dir.isDirectory())
+            processor.getRecorder().setDirectory (dir);
+    }
+
+    void resized() override
+    {
+        auto r (getLocalBounds().reduced (4));
+        directory->setBounds (r.removeFromTop (18));
+        r.removeFromTop (4);
+
+        auto r2 = r.removeFromTop (18);
+        recordButton.setBounds (r2.removeFromLeft (80));
+        r2.removeFromLeft (4);
+        formatBox.setBounds (r2);
+        r.removeFromTop (4);
+
+        r2 = r.removeFromTop (18);
+        syncToggle.setBounds (r2.removeFromLeft (140));
+        punchToggle.setBounds (r2);
+        r.removeFromTop (4);
+
+        r2 = r.removeFromTop (18);
+        punchIn.setBounds (r2.removeFromLeft (r2.getWidth() / 2 - 2));
+        r2.removeFromLeft (4);
+        punchOut.setBounds (r2);
+        r.removeFromTop (4);
+
+        preRoll.setBounds (r.removeFromTop (18));
+        r.removeFromTop (4);
+        status.setBounds (r.removeFromTop (18));
+    }
+
+    void paint (Graphics& g) override
+    {
+        g.fillAll (LookAndFeel::widgetBackgroundColor);
+    }
+
+private:
+    DiskRecorderNode& processor;
+    std::unique_ptr<FilenameComponent> directory;
+    TextButton recordButton;
+    ToggleButton syncToggle, punchToggle;
+    Slider punchIn, punchOut, preRoll;
+    ComboBox formatBox;
+    Label status;
+
+    void timerCallback() override { stabilizeComponents(); }
+};
+
+//==============================================================================
+DiskRecorderNode::DiskRecorderNode (int channels)
+    : BaseProcessor (BusesProperties()
+        .withInput  ("Main", channelSetFor (jlimit (1, 128, channels)), true)
+        .withOutput ("Main", channelSetFor (jlimit (1, 128, channels)), true)),
+      numChannels (jlimit (1, 128, channels)),
+      recorder (*streamer->getThread())
+{
+    addParameter (record = new AudioParameterBool ("record", "Record", false));
+    addParameter (sync   = new AudioParameterBool ("sync", "Sync", true));
+    addParameter (punch  = new AudioParameterBool ("punch", "Punch", false));
+    punchIn.set (0.0);
+    punchOut.set (60.0);
+}
+
+DiskRecorderNode::~DiskRecorderNode()
+{
+    recorder.release();
+    record = sync = punch = nullptr;
+}
+
+int DiskRecorderNode::getNumChannelsFor (const String& fileOrIdentifier)
+{
+    const int channels = fileOrIdentifier.fromLastOccurrenceOf (".", false, false).getIntValue();
+    return channels > 0 ? channels : 2;
+}
+
+void DiskRecorderNode::fillInPluginDescription (PluginDescription& desc) const
+{
+    desc.name               = getName();
+    desc.name << " (" << numChannels << "ch)";
+    desc.fileOrIdentifier   = String (EL_INTERNAL_ID_DISK_RECORDER) + "." + String (numChannels);
+    desc.descriptiveName    = "Records audio and MIDI to disk";
+    desc.category           = "Utility";
+    desc.numInputChannels   = numChannels;
+    desc.numOutputChannels  = numChannels;
+    desc.hasSharedContainer = false;
+    desc.isInstrument       = false;
+    desc.manufacturerName   = "Element";
+    desc.pluginFormatName   = "Element";
+    desc.version            = "1.0.0";
+    desc.uid                = EL_INTERNAL_UID_DISK_RECORDER;
+}
+
+void DiskRecorderNode::setPunchRange (double inSeconds, double outSeconds)
+{
+    punchIn.set (jmax (0.0, inSeconds));
+    punchOut.set (jmax (punchIn.get(), outSeconds));
+}
+
+void DiskRecorderNode::setPreRollSeconds (double seconds)
+{
+    recorder.setPreRollSeconds (seconds);
+    if (! prepared || recorder.getStats().recording)
+        return;
+
+    // a long pre-roll is a big ring, build it before taking the callback
+    // lock so the audio thread only waits for the swap
+    recorder.release();
+    recorder.allocate (numChannels, getSampleRate(), getBlockSize());
+    {
+        ScopedLock sl (getCallbackLock());
+        recorder.swapBuffers();
+    }
+    recorder.start();
+}
+
+void DiskRecorderNode::prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock)
+{
+    setPlayConfigDetails (numChannels, numChannels, sampleRate, maximumExpectedSamplesPerBlock);
+    recorder.prepare (numChannels, sampleRate, maximumExpectedSamplesPerBlock);
+    prepared = true;
+}
+
+void DiskRecorderNode::releaseResources()
+{
+    prepared = false;
+    recorder.release();
+}
+
+void DiskRecorderNode::processBlock (AudioBuffer<float>& buffer, MidiBuffer& midi)
+{
+    const int numSamples = buffer.getNumSamples();
+    int from = 0, to = *record ? numSamples : 0;
+
+    if (*record && *sync)
+    {
+        AudioPlayHead::CurrentPositionInfo pos;
+        auto* const playhead = getPlayHead();
+        if (playhead == nullptr || ! playhead->getCurrentPosition (pos)
+            || ! pos.isPlaying || ! pos.isRecording)
+        {
+            to = 0;
+        }
+        else if (*punch)
+        {
+            const auto rate = getSampleRate();
+            const auto start = (int64) (punchIn.get() * rate) - pos.timeInSamples;
+            const auto end   = (int64) (punchOut.get() * rate) - pos.timeInSamples;
+            from = (int) jlimit ((int64) 0, (int64) numSamples, start);
+            to   = (int) jlimit ((int64) from, (int64) numSamples, end);
+        }
+    }
+
+    // [from, to) of this block belongs in a take
+    const bool inRange = from < to;
+    if (recorder.isRecording() && (! inRange || from > 0))
+        recorder.punchOut (0);
+    if (inRange && ! recorder.isRecording())
+        recorder.punchIn (from);
+    if (inRange && to < numSamples)
+        recorder.punchOut (to);
+
+    recorder.write (buffer, midi);
+}
+
+AudioProcessorEditor* DiskRecorderNode::createEditor()
+{
+    return new DiskRecorderEditor (*this);
+}
+
+void DiskRecorderNode::getStateInformation (juce::MemoryBlock& destData)
+{
+    ValueTree state (Tags::state);
+    state.setProperty ("directory", recorder.getDirectory().getFullPathName(), nullptr)
+         .setProperty ("baseName", recorder.getBaseName(), nullptr)
+         .setProperty ("format", (int) recorder.getFormat(), nullptr)
+         .setProperty ("bitsPerSample", recorder.getBitsPerSample(), nullptr)
+         .setProperty ("preRoll", recorder.getPreRollSeconds(), nullptr)
+         .setProperty ("punchIn", punchIn.get(), nullptr)
+         .setProperty ("punchOut", punchOut.get(), nullptr)
+         .setProperty ("sync", (bool) *sync, nullptr)
+         .setProperty ("punch", (bool) *punch, nullptr);
+
+    MemoryOutputStream stream (destData, false);
+    state.writeToStream (stream);
+}
+
+void DiskRecorderNode::setStateInformation (const void* data, int sizeInBytes)
+{
+    const auto state = ValueTree::readFromData (data, (size_t) sizeInBytes);
+    if (! state.isValid())
+        return;
+
+    if (File::isAbsolutePath (state["directory"].toString()))
+        recorder.setDirectory (File (state["directory"].toString()));
+    recorder.setBaseName (state.getProperty ("baseName", "Recording").toString());
+    recorder.setFormat ((DiskRecorder::Format) jlimit (0, 2, (int) state.getProperty ("format", 0)),
+                        (int) state.getProperty ("bitsPerSample", 24));
+    setPreRollSeconds ((double) state.getProperty ("preRoll", 2.0));
+    setPunchRange ((double) state.getProperty ("punchIn", 0.0),
+                   (double) state.getProperty ("punchOut", 60.0));
+    *sync  = (bool) state.getProperty ("sync", true);
+    *punch = (bool) state.getProperty ("punch", false);
+}
+
+bool DiskRecorderNode::isBusesLayoutSupported (const BusesLayout& layout) const
+{
+    return layout.inputBuses.size() == 1 && layout.outputBuses.size() == 1
+        && layout.getMainInputChannels() == numChannels
+        && layout.getMainOutputChannels() == numChannels;
+}
+
+}
@@ -0,0 +1,107 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "engine/nodes/BaseProcessor.h"
+#include "engine/AudioFileStreamer.h"
+#include "engine/DiskRecorder.h"
+
+namespace Element {
+
+/** Records its inputs and MIDI to disk and passes them through unchanged.
+
+    When synced, takes follow the transport's record state and, with punch
+    enabled, only the range between the punch in and out times. Otherwise
+    the record parameter starts and stops a take directly.
+ */
+class DiskRecorderNode : public BaseProcessor
+{
+public:
+    enum Parameters { Record = 0, Sync, Punch };
+
+    explicit DiskRecorderNode (int numChannels = 2);
+    virtual ~DiskRecorderNode();
+
+    void fillInPluginDescription (PluginDescription& desc) const override;
+
+    /** Returns the channel count encoded in a recorder's identifier */
+    static int getNumChannelsFor (const String& fileOrIdentifier);
+
+    DiskRecorder& getRecorder() noexcept { return recorder; }
+
+    void setRecording (bool shouldRecord)       { *record = shouldRecord; }
+    bool isRecordEnabled() const                { return *record; }
+    void setSyncToTransport (bool shouldSync)   { *sync = shouldSync; }
+    bool isSyncedToTransport() const            { return *sync; }
+    void setPunchEnabled (bool shouldPunch)     { *punch = shouldPunch; }
+    bool isPunchEnabled() const                 { return *punch; }
+
+    /** Sets the punch range in seconds of transport time */
+    void setPunchRange (double inSeconds, double outSeconds);
+    double getPunchIn() const                   { return punchIn.get(); }
+    double getPunchOut() const                  { return punchOut.get(); }
+
+    /** Changes the pre-roll, reallocating the ring now if not recording */
+    void setPreRollSeconds (double seconds);
+
+    const String getName() const override { return "Disk Recorder"; }
+    void prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock) override;
+    void releaseResources() override;
+    void processBlock (AudioBuffer<float>& buffer, MidiBuffer& midiMessages) override;
+
+    bool canAddBus (bool isInput) const override                     { ignoreUnused (isInput); return false; }
+    bool canRemoveBus (bool isInput) const override                  { ignoreUnused (isInput); return false; }
+
+    AudioProcessorEditor* createEditor() override;
+    bool hasEditor() const override { return true; }
+
+    double getTailLengthSeconds() const override        { return 0.0; }
+    bool acceptsMidi() const override                   { return true; }
+    bool producesMidi() const override                  { return true; }
+    bool supportsMPE() const override                   { return false; }
+    bool isMidiEffect() const override                  { return false; }
+
+    int getNumPrograms() override                       { return 1; };
+    int getCurrentProgram() override                    { return 0; };
+    void setCurrentProgram (int index) override         { ignoreUnused (index); };
+    const String getProgramName (int index) override    { ignoreUnused (index); return getName(); }
+    void changeProgramName (int index, const String& newName) override { ignoreUnused (index, newName); }
+
+    void getStateInformation (juce::MemoryBlock& destData) override;
+    void setStateInformation (const void* data, int sizeInBytes) override;
+
+protected:
+    bool isBusesLayoutSupported (const BusesLayout&) const override;
+
+private:
+    const int numChannels;
+    SharedResourcePointer<AudioFileStreamer> streamer;
+    DiskRecorder recorder;
+    bool prepared = false;
+
+    AudioParameterBool* record  { nullptr };
+    AudioParameterBool* sync    { nullptr };
+    AudioParameterBool* punch   { nullptr };
+    Atomic<double> punchIn, punchOut;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (DiskRecorderNode)
+};
+
+}
@@ -20,38 +20,59 @@ Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
 #pragma once
 
 #include "engine/nodes/BaseProcessor.h"
+#include "engine/Crossover.h"
 #include "ElementApp.h"
-#include "EQFilterProcessor.h"
 
 namespace Element {
+    /** Splits its input into N bands with Linkwitz-Riley crossovers, one
+        output bus per band. The bands sum back to the input with only its
+        phase shifted. */
     class FreqSplitterProcessor : public BaseProcessor
     {
     public:
-        explicit FreqSplitterProcessor (const int _numChannels = 2)
-            : BaseProcessor (BusesProperties()
-                .withInput ("Main", AudioChannelSet::canonicalChannelSet (jlimit (1, 2, _numChannels)))
-                .withOutput ("Low", AudioChannelSet::canonicalChannelSet (jlimit (1, 2, _numChannels)))
-                .withOutput ("Mid", AudioChannelSet::canonicalChannelSet (jlimit (1, 2, _numChannels)))
-                .withOutput ("High", AudioChannelSet::canonicalChannelSet (jlimit (1, 2, _numChannels)))),
-            numChannelsIn (jlimit (1, 2, _numChannels)),
-            numChannelsOut (3 * numChannelsIn)
+        enum { maxChannels = 8 };
+
+        explicit FreqSplitterProcessor (const int _numChannels = 2, const int _numBands = 3)
+            : BaseProcessor (createBuses (jlimit (1, (int) maxChannels, _numChannels),
+                                          jlimit (2, (int) Crossover::maxBands, _numBands))),
+            numChannelsIn (jlimit (1, (int) maxChannels, _numChannels)),
+            numBands (jlimit (2, (int) Crossover::maxBands, _numBands)),
+            numChannelsOut (numBands * numChannelsIn)
         {
             setBusesLayout (getBusesLayout());
             setRateAndBufferSizeDetails (44100.0, 1024);
+            crossover.setup (numChannelsIn, numBands);
 
             NormalisableRange<float> freqRange (20.0f, 22000.0f);
             freqRange.setSkewForCentre (1000.0f);
 
-            addParameter (lowFreq  = new AudioParameterFloat ("lowFreq",  "Low Frequency [Hz]",  freqRange, 500.0f));
-            addParameter (highFreq = new AudioParameterFloat ("highFreq", "High Frequency [Hz]", freqRange, 2000.0f));
+            for (int i = 0; i < numBands - 1; ++i)
+            {
+                // three bands keep the defaults from before N bands
+                const String id (i + 1);
+                const float freq = numBands == 3 ? (i == 0 ? 500.0f : 2000.0f) : crossover.getFrequency (i);
+                AudioParameterFloat* param = nullptr;
+                addParameter (param = new AudioParameterFloat ("freq" + id, "Crossover " + id + " [Hz]", freqRange, freq));
+                frequencies.add (param);
+            }
+        }
+
+        /** Returns the band count encoded in an identifier */
+        static int getNumBandsFor (const String& fileOrIdentifier)
+        {
+            const int bands = fileOrIdentifier.fromLastOccurrenceOf (".", false, false).getIntValue();
+            return bands >= 2 ? bands : 3;
         }
 
         const String getName() const override { return "Frequency Band Splitter"; }
 
+        int getNumBands() const noexcept { return numBands; }
+
         void fillInPluginDescription (PluginDescription& desc) const override
         {
             desc.name = getName();
-            desc.fileOrIdentifier   = EL_INTERNAL_ID_FREQ_SPLITTER;
+            desc.name << " (" << numBands << " bands)";
+            desc.fileOrIdentifier   = String (EL_INTERNAL_ID_FREQ_SPLITTER) + "." + String (numBands);
             desc.descriptiveName    = "Frequency Band Splitter";
             desc.numInputChannels   = numChannelsIn;
             desc.numOutputChannels  = numChannelsOut;
@@ -65,26 +86,14 @@ namespace Element {
 
         void prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock) override
         {
-            const float butterQ = 0.7071f; // maximally flat passband
-            auto setupFilter = [butterQ, sampleRate] (EQFilter& filt, float freq, EQFilter::Shape shape)
-            {
-                filt.setFrequency (freq);
-                filt.setQ (butterQ);
-                filt.setGain (1.0f);
-                filt.setShape (shape);
-                filt.reset (sampleRate);
-            };
-
-            for (int ch = 0; ch < 2; ++ch)
-            {
-                setupFilter (lowLPF[ch],  *lowFreq,  EQFilter::Shape::LowPass);
-                setupFilter (lowHPF[ch],  *lowFreq,  EQFilter::Shape::HighPass);
-                setupFilter (highLPF[ch], *highFreq, EQFilter::Shape::LowPass);
-                setupFilter (highHPF[ch], *highFreq, EQFilter::Shape::HighPass);
-            }
-
             setBusesLayout (getBusesLayout());
             setRateAndBufferSizeDetails (sampleRate, maximumExpectedSamplesPerBlock);
+
+            crossover.setup (numChannelsIn, numBands);
+            crossover.setSampleRate (sampleRate);
+            for (int i = 0; i < frequencies.size(); ++i)
+                crossover.setFrequency (i, *frequencies.getUnchecked (i));
+            crossover.reset();
         }
 
         void releaseResources() override
@@ -93,43 +102,29 @@ namespace Element {
 
         void processBlock (AudioBuffer<float>& buffer, MidiBuffer&) override
         {
-            auto inBuffer = getBusBuffer (buffer, true, 0);
-            auto lowBuffer = getBusBuffer (buffer, false, 0);
-            auto midBuffer = getBusBuffer (buffer, false, 1);
-            auto highBuffer = getBusBuffer (buffer, false, 2);
-
-            const auto numChannels = inBuffer.getNumChannels();
             const auto numSamples = buffer.getNumSamples();
-
-            // copy input into extra output channels
-            for (int ch = 0; ch < numChannels; ++ch)
+            if (numSamples <= 0 || crossover.getNumChannels() != numChannelsIn
+                || buffer.getNumChannels() < numChannelsOut)
+                return;
+
+            // only recomputes coefficients when a frequency moved
+            for (int i = 0; i < frequencies.size(); ++i)
+                crossover.setFrequency (i, *frequencies.getUnchecked (i));
+
+            // the input shares channels with the low bus, the crossover
+            // reads each chunk before writing it
+            const float* inputs [maxChannels];
+            float* outputs [Crossover::maxBands * maxChannels];
+            for (int ch = 0; ch < numChannelsIn; ++ch)
+                inputs[ch] = buffer.getReadPointer (ch);
+            for (int band = 0; band < numBands; ++band)
             {
-                lowBuffer.copyFrom (ch, 0, inBuffer.getReadPointer (ch), numSamples);
-                midBuffer.copyFrom (ch, 0, inBuffer.getReadPointer (ch), numSamples);
-                highBuffer.copyFrom (ch, 0, inBuffer.getReadPointer (ch), numSamples);
+                auto bus = getBusBuffer (buffer, false, band);
+                for (int ch = 0; ch < numChannelsIn; ++ch)
+                    outputs [band * numChannelsIn + ch] = bus.getWritePointer (ch);
             }
 
-            // update filter parameters
-            for (int c = 0; c < 2; ++c)
-            {
-                lowLPF[c].setFrequency (*lowFreq);
-                lowHPF[c].setFrequency (*lowFreq);
-                highLPF[c].setFrequency (*highFreq);
-                highHPF[c].setFrequency (*highFreq);
-            }
-
-            for (int ch = 0; ch < numChannels; ++ch)
-            {
-                // Low freq band
-                lowLPF[ch].processBlock (lowBuffer.getWritePointer (ch), numSamples);
-
-                // Mid freq band
-                lowHPF[ch].processBlock  (midBuffer.getWritePointer (ch), numSamples);
-                highLPF[ch].processBlock (midBuffer.getWritePointer (ch), numSamples);
-
-                // High freq band
-                highHPF[ch].processBlock (highBuffer.getWritePointer (ch), numSamples);
-            }
+            crossover.process (inputs, outputs, numSamples);
         }
 
         AudioProcessorEditor* createEditor() override   { return new GenericAudioProcessorEditor (this); }
@@ -148,8 +143,8 @@ namespace Element {
         void getStateInformation (juce::MemoryBlock& destData) override
         {
             ValueTree state (Tags::state);
-            state.setProperty ("lowFreq",  (float) *lowFreq,  0);
-            state.setProperty ("highFreq", (float) *highFreq, 0);
+            for (auto* param : frequencies)
+                state.setProperty (param->paramID, param->get(), nullptr);
             if (auto e = state.createXml())
                 AudioProcessor::copyXmlToBinary (*e, destData);
         }
@@ -159,36 +154,43 @@ namespace Element {
             if (auto e = AudioProcessor::getXmlFromBinary (data, sizeInBytes))
             {
                 auto state = ValueTree::fromXml (*e);
-                if (state.isValid())
+                if (! state.isValid())
+                    return;
+
+                // three band sessions saved lowFreq and highFreq
+                if (numBands == 3 && state.hasProperty ("lowFreq"))
                 {
-                    *lowFreq  = (float) state.getProperty ("lowFreq",  (float) *lowFreq);
-                    *highFreq = (float) state.getProperty ("highFreq", (float) *highFreq);
+                    state.setProperty ("freq1", state.getProperty ("lowFreq"), nullptr);
+                    state.setProperty ("freq2", state.getProperty ("highFreq", frequencies[1]->get()), nullptr);
                 }
+
+                for (auto* param : frequencies)
+                    *param = (float) state.getProperty (param->paramID, param->get());
             }
         }
 
         void numChannelsChanged() override
         {
-            numChannelsIn = getTotalNumInputChannels();
-            numChannelsOut = getTotalNumOutputChannels();
+            numChannelsIn = jlimit (1, (int) maxChannels, getTotalNumInputChannels());
+            numChannelsOut = numBands * numChannelsIn;
         }
 
     protected:
         inline bool isBusesLayoutSupported (const BusesLayout& layout) const override 
         {
-            // supports single input bus, three output busses
-            if (layout.inputBuses.size() != 1 && layout.outputBuses.size() != 3)
+            // supports single input bus, one output bus per band
+            if (layout.inputBuses.size() != 1 || layout.outputBuses.size() != numBands)
                 return false;
 
             // ins must equal outs
-            for (int bus = 0; bus < 3; ++bus)
+            for (int bus = 0; bus < numBands; ++bus)
             {
                 if (layout.getMainInputChannels() != layout.outputBuses[bus].size())
                     return false;
             }
 
             const auto nchans = layout.getMainInputChannels();
-            return nchans >= 1 && nchans <= 2;
+            return nchans >= 1 && nchans <= maxChannels;
         }
 
         inline bool canApplyBusesLayout (const BusesLayout& layouts) const override { return isBusesLayoutSupported (layouts); }
@@ -200,13 +202,23 @@ namespace Element {
 
     private:
         int numChannelsIn = 0;
+        const int numBands;
         int numChannelsOut = 0;
-        AudioParameterFloat* lowFreq    = nullptr;
-        AudioParameterFloat* highFreq   = nullptr;
-        EQFilter lowLPF[2];
-        EQFilter lowHPF[2];
-        EQFilter highLPF[2];
-        EQFilter highHPF[2];
+        Array<AudioParameterFloat*> frequencies;
+        Crossover crossover;
+
+        static BusesProperties createBuses (int numChannels, int numBands)
+        {
+            const auto channels = AudioChannelSet::canonicalChannelSet (numChannels);
+            auto buses = BusesProperties().withInput ("Main", channels);
+            for (int band = 0; band < numBands; ++band)
+            {
+                const String name = band == 0 ? "Low" : band == numBands - 1 ? "High"
+                                  : numBands == 3 ? "Mid" : "Mid " + String (band);
+                buses = buses.withOutput (name, channels);
+            }
+            return buses;
+        }
     };
 
 }
@@ -25,7 +25,9 @@
 #include "engine/nodes/LuaNode.h"
 #include "engine/MidiPipe.h"
 #include "engine/Parameter.h"
+#include "scripting/LuaAllocator.h"
 #include "scripting/LuaBindings.h"
+#include "scripting/LuaBytecodeCache.h"
 
 #define EL_LUA_DBG(x)
 // #define EL_LUA_DBG(x) DBG(x)
@@ -183,8 +185,13 @@ private:
 struct LuaNode::Context
 {
     explicit Context ()
+        : state (sol::default_at_panic, &LuaAllocator::allocate, &allocator)
     { 
         L = state.lua_state();
+
+        // collection is driven from render() in bounded steps, and in full on
+        // the message thread in prepare/release/setState
+        lua_gc (L, LUA_GCSTOP, 0);
     }
 
     ~Context()
@@ -220,9 +227,15 @@ struct LuaNode::Context
                                   sol::lib::io, sol::lib::package,
                                   sol::lib::math);
             Lua::openDSP (state);
-            auto res = state.script (script.toRawUTF8());
-            
-            if (res.valid())
+
+            // parsed once per unique script, shared by every node using it
+            if (LuaBytecodeCache::getShared().load (L, script) != LUA_OK
+                || lua_pcall (L, 0, 0, 0) != LUA_OK)
+            {
+                errorMsg = String::fromUTF8 (lua_tostring (L, -1));
+                lua_settop (L, 0);
+            }
+            else
             {
                 bool ok = false;
                 if (lua_getglobal (state, "node_render") == LUA_TFUNCTION)
@@ -369,8 +382,11 @@ struct LuaNode::Context
         {
             kv_midi_pipe_resize (L, midiPipe, nmidi);
             kv_midi_pipe_clear (midiPipe, -1);
+            midiPipeSize = nmidi;
         }
 
+        gcBudgetTicks = Time::secondsToHighResolutionTicks (
+            gcBudgetFraction * (double) block / rate);
         state.collect_garbage();
     }
 
@@ -391,6 +407,7 @@ struct LuaNode::Context
         if (midiPipe != nullptr)
         {
             kv_midi_pipe_resize (L, midiPipe, 0);
+            midiPipeSize = 0;
         }
 
         state.collect_garbage();
@@ -411,17 +428,24 @@ struct LuaNode::Context
             {
                 if (lua_rawgeti (L, LUA_REGISTRYINDEX, midiPipeRef) == LUA_TUSERDATA)
                 {
-                   #if ! LRT_FORCE_FLOAT32
-                    kv_audio_buffer_duplicate_32 (audioBuffer,
-                        audio.getArrayOfReadPointers(), nchans, nframes);
-                   #else
+                   #if LRT_FORCE_FLOAT32
+                    // script works directly on the graph's channels
                     kv_audio_buffer_refer_to (audioBuffer,
                         audio.getArrayOfWritePointers(), nchans, nframes);
+                   #else
+                    kv_audio_buffer_duplicate_32 (audioBuffer,
+                        audio.getArrayOfReadPointers(), nchans, nframes);
                    #endif
-                
-                    kv_midi_pipe_resize (L, midiPipe, midi.getNumBuffers());
+
+                    // the pipe only needs resizing if the graph changed its
+                    // buffer count, otherwise just clear what the last block left
+                    if (midiPipeSize != nmidi)
+                    {
+                        kv_midi_pipe_resize (L, midiPipe, nmidi);
+                        midiPipeSize = nmidi;
+                    }
                     kv_midi_pipe_clear (midiPipe, -1);
-                    
+
                     int bytes = 0, frame = 0;
                     const uint8* data = nullptr;
                     for (int i = 0; i < nmidi; ++i)
@@ -468,6 +492,52 @@ struct LuaNode::Context
         {
             DBG("didn't get render fucntion in callback");
         }
+
+        // a stray value may be left if a registry lookup failed
+        lua_settop (L, 0);
+        collectGarbageIncrementally();
+    }
+
+    /** Runs incremental GC steps until a cycle finishes or the time budget for
+        this block is used. Always does at least one step so collection keeps
+        up with scripts that allocate every block */
+    void collectGarbageIncrementally() noexcept
+    {
+        const int64 start = Time::getHighResolutionTicks();
+        int64 elapsed = 0;
+        do
+        {
+            ++gcSteps;
+            if (lua_gc (L, LUA_GCSTEP, 0) != 0)
+            {
+                ++gcCycles;
+                break;
+            }
+            elapsed = Time::getHighResolutionTicks() - start;
+        } while (elapsed < gcBudgetTicks);
+
+        elapsed = Time::getHighResolutionTicks() - start;
+        const double micros = 1000000.0 * Time::highResolutionTicksToSeconds (elapsed);
+        gcLastMicros = micros;
+        if (micros > gcMaxMicros.get())
+            gcMaxMicros = micros;
+    }
+
+    LuaNode::MemoryStats getMemoryStats() const
+    {
+        const auto alloc = allocator.getStats();
+        LuaNode::MemoryStats stats;
+        stats.arenaSize         = alloc.arenaSize;
+        stats.arenaUsed         = alloc.arenaUsed;
+        stats.bytesInUse        = alloc.bytesInUse;
+        stats.peakBytesInUse    = alloc.peakBytesInUse;
+        stats.numAllocations    = alloc.numAllocations;
+        stats.numFallbacks      = alloc.numFallbacks;
+        stats.gcSteps           = gcSteps.get();
+        stats.gcCycles          = gcCycles.get();
+        stats.gcLastMicros      = gcLastMicros.get();
+        stats.gcMaxMicros       = gcMaxMicros.get();
+        return stats;
     }
     
     const OwnedArray<PortDescription>& getPortArray() const noexcept
@@ -580,8 +650,15 @@ struct LuaNode::Context
     }
 
 private:
+    LuaAllocator allocator;
     sol::state state;
     lua_State* L { nullptr };
+
+    // fraction of the block period GC may use on the audio thread
+    static constexpr double gcBudgetFraction = 0.05;
+    int64 gcBudgetTicks = 0;
+    Atomic<int64> gcSteps { 0 }, gcCycles { 0 };
+    Atomic<double> gcLastMicros { 0.0 }, gcMaxMicros { 0.0 };
     sol::function renderf;
     std::function<void(AudioSampleBuffer&, MidiPipe&)> renderstdf;
     String name;
@@ -591,6 +668,7 @@ private:
     int audioBufRef = LUA_NOREF;
     int midiPipeRef = LUA_NOREF;
     kv_midi_pipe_t* midiPipe { nullptr };
+    int midiPipeSize = 0;
     kv_audio_buffer_t* audioBuffer { nullptr };
 
     PortList ports;
@@ -777,21 +855,24 @@ Parameter::Ptr LuaNode::getParameter (const PortDescription& port)
     return context->getParameter (port);
 }
 
-Result LuaNode::loadScript (const String& newScript)
+Result LuaNode::createContext (const String& newScript, std::unique_ptr<Context>& newContext)
 {
     auto result = Context::validate (newScript);
     if (result.failed())
         return result;
-    
-    auto newContext = std::make_unique<Context>();
-    result = newContext->load (newScript);
 
-    if (result.wasOk())
+    newContext = std::make_unique<Context>();
+    return newContext->load (newScript);
+}
+
+void LuaNode::applyContext (const String& newScript, std::unique_ptr<Context> newContext)
+{
+    script = draftScript = newScript;
+    if (prepared)
+        newContext->prepare (sampleRate, blockSize);
+    triggerPortReset();
+
     {
-        script = draftScript = newScript;
-        if (prepared)
-            newContext->prepare (sampleRate, blockSize);
-        triggerPortReset();
         ScopedLock sl (lock);
         if (context != nullptr)
             newContext->copyParameterValues (*context);
@@ -803,10 +884,48 @@ Result LuaNode::loadScript (const String& newScript)
         newContext->release();
         newContext.reset();
     }
+}
+
+Result LuaNode::loadScript (const String& newScript)
+{
+    ++loadGeneration;
+
+    std::unique_ptr<Context> newContext;
+    auto result = createContext (newScript, newContext);
+    if (result.wasOk())
+        applyContext (newScript, std::move (newContext));
 
     return result;
 }
 
+static ThreadPool& getScriptCompilerPool()
+{
+    static ThreadPool pool (1);
+    return pool;
+}
+
+void LuaNode::loadScriptAsync (const String& newScript, std::function<void (const Result&)> callback)
+{
+    const int generation = ++loadGeneration;
+    Ptr self (this);
+
+    getScriptCompilerPool().addJob ([self, newScript, generation, callback]()
+    {
+        auto holder = std::make_shared<std::unique_ptr<Context>>();
+        const auto result = createContext (newScript, *holder);
+
+        MessageManager::callAsync ([self, newScript, generation, callback, holder, result]()
+        {
+            if (generation != self->loadGeneration.get())
+                return;
+            if (result.wasOk())
+                self->applyContext (newScript, std::move (*holder));
+            if (callback)
+                callback (result);
+        });
+    });
+}
+
 void LuaNode::fillInPluginDescription (PluginDescription& desc)
 {
     desc.name               = "Lua";
@@ -899,6 +1018,13 @@ void LuaNode::getState (MemoryBlock& block)
     }
 }
 
+LuaNode::MemoryStats LuaNode::getMemoryStats() const
+{
+    // contexts are only swapped on this thread and the stats are atomic, so
+    // there's no need to contend with the render thread for the lock
+    return context != nullptr ? context->getMemoryStats() : MemoryStats();
+}
+
 void LuaNode::setParameter (int index, float value)
 {
     ScopedLock sl (lock);
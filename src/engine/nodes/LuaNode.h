@@ -35,6 +35,21 @@ public:
     
     struct Context;
 
+    /** Memory and garbage collection counters for the running script */
+    struct MemoryStats
+    {
+        size_t arenaSize        = 0;
+        size_t arenaUsed        = 0;
+        size_t bytesInUse       = 0;
+        size_t peakBytesInUse   = 0;
+        int64 numAllocations    = 0;
+        int64 numFallbacks      = 0;
+        int64 gcSteps           = 0;
+        int64 gcCycles          = 0;
+        double gcLastMicros     = 0.0;
+        double gcMaxMicros      = 0.0;
+    };
+
     void fillInPluginDescription (PluginDescription& desc);
     void prepareToRender (double sampleRate, int maxBufferSize) override;
     void releaseResources() override;
@@ -44,6 +59,13 @@ public:
     
     Result loadScript (const String&);
 
+    /** Validates and compiles a script on a background thread, then swaps it
+        in on the message thread. If another load starts before this one
+        finishes, this one is dropped. Otherwise the callback is called on the
+        message thread with the result.
+     */
+    void loadScriptAsync (const String&, std::function<void (const Result&)> callback = nullptr);
+
     const String& getScript() const { return script; }
     const String& getDraftScript() const { return draftScript; }
     void setDraftScript (const String& draft) { draftScript = draft; }
@@ -56,6 +78,9 @@ public:
     */
     void setParameter (int index, float value);
 
+    /** Returns allocator and GC counters. Call from the message thread */
+    MemoryStats getMemoryStats() const;
+
 protected:
     inline bool wantsMidiPipe() const override { return true; }
     void createPorts() override;
@@ -66,9 +91,13 @@ private:
     int blockSize = 512;
     double sampleRate = 44100.0;
     bool prepared = false;
-    CriticalSection lock;
+    mutable CriticalSection lock;
     std::unique_ptr<Context> context;
     ParameterArray inParams, outParams;
+    Atomic<int> loadGeneration { 0 };
+
+    static Result createContext (const String&, std::unique_ptr<Context>&);
+    void applyContext (const String&, std::unique_ptr<Context>);
 };
 
 }
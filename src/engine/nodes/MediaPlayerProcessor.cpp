@@ -222,12 +222,12 @@ void MediaPlayerProcessor::openFile (const File& file)
 {
     if (file == audioFile)
         return;
-    if (auto* newReader = formats.createReaderFor (file))
+    if (auto* newReader = streamer->createReaderFor (file))
     {
         clearPlayer();
         reader.reset (new AudioFormatReaderSource (newReader, true));
         audioFile = file;
-        player.setSource (reader.get(), 1024 * 8, &thread, getSampleRate(), 2);
+        streamer->setSource (player, reader.get(), getSampleRate(), getBlockSize());
         ScopedLock sl (getCallbackLock());        
         player.setLooping (true);
         reader->setLooping (true);
@@ -236,7 +236,6 @@ void MediaPlayerProcessor::openFile (const File& file)
 
 void MediaPlayerProcessor::prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock)
 {
-    thread.startThread();
     formats.registerBasicFormats();
     player.prepareToPlay (maximumExpectedSamplesPerBlock, sampleRate);
     player.setLooping (true);
@@ -249,7 +248,6 @@ void MediaPlayerProcessor::releaseResources()
     player.stop();
     player.releaseResources();
     formats.clearFormats();
-    thread.stopThread (14);
 }
 
 void MediaPlayerProcessor::processBlock (AudioBuffer<float>& buffer, MidiBuffer& midi)
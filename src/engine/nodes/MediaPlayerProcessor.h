@@ -20,6 +20,7 @@
 #pragma once
 
 #include "engine/nodes/BaseProcessor.h"
+#include "engine/AudioFileStreamer.h"
 
 namespace Element {
 
@@ -104,7 +105,7 @@ protected:
 #endif
 
 private:
-    TimeSliceThread thread { "MediaPlayer" };
+    SharedResourcePointer<AudioFileStreamer> streamer;
     std::unique_ptr<AudioFormatReaderSource> reader;
     AudioFormatManager formats;
     AudioTransportSource player;
@@ -30,13 +30,21 @@ MidiRouterNode::MidiRouterNode (int ins, int outs)
       numSources (ins),
       numDestinations (outs),
       state (ins, outs),
-      toggles (ins, outs),
-      nextToggles (ins, outs)
+      routes (ins * numKeys, outs)
 {
     jassert (metadata.hasType (Tags::node));
     metadata.setProperty (Tags::format, "Element", nullptr);
     metadata.setProperty (Tags::identifier, EL_INTERNAL_ID_MIDI_ROUTER, nullptr);
 
+    channelFilters.allocate ((size_t) (ins * outs), true);
+    kindFilters.allocate ((size_t) (ins * outs), true);
+    channelMaps.allocate ((size_t) (ins * outs * 16), true);
+    channels.allocate ((size_t) (ins * outs * 16), true);
+    nextChannels.allocate ((size_t) (ins * outs * 16), true);
+    for (int src = 0; src < ins; ++src)
+        for (int dst = 0; dst < outs; ++dst)
+            resetRoute (src, dst);
+
     clearPatches();
     initMidiOuts (midiOuts);
 
@@ -72,6 +80,16 @@ MidiRouterNode::MidiRouterNode (int ins, int outs)
 
 MidiRouterNode::~MidiRouterNode() { }
 
+void MidiRouterNode::prepareToRender (double sampleRate, int maxBufferSize)
+{
+    ignoreUnused (sampleRate);
+
+    // room for a busy block so fanning out doesn't grow buffers while rendering
+    const auto bytes = (size_t) jmax (512, maxBufferSize) * 3;
+    for (auto* const buffer : midiOuts)
+        buffer->ensureSize (bytes);
+}
+
 void MidiRouterNode::setCurrentProgram (int index)
 {
     if (auto* program = programs [index])
@@ -84,13 +102,13 @@ void MidiRouterNode::setCurrentProgram (int index)
 void MidiRouterNode::setMatrixState (const MatrixState& matrix)
 {
     jassert (state.sameSizeAs (matrix));
-    state = matrix;
-    ToggleGrid newPatches (state);
 
     {
         ScopedLock sl (getLock());
-        toggles.swapWith (newPatches);
-        togglesChanged = true; // initiate the crossfade
+        state = matrix;
+        for (int src = 0; src < numSources; ++src)
+            for (int dst = 0; dst < numDestinations; ++dst)
+                updateRoute (src, dst);
     }
 
     sendChangeMessage();
@@ -101,6 +119,94 @@ MatrixState MidiRouterNode::getMatrixState() const
     return state;
 }
 
+void MidiRouterNode::setFilter (int src, int dst, int channelMask, int kindMask)
+{
+    if (! isPositiveAndBelow (src, numSources) || ! isPositiveAndBelow (dst, numDestinations))
+        return;
+
+    {
+        ScopedLock sl (getLock());
+        channelFilters [patch (src, dst)] = (uint16) (channelMask & allChannels);
+        kindFilters [patch (src, dst)]    = (uint8) (kindMask & allKinds);
+        updateRoute (src, dst);
+    }
+
+    sendChangeMessage();
+}
+
+int MidiRouterNode::getChannelFilter (int src, int dst) const
+{
+    if (! isPositiveAndBelow (src, numSources) || ! isPositiveAndBelow (dst, numDestinations))
+        return 0;
+    ScopedLock sl (routes.getLock());
+    return channelFilters [patch (src, dst)];
+}
+
+int MidiRouterNode::getKindFilter (int src, int dst) const
+{
+    if (! isPositiveAndBelow (src, numSources) || ! isPositiveAndBelow (dst, numDestinations))
+        return 0;
+    ScopedLock sl (routes.getLock());
+    return kindFilters [patch (src, dst)];
+}
+
+void MidiRouterNode::setChannelMapping (int src, int dst, int inputChannel, int outputChannel)
+{
+    if (! isPositiveAndBelow (src, numSources) || ! isPositiveAndBelow (dst, numDestinations))
+        return;
+    jassert (inputChannel >= 1 && inputChannel <= 16 && outputChannel >= 1 && outputChannel <= 16);
+
+    {
+        ScopedLock sl (getLock());
+        channelMaps [patch (src, dst) * 16 + jlimit (1, 16, inputChannel) - 1] = (uint8) (jlimit (1, 16, outputChannel) - 1);
+        updateRoute (src, dst);
+    }
+
+    sendChangeMessage();
+}
+
+int MidiRouterNode::getChannelMapping (int src, int dst, int inputChannel) const
+{
+    if (! isPositiveAndBelow (src, numSources) || ! isPositiveAndBelow (dst, numDestinations))
+        return inputChannel;
+    ScopedLock sl (routes.getLock());
+    return 1 + channelMaps [patch (src, dst) * 16 + jlimit (1, 16, inputChannel) - 1];
+}
+
+void MidiRouterNode::resetRoute (int src, int dst)
+{
+    if (! isPositiveAndBelow (src, numSources) || ! isPositiveAndBelow (dst, numDestinations))
+        return;
+
+    ScopedLock sl (getLock());
+    channelFilters [patch (src, dst)] = (uint16) allChannels;
+    kindFilters [patch (src, dst)]    = (uint8) allKinds;
+    for (int ch = 0; ch < 16; ++ch)
+        channelMaps [patch (src, dst) * 16 + ch] = (uint8) ch;
+    updateRoute (src, dst);
+}
+
+void MidiRouterNode::updateRoute (int src, int dst)
+{
+    // lock is held: compile one patch into the next routes' table
+    const bool patched    = state.connected (src, dst);
+    const int channelMask = channelFilters [patch (src, dst)];
+    const int kinds       = kindFilters [patch (src, dst)];
+
+    for (int kind = 0; kind < numKinds; ++kind)
+    {
+        const bool kindPasses = patched && (kinds & (1 << kind)) != 0;
+        for (int ch = 0; ch < 16; ++ch)
+        {
+            const bool passes = kindPasses && (kind == System ? ch == 0 : (channelMask & (1 << ch)) != 0);
+            routes.getPending().set (key (src, kind, ch), dst, passes);
+        }
+    }
+
+    memcpy (nextChannels + patch (src, dst) * 16, channelMaps + patch (src, dst) * 16, 16);
+    routes.markChanged();
+}
+
 void MidiRouterNode::render (AudioSampleBuffer& audio, MidiPipe& midi)
 {
     jassert (midi.getNumBuffers() >= numDestinations);
@@ -109,30 +215,94 @@ void MidiRouterNode::render (AudioSampleBuffer& audio, MidiPipe& midi)
     const auto nbuffers = midi.getNumBuffers();
     audio.clear();
 
-    ScopedLock sl (getLock());
-    for (int src = 0; src < numSources; ++src)
+    // a change still being written is picked up next block
+    routes.update ([this]() {
+        memcpy (channels, nextChannels, (size_t) (numSources * numDestinations * 16));
+    });
+    const auto& masks = routes.getCurrent();
+
+    for (int src = 0; src < jmin (numSources, nbuffers); ++src)
     {
-        if (src >= nbuffers)
-            break;
-        
-        const auto& rb = *midi.getReadBuffer (src);
-        for (int dst = 0; dst < numDestinations; ++dst)
-            if (toggles.get (src, dst))
-                midiOuts.getUnchecked(dst)->addEvents (rb, 0, nsamples, 0);
+        MidiBuffer::Iterator iter (*midi.getReadBuffer (src));
+        const uint8* data = nullptr; int size = 0, frame = 0;
+
+        while (iter.getNextEvent (data, size, frame))
+        {
+            if (frame >= nsamples || size <= 0)
+                continue;
+
+            const int status = data[0];
+            const bool hasChannel = status >= 0x80 && status < 0xf0;
+            const int kind    = hasChannel ? (status >> 4) - 8 : (int) System;
+            const int channel = hasChannel ? (status & 0x0f) : 0;
+            
+            masks.forEachOutput (key (src, kind, channel), [&](int dst)
+            {
+                auto* const out = midiOuts.getUnchecked (dst);
+                const int mapped = hasChannel ? channels [patch (src, dst) * 16 + channel] : channel;
+                
+                if (mapped == channel || size > 3)
+                {
+                    out->addEvent (data, size, frame);
+                }
+                else
+                {
+                    const uint8 remapped[3] = { (uint8) ((status & 0xf0) | mapped),
+                                                size > 1 ? data[1] : (uint8) 0,
+                                                size > 2 ? data[2] : (uint8) 0 };
+                    out->addEvent (remapped, size, frame);
+                }
+            });
+        }
     }
 
+    // copy rather than swap, so both sides keep the room reserved for them
     for (int i = midiOuts.size(); --i >= 0;)
     {
         auto* const ob = midiOuts.getUnchecked (i);
-        ob->swapWith (*midi.getWriteBuffer (i));
+        auto* const wb = midi.getWriteBuffer (i);
+        wb->clear();
+        wb->addEvents (*ob, 0, nsamples, 0);
         ob->clear();
     }
 }
 
 void MidiRouterNode::getState (MemoryBlock& block)
 {
+    auto tree = state.createValueTree();
+
+    {
+        // only patches which filter or remap are saved
+        ScopedLock sl (getLock());
+        for (int src = 0; src < numSources; ++src)
+        {
+            for (int dst = 0; dst < numDestinations; ++dst)
+            {
+                const auto* map = channelMaps + patch (src, dst) * 16;
+                String mapText; bool remaps = false;
+                for (int ch = 0; ch < 16; ++ch)
+                {
+                    mapText << (1 + (int) map[ch]) << " ";
+                    remaps |= map[ch] != ch;
+                }
+
+                if (! remaps && channelFilters [patch (src, dst)] == allChannels
+                             && kindFilters [patch (src, dst)] == allKinds)
+                    continue;
+
+                ValueTree route ("route");
+                route.setProperty ("source", src, nullptr)
+                     .setProperty ("destination", dst, nullptr)
+                     .setProperty ("channels", (int) channelFilters [patch (src, dst)], nullptr)
+                     .setProperty ("kinds", (int) kindFilters [patch (src, dst)], nullptr)
+                     .setProperty ("map", mapText.trim(), nullptr);
+                tree.appendChild (route, nullptr);
+            }
+        }
+    }
+
     MemoryOutputStream stream (block, false);
-    state.createValueTree().writeToStream (stream);
+    tree.writeToStream (stream);
 }
 
 void MidiRouterNode::setState (const void* data, int sizeInBytes)
@@ -144,6 +314,35 @@ void MidiRouterNode::setState (const void* data, int sizeInBytes)
         kv::MatrixState matrix;
         matrix.restoreFromValueTree (tree);
         jassert (matrix.getNumRows() == numSources && matrix.getNumColumns() == numDestinations);
+
+        {
+            ScopedLock sl (getLock());
+            for (int src = 0; src < numSources; ++src)
+                for (int dst = 0; dst < numDestinations; ++dst)
+                    resetRoute (src, dst);
+
+            for (int i = 0; i < tree.getNumChildren(); ++i)
+            {
+                const auto route = tree.getChild (i);
+                if (! route.hasType ("route"))
+                    continue;
+                
+                const int src = route.getProperty ("source", -1);
+                const int dst = route.getProperty ("destination", -1);
+                if (! isPositiveAndBelow (src, numSources) || ! isPositiveAndBelow (dst, numDestinations))
+                    continue;
+
+                channelFilters [patch (src, dst)] = (uint16) ((int) route.getProperty ("channels", (int) allChannels) & allChannels);
+                kindFilters [patch (src, dst)]    = (uint8) ((int) route.getProperty ("kinds", (int) allKinds) & allKinds);
+                
+                StringArray map;
+                map.addTokens (route.getProperty ("map").toString(), " ", String());
+                map.removeEmptyStrings();
+                for (int ch = 0; ch < jmin (16, map.size()); ++ch)
+                    channelMaps [patch (src, dst) * 16 + ch] = (uint8) (jlimit (1, 16, map[ch].getIntValue()) - 1);
+            }
+        }
+
         setMatrixState (matrix);
     }
 }
@@ -151,28 +350,25 @@ void MidiRouterNode::setState (const void* data, int sizeInBytes)
 void MidiRouterNode::setWithoutLocking (int src, int dst, bool set)
 {
     jassert (src >= 0 && src < numSources && dst >= 0 && dst < numDestinations);
-    toggles.set (src, dst, set);
     state.set (src, dst, set);
+    updateRoute (src, dst);
 }
 
 void MidiRouterNode::set (int src, int dst, bool patched)
 {
-    jassert (src >= 0 && src < numSources && dst >= 0 && numDestinations < 4);
-    toggles.set (src, dst, patched);
-    state.set (src, dst, patched);
+    ScopedLock sl (getLock());
+    setWithoutLocking (src, dst, patched);
 }
 
 void MidiRouterNode::clearPatches()
 {
-    {
-        ScopedLock sl (getLock());
-        toggles.clear();
-        nextToggles.clear();
-    }
-
+    ScopedLock sl (getLock());
     for (int r = 0; r < state.getNumRows(); ++r)
         for (int c = 0; c < state.getNumColumns(); ++c)
             state.set (r, c, false);
+    for (int src = 0; src < numSources; ++src)
+        for (int dst = 0; dst < numDestinations; ++dst)
+            updateRoute (src, dst);
 }
 
 void MidiRouterNode::initMidiOuts (OwnedArray<MidiBuffer>& outs)
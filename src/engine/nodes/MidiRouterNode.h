@@ -20,20 +20,42 @@
 #pragma once
 
 #include "engine/GraphNode.h"
-#include "engine/LinearFade.h"
 #include "engine/ToggleGrid.h"
 #include "engine/nodes/BaseProcessor.h"
 
 namespace Element {
 
+/** Routes MIDI inputs to outputs through a patch grid.
+
+    Each patch can also filter by message kind and input channel, and remap
+    channels. These are compiled into a table of destination masks keyed by
+    source, kind and channel, so rendering reads each input once and looks
+    up where every event goes.
+ */
 class MidiRouterNode : public GraphNode,
                        public ChangeBroadcaster
 {
 public:
+    /** Message kinds a patch can filter, as bit numbers of a kind mask */
+    enum Kind
+    {
+        NoteOff = 0,
+        NoteOn,
+        Aftertouch,
+        Controller,
+        ProgramChange,
+        ChannelPressure,
+        PitchBend,
+        System,
+        numKinds
+    };
+
+    enum { allKinds = (1 << numKinds) - 1, allChannels = 0xffff };
+
     explicit MidiRouterNode (int ins = 4, int outs = 4);
     ~MidiRouterNode();
 
-    void prepareToRender (double sampleRate, int maxBufferSize) override { ignoreUnused (sampleRate, maxBufferSize); }
+    void prepareToRender (double sampleRate, int maxBufferSize) override;
     void releaseResources() override { }
 
     inline bool wantsMidiPipe() const override { return true; }
@@ -44,7 +66,21 @@ public:
     void setMatrixState (const MatrixState&);
     MatrixState getMatrixState() const;
     void setWithoutLocking (int src, int dst, bool set);
-    CriticalSection& getLock() { return lock; }
+    CriticalSection& getLock() { return routes.getLock(); }
+
+    /** Sets which input channels (bit 0 is channel 1) and message kinds
+        (bits of Kind) a patch passes. System messages ignore the channels */
+    void setFilter (int src, int dst, int channelMask, int kindMask);
+    int getChannelFilter (int src, int dst) const;
+    int getKindFilter (int src, int dst) const;
+
+    /** Sends an input channel out on another channel through a patch.
+        Channels are 1 to 16 */
+    void setChannelMapping (int src, int dst, int inputChannel, int outputChannel);
+    int getChannelMapping (int src, int dst, int inputChannel) const;
+
+    /** Resets a patch to pass everything unchanged */
+    void resetRoute (int src, int dst);
 
     int getNumPrograms() const override { return jmax (1, programs.size()); }
     int getCurrentProgram() const override { return currentProgram; }
@@ -90,7 +126,6 @@ protected:
     }
 
 private:
-    CriticalSection lock;
     const int numSources;
     const int numDestinations;
     
@@ -111,10 +146,24 @@ private:
 
     // used by the UI, but not the rendering
     MatrixState state;
+    HeapBlock<uint16> channelFilters;   // per patch
+    HeapBlock<uint8> kindFilters;       // per patch
+    HeapBlock<uint8> channelMaps;       // per patch and input channel
+
+    /** What the render reads. A row of destination masks per source, kind
+        and channel, and an output channel per patch and input channel. The
+        channels are picked up with the masks */
+    enum { numKeys = numKinds * 16 };
+    static inline int key (const int src, const int kind, const int channel) noexcept
+    {
+        return src * numKeys + kind * 16 + channel;
+    }
+
+    ToggleGridBuffer routes;
+    HeapBlock<uint8> channels, nextChannels;   // render reads channels, nextChannels is written under the lock
 
-    ToggleGrid toggles;
-    ToggleGrid nextToggles;
-    bool togglesChanged { false };
+    inline int patch (int src, int dst) const noexcept { return src * numDestinations + dst; }
+    void updateRoute (int src, int dst);
 
     OwnedArray<MidiBuffer> midiOuts;
     void initMidiOuts (OwnedArray<MidiBuffer>& outs);
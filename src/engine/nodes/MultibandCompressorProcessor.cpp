@@ -0,0 +1,251 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/nodes/MultibandCompressorProcessor.h"
+
+namespace Element {
+
+MultibandCompressorProcessor::MultibandCompressorProcessor (const int _numChannels, const int _numBands)
+    : BaseProcessor (BusesProperties()
+        .withInput ("Main", AudioChannelSet::canonicalChannelSet (jlimit (1, (int) maxChannels, _numChannels)))
+        .withOutput ("Main", AudioChannelSet::canonicalChannelSet (jlimit (1, (int) maxChannels, _numChannels)))),
+      numChannels (jlimit (1, (int) maxChannels, _numChannels))
+{
+    setBusesLayout (getBusesLayout());
+    setRateAndBufferSizeDetails (44100.0, 1024);
+    setLatencySamples (lookaheadSamples);
+
+    const int numBands = jlimit (2, (int) Crossover::maxBands, _numBands);
+    crossover.setup (numChannels, numBands);
+
+    NormalisableRange<float> freqRange (20.0f, 20000.0f);
+    freqRange.setSkewForCentre (1000.0f);
+    for (int i = 0; i < numBands - 1; ++i)
+    {
+        const String id (i + 1);
+        AudioParameterFloat* freq = nullptr;
+        addParameter (freq = new AudioParameterFloat ("freq" + id, "Crossover " + id + " [Hz]",
+                                                     freqRange, crossover.getFrequency (i)));
+        frequencies.add (freq);
+    }
+
+    NormalisableRange<float> ratioRange (1.0f, 20.0f);
+    ratioRange.setSkewForCentre (4.0f);
+    NormalisableRange<float> attackRange (0.1f, 200.0f);
+    attackRange.setSkewForCentre (10.0f);
+    NormalisableRange<float> releaseRange (10.0f, 2000.0f);
+    releaseRange.setSkewForCentre (100.0f);
+
+    for (int b = 0; b < numBands; ++b)
+    {
+        auto* band = bands.add (new Band());
+        const String id (b + 1);
+        const String name = "Band " + id + " ";
+        addParameter (band->threshDB    = new AudioParameterFloat ("thresh" + id,    name + "Threshold [dB]",  -60.0f, 0.0f, 0.0f));
+        addParameter (band->ratio       = new AudioParameterFloat ("ratio" + id,     name + "Ratio",           ratioRange, 1.0f));
+        addParameter (band->attackMs    = new AudioParameterFloat ("attack" + id,    name + "Attack [ms]",     attackRange, 10.0f));
+        addParameter (band->releaseMs   = new AudioParameterFloat ("release" + id,   name + "Release [ms]",    releaseRange, 100.0f));
+        addParameter (band->makeupDB    = new AudioParameterFloat ("makeup" + id,    name + "Makeup [dB]",     -18.0f, 18.0f, 0.0f));
+        addParameter (band->expThreshDB = new AudioParameterFloat ("expThresh" + id, name + "Expander [dB]",   -90.0f, -20.0f, -90.0f));
+        addParameter (band->expRatio    = new AudioParameterFloat ("expRatio" + id,  name + "Expander Ratio",  1.0f, 10.0f, 1.0f));
+    }
+}
+
+MultibandCompressorProcessor::~MultibandCompressorProcessor() { }
+
+int MultibandCompressorProcessor::getNumBandsFor (const String& fileOrIdentifier)
+{
+    const int numBands = fileOrIdentifier.fromLastOccurrenceOf (".", false, false).getIntValue();
+    return numBands >= 2 ? numBands : 3;
+}
+
+void MultibandCompressorProcessor::fillInPluginDescription (PluginDescription& desc) const
+{
+    desc.name               = getName();
+    desc.name << " (" << bands.size() << " bands)";
+    desc.fileOrIdentifier   = String (EL_INTERNAL_ID_MULTIBAND_COMPRESSOR) + "." + String (bands.size());
+    desc.descriptiveName    = "Multiband Compressor";
+    desc.numInputChannels   = numChannels;
+    desc.numOutputChannels  = numChannels;
+    desc.hasSharedContainer = false;
+    desc.isInstrument       = false;
+    desc.manufacturerName   = "Element";
+    desc.pluginFormatName   = "Element";
+    desc.version            = "1.0.0";
+    desc.uid                = EL_INTERNAL_UID_MULTIBAND_COMPRESSOR;
+}
+
+float MultibandCompressorProcessor::getGainReductionDB (int band) const
+{
+    if (auto* b = bands [band])
+        return b->reductionDB.get();
+    return 0.f;
+}
+
+void MultibandCompressorProcessor::prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock)
+{
+    setBusesLayout (getBusesLayout());
+    setRateAndBufferSizeDetails (sampleRate, maximumExpectedSamplesPerBlock);
+    setLatencySamples (lookaheadSamples);
+
+    const int numBands = bands.size();
+    const int blockSize = jmax (1, maximumExpectedSamplesPerBlock);
+    crossover.setup (numChannels, numBands);
+    crossover.setSampleRate (sampleRate);
+    for (int i = 0; i < frequencies.size(); ++i)
+        crossover.setFrequency (i, *frequencies.getUnchecked (i));
+    crossover.reset();
+
+    for (auto* band : bands)
+        band->detector.reset ((float) sampleRate);
+
+    bandAudio.setSize (numBands * numChannels, blockSize);
+    work.setSize (numBands + 1, blockSize);
+    delayLines.allocate ((size_t) (numBands * numChannels * lookaheadSamples), true);
+    delayPosition = 0;
+}
+
+void MultibandCompressorProcessor::releaseResources()
+{
+    bandAudio.setSize (1, 1);
+    work.setSize (1, 1);
+    delayLines.free();
+}
+
+void MultibandCompressorProcessor::delay (float* audio, float* line, int numSamples) const noexcept
+{
+    // swapping with the line leaves the audio lookaheadSamples late
+    int position = delayPosition;
+    for (int done = 0; done < numSamples;)
+    {
+        const int count = jmin (numSamples - done, lookaheadSamples - position);
+        std::swap_ranges (audio + done, audio + done + count, line + position);
+        done += count;
+        position = (position + count) % lookaheadSamples;
+    }
+}
+
+void MultibandCompressorProcessor::processBlock (AudioBuffer<float>& buffer, MidiBuffer&)
+{
+    const int numSamples = buffer.getNumSamples();
+    const int numBands   = bands.size();
+    if (numSamples <= 0 || buffer.getNumChannels() < numChannels
+        || bandAudio.getNumChannels() != numBands * numChannels || delayLines.getData() == nullptr)
+        return;
+
+    // snapshot parameters, the crossover only recomputes on change
+    for (int i = 0; i < frequencies.size(); ++i)
+        crossover.setFrequency (i, *frequencies.getUnchecked (i));
+
+    struct Settings { float thresh, slope, expThresh, expSlope, makeup; };
+    Settings settings [Crossover::maxBands];
+    for (int b = 0; b < numBands; ++b)
+    {
+        auto* band = bands.getUnchecked (b);
+        band->detector.setAttackMs (*band->attackMs);
+        band->detector.setReleaseMs (*band->releaseMs);
+        settings[b] = { band->threshDB->get(), 1.f / band->ratio->get() - 1.f,
+                        band->expThreshDB->get(), band->expRatio->get() - 1.f, band->makeupDB->get() };
+    }
+
+    const float* inputs [maxChannels];
+    float* outputs [Crossover::maxBands * maxChannels];
+    float* const levels = work.getWritePointer (numBands);
+
+    for (int start = 0; start < numSamples; start += bandAudio.getNumSamples())
+    {
+        const int n = jmin (bandAudio.getNumSamples(), numSamples - start);
+
+        for (int ch = 0; ch < numChannels; ++ch)
+            inputs[ch] = buffer.getReadPointer (ch, start);
+        for (int i = 0; i < numBands * numChannels; ++i)
+            outputs[i] = bandAudio.getWritePointer (i);
+        crossover.process (inputs, outputs, n);
+
+        for (int b = 0; b < numBands; ++b)
+        {
+            float* const* const band = outputs + b * numChannels;
+            float* const gains = work.getWritePointer (b);
+            const auto& s = settings[b];
+
+            // detect on the loudest channel before the lookahead delay
+            for (int i = 0; i < n; ++i)
+                levels[i] = std::abs (band[0][i]);
+            for (int ch = 1; ch < numChannels; ++ch)
+                for (int i = 0; i < n; ++i)
+                    levels[i] = jmax (levels[i], std::abs (band[ch][i]));
+            bands.getUnchecked (b)->detector.process (levels, levels, n);
+
+            float minGainDB = 0.f;
+            for (int i = 0; i < n; ++i)
+            {
+                const float levelDB = 20.f * std::log10 (jmax (levels[i], 1.0e-6f));
+                const float over    = jmax (0.f, levelDB - s.thresh);
+                const float under   = jmax (0.f, s.expThresh - levelDB);
+                const float gainDB  = over * s.slope - jmin (60.f, under * s.expSlope);
+                minGainDB = jmin (minGainDB, gainDB);
+                gains[i] = std::pow (10.f, (gainDB + s.makeup) * 0.05f);
+            }
+            bands.getUnchecked (b)->reductionDB.set (minGainDB);
+
+            for (int ch = 0; ch < numChannels; ++ch)
+                delay (band[ch], delayLines + (b * numChannels + ch) * lookaheadSamples, n);
+        }
+
+        delayPosition = (delayPosition + n) % lookaheadSamples;
+
+        // sum the delayed bands at their gains straight into the output
+        for (int ch = 0; ch < numChannels; ++ch)
+        {
+            float* const out = buffer.getWritePointer (ch, start);
+            FloatVectorOperations::multiply (out, outputs[ch], work.getReadPointer (0), n);
+            for (int b = 1; b < numBands; ++b)
+                FloatVectorOperations::addWithMultiply (out, outputs[b * numChannels + ch], work.getReadPointer (b), n);
+        }
+    }
+}
+
+void MultibandCompressorProcessor::getStateInformation (juce::MemoryBlock& destData)
+{
+    ValueTree state (Tags::state);
+    for (auto* param : getParameters())
+        if (auto* p = dynamic_cast<AudioParameterFloat*> (param))
+            state.setProperty (p->paramID, p->get(), nullptr);
+    if (auto e = state.createXml())
+        AudioProcessor::copyXmlToBinary (*e, destData);
+}
+
+void MultibandCompressorProcessor::setStateInformation (const void* data, int sizeInBytes)
+{
+    if (auto e = AudioProcessor::getXmlFromBinary (data, sizeInBytes))
+    {
+        auto state = ValueTree::fromXml (*e);
+        if (state.isValid())
+            for (auto* param : getParameters())
+                if (auto* p = dynamic_cast<AudioParameterFloat*> (param))
+                    *p = (float) state.getProperty (p->paramID, p->get());
+    }
+}
+
+void MultibandCompressorProcessor::numChannelsChanged()
+{
+    numChannels = jlimit (1, (int) maxChannels, getTotalNumInputChannels());
+}
+
+}
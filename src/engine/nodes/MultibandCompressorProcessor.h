@@ -0,0 +1,128 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "engine/nodes/BaseProcessor.h"
+#include "engine/nodes/CompressorProcessor.h"
+#include "engine/Crossover.h"
+
+namespace Element {
+
+/** Multiband dynamics in one node.
+
+    The input is split with Linkwitz-Riley crossovers, and each band gets
+    a compressor above its threshold and a downward expander below its
+    expander threshold. Detection runs ahead of the audio by a fixed
+    lookahead, which is reported as the node's latency.
+ */
+class MultibandCompressorProcessor : public BaseProcessor
+{
+public:
+    enum
+    {
+        maxChannels = 8,
+        lookaheadSamples = 128  // fixed, the graph reads latency once per node
+    };
+
+    explicit MultibandCompressorProcessor (const int _numChannels = 2, const int _numBands = 3);
+    ~MultibandCompressorProcessor();
+
+    /** Returns the band count encoded in an identifier */
+    static int getNumBandsFor (const String& fileOrIdentifier);
+
+    const String getName() const override { return "Multiband Compressor"; }
+    void fillInPluginDescription (PluginDescription& desc) const override;
+
+    int getNumBands() const noexcept { return bands.size(); }
+
+    /** Gain reduction of a band at the end of the last block */
+    float getGainReductionDB (int band) const;
+
+    void prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock) override;
+    void releaseResources() override;
+    void processBlock (AudioBuffer<float>& buffer, MidiBuffer&) override;
+
+    AudioProcessorEditor* createEditor() override   { return new GenericAudioProcessorEditor (this); }
+    bool hasEditor() const override                 { return true; }
+
+    double getTailLengthSeconds() const override    { return 0.0; };
+    bool acceptsMidi() const override               { return false; }
+    bool producesMidi() const override              { return false; }
+
+    int getNumPrograms() override                                      { return 1; };
+    int getCurrentProgram() override                                   { return 1; };
+    void setCurrentProgram (int index) override                        { ignoreUnused (index); };
+    const String getProgramName (int index) override                   { ignoreUnused (index); return "Parameter"; }
+    void changeProgramName (int index, const String& newName) override { ignoreUnused (index, newName); }
+
+    void getStateInformation (juce::MemoryBlock& destData) override;
+    void setStateInformation (const void* data, int sizeInBytes) override;
+    void numChannelsChanged() override;
+
+protected:
+    inline bool isBusesLayoutSupported (const BusesLayout& layout) const override 
+    {
+        if (layout.inputBuses.size() != 1 || layout.outputBuses.size() != 1)
+            return false;
+
+        if (layout.getMainInputChannels() != layout.getMainOutputChannels())
+            return false;
+
+        const auto nchans = layout.getMainInputChannels();
+        return nchans >= 1 && nchans <= maxChannels;
+    }
+
+    inline bool canApplyBusesLayout (const BusesLayout& layouts) const override { return isBusesLayoutSupported (layouts); }
+    inline bool canApplyBusCountChange (bool isInput, bool isAddingBuses, BusProperties& outNewBusProperties) override
+    {
+        ignoreUnused (isInput, isAddingBuses, outNewBusProperties);
+        return false;
+    }
+
+private:
+    struct Band
+    {
+        AudioParameterFloat* threshDB       = nullptr;
+        AudioParameterFloat* ratio          = nullptr;
+        AudioParameterFloat* attackMs       = nullptr;
+        AudioParameterFloat* releaseMs      = nullptr;
+        AudioParameterFloat* makeupDB       = nullptr;
+        AudioParameterFloat* expThreshDB    = nullptr;
+        AudioParameterFloat* expRatio       = nullptr;
+        LevelDetector detector;
+        Atomic<float> reductionDB { 0.f };
+    };
+
+    int numChannels = 0;
+    OwnedArray<Band> bands;
+    Array<AudioParameterFloat*> frequencies;
+
+    Crossover crossover;
+    AudioBuffer<float> bandAudio;   // band major, numChannels per band
+    AudioBuffer<float> work;        // a gain vector per band, then detector input
+    HeapBlock<float> delayLines;    // lookahead per band and channel
+    int delayPosition = 0;
+
+    void delay (float* audio, float* line, int numSamples) const noexcept;
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (MultibandCompressorProcessor)
+};
+
+}
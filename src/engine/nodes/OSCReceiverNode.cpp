@@ -19,10 +19,46 @@
 */
 
 #include "engine/nodes/OSCReceiverNode.h"
+#include "engine/GraphProcessor.h"
 #include "Utils.h"
 
+#include <chrono>
+
 namespace Element {
 
+static const char* routeKindNames[] = { "midi", "note", "controller", "parameter", nullptr };
+
+OSCReceiverNode::Route::Kind OSCReceiverNode::Route::getKindFor (const String& name)
+{
+    for (int i = 0; routeKindNames[i] != nullptr; ++i)
+        if (name == routeKindNames[i])
+            return static_cast<Kind> (i);
+    return Midi;
+}
+
+String OSCReceiverNode::Route::getKindName (Kind kind)
+{
+    return isPositiveAndBelow ((int) kind, 4) ? routeKindNames [kind] : routeKindNames [0];
+}
+
+/** Reads the first argument as 0 to 1, integers as 0 to 127 */
+static bool getNormalizedArgument (const OSCMessage& message, float& value)
+{
+    if (message.isEmpty())
+        return false;
+
+    const auto& arg = message[0];
+    if (arg.isFloat32())
+        value = arg.getFloat32();
+    else if (arg.isInt32())
+        value = (float) arg.getInt32() / 127.f;
+    else
+        return false;
+
+    value = jlimit (0.f, 1.f, value);
+    return true;
+}
+
 OSCReceiverNode::OSCReceiverNode()
     : MidiFilterNode (0)
 {
@@ -30,11 +66,16 @@ OSCReceiverNode::OSCReceiverNode()
     metadata.setProperty (Tags::format, "Element", nullptr);
     metadata.setProperty (Tags::identifier, EL_INTERNAL_ID_OSC_RECEIVER, nullptr);
 
+    queueData.calloc ((size_t) queueSize);
+    pending.calloc ((size_t) queueSize);
+    setRoutes (getDefaultRoutes());
     oscReceiver.addListener (this);
 }
 
 OSCReceiverNode::~OSCReceiverNode()
 {
+    cancelPendingUpdate();
+    graphChanged.disconnect();
     oscReceiver.removeListener (this);
     oscReceiver.disconnect();
 }
@@ -55,6 +96,25 @@ void OSCReceiverNode::setState (const void* data, int size)
     if (newConnected)
         connect(newPortNumber);
 
+    const auto routesTree = tree.getChildWithName ("routes");
+    if (routesTree.isValid())
+    {
+        Array<Route> newRoutes;
+        for (int i = 0; i < routesTree.getNumChildren(); ++i)
+        {
+            const auto r = routesTree.getChild (i);
+            Route route;
+            route.pattern   = r.getProperty ("pattern").toString();
+            route.kind      = Route::getKindFor (r.getProperty ("kind").toString());
+            route.output    = jlimit (0, numMidiOutputs - 1, (int) r.getProperty ("output", 0));
+            route.channel   = jlimit (1, 16, (int) r.getProperty ("channel", 1));
+            route.number    = jmax (0, (int) r.getProperty ("number", 0));
+            route.nodeId    = (uint32) (int64) r.getProperty ("node", 0);
+            newRoutes.add (route);
+        }
+        setRoutes (newRoutes);
+    }
+
     currentHostName = newHostName;
     currentPortNumber = newPortNumber;
     connected = newConnected;
@@ -69,7 +129,21 @@ void OSCReceiverNode::getState (MemoryBlock& block)
     tree.setProperty ("hostName", currentHostName, nullptr);
     tree.setProperty ("portNumber", currentPortNumber, nullptr);
     tree.setProperty ("connected", connected, nullptr);
-    tree.setProperty ("paused", paused, nullptr);
+    tree.setProperty ("paused", paused.get(), nullptr);
+
+    ValueTree routesTree ("routes");
+    for (const auto& route : getRoutes())
+    {
+        ValueTree r ("route");
+        r.setProperty ("pattern", route.pattern, nullptr)
+         .setProperty ("kind", Route::getKindName (route.kind), nullptr)
+         .setProperty ("output", route.output, nullptr)
+         .setProperty ("channel", route.channel, nullptr)
+         .setProperty ("number", route.number, nullptr)
+         .setProperty ("node", (int64) route.nodeId, nullptr);
+        routesTree.appendChild (r, nullptr);
+    }
+    tree.appendChild (routesTree, nullptr);
 
     MemoryOutputStream stream (block, false);
 
@@ -90,46 +164,298 @@ inline void OSCReceiverNode::createPorts()
 
     ports.add (PortType::Midi, 0, 0, "midi_in", "MIDI In", true);
     ports.add (PortType::Midi, 1, 0, "midi_out", "MIDI Out", false);
+    for (int i = 1; i < numMidiOutputs; ++i)
+        ports.add (PortType::Midi, 1 + i, i, String ("midi_out_") + String (i + 1),
+                   String ("MIDI Out ") + String (i + 1), false);
     createdPorts = true;
 }
 
 void OSCReceiverNode::prepareToRender (double sampleRate, int maxBufferSize)
 {
-    if (! outputMidiMessagesInitDone) {
-        outputMidiMessages.reset (sampleRate);
+    ignoreUnused (maxBufferSize);
+    if (sampleRate > 0.0)
         currentSampleRate = sampleRate;
-        outputMidiMessagesInitDone = true;
+
+    // the parent graph is set by now
+    triggerAsyncUpdate();
+
+    // Time only has milliseconds, the system clock is read in microseconds
+    // so the base is exact without waiting for a tick
+    const auto micros = std::chrono::duration_cast<std::chrono::microseconds> (
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    clockBaseMillis = Time::getMillisecondCounterHiRes();
+
+    const uint64 secondsSince1900 = (uint64) (micros / 1000000) + 2208988800ull;
+    const uint64 fraction = ((uint64) (micros % 1000000) << 32) / 1000000ull;
+    clockBase = (secondsSince1900 << 32) | fraction;
+    clockValid = false;
+}
+
+void OSCReceiverNode::updateClock (int64 blockStart, int numSamples)
+{
+    const double elapsed = (Time::getMillisecondCounterHiRes() - clockBaseMillis) * 0.001;
+    const double offset  = elapsed - (double) blockStart / currentSampleRate;
+    const double error   = offset - clockOffset;
+
+    // jitter within a couple of blocks is ignored, drift beyond it is slewed
+    // out and anything large, like a device restart, resyncs
+    if (! clockValid || std::abs (error) > 0.25)
+    {
+        clockOffset = offset;
+        clockValid = true;
     }
+    else if (std::abs (error) > jmax (0.002, 2.0 * (double) numSamples / currentSampleRate))
+    {
+        clockOffset += error * 0.05;
+    }
+}
+
+int64 OSCReceiverNode::getPositionForTimeTag (const OSCTimeTag& timeTag) const
+{
+    const double seconds = (double) (int64) (timeTag.getRawTimeTag() - clockBase) / 4294967296.0;
+    return (int64) std::floor ((seconds - clockOffset) * currentSampleRate + 0.5);
+}
+
+OSCTimeTag OSCReceiverNode::getTimeTagForPosition (int64 position) const
+{
+    const double seconds = (double) position / currentSampleRate + clockOffset;
+    return OSCTimeTag (clockBase + (uint64) (int64) (seconds * 4294967296.0));
 }
 
 void OSCReceiverNode::render (AudioSampleBuffer& audio, MidiPipe& midi)
 {
     const auto nframes = audio.getNumSamples();
+    const auto nbuffers = midi.getNumBuffers();
+    for (int i = 0; i < nbuffers; ++i)
+        midi.getWriteBuffer(i)->clear();
+
     if (nframes == 0) {
         return;
     }
 
-    outputMidiMessages.removeNextBlockOfMessages ( *midi.getWriteBuffer (0), nframes );
+    const int64 blockStart = renderPosition;
+    const int64 blockEnd = blockStart + nframes;
+    const int64 horizon = blockStart + (int64) (maxScheduleSeconds * currentSampleRate);
+    updateClock (blockStart, nframes);
+
+    // schedule newly decoded events, leaving any which don't fit for later
+    int start1, size1, start2, size2;
+    queue.prepareToRead (jmin (queue.getNumReady(), (int) queueSize - numPending),
+                         start1, size1, start2, size2);
+
+    for (int i = 0; i < size1 + size2; ++i)
+    {
+        auto event = queueData [i < size1 ? start1 + i : start2 + i - size1];
+        if (event.time == OSCTimeTag::immediately.getRawTimeTag())
+        {
+            event.position = blockStart;
+        }
+        else
+        {
+            event.position = getPositionForTimeTag (OSCTimeTag (event.time));
+            if (event.position > horizon)
+            {
+                numDropped += 1;
+                continue;
+            }
+
+            if (event.position < blockStart)
+                numLate.set (numLate.get() + 1);
+        }
+
+        pending [numPending++] = event;
+    }
+
+    queue.finishedRead (size1 + size2);
+
+    int numKept = 0;
+    for (int i = 0; i < numPending; ++i)
+    {
+        const auto& event = pending[i];
+        if (event.position >= blockEnd)
+        {
+            pending [numKept++] = event;
+            continue;
+        }
+
+        if (event.output < nbuffers)
+            midi.getWriteBuffer (event.output)->addEvent (event.data, (int) event.size,
+                (int) jmax ((int64) 0, event.position - blockStart));
+    }
+
+    numPending = numKept;
+    renderPosition = blockEnd;
 }
 
 /** OSCReceiver real-time callbacks */
 
 void OSCReceiverNode::oscMessageReceived (const OSCMessage& message)
 {
-    if (paused)
+    handleMessage (message, OSCTimeTag::immediately.getRawTimeTag());
+}
+
+void OSCReceiverNode::oscBundleReceived (const OSCBundle& bundle)
+{
+    handleBundle (bundle, OSCTimeTag::immediately.getRawTimeTag());
+}
+
+void OSCReceiverNode::handleBundle (const OSCBundle& bundle, uint64 time)
+{
+    // nested bundles tagged immediately play with their parent
+    const auto& tag = bundle.getTimeTag();
+    if (! tag.isImmediately())
+        time = tag.getRawTimeTag();
+
+    for (const auto& element : bundle)
+    {
+        if (element.isBundle())
+            handleBundle (element.getBundle(), time);
+        else if (element.isMessage())
+            handleMessage (element.getMessage(), time);
+    }
+}
+
+void OSCReceiverNode::handleMessage (const OSCMessage& message, uint64 time)
+{
+    if (paused.get() || message.getAddressPattern().containsWildcards())
         return;
 
-    auto timestamp = Time::getMillisecondCounterHiRes();
+    const OSCAddress address (message.getAddressPattern().toString());
+
+    ScopedLock sl (routeLock);
+    for (int i = 0; i < routes.size(); ++i)
+    {
+        if (! patterns.getUnchecked(i)->matches (address))
+            continue;
+
+        const auto& route = routes.getReference (i);
+        Event event;
+        zerostruct (event);
+        event.time = time;
+        event.output = route.output;
+
+        MidiMessage midiMsg;
+        float value = 0.f;
+
+        switch (route.kind)
+        {
+            case Route::Midi:
+                midiMsg = Util::processOscToMidiMessage (message);
+                break;
+            case Route::Note:
+                if (! getNormalizedArgument (message, value))
+                    continue;
+                midiMsg = value > 0.f ? MidiMessage::noteOn (route.channel, route.number, value)
+                                      : MidiMessage::noteOff (route.channel, route.number);
+                break;
+            case Route::Controller:
+                if (! getNormalizedArgument (message, value))
+                    continue;
+                midiMsg = MidiMessage::controllerEvent (route.channel, route.number, roundToInt (value * 127.f));
+                break;
+            case Route::Parameter:
+                if (getNormalizedArgument (message, value))
+                    if (auto* target = targets.getObjectPointer (i))
+                        target->queueParameterValue (route.number, value);
+                continue;
+        }
+
+        // SysEx doesn't fit the queue
+        if (midiMsg.isSysEx() || midiMsg.getRawDataSize() > 3)
+            continue;
+
+        event.size = (uint8) midiMsg.getRawDataSize();
+        memcpy (event.data, midiMsg.getRawData(), (size_t) event.size);
+        pushEvent (event);
+    }
+}
+
+void OSCReceiverNode::pushEvent (const Event& event)
+{
+    int start1, size1, start2, size2;
+    queue.prepareToWrite (1, start1, size1, start2, size2);
+    if (size1 + size2 <= 0)
+    {
+        numDropped += 1;
+        return;
+    }
+
+    queueData [size1 > 0 ? start1 : start2] = event;
+    queue.finishedWrite (1);
+}
+
+/** Routing */
+
+bool OSCReceiverNode::setRoutes (const Array<Route>& newRoutes)
+{
+    Array<Route> valid;
+    OwnedArray<OSCAddressPattern> newPatterns;
+
+    for (const auto& route : newRoutes)
+    {
+        try
+        {
+            newPatterns.add (new OSCAddressPattern (route.pattern));
+            valid.add (route);
+        }
+        catch (const OSCFormatError&) {}
+    }
+
+    const bool allValid = valid.size() == newRoutes.size();
 
-    MidiMessage midiMsg = Util::processOscToMidiMessage (message);
-    midiMsg.setTimeStamp (timestamp);
+    {
+        ScopedLock sl (routeLock);
+        routes.swapWith (valid);
+        patterns.swapWith (newPatterns);
+    }
 
-    outputMidiMessages.addMessageToQueue( midiMsg );
-};
+    updateTargets();
+    return allValid;
+}
 
-void OSCReceiverNode::oscBundleReceived(const OSCBundle& bundle)
+void OSCReceiverNode::updateTargets()
 {
-};
+    auto* const graph = getParentGraph();
+    if (graph != watchedGraph)
+    {
+        // nodes are added and removed on this thread, so look again whenever
+        // the graph rebuilds
+        graphChanged.disconnect();
+        watchedGraph = graph;
+        if (graph != nullptr)
+            graphChanged = graph->renderingSequenceChanged.connect ([this]() { triggerAsyncUpdate(); });
+    }
+
+    ReferenceCountedArray<GraphNode> newTargets;
+    ScopedLock sl (routeLock);
+    for (const auto& route : routes)
+        newTargets.add (route.kind == Route::Parameter && graph != nullptr
+            ? graph->getNodeForId (route.nodeId) : nullptr);
+    targets.swapWith (newTargets);
+}
+
+void OSCReceiverNode::handleAsyncUpdate()
+{
+    updateTargets();
+}
+
+Array<OSCReceiverNode::Route> OSCReceiverNode::getRoutes() const
+{
+    ScopedLock sl (routeLock);
+    return routes;
+}
+
+Array<OSCReceiverNode::Route> OSCReceiverNode::getDefaultRoutes()
+{
+    Array<Route> defaults;
+    for (const auto* pattern : { "/midi/*", "/midi/*/*" })
+    {
+        Route route;
+        route.pattern = pattern;
+        defaults.add (route);
+    }
+    return defaults;
+}
 
 /** For node editor */
 
@@ -169,17 +495,17 @@ void OSCReceiverNode::resume ()
 
 bool OSCReceiverNode::isPaused ()
 {
-    return paused;
+    return paused.get();
 }
 
 bool OSCReceiverNode::togglePause ()
 {
-    if ( paused )
+    if ( paused.get() )
         resume();
     else
         pause();
 
-    return paused;
+    return paused.get();
 }
 
 int OSCReceiverNode::getCurrentPortNumber ()
@@ -23,14 +23,55 @@
 #include "engine/MidiPipe.h"
 #include "engine/nodes/BaseProcessor.h"
 #include "engine/nodes/MidiFilterNode.h"
+#include "Signals.h"
 
 namespace Element {
 
+/** Receives OSC and renders it as MIDI or parameter changes.
+
+    Messages are matched against a table of address pattern routes on the
+    receiver thread and decoded into a preallocated queue. The render thread
+    drains the queue and schedules each event at the sample its timetag
+    falls on. Messages outside a bundle and bundles tagged "immediately" play
+    at the start of the next block, late ones as soon as possible.
+
+    Timetags are mapped to samples through a clock which follows the system
+    time, but only corrects itself once it has drifted by more than about two
+    blocks. Callback jitter doesn't move events around.
+
+    Parameter routes are the exception: they are queued on the target node
+    as they arrive and apply at the start of its next block.
+ */
 class OSCReceiverNode : public MidiFilterNode,
                         public ChangeBroadcaster,
-                        public OSCReceiver::Listener<OSCReceiver::RealtimeCallback>
+                        public OSCReceiver::Listener<OSCReceiver::RealtimeCallback>,
+                        private AsyncUpdater
 {
 public:
+    enum { numMidiOutputs = 4 };
+
+    /** Maps OSC addresses to an output */
+    struct Route
+    {
+        enum Kind
+        {
+            Midi = 0,       // converts /midi/{command} style messages
+            Note,           // first argument is velocity, zero for note off
+            Controller,     // first argument is the controller value
+            Parameter       // first argument is a normalized parameter value
+        };
+
+        String pattern;
+        Kind kind           = Midi;
+        int output          = 0;    // MIDI output index
+        int channel         = 1;
+        int number          = 0;    // note, controller or parameter index
+        uint32 nodeId       = 0;    // node in the same graph for parameter routes
+
+        /** Returns a kind from its name, or Midi */
+        static Kind getKindFor (const String& name);
+        static String getKindName (Kind kind);
+    };
 
     OSCReceiverNode();
     virtual ~OSCReceiverNode();
@@ -73,26 +114,102 @@ public:
     void setPortNumber (int port);
     void setHostName (String hostName);
 
+    /** Replaces the routing table. Routes with an invalid pattern are skipped
+        @returns false if any were skipped
+     */
+    bool setRoutes (const Array<Route>& newRoutes);
+
+    /** Returns the routing table */
+    Array<Route> getRoutes() const;
+
+    /** Finds the nodes parameter routes point at in the parent graph. This
+        happens on its own when the routes or the graph change, call it on the
+        message thread */
+    void updateTargets();
+
+    /** Returns the routes used by a new node: all /midi messages to the first output */
+    static Array<Route> getDefaultRoutes();
+
+    /** Returns the number of events which arrived after their timetag */
+    int getNumLate() const                      { return numLate.get(); }
+
+    /** Returns the number of events dropped because the queue was full or
+        they were scheduled too far ahead */
+    int getNumDropped() const                   { return numDropped.get(); }
+
+    /** Returns the sample position of the next block to render */
+    int64 getRenderPosition() const             { return renderPosition; }
+
+    /** Converts between timetags and render positions. Call these on the
+        render thread or while not rendering */
+    int64 getPositionForTimeTag (const OSCTimeTag& timeTag) const;
+    OSCTimeTag getTimeTagForPosition (int64 position) const;
+
     void addMessageLoopListener (OSCReceiver::Listener<OSCReceiver::MessageLoopCallback>* callback);
     void removeMessageLoopListener (OSCReceiver::Listener<OSCReceiver::MessageLoopCallback>* callback);
 
 private:
+    enum
+    {
+        queueSize           = 1024,
+        maxScheduleSeconds  = 30
+    };
+
+    /** A decoded MIDI message */
+    struct Event
+    {
+        uint64 time;
+        int64 position;
+        int output;
+        uint8 data[3];
+        uint8 size;
+    };
 
     /** MIDI */
     bool createdPorts = false;
-    double currentSampleRate;
-    bool outputMidiMessagesInitDone = false;
-    MidiMessageCollector outputMidiMessages;
+    double currentSampleRate = 44100.0;
+
+    /** Routes, matched on the receiver thread */
+    CriticalSection routeLock;
+    Array<Route> routes;
+    OwnedArray<OSCAddressPattern> patterns;
+    ReferenceCountedArray<GraphNode> targets;   // per route, resolved on the message thread
+    GraphProcessor* watchedGraph = nullptr;
+    SignalConnection graphChanged;
+
+    /** Decoded events, written by the receiver thread */
+    AbstractFifo queue { queueSize };
+    HeapBlock<Event> queueData;
+
+    /** Events waiting for their block, render thread only */
+    HeapBlock<Event> pending;
+    int numPending = 0;
+    int64 renderPosition = 0;
+
+    /** Maps timetags to samples, render thread only */
+    uint64 clockBase = 0;
+    double clockBaseMillis = 0.0;
+    double clockOffset = 0.0;
+    bool clockValid = false;
+
+    Atomic<int> numLate { 0 };
+    Atomic<int> numDropped { 0 };
 
     /** OSC */
     OSCReceiver oscReceiver;
     bool connected = false;
-    bool paused = false;
+    Atomic<bool> paused { false };
     int currentPortNumber = 9001;
     String currentHostName = "";
 
     void oscMessageReceived(const OSCMessage& message) override;
     void oscBundleReceived(const OSCBundle& bundle) override;
+
+    void handleBundle (const OSCBundle& bundle, uint64 time);
+    void handleMessage (const OSCMessage& message, uint64 time);
+    void pushEvent (const Event& event);
+    void updateClock (int64 blockStart, int numSamples);
+    void handleAsyncUpdate() override;
 };
 
 
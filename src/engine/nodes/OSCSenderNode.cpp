@@ -31,6 +31,9 @@ OSCSenderNode::OSCSenderNode()
     metadata.setProperty (Tags::format, "Element", nullptr);
     metadata.setProperty (Tags::identifier, EL_INTERNAL_ID_OSC_SENDER, nullptr);
 
+    queueData.calloc ((size_t) queueSize);
+    sending.calloc ((size_t) queueSize);
+    logData.calloc ((size_t) logSize);
     startThread();
 }
 
@@ -50,6 +53,7 @@ void OSCSenderNode::setState (const void* data, int size)
     int newPortNumber = jlimit (1, 65536, (int) tree.getProperty ("portNumber", 9001));
     bool newConnected = (bool) tree.getProperty ("connected", false);
     bool newPaused = (bool) tree.getProperty ("paused", false);
+    setSendInterval ((int) tree.getProperty ("interval", 0));
 
     if (newHostName != currentHostName || newPortNumber != currentPortNumber)
         disconnect();
@@ -58,7 +62,6 @@ void OSCSenderNode::setState (const void* data, int size)
 
     currentHostName = newHostName;
     currentPortNumber = newPortNumber;
-    connected = newConnected;
     paused = newPaused;
 
     sendChangeMessage();
@@ -69,8 +72,9 @@ void OSCSenderNode::getState (MemoryBlock& block)
     ValueTree tree ("state");
     tree.setProperty ("hostName", currentHostName, nullptr);
     tree.setProperty ("portNumber", currentPortNumber, nullptr);
-    tree.setProperty ("connected", connected, nullptr);
-    tree.setProperty ("paused", paused, nullptr);
+    tree.setProperty ("connected", connected.get(), nullptr);
+    tree.setProperty ("paused", paused.get(), nullptr);
+    tree.setProperty ("interval", sendInterval.get(), nullptr);
 
     MemoryOutputStream stream (block, false);
 
@@ -84,40 +88,119 @@ void OSCSenderNode::run ()
 {
     while (! threadShouldExit())
     {
-        sem.wait();
+        // with no interval render wakes us when it queues a block
+        const int interval = sendInterval.get();
+        wakeup.wait (interval > 0 ? interval : -1);
 
         if (threadShouldExit())
             break;
 
-        /** MIDI queue -> OSC messages */
+        sendPending();
+    }
+
+    DBG("[EL] OSCSenderNode: OSC -> MIDI processing thread exited");
+}
 
-        MidiBuffer messages;
+void OSCSenderNode::sendPending()
+{
+    const int numReady = queue.getNumReady();
+    if (numReady <= 0)
+        return;
 
-        midiMessageQueue.removeNextBlockOfMessages (messages, numSamples.get());
-        numSamples = 0;
+    // someone is connecting, try again next time
+    ScopedTryLock sl (connectionLock);
+    if (! sl.isLocked())
+        return;
 
-        MidiBuffer::Iterator iter1 (messages);
-        MidiMessage msg;
-        int frame;
+    int start1, size1, start2, size2;
+    queue.prepareToRead (numReady, start1, size1, start2, size2);
+    if (size1 > 0)
+        memcpy (sending.getData(), queueData + start1, sizeof (Event) * (size_t) size1);
+    if (size2 > 0)
+        memcpy (sending + size1, queueData + start2, sizeof (Event) * (size_t) size2);
+    queue.finishedRead (size1 + size2);
 
-        ScopedLock sl (lock);
+    const int numEvents = size1 + size2;
+    if (! connected.get())
+        return;
 
-        while (iter1.getNextEvent (msg, frame))
+    const int64 rendered = renderPosition.get();
+    const double sampleRate = currentSampleRate.get();
+    const bool perBlock = sendInterval.get() <= 0;
+
+    // what 'rendered' is tagged with, 32.32 fixed point seconds
+    const auto latency = (uint64) (getLatencySeconds() * 4294967296.0);
+    const uint64 base = OSCTimeTag (Time::getCurrentTime()).getRawTimeTag() + latency;
+
+    int first = 0;
+    for (int i = 1; i <= numEvents; ++i)
+    {
+        if (i == numEvents || i - first >= maxBundleMessages
+            || (perBlock && sending[i].blockStart != sending[first].blockStart))
         {
-            OSCMessage oscMsg = Util::processMidiToOscMessage (msg);
-            oscSender.send ( oscMsg );
+            sendBundle (sending + first, i - first, rendered, base, sampleRate);
+            first = i;
+        }
+    }
+}
 
-            if (! msg.isMidiClock())
-            {
-                oscMessagesToLog.push_back ( oscMsg );
-            }
+void OSCSenderNode::sendBundle (const Event* events, int numEvents, int64 rendered,
+                                uint64 base, double sampleRate)
+{
+    // events are at most an interval and a block old, so they land between
+    // now and base. Never earlier than a tag already sent
+    auto timeTagFor = [&](int64 position)
+    {
+        const double seconds = (double) (position - rendered) / sampleRate;
+        lastTimeTag = jmax (lastTimeTag, base + (uint64) (int64) (seconds * 4294967296.0));
+        return OSCTimeTag (lastTimeTag);
+    };
+
+    auto messageFor = [](const Event& event)
+    {
+        return Util::processMidiToOscMessage (MidiMessage (event.data, (int) event.size));
+    };
+
+    OSCBundle bundle (timeTagFor (events[0].position));
+    for (int i = 0; i < numEvents;)
+    {
+        int next = i + 1;
+        while (next < numEvents && events[next].position == events[i].position)
+            ++next;
+
+        if (events[i].position == events[0].position)
+        {
+            for (int j = i; j < next; ++j)
+                bundle.addElement (messageFor (events[j]));
+        }
+        else
+        {
+            OSCBundle nested (timeTagFor (events[i].position));
+            for (int j = i; j < next; ++j)
+                nested.addElement (messageFor (events[j]));
+            bundle.addElement (nested);
         }
 
-        while (oscMessagesToLog.size() > maxOscMessages)
-            oscMessagesToLog.erase ( oscMessagesToLog.begin() );
+        i = next;
     }
 
-    DBG("[EL] OSCSenderNode: OSC -> MIDI processing thread exited");
+    if (! oscSender.send (bundle))
+        return;
+
+    numBundlesSent.set (numBundlesSent.get() + 1);
+
+    for (int i = 0; i < numEvents; ++i)
+    {
+        if (MidiMessage (events[i].data, (int) events[i].size).isMidiClock())
+            continue;
+        if (log.getFreeSpace() <= 0)
+            break;
+
+        int start1, size1, start2, size2;
+        log.prepareToWrite (1, start1, size1, start2, size2);
+        logData [size1 > 0 ? start1 : start2] = events[i];
+        log.finishedWrite (1);
+    }
 }
 
 void OSCSenderNode::stop ()
@@ -125,7 +208,7 @@ void OSCSenderNode::stop ()
     if (isThreadRunning())
     {
         signalThreadShouldExit();
-        sem.post();
+        wakeup.signal();
         stopThread (100);
     }
 }
@@ -143,37 +226,54 @@ inline void OSCSenderNode::createPorts()
     createdPorts = true;
 }
 
-void OSCSenderNode::prepareToRender (double sampleRate, int maxBufferSize) {
-    if (! midiMessageQueueInitDone) {
-        midiMessageQueue.reset (sampleRate);
-        currentSampleRate = sampleRate;
-        midiMessageQueueInitDone = true;
-    }
-};
+void OSCSenderNode::prepareToRender (double sampleRate, int maxBufferSize)
+{
+    currentSampleRate.set (sampleRate);
+    blockSize.set (jmax (1, maxBufferSize));
+}
 
 void OSCSenderNode::render (AudioSampleBuffer& audio, MidiPipe& midi)
 {
     const auto nframes = audio.getNumSamples();
     auto* const midiIn = midi.getWriteBuffer (0);
+    const int64 blockStart = renderPosition.get();
 
-    if (nframes == 0 || !connected || paused) {
-        midiIn->clear();
-        return;
-    }
+    if (nframes > 0 && connected.get() && ! paused.get() && ! midiIn->isEmpty())
+    {
+        int start1, size1, start2, size2;
+        queue.prepareToWrite (midiIn->getNumEvents(), start1, size1, start2, size2);
 
-    MidiBuffer::Iterator iter1 (*midiIn);
-    MidiMessage msg;
-    int frame;
-    auto timestamp = Time::getMillisecondCounterHiRes();
+        MidiBuffer::Iterator iter (*midiIn);
+        const uint8* data;
+        int size, frame, written = 0;
 
-    while (iter1.getNextEvent (msg, frame))
-    {
-        msg.setTimeStamp ( timestamp + (1000.0 * (static_cast<double> (frame) / currentSampleRate)) );
-        midiMessageQueue.addMessageToQueue ( msg );
+        while (iter.getNextEvent (data, size, frame))
+        {
+            // SysEx has no OSC mapping
+            if (size > 3)
+                continue;
+
+            if (written >= size1 + size2)
+            {
+                numDropped.set (numDropped.get() + 1);
+                continue;
+            }
+
+            auto& event = queueData [written < size1 ? start1 + written : start2 + written - size1];
+            event.position   = blockStart + frame;
+            event.blockStart = blockStart;
+            event.size       = (uint8) size;
+            memcpy (event.data, data, (size_t) size);
+            ++written;
+        }
+
+        queue.finishedWrite (written);
+
+        if (written > 0 && sendInterval.get() <= 0)
+            wakeup.wake();
     }
 
-    numSamples += nframes;
-    sem.post();
+    renderPosition.set (blockStart + nframes);
     midiIn->clear();
 }
 
@@ -181,27 +281,30 @@ void OSCSenderNode::render (AudioSampleBuffer& audio, MidiPipe& midi)
 
 bool OSCSenderNode::connect (String hostName, int portNumber)
 {
-   if (connected && currentPortNumber == portNumber)
-        return connected;
+    if (connected.get() && currentPortNumber == portNumber)
+        return true;
 
+    ScopedLock sl (connectionLock);
     currentHostName = hostName;
     currentPortNumber = portNumber;
     connected = oscSender.connect (hostName, portNumber);
 
-    return connected;
+    return connected.get();
 }
 
 bool OSCSenderNode::disconnect ()
 {
-   if (!connected)
+    if (! connected.get())
         return true;
+
+    ScopedLock sl (connectionLock);
     connected = false;
     return oscSender.disconnect();
 }
 
 bool OSCSenderNode::isConnected ()
 {
-    return connected;
+    return connected.get();
 }
 
 void OSCSenderNode::pause ()
@@ -216,17 +319,17 @@ void OSCSenderNode::resume ()
 
 bool OSCSenderNode::isPaused ()
 {
-    return paused;
+    return paused.get();
 }
 
 bool OSCSenderNode::togglePause ()
 {
-    if ( paused )
+    if ( paused.get() )
         resume();
     else
         pause();
 
-    return paused;
+    return paused.get();
 }
 
 int OSCSenderNode::getCurrentPortNumber ()
@@ -249,17 +352,35 @@ void OSCSenderNode::setHostName (String hostName)
     currentHostName = hostName;
 }
 
+void OSCSenderNode::setSendInterval (int milliseconds)
+{
+    sendInterval.set (jlimit (0, 1000, milliseconds));
+    wakeup.signal();
+}
+
+double OSCSenderNode::getLatencySeconds() const
+{
+    const double sampleRate = currentSampleRate.get();
+    return (double) sendInterval.get() / 1000.0
+        + (sampleRate > 0.0 ? 2.0 * (double) blockSize.get() / sampleRate : 0.0);
+}
+
 std::vector<OSCMessage> OSCSenderNode::getOscMessages()
 {
-    std::vector<OSCMessage> copied;
+    std::vector<OSCMessage> messages;
+
+    int start1, size1, start2, size2;
+    log.prepareToRead (log.getNumReady(), start1, size1, start2, size2);
+    messages.reserve ((size_t) (size1 + size2));
 
+    for (int i = 0; i < size1 + size2; ++i)
     {
-        ScopedLock sl (lock);
-        std::copy ( oscMessagesToLog.begin(), oscMessagesToLog.end(), std::back_inserter( copied ) );
-        oscMessagesToLog.clear();
+        const auto& event = logData [i < size1 ? start1 + i : start2 + i - size1];
+        messages.push_back (Util::processMidiToOscMessage (MidiMessage (event.data, (int) event.size)));
     }
 
-    return copied;
+    log.finishedRead (size1 + size2);
+    return messages;
 }
 
 }
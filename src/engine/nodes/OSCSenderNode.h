@@ -21,11 +21,24 @@
 #pragma once
 
 #include "engine/MidiPipe.h"
+#include "engine/WorkerWakeup.h"
 #include "engine/nodes/BaseProcessor.h"
 #include "engine/nodes/MidiFilterNode.h"
 
 namespace Element {
 
+/** Sends the MIDI it renders as OSC.
+
+    The audio thread only copies events into a lock-free FIFO. The sender
+    thread wakes once per send interval and packs everything waiting into
+    OSC bundles, one datagram each. With no interval, every rendered block
+    gets its own bundle and the audio thread wakes the sender. Events which
+    share a sample share a nested bundle, later samples get their own.
+
+    Bundles are timetagged a fixed latency after the events were rendered,
+    long enough for the oldest event in a bundle to still be in the future
+    when it is sent. See getLatencySeconds().
+ */
 class OSCSenderNode   : public MidiFilterNode,
                         public ChangeBroadcaster,
                         public Thread
@@ -81,37 +94,78 @@ public:
     void setPortNumber (int port);
     void setHostName (String hostName);
 
+    /** Returns messages sent since the last call, oldest first. Only one
+        thread should call this */
     std::vector<OSCMessage> getOscMessages();
 
+    /** Sets how often bundles are sent in milliseconds, 0 sends a bundle
+        per rendered block */
+    void setSendInterval (int milliseconds);
+    int getSendInterval() const                 { return sendInterval.get(); }
+
+    /** Returns the number of events dropped because the queue was full */
+    int getNumDropped() const                   { return numDropped.get(); }
+
+    /** Returns the number of bundles sent */
+    int getNumBundlesSent() const               { return numBundlesSent.get(); }
+
+    /** Returns how far after rendering bundles are timetagged. An event
+        can wait a block and a send interval before it goes out, another
+        block on top keeps its tag ahead of the time it is sent */
+    double getLatencySeconds() const;
+
 private:
+    enum
+    {
+        queueSize           = 4096,
+        logSize             = 256,
+        maxBundleMessages   = 128    // keeps datagrams well under a typical MTU multiple
+    };
 
-    Semaphore sem;
-    CriticalSection lock;
+    /** A short MIDI message at an absolute render position */
+    struct Event
+    {
+        int64 position;
+        int64 blockStart;
+        uint8 data[3];
+        uint8 size;
+    };
 
     /** MIDI */
     bool createdPorts = false;
 
-    /** OSC */
+    /** OSC, the connection lock is never waited on by the sender thread */
+    CriticalSection connectionLock;
     OSCSender oscSender;
 
-    bool connected = false;
-    bool paused = false;
+    Atomic<bool> connected { false };
+    Atomic<bool> paused { false };
 
     int currentPortNumber = 9002;
     String currentHostName = "127.0.0.1";
 
-    /** Max messages in queue before they start getting dropped */
-    int maxOscMessages = 100;
+    /** Rendered events waiting to be sent */
+    AbstractFifo queue { queueSize };
+    HeapBlock<Event> queueData, sending;
 
-    /** GUI */
-    std::vector<OSCMessage> oscMessagesToLog;
+    /** Sent events for the editor, dropped while full */
+    AbstractFifo log { logSize };
+    HeapBlock<Event> logData;
+
+    Atomic<int64> renderPosition { 0 };
+    Atomic<double> currentSampleRate { 44100.0 };
+    Atomic<int> sendInterval { 0 };
+    Atomic<int> numDropped { 0 };
+    Atomic<int> numBundlesSent { 0 };
+    Atomic<int> blockSize { 512 };
+    WorkerWakeup wakeup;
 
-    /** To be processed and sent as OSC messages */
-    MidiMessageCollector midiMessageQueue;
+    /** Sender thread only, keeps tags from going back in time when the
+        audio and system clocks jitter against each other */
+    uint64 lastTimeTag = 0;
 
-    Atomic<int> numSamples = 0;
-    double currentSampleRate = 0;
-    bool midiMessageQueueInitDone = false;
+    void sendPending();
+    void sendBundle (const Event* events, int numEvents, int64 rendered, uint64 base, double sampleRate);
 };
 
 }
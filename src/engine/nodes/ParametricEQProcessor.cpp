@@ -0,0 +1,161 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "engine/nodes/ParametricEQProcessor.h"
+
+namespace Element {
+
+ParametricEQProcessor::ParametricEQProcessor (const int _numChannels, const int _numBands)
+    : BaseProcessor (BusesProperties()
+        .withInput ("Main", AudioChannelSet::canonicalChannelSet (jlimit (1, (int) maxChannels, _numChannels)))
+        .withOutput ("Main", AudioChannelSet::canonicalChannelSet (jlimit (1, (int) maxChannels, _numChannels)))),
+      numChannels (jlimit (1, (int) maxChannels, _numChannels))
+{
+    setBusesLayout (getBusesLayout());
+    setRateAndBufferSizeDetails (44100.0, 1024);
+
+    NormalisableRange<float> freqRange (20.0f, 22000.0f);
+    freqRange.setSkewForCentre (1000.0f);
+    NormalisableRange<float> qRange (0.1f, 18.0f);
+    qRange.setSkewForCentre (0.707f);
+
+    const int numBands = jlimit (1, (int) maxBands, _numBands);
+    for (int b = 0; b < numBands; ++b)
+    {
+        auto* band = bands.add (new Band());
+        const String id (b + 1);
+        const String name = "Band " + id + " ";
+
+        // spread the bands evenly from 50 Hz to 12 kHz
+        const float ratio = numBands > 1 ? (float) b / (float) (numBands - 1) : 0.5f;
+        const float freq  = 50.f * std::pow (240.f, ratio);
+        const int shape   = b == 0 ? EQFilter::LowShelf : b == numBands - 1 ? EQFilter::HighShelf : EQFilter::Bell;
+
+        addParameter (band->enabled = new AudioParameterBool ("on" + id, name + "On", true));
+        addParameter (band->shape   = new AudioParameterChoice ("shape" + id, name + "Shape",
+            { "Bell", "Notch", "Hi Shelf", "Low Shelf", "HPF", "LPF" }, shape));
+        addParameter (band->freq    = new AudioParameterFloat ("freq" + id, name + "Frequency [Hz]", freqRange, freq));
+        addParameter (band->q       = new AudioParameterFloat ("q" + id,    name + "Q",              qRange, 0.707f));
+        addParameter (band->gainDB  = new AudioParameterFloat ("gain" + id, name + "Gain [dB]",      -15.0f, 15.0f, 0.0f));
+    }
+}
+
+ParametricEQProcessor::~ParametricEQProcessor() { }
+
+int ParametricEQProcessor::getNumBandsFor (const String& fileOrIdentifier)
+{
+    const int numBands = fileOrIdentifier.fromLastOccurrenceOf (".", false, false).getIntValue();
+    return numBands >= 1 ? numBands : 8;
+}
+
+void ParametricEQProcessor::fillInPluginDescription (PluginDescription& desc) const
+{
+    desc.name               = getName();
+    desc.name << " (" << bands.size() << " bands)";
+    desc.fileOrIdentifier   = String (EL_INTERNAL_ID_PARAMETRIC_EQ) + "." + String (bands.size());
+    desc.descriptiveName    = "Parametric EQ";
+    desc.numInputChannels   = numChannels;
+    desc.numOutputChannels  = numChannels;
+    desc.hasSharedContainer = false;
+    desc.isInstrument       = false;
+    desc.manufacturerName   = "Element";
+    desc.pluginFormatName   = "Element";
+    desc.version            = "1.0.0";
+    desc.uid                = EL_INTERNAL_UID_PARAMETRIC_EQ;
+}
+
+void ParametricEQProcessor::prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock)
+{
+    setBusesLayout (getBusesLayout());
+    setRateAndBufferSizeDetails (sampleRate, maximumExpectedSamplesPerBlock);
+
+    // glide coefficients over 5 ms
+    cascade.prepare (numChannels, roundToInt (sampleRate * 0.005));
+    updateSections (true);
+    cascade.reset();
+}
+
+void ParametricEQProcessor::releaseResources() { }
+
+void ParametricEQProcessor::updateSections (bool force)
+{
+    const double sampleRate = getSampleRate();
+    for (int b = 0; b < bands.size(); ++b)
+    {
+        auto* band = bands.getUnchecked (b);
+        const bool enabled = band->enabled->get();
+        const int shape    = band->shape->getIndex();
+        const float freq   = band->freq->get();
+        const float q      = band->q->get();
+        const float gainDB = band->gainDB->get();
+
+        if (! force && enabled == band->wasEnabled && shape == band->lastShape
+            && freq == band->lastFreq && q == band->lastQ && gainDB == band->lastGainDB)
+            continue;
+
+        band->wasEnabled = enabled;
+        band->lastShape  = shape;
+        band->lastFreq   = freq;
+        band->lastQ      = q;
+        band->lastGainDB = gainDB;
+
+        // disabled bands glide to unity, after which they are skipped
+        cascade.setTarget (b, enabled ? BiquadCascade::design ((EQFilter::Shape) shape, sampleRate, freq, q, gainDB)
+                                      : BiquadCascade::Coefficients());
+    }
+}
+
+void ParametricEQProcessor::processBlock (AudioBuffer<float>& buffer, MidiBuffer&)
+{
+    const int numSamples = buffer.getNumSamples();
+    if (numSamples <= 0 || buffer.getNumChannels() < numChannels)
+        return;
+
+    updateSections (false);
+    cascade.process (buffer.getArrayOfWritePointers(), numChannels, numSamples);
+}
+
+void ParametricEQProcessor::getStateInformation (juce::MemoryBlock& destData)
+{
+    ValueTree state (Tags::state);
+    for (auto* param : getParameters())
+        if (auto* p = dynamic_cast<AudioProcessorParameterWithID*> (param))
+            state.setProperty (p->paramID, p->getValue(), nullptr);
+    if (auto e = state.createXml())
+        AudioProcessor::copyXmlToBinary (*e, destData);
+}
+
+void ParametricEQProcessor::setStateInformation (const void* data, int sizeInBytes)
+{
+    if (auto e = AudioProcessor::getXmlFromBinary (data, sizeInBytes))
+    {
+        auto state = ValueTree::fromXml (*e);
+        if (state.isValid())
+            for (auto* param : getParameters())
+                if (auto* p = dynamic_cast<AudioProcessorParameterWithID*> (param))
+                    p->setValueNotifyingHost ((float) state.getProperty (p->paramID, p->getValue()));
+    }
+}
+
+void ParametricEQProcessor::numChannelsChanged()
+{
+    numChannels = jlimit (1, (int) maxChannels, getTotalNumInputChannels());
+}
+
+}
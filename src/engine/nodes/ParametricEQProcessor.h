@@ -0,0 +1,118 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "engine/nodes/BaseProcessor.h"
+#include "engine/BiquadCascade.h"
+
+namespace Element {
+
+/** A parametric EQ with several bands in one node.
+
+    Every band is a biquad section of one cascade, so the audio is filtered
+    in a single pass with all channels side by side. Parameter changes glide
+    the coefficients over a few milliseconds, and bands that are off or at
+    0 dB cost nothing.
+ */
+class ParametricEQProcessor : public BaseProcessor
+{
+public:
+    enum { maxChannels = 8, maxBands = BiquadCascade::maxSections };
+
+    explicit ParametricEQProcessor (const int _numChannels = 2, const int _numBands = 8);
+    ~ParametricEQProcessor();
+
+    /** Returns the band count encoded in an identifier */
+    static int getNumBandsFor (const String& fileOrIdentifier);
+
+    const String getName() const override { return "Parametric EQ"; }
+    void fillInPluginDescription (PluginDescription& desc) const override;
+
+    int getNumBands() const noexcept { return bands.size(); }
+
+    /** Returns true if a band was filtering during the last block */
+    bool isBandActive (int band) const noexcept { return cascade.isActive (band); }
+
+    void prepareToPlay (double sampleRate, int maximumExpectedSamplesPerBlock) override;
+    void releaseResources() override;
+    void processBlock (AudioBuffer<float>& buffer, MidiBuffer&) override;
+
+    AudioProcessorEditor* createEditor() override   { return new GenericAudioProcessorEditor (this); }
+    bool hasEditor() const override                 { return true; }
+
+    double getTailLengthSeconds() const override    { return 0.0; };
+    bool acceptsMidi() const override               { return false; }
+    bool producesMidi() const override              { return false; }
+
+    int getNumPrograms() override                                      { return 1; };
+    int getCurrentProgram() override                                   { return 1; };
+    void setCurrentProgram (int index) override                        { ignoreUnused (index); };
+    const String getProgramName (int index) override                   { ignoreUnused (index); return "Parameter"; }
+    void changeProgramName (int index, const String& newName) override { ignoreUnused (index, newName); }
+
+    void getStateInformation (juce::MemoryBlock& destData) override;
+    void setStateInformation (const void* data, int sizeInBytes) override;
+    void numChannelsChanged() override;
+
+protected:
+    inline bool isBusesLayoutSupported (const BusesLayout& layout) const override
+    {
+        if (layout.inputBuses.size() != 1 || layout.outputBuses.size() != 1)
+            return false;
+
+        if (layout.getMainInputChannels() != layout.getMainOutputChannels())
+            return false;
+
+        const auto nchans = layout.getMainInputChannels();
+        return nchans >= 1 && nchans <= maxChannels;
+    }
+
+    inline bool canApplyBusesLayout (const BusesLayout& layouts) const override { return isBusesLayoutSupported (layouts); }
+    inline bool canApplyBusCountChange (bool isInput, bool isAddingBuses, BusProperties& outNewBusProperties) override
+    {
+        ignoreUnused (isInput, isAddingBuses, outNewBusProperties);
+        return false;
+    }
+
+private:
+    struct Band
+    {
+        AudioParameterBool* enabled     = nullptr;
+        AudioParameterChoice* shape     = nullptr;
+        AudioParameterFloat* freq       = nullptr;
+        AudioParameterFloat* q          = nullptr;
+        AudioParameterFloat* gainDB     = nullptr;
+
+        // what the section was last designed from
+        bool wasEnabled = false;
+        int lastShape = -1;
+        float lastFreq = 0.f, lastQ = 0.f, lastGainDB = 0.f;
+    };
+
+    int numChannels = 0;
+    OwnedArray<Band> bands;
+    BiquadCascade cascade;
+
+    void updateSections (bool force);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (ParametricEQProcessor)
+};
+
+}
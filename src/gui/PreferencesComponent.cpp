@@ -664,6 +664,10 @@ namespace Element {
             addAndMakeVisible (midiOutput);
             midiOutput.addListener (this);
 
+            addAndMakeVisible (midiOutputTiming);
+            midiOutputTiming.setFont (Font (11.0));
+            midiOutputTiming.setJustificationType (Justification::centredRight);
+
            #if defined (EL_PRO)
             addAndMakeVisible (generateClockLabel);
             generateClockLabel.setFont (Font (12.0, Font::bold));
@@ -696,6 +700,7 @@ namespace Element {
 
             devices.addChangeListener (this);
             updateDevices();
+            updateOutputTiming();
             startTimer (1 * 1000); // refresh if needed every 1 second
         }
 
@@ -713,6 +718,21 @@ namespace Element {
             {
                 updateDevices();
             }
+
+            updateOutputTiming();
+        }
+
+        void updateOutputTiming()
+        {
+            const auto stats = midi.getMidiOutputScheduler().getTimingStats();
+            String text;
+            if (stats.numSent > 0)
+                text << "Sent " << stats.numSent << ", late by "
+                     << String (stats.meanErrorMs, 2) << " ms mean, "
+                     << String (stats.maxErrorMs, 2) << " ms max";
+            if (stats.numDropped > 0)
+                text << (text.isEmpty() ? "" : ", ") << stats.numDropped << " dropped";
+            midiOutputTiming.setText (text, dontSendNotification);
         }
 
         void resized() override
@@ -724,6 +744,7 @@ namespace Element {
             auto r2 = r.removeFromTop (settingHeight);
             midiOutputLabel.setBounds (r2.removeFromLeft (getWidth() / 2));
             midiOutput.setBounds (r2.withSizeKeepingCentre (r2.getWidth(), settingHeight));
+            midiOutputTiming.setBounds (r.removeFromTop (16));
            #if defined (EL_PRO)
             layoutSetting (r, generateClockLabel, generateClock);
             layoutSetting (r, sendClockToInputLabel, sendClockToInput);
@@ -776,6 +797,7 @@ namespace Element {
 
         Label midiOutputLabel;
         ComboBox midiOutput;
+        Label midiOutputTiming;
         Label generateClockLabel;
         SettingButton generateClock;
         Label sendClockToInputLabel;
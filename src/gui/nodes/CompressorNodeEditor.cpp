@@ -30,13 +30,10 @@ CompressorNodeEditor::CompViz::CompViz (CompressorProcessor& proc) :
     startTimer (40);
 
     updateCurve();
-
-    proc.addListener (this);
 }
 
 CompressorNodeEditor::CompViz::~CompViz()
 {
-    proc.removeListener (this);
 }
 
 float CompressorNodeEditor::CompViz::getDBForX (float x)
@@ -86,6 +83,9 @@ void CompressorNodeEditor::CompViz::updateInGainDB (float inDB)
 
 void CompressorNodeEditor::CompViz::timerCallback()
 {
+    // the processor publishes its level once per block
+    updateInGainDB (proc.getInputLevelDB());
+    gainReductionDB = proc.getGainReductionDB();
     repaint();
 }
 
@@ -113,6 +113,10 @@ void CompressorNodeEditor::CompViz::paint (Graphics& g)
     g.setColour (Colours::orange);
     g.fillEllipse (dotX - 5, dotY - 5, 10, 10);
 
+    // gain reduction meter, hanging from the top
+    const float reduction = jlimit (0.0f, 1.0f, -gainReductionDB / maxReductionDB);
+    g.fillRect ((float) getWidth() - 8.0f, 0.0f, 6.0f, reduction * (float) getHeight());
+
     // Draw outline
     g.setColour (Colours::white);
     g.drawRect (getLocalBounds().toFloat().reduced (0.5f));
@@ -122,10 +126,10 @@ void CompressorNodeEditor::CompViz::paint (Graphics& g)
 CompressorNodeEditor::CompressorNodeEditor (CompressorProcessor& proc) :
     AudioProcessorEditor (proc),
     proc (proc),
-    knobs (proc, [this, &proc] { proc.updateParams(); compViz.updateCurve(); }),
+    knobs (proc, [this] { compViz.updateCurve(); }),
     compViz (proc)
 {
-    setSize (610, 420);
+    setSize (700, 420);
 
     addAndMakeVisible (knobs);
     addAndMakeVisible (compViz);
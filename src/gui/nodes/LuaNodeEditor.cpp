@@ -154,13 +154,15 @@ LuaNodeEditor::LuaNodeEditor (const Node& node)
     {
         if (auto* const lua = getNodeObjectOfType<LuaNode>())
         {
-            const auto script = document.getAllContent();
-            auto result = lua->loadScript (script);
-            if (! result.wasOk())
+            // compiles off the message thread, errors come back here
+            lua->loadScriptAsync (document.getAllContent(), [](const Result& result)
             {
-                AlertWindow::showMessageBoxAsync (AlertWindow::WarningIcon,
-                    "Script Error", result.getErrorMessage());
-            }
+                if (! result.wasOk())
+                {
+                    AlertWindow::showMessageBoxAsync (AlertWindow::WarningIcon,
+                        "Script Error", result.getErrorMessage());
+                }
+            });
         }
     };
 
@@ -177,15 +179,23 @@ LuaNodeEditor::LuaNodeEditor (const Node& node)
     addAndMakeVisible (props);
     props.setVisible (editorButton.getToggleState());
 
+    addAndMakeVisible (memoryLabel);
+    memoryLabel.setFont (Font (11.f));
+    memoryLabel.setJustificationType (Justification::centredRight);
+    memoryLabel.setTooltip ("Script memory: live / peak, arena use, system fallbacks and GC time per block");
+
     updateProperties();
     lua->addChangeListener (this);
     portsChangedConnection = lua->portsChanged.connect (
         std::bind (&LuaNodeEditor::onPortsChanged, this));
     setSize (660, 480);
+    timerCallback();
+    startTimerHz (4);
 }
 
 LuaNodeEditor::~LuaNodeEditor()
 {
+    stopTimer();
     portsChangedConnection.disconnect();
     if (auto* const lua = getNodeObjectOfType<LuaNode>())
     {
@@ -219,6 +229,21 @@ void LuaNodeEditor::changeListenerCallback (ChangeBroadcaster*)
     resized();
 }
 
+void LuaNodeEditor::timerCallback()
+{
+    const auto stats = lua->getMemoryStats();
+    const auto kb = [](size_t bytes) { return String (roundToInt ((double) bytes / 1024.0)) + " KB"; };
+
+    String text;
+    text << kb (stats.bytesInUse) << " / " << kb (stats.peakBytesInUse) << " peak"
+         << "  arena " << roundToInt (100.0 * (double) stats.arenaUsed / (double) jmax ((size_t) 1, stats.arenaSize)) << "%"
+         << "  fallbacks " << String (stats.numFallbacks)
+         << "  GC " << String (stats.gcLastMicros, 1) << " us (max " << String (stats.gcMaxMicros, 1) << ")";
+    memoryLabel.setText (text, dontSendNotification);
+    memoryLabel.setColour (Label::textColourId, stats.numFallbacks > 0
+        ? Colours::orange : Element::LookAndFeel::textColor.withAlpha (0.8f));
+}
+
 void LuaNodeEditor::paint (Graphics& g)
 {
     g.fillAll (Element::LookAndFeel::backgroundColor);
@@ -233,6 +258,9 @@ void LuaNodeEditor::resized()
     compileButton.setBounds (r2.removeFromLeft (compileButton.getWidth()));
     editorButton.changeWidthToFitText (r2.getHeight());
     editorButton.setBounds (r2.removeFromRight (editorButton.getWidth()));
+    r2.removeFromLeft (4);
+    r2.removeFromRight (4);
+    memoryLabel.setBounds (r2);
 
     r1.removeFromTop (2);
     if (props.isVisible())
@@ -27,7 +27,8 @@
 namespace Element {
 
 class LuaNodeEditor : public NodeEditorComponent,
-                      public ChangeListener
+                      public ChangeListener,
+                      private Timer
 {
 public:
     explicit LuaNodeEditor (const Node&);
@@ -45,11 +46,13 @@ private:
     TextButton compileButton;
     TextButton editorButton;
     PropertyPanel props;
+    Label memoryLabel;
     SignalConnection portsChangedConnection;
     LuaNode::Ptr lua;
 
     void updateProperties();
     void onPortsChanged();
+    void timerCallback() override;
 };
 
 }
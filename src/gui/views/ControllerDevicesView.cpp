@@ -854,13 +854,18 @@ public:
             
             eventType = control.getPropertyAsValue ("eventType");
             props.add (new ChoicePropertyComponent (eventType, "Event Type", 
-                { "Controller", "Note" }, { var ("controller"), var ("note") }));
+                { "Controller", "Note", "NRPN", "RPN" }, 
+                { var ("controller"), var ("note"), var ("nrpn"), var ("rpn") }));
 
             String eventName = "Event ID";
             if (control.isNoteEvent())
                 eventName = "Note Number";
             else if (control.isControllerEvent())
                 eventName = "CC Number";
+            else if (control.isNrpnEvent())
+                eventName = "NRPN Number";
+            else if (control.isRpnEvent())
+                eventName = "RPN Number";
 
             props.add (new ChoicePropertyComponent (control.getPropertyAsValue (Tags::midiChannel),
                 "Channel", { "Omni", "1", "2", "3", "4", "5", "6", "7", "8",
@@ -868,10 +873,17 @@ public:
                             { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15, 16 }));
 
             eventId = control.getPropertyAsValue ("eventId");
+            const bool isParameterEvent = control.isNrpnEvent() || control.isRpnEvent();
             props.add (new SliderPropertyComponent (eventId, eventName, 
-                0.0, 127.0, 1.0));
+                0.0, isParameterEvent ? 16383.0 : 127.0, 1.0));
 
-            if (control.isControllerEvent())
+            if (control.isControllerEvent() && control.getEventId() < 32)
+            {
+                props.add (new BooleanPropertyComponent (control.getHighResolutionObject(),
+                    "14-bit", "Pair with the LSB controller (CC + 32)"));
+            }
+
+            if (control.isControllerEvent() || isParameterEvent)
             {
                 toggleMode = control.getToggleModeObject();
                 props.add (new ChoicePropertyComponent (toggleMode, "Toggle Mode", 
@@ -882,6 +894,9 @@ public:
                 props.add (new SliderPropertyComponent (toggleValue, "Toggle Value", 
                     0.0, 127.0, 1.0));
 
+                props.add (new SliderPropertyComponent (control.getSmoothingTimeObject(),
+                    "Smoothing (ms)", 0.0, 1000.0, 1.0));
+
                 if (toggleMode.getValue() != "eq")
                 {
                     Value inverseToggle = control.getPropertyAsValue ("inverseToggle");
@@ -0,0 +1,163 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "scripting/LuaAllocator.h"
+
+namespace Element {
+
+LuaAllocator::LuaAllocator (size_t size)
+    : arenaSize (size)
+{
+    arena.calloc (arenaSize);
+
+    // calloc hands back untouched zero pages, write to each one now so the
+    // audio thread never faults them in
+    auto* const pages = static_cast<volatile char*> (arena.get());
+    for (size_t i = 0; i < arenaSize; i += 4096)
+        pages[i] = 0;
+    for (auto& list : freeLists)
+        list = nullptr;
+}
+
+LuaAllocator::~LuaAllocator() { }
+
+//==============================================================================
+int LuaAllocator::getSizeClass (size_t size) noexcept
+{
+    int shift = minClassShift;
+    while (((size_t) 1 << shift) < size)
+        ++shift;
+    return shift - minClassShift;
+}
+
+bool LuaAllocator::ownsBlock (const void* ptr) const noexcept
+{
+    auto* const p = static_cast<const char*> (ptr);
+    return p >= arena.get() && p < arena.get() + arenaSize;
+}
+
+void* LuaAllocator::allocateBlock (size_t size)
+{
+    ++numAllocations;
+    const auto total = bytesInUse.get() + (int64) size;
+    bytesInUse = total;
+    if (total > peakBytesInUse.get())
+        peakBytesInUse = total;
+
+    if (size <= ((size_t) 1 << maxClassShift))
+    {
+        const int sizeClass = getSizeClass (size);
+        if (auto* const block = freeLists [sizeClass])
+        {
+            freeLists [sizeClass] = block->next;
+            return block;
+        }
+
+        const size_t classSize = (size_t) 1 << (sizeClass + minClassShift);
+        if (arenaUsed + classSize <= arenaSize)
+        {
+            auto* const block = arena.get() + arenaUsed;
+            arenaUsed += classSize;
+            arenaUsedAtomic = (int64) arenaUsed;
+            return block;
+        }
+    }
+
+    ++numFallbacks;
+    return std::malloc (size);
+}
+
+void LuaAllocator::freeBlock (void* ptr, size_t size)
+{
+    bytesInUse -= (int64) size;
+
+    if (ownsBlock (ptr))
+    {
+        auto* const block = static_cast<FreeBlock*> (ptr);
+        const int sizeClass = getSizeClass (size);
+        block->next = freeLists [sizeClass];
+        freeLists [sizeClass] = block;
+        return;
+    }
+
+    std::free (ptr);
+}
+
+void* LuaAllocator::reallocate (void* ptr, size_t oldSize, size_t newSize)
+{
+    const size_t maxClassSize = (size_t) 1 << maxClassShift;
+
+    // still fits the same class, nothing to do
+    if (ownsBlock (ptr) && newSize <= maxClassSize
+        && getSizeClass (newSize) == getSizeClass (oldSize))
+    {
+        bytesInUse += (int64) newSize - (int64) oldSize;
+        return ptr;
+    }
+
+    // both large: let the system grow in place if it can
+    if (! ownsBlock (ptr) && oldSize > maxClassSize && newSize > maxClassSize)
+    {
+        auto* const block = std::realloc (ptr, newSize);
+        if (block != nullptr)
+        {
+            ++numFallbacks;
+            bytesInUse += (int64) newSize - (int64) oldSize;
+        }
+        return block;
+    }
+
+    auto* const block = allocateBlock (newSize);
+    if (block == nullptr)
+        return nullptr;
+    memcpy (block, ptr, jmin (oldSize, newSize));
+    freeBlock (ptr, oldSize);
+    return block;
+}
+
+void* LuaAllocator::allocate (void* userData, void* ptr, size_t oldSize, size_t newSize)
+{
+    auto& self = *static_cast<LuaAllocator*> (userData);
+
+    if (newSize == 0)
+    {
+        if (ptr != nullptr)
+            self.freeBlock (ptr, oldSize);
+        return nullptr;
+    }
+
+    // when ptr is null, oldSize is the Lua type being allocated
+    return ptr == nullptr ? self.allocateBlock (newSize)
+                          : self.reallocate (ptr, oldSize, newSize);
+}
+
+//==============================================================================
+LuaAllocator::Stats LuaAllocator::getStats() const
+{
+    Stats stats;
+    stats.arenaSize         = arenaSize;
+    stats.arenaUsed         = (size_t) arenaUsedAtomic.get();
+    stats.bytesInUse        = (size_t) jmax ((int64) 0, bytesInUse.get());
+    stats.peakBytesInUse    = (size_t) peakBytesInUse.get();
+    stats.numAllocations    = numAllocations.get();
+    stats.numFallbacks      = numFallbacks.get();
+    return stats;
+}
+
+}
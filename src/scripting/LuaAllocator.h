@@ -0,0 +1,91 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+namespace Element {
+
+/** A lua_Alloc which serves a Lua state from a preallocated arena.
+
+    Small blocks come from power of two size classes carved out of the arena
+    and recycled through per-class free lists, so allocating and freeing is a
+    constant time pointer swap with no system calls. Lua always passes the old
+    size of a block back to the allocator which means blocks need no header.
+
+    Blocks larger than the biggest class, or any block once the arena is
+    exhausted, fall back to the system allocator. These are counted so a script
+    which isn't realtime safe shows up in the stats.
+
+    Not thread safe, like the Lua state it serves.
+ */
+class LuaAllocator
+{
+public:
+    struct Stats
+    {
+        size_t arenaSize        = 0;    // total bytes reserved
+        size_t arenaUsed        = 0;    // bytes carved from the arena so far
+        size_t bytesInUse       = 0;    // live bytes, arena and fallback
+        size_t peakBytesInUse   = 0;
+        int64 numAllocations    = 0;
+        int64 numFallbacks      = 0;    // allocations served by the system
+    };
+
+    enum { defaultArenaSize = 4 * 1024 * 1024 };
+
+    explicit LuaAllocator (size_t arenaSize = (size_t) defaultArenaSize);
+    ~LuaAllocator();
+
+    /** The lua_Alloc function. Pass the allocator as the user data pointer */
+    static void* allocate (void* userData, void* ptr, size_t oldSize, size_t newSize);
+
+    /** Returns allocation counters. Safe to call from any thread */
+    Stats getStats() const;
+
+private:
+    enum
+    {
+        minClassShift   = 4,                    // 16 bytes
+        maxClassShift   = 12,                   // 4096 bytes
+        numClasses      = maxClassShift - minClassShift + 1
+    };
+
+    struct FreeBlock { FreeBlock* next; };
+
+    HeapBlock<char> arena;
+    size_t arenaSize = 0;
+    size_t arenaUsed = 0;
+    FreeBlock* freeLists [numClasses];
+
+    Atomic<int64> bytesInUse { 0 }, peakBytesInUse { 0 };
+    Atomic<int64> numAllocations { 0 }, numFallbacks { 0 };
+    Atomic<int64> arenaUsedAtomic { 0 };
+
+    static int getSizeClass (size_t size) noexcept;
+    bool ownsBlock (const void* ptr) const noexcept;
+    void* allocateBlock (size_t size);
+    void freeBlock (void* ptr, size_t size);
+    void* reallocate (void* ptr, size_t oldSize, size_t newSize);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LuaAllocator)
+};
+
+}
@@ -33,6 +33,7 @@
 #include "Globals.h"
 #include "Settings.h"
 
+#include "scripting/LuaDSP.h"
 #include "scripting/LuaIterators.h"
 
 #include "sol/sol.hpp"
@@ -354,7 +355,10 @@ static void openWorld (state& lua)
 
 void openDSP (sol::state& lua)
 {
-    kv_openlibs (lua.lua_state(), 0);
+    auto* L = lua.lua_state();
+    kv_openlibs (L, 0);
+    luaL_requiref (L, "element.dsp", openDSPKernels, 0);
+    lua_pop (L, 1);
 }
 
 void openLibs (sol::state& lua)
@@ -0,0 +1,119 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "sol/sol.hpp"
+
+#include "scripting/LuaBytecodeCache.h"
+
+namespace Element {
+
+static int writeChunk (lua_State*, const void* data, size_t size, void* userData)
+{
+    static_cast<MemoryBlock*> (userData)->append (data, size);
+    return 0;
+}
+
+//==============================================================================
+LuaBytecodeCache::LuaBytecodeCache() { }
+
+LuaBytecodeCache::~LuaBytecodeCache() { }
+
+LuaBytecodeCache& LuaBytecodeCache::getShared()
+{
+    static LuaBytecodeCache cache;
+    return cache;
+}
+
+String LuaBytecodeCache::getKey (const String& source)
+{
+    return SHA256 (source.toUTF8()).toHexString();
+}
+
+//==============================================================================
+Result LuaBytecodeCache::compile (const String& source, MemoryBlock& bytecode)
+{
+    const auto key = getKey (source);
+
+    {
+        ScopedLock sl (lock);
+        if (entries.contains (key))
+        {
+            bytecode = entries [key];
+            ++numHits;
+            return Result::ok();
+        }
+    }
+
+    ++numMisses;
+
+    // compile in a bare state, nothing runs here
+    auto* L = luaL_newstate();
+    if (L == nullptr)
+        return Result::fail ("could not create Lua state");
+
+    const auto utf8 = source.toRawUTF8();
+    Result result = Result::ok();
+    if (luaL_loadbufferx (L, utf8, strlen (utf8), "=script", "t") != LUA_OK)
+    {
+        result = Result::fail (String::fromUTF8 (lua_tostring (L, -1)));
+    }
+    else
+    {
+        bytecode.reset();
+        lua_dump (L, writeChunk, &bytecode, 0);
+    }
+
+    lua_close (L);
+
+    if (result.wasOk())
+        store (key, bytecode);
+
+    return result;
+}
+
+int LuaBytecodeCache::load (lua_State* L, const String& source, const char* chunkName)
+{
+    MemoryBlock bytecode;
+    const auto result = compile (source, bytecode);
+    if (result.failed())
+    {
+        lua_pushstring (L, result.getErrorMessage().toRawUTF8());
+        return LUA_ERRSYNTAX;
+    }
+
+    return luaL_loadbufferx (L, static_cast<const char*> (bytecode.getData()),
+                             bytecode.getSize(), chunkName, "b");
+}
+
+void LuaBytecodeCache::clear()
+{
+    ScopedLock sl (lock);
+    entries.clear();
+}
+
+//==============================================================================
+void LuaBytecodeCache::store (const String& key, const MemoryBlock& bytecode)
+{
+    ScopedLock sl (lock);
+    if (entries.size() >= (int) maxEntries)
+        entries.clear();
+    entries.set (key, bytecode);
+}
+
+}
@@ -0,0 +1,77 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+#include "JuceHeader.h"
+
+struct lua_State;
+
+namespace Element {
+
+/** Compiles Lua source to bytecode, keyed by a hash of the source.
+
+    Compiled chunks are kept in memory so scripts used by many nodes are
+    only parsed once. Nothing is written to disk, Lua doesn't verify binary
+    chunks and loading a tampered one can crash or run arbitrary code.
+
+    All methods are thread safe.
+ */
+class LuaBytecodeCache
+{
+public:
+    LuaBytecodeCache();
+    ~LuaBytecodeCache();
+
+    /** The cache shared by all script nodes */
+    static LuaBytecodeCache& getShared();
+
+    /** Returns bytecode for a script, compiling it if not cached.
+        @returns an error with Lua's message if the script doesn't compile
+     */
+    Result compile (const String& source, MemoryBlock& bytecode);
+
+    /** Loads a script through the cache and pushes the chunk onto the stack,
+        like luaL_loadbuffer does. On failure pushes the error message instead.
+        @returns the Lua status code
+     */
+    int load (lua_State* L, const String& source, const char* chunkName = "=script");
+
+    /** Drops all cached chunks */
+    void clear();
+
+    int getNumHits() const noexcept     { return numHits.get(); }
+    int getNumMisses() const noexcept   { return numMisses.get(); }
+
+    /** Returns the cache key for some source code */
+    static String getKey (const String& source);
+
+private:
+    enum { maxEntries = 256 };
+
+    CriticalSection lock;
+    HashMap<String, MemoryBlock> entries;
+    Atomic<int> numHits { 0 }, numMisses { 0 };
+
+    void store (const String& key, const MemoryBlock& bytecode);
+
+    JUCE_DECLARE_NON_COPYABLE_WITH_LEAK_DETECTOR (LuaBytecodeCache)
+};
+
+}
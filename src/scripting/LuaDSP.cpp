@@ -0,0 +1,924 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#include "sol/sol.hpp"
+#include "lua-kv.h"
+
+#include "JuceHeader.h"
+#include "scripting/LuaDSP.h"
+
+#define EL_DSP_BIQUAD       "element.dsp.Biquad"
+#define EL_DSP_DELAY        "element.dsp.Delay"
+#define EL_DSP_FOLLOWER     "element.dsp.Follower"
+#define EL_DSP_FFT          "element.dsp.FFT"
+#define EL_DSP_TABLE        "element.dsp.Table"
+
+namespace Element {
+namespace Lua {
+
+using Sample = kv_sample_t;
+
+//==============================================================================
+// registry key for the kv.audio.Buffer metatable, captured when the module opens
+static const char bufferMetatableKey = 0;
+
+struct Channels
+{
+    Sample* const* data;
+    int numChannels, numFrames;
+    int start, end;     // selected channels, end exclusive
+};
+
+/** Checks a buffer/channel argument pair. Channel is 1 based, 0 selects all */
+static Channels checkChannels (lua_State* L, int arg)
+{
+    bool isBuffer = false;
+    if (lua_getmetatable (L, arg))
+    {
+        lua_rawgetp (L, LUA_REGISTRYINDEX, &bufferMetatableKey);
+        isBuffer = lua_rawequal (L, -1, -2) != 0;
+        lua_pop (L, 2);
+    }
+
+    if (! isBuffer)
+        luaL_argerror (L, arg, "kv.audio.Buffer expected");
+
+    // kv buffers are full userdata, the block is the buffer struct itself
+    auto* buffer = static_cast<kv_audio_buffer_t*> (lua_touserdata (L, arg));
+
+    Channels ch;
+    ch.data         = kv_audio_buffer_array (buffer);
+    ch.numChannels  = kv_audio_buffer_channels (buffer);
+    ch.numFrames    = kv_audio_buffer_length (buffer);
+
+    const int channel = (int) luaL_checkinteger (L, arg + 1);
+    luaL_argcheck (L, channel >= 0 && channel <= ch.numChannels, arg + 1, "channel out of range");
+    ch.start = channel == 0 ? 0 : channel - 1;
+    ch.end   = channel == 0 ? ch.numChannels : channel;
+    return ch;
+}
+
+/** Maps a destination channel to its source: a single source channel feeds
+    every destination, otherwise channels pair up by index */
+static int sourceChannel (const Channels& src, int destChannel) noexcept
+{
+    return src.end - src.start == 1 ? src.start : destChannel;
+}
+
+template<class T, class... Args>
+static T* newObject (lua_State* L, const char* metatable, Args&&... args)
+{
+    auto* const block = lua_newuserdata (L, sizeof (T));
+    auto* const object = new (block) T (std::forward<Args> (args)...);
+    luaL_setmetatable (L, metatable);
+    return object;
+}
+
+template<class T>
+static T* checkObject (lua_State* L, int arg, const char* metatable)
+{
+    return static_cast<T*> (luaL_checkudata (L, arg, metatable));
+}
+
+template<class T>
+static int destroyObject (lua_State* L)
+{
+    static_cast<T*> (lua_touserdata (L, 1))->~T();
+    return 0;
+}
+
+//==============================================================================
+static int dsp_gain (lua_State* L)
+{
+    const auto ch = checkChannels (L, 1);
+    const auto gain = (Sample) luaL_checknumber (L, 3);
+    for (int c = ch.start; c < ch.end; ++c)
+        FloatVectorOperations::multiply (ch.data[c], gain, ch.numFrames);
+    return 0;
+}
+
+static int dsp_ramp (lua_State* L)
+{
+    const auto ch = checkChannels (L, 1);
+    const auto startGain = (Sample) luaL_checknumber (L, 3);
+    const auto endGain   = (Sample) luaL_checknumber (L, 4);
+
+    if (startGain == endGain)
+    {
+        for (int c = ch.start; c < ch.end; ++c)
+            FloatVectorOperations::multiply (ch.data[c], startGain, ch.numFrames);
+        return 0;
+    }
+
+    // gain is computed from the frame index, not accumulated, so the
+    // loop has no carried dependency and vectorizes
+    const Sample delta = (endGain - startGain) / (Sample) jmax (1, ch.numFrames - 1);
+    for (int c = ch.start; c < ch.end; ++c)
+    {
+        auto* const data = ch.data[c];
+        for (int f = 0; f < ch.numFrames; ++f)
+            data[f] *= startGain + delta * (Sample) f;
+    }
+
+    return 0;
+}
+
+static int mixOrCopy (lua_State* L, bool add)
+{
+    const auto dst = checkChannels (L, 1);
+    const auto src = checkChannels (L, 3);
+    const auto gain = (Sample) luaL_optnumber (L, 5, 1.0);
+    const int numFrames = jmin (dst.numFrames, src.numFrames);
+
+    for (int c = dst.start; c < dst.end; ++c)
+    {
+        const int s = sourceChannel (src, c);
+        if (s >= src.end)
+            break;
+
+        if (add)
+            FloatVectorOperations::addWithMultiply (dst.data[c], src.data[s], gain, numFrames);
+        else if (gain == (Sample) 1)
+            FloatVectorOperations::copy (dst.data[c], src.data[s], numFrames);
+        else
+            FloatVectorOperations::copyWithMultiply (dst.data[c], src.data[s], gain, numFrames);
+    }
+
+    return 0;
+}
+
+static int dsp_mix (lua_State* L)    { return mixOrCopy (L, true); }
+static int dsp_copy (lua_State* L)   { return mixOrCopy (L, false); }
+
+/** Linear resampling of src into dst. Returns the read position after the
+    last frame written, relative to the end of the source, so the result can
+    be passed straight back in as the next block's phase. Negative positions
+    wrap around to the end of the source */
+static int dsp_interpolate (lua_State* L)
+{
+    const auto dst = checkChannels (L, 1);
+    const auto src = checkChannels (L, 3);
+    const double ratio = luaL_checknumber (L, 5);
+    const double phase = luaL_optnumber (L, 6, 0.0);
+    luaL_argcheck (L, ratio > 0.0, 5, "ratio must be positive");
+
+    const int lastFrame = src.numFrames - 1;
+    const double length = (double) src.numFrames;
+    for (int c = dst.start; c < dst.end && lastFrame >= 0; ++c)
+    {
+        const int s = sourceChannel (src, c);
+        if (s >= src.end)
+            break;
+
+        const auto* const in = src.data[s];
+        auto* const out = dst.data[c];
+        for (int f = 0; f < dst.numFrames; ++f)
+        {
+            double pos = phase + ratio * (double) f;
+            const bool wrapped = pos < 0.0;
+            if (wrapped)
+            {
+                pos = std::fmod (pos, length) + length;
+                if (pos >= length)
+                    pos -= length;
+            }
+
+            const int i0 = (int) pos;
+            if (i0 >= lastFrame && ! wrapped)
+            {
+                out[f] = i0 == lastFrame ? in[lastFrame] : (Sample) 0;
+                continue;
+            }
+
+            const int i1 = i0 < lastFrame ? i0 + 1 : 0;
+            const auto alpha = (Sample) (pos - (double) i0);
+            out[f] = in[i0] + alpha * (in[i1] - in[i0]);
+        }
+    }
+
+    lua_pushnumber (L, phase + ratio * (double) dst.numFrames - (double) src.numFrames);
+    return 1;
+}
+
+//==============================================================================
+/** Cascade of second order sections, transposed direct form II */
+struct Biquad
+{
+    struct Coefficients { double b0 = 1.0, b1 = 0.0, b2 = 0.0, a1 = 0.0, a2 = 0.0; };
+
+    Biquad (int stages, int channels)
+        : numStages (stages), numChannels (channels)
+    {
+        coefficients.allocate ((size_t) numStages, true);
+        for (int i = 0; i < numStages; ++i)
+            coefficients[i] = Coefficients();
+        state.allocate ((size_t) (numStages * numChannels * 2), true);
+    }
+
+    void reset() noexcept
+    {
+        zeromem (state.get(), sizeof (double) * (size_t) (numStages * numChannels * 2));
+    }
+
+    void set (int stage, double b0, double b1, double b2, double a0, double a1, double a2) noexcept
+    {
+        auto& c = coefficients [stage];
+        c.b0 = b0 / a0; c.b1 = b1 / a0; c.b2 = b2 / a0;
+        c.a1 = a1 / a0; c.a2 = a2 / a0;
+    }
+
+    /** Runs each stage over the whole block before the next so a stage's
+        coefficients and state stay in registers */
+    void process (Sample* data, int channel, int numFrames) noexcept
+    {
+        for (int s = 0; s < numStages; ++s)
+        {
+            const auto& c = coefficients [s];
+            double* const z = state.get() + (channel * numStages + s) * 2;
+            double z1 = z[0], z2 = z[1];
+
+            for (int f = 0; f < numFrames; ++f)
+            {
+                const double in  = (double) data[f];
+                const double out = c.b0 * in + z1;
+                z1 = c.b1 * in - c.a1 * out + z2;
+                z2 = c.b2 * in - c.a2 * out;
+                data[f] = (Sample) out;
+            }
+
+            z[0] = z1; z[1] = z2;
+        }
+    }
+
+    const int numStages, numChannels;
+    HeapBlock<Coefficients> coefficients;
+    HeapBlock<double> state;
+};
+
+static int biquad_new (lua_State* L)
+{
+    const int stages   = (int) luaL_optinteger (L, 1, 1);
+    const int channels = (int) luaL_optinteger (L, 2, 2);
+    luaL_argcheck (L, stages > 0 && stages <= 64, 1, "stages must be 1-64");
+    luaL_argcheck (L, channels > 0 && channels <= 128, 2, "channels must be 1-128");
+    newObject<Biquad> (L, EL_DSP_BIQUAD, stages, channels);
+    return 1;
+}
+
+static Biquad* checkBiquad (lua_State* L)   { return checkObject<Biquad> (L, 1, EL_DSP_BIQUAD); }
+
+static int checkStage (lua_State* L, const Biquad& biquad)
+{
+    const int stage = (int) luaL_checkinteger (L, 2);
+    luaL_argcheck (L, stage >= 1 && stage <= biquad.numStages, 2, "stage out of range");
+    return stage - 1;
+}
+
+namespace BiquadShape {
+    enum { LowPass, HighPass, BandPass, Notch, AllPass, Peak, LowShelf, HighShelf };
+}
+
+/** Audio EQ Cookbook (R. Bristow-Johnson) designs */
+template<int shape>
+static int biquad_design (lua_State* L)
+{
+    auto* const self = checkBiquad (L);
+    const int stage = checkStage (L, *self);
+    const double rate = luaL_checknumber (L, 3);
+    const double freq = luaL_checknumber (L, 4);
+    const double q    = luaL_optnumber (L, 5, 0.70710678118654752);
+    const double db   = luaL_optnumber (L, 6, 0.0);
+    luaL_argcheck (L, rate > 0.0, 3, "rate must be positive");
+    luaL_argcheck (L, q > 0.0, 5, "q must be positive");
+
+    const double w0 = MathConstants<double>::twoPi * jlimit (1.0, rate * 0.499, freq) / rate;
+    const double cosw = std::cos (w0);
+    const double alpha = std::sin (w0) / (2.0 * q);
+    const double A = std::pow (10.0, db / 40.0);
+    const double beta = 2.0 * std::sqrt (A) * alpha;
+
+    switch (shape)
+    {
+        case BiquadShape::LowPass:
+            self->set (stage, (1.0 - cosw) * 0.5, 1.0 - cosw, (1.0 - cosw) * 0.5,
+                       1.0 + alpha, -2.0 * cosw, 1.0 - alpha);
+            break;
+        case BiquadShape::HighPass:
+            self->set (stage, (1.0 + cosw) * 0.5, -(1.0 + cosw), (1.0 + cosw) * 0.5,
+                       1.0 + alpha, -2.0 * cosw, 1.0 - alpha);
+            break;
+        case BiquadShape::BandPass:
+            self->set (stage, alpha, 0.0, -alpha,
+                       1.0 + alpha, -2.0 * cosw, 1.0 - alpha);
+            break;
+        case BiquadShape::Notch:
+            self->set (stage, 1.0, -2.0 * cosw, 1.0,
+                       1.0 + alpha, -2.0 * cosw, 1.0 - alpha);
+            break;
+        case BiquadShape::AllPass:
+            self->set (stage, 1.0 - alpha, -2.0 * cosw, 1.0 + alpha,
+                       1.0 + alpha, -2.0 * cosw, 1.0 - alpha);
+            break;
+        case BiquadShape::Peak:
+            self->set (stage, 1.0 + alpha * A, -2.0 * cosw, 1.0 - alpha * A,
+                       1.0 + alpha / A, -2.0 * cosw, 1.0 - alpha / A);
+            break;
+        case BiquadShape::LowShelf:
+            self->set (stage,
+                       A * ((A + 1.0) - (A - 1.0) * cosw + beta),
+                       2.0 * A * ((A - 1.0) - (A + 1.0) * cosw),
+                       A * ((A + 1.0) - (A - 1.0) * cosw - beta),
+                       (A + 1.0) + (A - 1.0) * cosw + beta,
+                       -2.0 * ((A - 1.0) + (A + 1.0) * cosw),
+                       (A + 1.0) + (A - 1.0) * cosw - beta);
+            break;
+        case BiquadShape::HighShelf:
+            self->set (stage,
+                       A * ((A + 1.0) + (A - 1.0) * cosw + beta),
+                       -2.0 * A * ((A - 1.0) + (A + 1.0) * cosw),
+                       A * ((A + 1.0) + (A - 1.0) * cosw - beta),
+                       (A + 1.0) - (A - 1.0) * cosw + beta,
+                       2.0 * ((A - 1.0) - (A + 1.0) * cosw),
+                       (A + 1.0) - (A - 1.0) * cosw - beta);
+            break;
+    }
+
+    return 0;
+}
+
+static int biquad_set (lua_State* L)
+{
+    auto* const self = checkBiquad (L);
+    const int stage = checkStage (L, *self);
+    self->set (stage, luaL_checknumber (L, 3), luaL_checknumber (L, 4), luaL_checknumber (L, 5),
+               1.0, luaL_checknumber (L, 6), luaL_checknumber (L, 7));
+    return 0;
+}
+
+static int biquad_process (lua_State* L)
+{
+    auto* const self = checkBiquad (L);
+    const auto ch = checkChannels (L, 2);
+    for (int c = ch.start; c < jmin (ch.end, self->numChannels); ++c)
+        self->process (ch.data[c], c, ch.numFrames);
+    return 0;
+}
+
+static int biquad_reset (lua_State* L)      { checkBiquad (L)->reset(); return 0; }
+static int biquad_stages (lua_State* L)     { lua_pushinteger (L, checkBiquad (L)->numStages); return 1; }
+
+static const luaL_Reg biquad_methods[] = {
+    { "lowpass",    biquad_design<BiquadShape::LowPass> },
+    { "highpass",   biquad_design<BiquadShape::HighPass> },
+    { "bandpass",   biquad_design<BiquadShape::BandPass> },
+    { "notch",      biquad_design<BiquadShape::Notch> },
+    { "allpass",    biquad_design<BiquadShape::AllPass> },
+    { "peak",       biquad_design<BiquadShape::Peak> },
+    { "lowshelf",   biquad_design<BiquadShape::LowShelf> },
+    { "highshelf",  biquad_design<BiquadShape::HighShelf> },
+    { "set",        biquad_set },
+    { "process",    biquad_process },
+    { "reset",      biquad_reset },
+    { "stages",     biquad_stages },
+    { nullptr, nullptr }
+};
+
+//==============================================================================
+/** Fractional delay line with feedback, one ring per channel */
+struct Delay
+{
+    Delay (int maxDelay, int channels)
+        : numChannels (channels)
+    {
+        size = nextPowerOfTwo (maxDelay + 2);
+        mask = size - 1;
+        lines.allocate ((size_t) (size * numChannels), true);
+        writePos.allocate ((size_t) numChannels, true);
+    }
+
+    void reset() noexcept
+    {
+        zeromem (lines.get(), sizeof (Sample) * (size_t) (size * numChannels));
+        zeromem (writePos.get(), sizeof (int) * (size_t) numChannels);
+    }
+
+    void process (Sample* data, int channel, int numFrames,
+                  double delay, Sample feedback, Sample mix) noexcept
+    {
+        delay = jlimit (1.0, (double) (size - 2), delay);
+        const int whole = (int) delay;
+        const auto frac = (Sample) (delay - (double) whole);
+        const Sample dry = (Sample) 1 - mix;
+
+        Sample* const line = lines.get() + channel * size;
+        int pos = writePos [channel];
+
+        for (int f = 0; f < numFrames; ++f)
+        {
+            const Sample a = line [(pos - whole) & mask];
+            const Sample b = line [(pos - whole - 1) & mask];
+            const Sample delayed = a + frac * (b - a);
+            const Sample in = data[f];
+
+            line [pos] = in + delayed * feedback;
+            data[f] = in * dry + delayed * mix;
+            pos = (pos + 1) & mask;
+        }
+
+        writePos [channel] = pos;
+    }
+
+    const int numChannels;
+    int size = 0, mask = 0;
+    HeapBlock<Sample> lines;
+    HeapBlock<int> writePos;
+};
+
+static Delay* checkDelay (lua_State* L)     { return checkObject<Delay> (L, 1, EL_DSP_DELAY); }
+
+static int delay_new (lua_State* L)
+{
+    const int maxDelay = (int) luaL_checkinteger (L, 1);
+    const int channels = (int) luaL_optinteger (L, 2, 2);
+    luaL_argcheck (L, maxDelay > 0 && maxDelay <= (1 << 24), 1, "max delay must be 1-16777216 samples");
+    luaL_argcheck (L, channels > 0 && channels <= 128, 2, "channels must be 1-128");
+    newObject<Delay> (L, EL_DSP_DELAY, maxDelay, channels);
+    return 1;
+}
+
+static int delay_process (lua_State* L)
+{
+    auto* const self = checkDelay (L);
+    const auto ch = checkChannels (L, 2);
+    const double delay    = luaL_checknumber (L, 4);
+    const auto feedback   = (Sample) luaL_optnumber (L, 5, 0.0);
+    const auto mix        = (Sample) luaL_optnumber (L, 6, 1.0);
+
+    for (int c = ch.start; c < jmin (ch.end, self->numChannels); ++c)
+        self->process (ch.data[c], c, ch.numFrames, delay, feedback, mix);
+    return 0;
+}
+
+static int delay_reset (lua_State* L)       { checkDelay (L)->reset(); return 0; }
+static int delay_size (lua_State* L)        { lua_pushinteger (L, checkDelay (L)->size - 2); return 1; }
+
+static const luaL_Reg delay_methods[] = {
+    { "process",    delay_process },
+    { "reset",      delay_reset },
+    { "size",       delay_size },
+    { nullptr, nullptr }
+};
+
+//==============================================================================
+/** Peak envelope follower with separate attack and release */
+struct Follower
+{
+    explicit Follower (int channels)
+        : numChannels (channels)
+    {
+        levels.allocate ((size_t) numChannels, true);
+    }
+
+    void set (double rate, double attackMs, double releaseMs) noexcept
+    {
+        attack  = (Sample) std::exp (-1.0 / (jmax (0.01, attackMs)  * 0.001 * rate));
+        release = (Sample) std::exp (-1.0 / (jmax (0.01, releaseMs) * 0.001 * rate));
+    }
+
+    Sample process (const Sample* data, Sample* envelope, int channel, int numFrames) noexcept
+    {
+        Sample level = levels [channel];
+        for (int f = 0; f < numFrames; ++f)
+        {
+            const Sample in = std::abs (data[f]);
+            const Sample coeff = in > level ? attack : release;
+            level = in + coeff * (level - in);
+            if (envelope != nullptr)
+                envelope[f] = level;
+        }
+
+        levels [channel] = level;
+        return level;
+    }
+
+    const int numChannels;
+    Sample attack = 0, release = 0;
+    HeapBlock<Sample> levels;
+};
+
+static Follower* checkFollower (lua_State* L)   { return checkObject<Follower> (L, 1, EL_DSP_FOLLOWER); }
+
+static int follower_new (lua_State* L)
+{
+    const int channels = (int) luaL_optinteger (L, 1, 2);
+    luaL_argcheck (L, channels > 0 && channels <= 128, 1, "channels must be 1-128");
+    auto* const self = newObject<Follower> (L, EL_DSP_FOLLOWER, channels);
+    self->set (44100.0, 10.0, 100.0);
+    return 1;
+}
+
+static int follower_set (lua_State* L)
+{
+    auto* const self = checkFollower (L);
+    const double rate = luaL_checknumber (L, 2);
+    luaL_argcheck (L, rate > 0.0, 2, "rate must be positive");
+    self->set (rate, luaL_checknumber (L, 3), luaL_checknumber (L, 4));
+    return 0;
+}
+
+/** follower:process (buffer, channel [, envelope, channel]) -> level
+    Returns the highest level of the selected channels. When an envelope
+    buffer is given, the envelope of each channel is written to it */
+static int follower_process (lua_State* L)
+{
+    auto* const self = checkFollower (L);
+    const auto ch = checkChannels (L, 2);
+    const bool hasEnvelope = ! lua_isnoneornil (L, 4);
+    Channels env {};
+    if (hasEnvelope)
+        env = checkChannels (L, 4);
+
+    Sample peak = 0;
+    for (int c = ch.start; c < jmin (ch.end, self->numChannels); ++c)
+    {
+        Sample* envelope = nullptr;
+        if (hasEnvelope)
+        {
+            const int e = sourceChannel (env, c);
+            if (e < env.end && env.numFrames >= ch.numFrames)
+                envelope = env.data[e];
+        }
+
+        peak = jmax (peak, self->process (ch.data[c], envelope, c, ch.numFrames));
+    }
+
+    lua_pushnumber (L, (lua_Number) peak);
+    return 1;
+}
+
+static int follower_level (lua_State* L)
+{
+    auto* const self = checkFollower (L);
+    const int channel = (int) luaL_checkinteger (L, 2);
+    luaL_argcheck (L, channel >= 1 && channel <= self->numChannels, 2, "channel out of range");
+    lua_pushnumber (L, (lua_Number) self->levels [channel - 1]);
+    return 1;
+}
+
+static int follower_reset (lua_State* L)
+{
+    auto* const self = checkFollower (L);
+    zeromem (self->levels.get(), sizeof (Sample) * (size_t) self->numChannels);
+    return 0;
+}
+
+static const luaL_Reg follower_methods[] = {
+    { "set",        follower_set },
+    { "process",    follower_process },
+    { "level",      follower_level },
+    { "reset",      follower_reset },
+    { nullptr, nullptr }
+};
+
+//==============================================================================
+/** Table for lookups and waveshaping, with a guard point for interpolation */
+struct Table
+{
+    explicit Table (int numValues)
+        : size (numValues)
+    {
+        values.allocate ((size_t) size + 1, true);
+    }
+
+    int size;
+    HeapBlock<Sample> values;
+};
+
+static Table* checkTable (lua_State* L, int arg = 1)    { return checkObject<Table> (L, arg, EL_DSP_TABLE); }
+
+static int table_new (lua_State* L)
+{
+    const int size = (int) luaL_checkinteger (L, 1);
+    luaL_argcheck (L, size >= 2 && size <= (1 << 24), 1, "size must be 2-16777216");
+    newObject<Table> (L, EL_DSP_TABLE, size);
+    return 1;
+}
+
+static int checkIndex (lua_State* L, const Table& table)
+{
+    const int index = (int) luaL_checkinteger (L, 2);
+    luaL_argcheck (L, index >= 1 && index <= table.size, 2, "index out of range");
+    return index - 1;
+}
+
+static int table_set (lua_State* L)
+{
+    auto* const self = checkTable (L);
+    const int index = checkIndex (L, *self);
+    self->values [index] = (Sample) luaL_checknumber (L, 3);
+    if (index == self->size - 1)
+        self->values [self->size] = self->values [index];
+    return 0;
+}
+
+static int table_get (lua_State* L)
+{
+    auto* const self = checkTable (L);
+    lua_pushnumber (L, (lua_Number) self->values [checkIndex (L, *self)]);
+    return 1;
+}
+
+/** table:fill (function (x) ... end) with x from 0 to 1. Calls into Lua
+    for every value, so do this outside of node_render() */
+static int table_fill (lua_State* L)
+{
+    auto* const self = checkTable (L);
+    luaL_checktype (L, 2, LUA_TFUNCTION);
+    for (int i = 0; i < self->size; ++i)
+    {
+        lua_pushvalue (L, 2);
+        lua_pushnumber (L, (lua_Number) i / (lua_Number) (self->size - 1));
+        lua_call (L, 1, 1);
+        self->values [i] = (Sample) luaL_checknumber (L, -1);
+        lua_pop (L, 1);
+    }
+
+    self->values [self->size] = self->values [self->size - 1];
+    return 0;
+}
+
+/** table:lookup (buffer, channel [, min, max]) replaces each sample with
+    the interpolated table value, mapping min..max (default -1..1) across the
+    table and clamping outside it */
+static int table_lookup (lua_State* L)
+{
+    auto* const self = checkTable (L);
+    const auto ch = checkChannels (L, 2);
+    const auto lo = (Sample) luaL_optnumber (L, 4, -1.0);
+    const auto hi = (Sample) luaL_optnumber (L, 5, 1.0);
+    luaL_argcheck (L, hi > lo, 5, "max must be greater than min");
+
+    const auto last  = (Sample) (self->size - 1);
+    const auto scale = last / (hi - lo);
+    const Sample* const values = self->values.get();
+
+    for (int c = ch.start; c < ch.end; ++c)
+    {
+        auto* const data = ch.data[c];
+        for (int f = 0; f < ch.numFrames; ++f)
+        {
+            const Sample pos = jlimit ((Sample) 0, last, (data[f] - lo) * scale);
+            const int i = (int) pos;
+            const Sample alpha = pos - (Sample) i;
+            data[f] = values[i] + alpha * (values[i + 1] - values[i]);
+        }
+    }
+
+    return 0;
+}
+
+static int table_size (lua_State* L)    { lua_pushinteger (L, checkTable (L)->size); return 1; }
+
+static const luaL_Reg table_methods[] = {
+    { "set",        table_set },
+    { "get",        table_get },
+    { "fill",       table_fill },
+    { "lookup",     table_lookup },
+    { "size",       table_size },
+    { nullptr, nullptr }
+};
+
+//==============================================================================
+/** Real FFT holding one frame of N/2 + 1 complex bins. Transforms go
+    through the complex FFT with buffers allocated here, the real only
+    calls of the fallback engine allocate scratch at large orders. */
+struct FFT
+{
+    using Complex = juce::dsp::Complex<float>;
+
+    explicit FFT (int order)
+        : fft (order), size (1 << order)
+    {
+        data.allocate ((size_t) size * 2, true);
+        input.allocate ((size_t) size, true);
+        output.allocate ((size_t) size, true);
+    }
+
+    void forward()
+    {
+        for (int i = 0; i < size; ++i)
+            input[i] = Complex (data[i], 0.f);
+        fft.perform (input, output, false);
+        for (int i = 0; i < numBins(); ++i)
+        {
+            data[i * 2]     = output[i].real();
+            data[i * 2 + 1] = output[i].imag();
+        }
+    }
+
+    /** Leaves the time domain signal in the real parts of output */
+    void inverse()
+    {
+        for (int i = 0; i < numBins(); ++i)
+            input[i] = Complex (data[i * 2], data[i * 2 + 1]);
+        for (int i = numBins(); i < size; ++i)
+            input[i] = std::conj (input[size - i]);
+        fft.perform (input, output, true);
+    }
+
+    juce::dsp::FFT fft;
+    const int size;
+    HeapBlock<float> data;      // interleaved re/im
+    HeapBlock<Complex> input, output;
+    int numBins() const noexcept { return size / 2 + 1; }
+};
+
+static FFT* checkFFT (lua_State* L, int arg = 1)    { return checkObject<FFT> (L, arg, EL_DSP_FFT); }
+
+static int fft_new (lua_State* L)
+{
+    const int order = (int) luaL_checkinteger (L, 1);
+    luaL_argcheck (L, order >= 4 && order <= 16, 1, "order must be 4-16");
+    newObject<FFT> (L, EL_DSP_FFT, order);
+    return 1;
+}
+
+/** fft:forward (buffer, channel [, window]) transforms the first N frames of
+    the channel, zero padding short buffers. A Table of N values is applied
+    as a window */
+static int fft_forward (lua_State* L)
+{
+    auto* const self = checkFFT (L);
+    const auto ch = checkChannels (L, 2);
+    luaL_argcheck (L, ch.end - ch.start == 1, 3, "a single channel is required");
+
+    const int numFrames = jmin (ch.numFrames, self->size);
+    float* const data = self->data.get();
+    for (int f = 0; f < numFrames; ++f)
+        data[f] = (float) ch.data[ch.start][f];
+    FloatVectorOperations::clear (data + numFrames, self->size * 2 - numFrames);
+
+    if (! lua_isnoneornil (L, 4))
+    {
+        auto* const window = checkTable (L, 4);
+        luaL_argcheck (L, window->size == self->size, 4, "window size must match the FFT");
+        for (int f = 0; f < numFrames; ++f)
+            data[f] *= (float) window->values[f];
+    }
+
+    self->forward();
+    return 0;
+}
+
+/** fft:inverse (buffer, channel) writes the time domain signal of the
+    current bins, scaled so forward then inverse is unity */
+static int fft_inverse (lua_State* L)
+{
+    auto* const self = checkFFT (L);
+    const auto ch = checkChannels (L, 2);
+    luaL_argcheck (L, ch.end - ch.start == 1, 3, "a single channel is required");
+
+    self->inverse();
+
+    const int numFrames = jmin (ch.numFrames, self->size);
+    for (int f = 0; f < numFrames; ++f)
+        ch.data[ch.start][f] = (Sample) self->output[f].real();
+    return 0;
+}
+
+static int fft_magnitudes (lua_State* L)
+{
+    auto* const self = checkFFT (L);
+    const auto ch = checkChannels (L, 2);
+    luaL_argcheck (L, ch.end - ch.start == 1, 3, "a single channel is required");
+
+    const float* const data = self->data.get();
+    const int numBins = jmin (ch.numFrames, self->numBins());
+    for (int i = 0; i < numBins; ++i)
+        ch.data[ch.start][i] = (Sample) std::sqrt (data[i * 2] * data[i * 2] + data[i * 2 + 1] * data[i * 2 + 1]);
+    return 0;
+}
+
+static int checkBin (lua_State* L, const FFT& fft)
+{
+    const int bin = (int) luaL_checkinteger (L, 2);
+    luaL_argcheck (L, bin >= 1 && bin <= fft.numBins(), 2, "bin out of range");
+    return bin - 1;
+}
+
+static int fft_bin (lua_State* L)
+{
+    auto* const self = checkFFT (L);
+    const int bin = checkBin (L, *self);
+    lua_pushnumber (L, (lua_Number) self->data [bin * 2]);
+    lua_pushnumber (L, (lua_Number) self->data [bin * 2 + 1]);
+    return 2;
+}
+
+static int fft_setbin (lua_State* L)
+{
+    auto* const self = checkFFT (L);
+    const int bin = checkBin (L, *self);
+    self->data [bin * 2]     = (float) luaL_checknumber (L, 3);
+    self->data [bin * 2 + 1] = (float) luaL_optnumber (L, 4, 0.0);
+    return 0;
+}
+
+/** fft:multiply (other) complex multiplies the bins by another FFT's bins,
+    for fast convolution */
+static int fft_multiply (lua_State* L)
+{
+    auto* const self = checkFFT (L);
+    auto* const other = checkFFT (L, 2);
+    luaL_argcheck (L, other->size == self->size, 2, "FFT sizes must match");
+
+    float* const a = self->data.get();
+    const float* const b = other->data.get();
+    for (int i = 0; i < self->numBins(); ++i)
+    {
+        const float re = a[i * 2] * b[i * 2] - a[i * 2 + 1] * b[i * 2 + 1];
+        const float im = a[i * 2] * b[i * 2 + 1] + a[i * 2 + 1] * b[i * 2];
+        a[i * 2] = re;
+        a[i * 2 + 1] = im;
+    }
+
+    return 0;
+}
+
+static int fft_size (lua_State* L)      { lua_pushinteger (L, checkFFT (L)->size); return 1; }
+static int fft_bins (lua_State* L)      { lua_pushinteger (L, checkFFT (L)->numBins()); return 1; }
+
+static const luaL_Reg fft_methods[] = {
+    { "forward",    fft_forward },
+    { "inverse",    fft_inverse },
+    { "magnitudes", fft_magnitudes },
+    { "bin",        fft_bin },
+    { "setbin",     fft_setbin },
+    { "multiply",   fft_multiply },
+    { "size",       fft_size },
+    { "bins",       fft_bins },
+    { nullptr, nullptr }
+};
+
+//==============================================================================
+static void registerType (lua_State* L, const char* name, const luaL_Reg* methods, lua_CFunction gc)
+{
+    luaL_newmetatable (L, name);
+    lua_pushvalue (L, -1);
+    lua_setfield (L, -2, "__index");
+    lua_pushcfunction (L, gc);
+    lua_setfield (L, -2, "__gc");
+    luaL_setfuncs (L, methods, 0);
+    lua_pop (L, 1);
+}
+
+static const luaL_Reg dsp_functions[] = {
+    { "gain",           dsp_gain },
+    { "ramp",           dsp_ramp },
+    { "mix",            dsp_mix },
+    { "copy",           dsp_copy },
+    { "interpolate",    dsp_interpolate },
+    { "Biquad",         biquad_new },
+    { "Delay",          delay_new },
+    { "Follower",       follower_new },
+    { "FFT",            fft_new },
+    { "Table",          table_new },
+    { nullptr, nullptr }
+};
+
+int openDSPKernels (lua_State* L)
+{
+    // remember the buffer metatable so arguments can be checked without
+    // depending on the name lua-kv registers it under
+    kv_audio_buffer_new (L, 0, 0);
+    if (lua_getmetatable (L, -1))
+        lua_rawsetp (L, LUA_REGISTRYINDEX, &bufferMetatableKey);
+    lua_pop (L, 1);
+
+    registerType (L, EL_DSP_BIQUAD,     biquad_methods,     destroyObject<Biquad>);
+    registerType (L, EL_DSP_DELAY,      delay_methods,      destroyObject<Delay>);
+    registerType (L, EL_DSP_FOLLOWER,   follower_methods,   destroyObject<Follower>);
+    registerType (L, EL_DSP_FFT,        fft_methods,        destroyObject<FFT>);
+    registerType (L, EL_DSP_TABLE,      table_methods,      destroyObject<Table>);
+
+    luaL_newlib (L, dsp_functions);
+    return 1;
+}
+
+}}
@@ -0,0 +1,67 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software; you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation; either version 2 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program; if not, write to the Free Software
+    Foundation, Inc., 675 Mass Ave, Cambridge, MA 02139, USA.
+*/
+
+#pragma once
+
+struct lua_State;
+
+namespace Element {
+namespace Lua {
+
+/** Opens the `element.dsp` module: block processing kernels which work on
+    whole channels of a kv.audio.Buffer in place.
+
+    @code
+    local dsp = require ('element.dsp')
+
+    -- channel 0 means every channel in the buffer
+    dsp.gain (buffer, 0, 0.5)
+    dsp.ramp (buffer, 1, start_gain, end_gain)
+    dsp.mix (dst, 1, src, 2, 0.7)
+    dsp.copy (dst, 2, src, 1)
+    phase = dsp.interpolate (dst, 1, src, 1, ratio, phase)
+
+    -- stateful kernels, create them outside node_render()
+    local eq = dsp.Biquad (2, 2)    -- stages, channels
+    eq:lowpass (1, rate, 1000, 0.707)
+    eq:peak (2, rate, 3000, 1.0, 6.0)
+    eq:process (buffer, 0)
+
+    local delay = dsp.Delay (rate, 2)          -- max samples, channels
+    delay:process (buffer, 0, 0.25 * rate, 0.4, 0.5)   -- delay, feedback, mix
+
+    local env = dsp.Follower (2)
+    env:set (rate, 5, 100)                      -- attack, release ms
+    local level = env:process (buffer, 1)
+
+    local fft = dsp.FFT (10)                    -- order, 1024 points
+    fft:forward (buffer, 1)
+    fft:magnitudes (spectrum, 1)
+    fft:inverse (buffer, 1)
+
+    local shape = dsp.Table (512)
+    shape:fill (function (x) return math.tanh (4 * (2 * x - 1)) end)
+    shape:lookup (buffer, 0)                    -- waveshape -1..1
+    @endcode
+
+    Kernels never allocate. Objects allocate once when they are created.
+ */
+int openDSPKernels (lua_State* L);
+
+}}
@@ -85,6 +85,8 @@ public:
 
         bool isNoteEvent() const        { return getProperty("eventType").toString() == "note"; }
         bool isControllerEvent() const  { return getProperty("eventType").toString() == "controller"; }
+        bool isNrpnEvent() const        { return getProperty("eventType").toString() == "nrpn"; }
+        bool isRpnEvent() const         { return getProperty("eventType").toString() == "rpn"; }
         int getEventId() const          { return (int)  getProperty ("eventId", 0); }
         
         bool isMomentary() const        { return (bool) getProperty ("momentary", false); }
@@ -93,6 +95,12 @@ public:
         Value getToggleValueObject()    { return getPropertyAsValue ("toggleValue"); }
         bool inverseToggle() const      { return (bool) getProperty ("inverseToggle", false); }
         Value getInverseToggleObject()  { return getPropertyAsValue ("inverseToggle"); }
+        int getSmoothingTime() const    { return (int)  getProperty ("smoothing", 0); }
+        Value getSmoothingTimeObject()  { return getPropertyAsValue ("smoothing"); }
+
+        /** True if a controller 0-31 should be paired with its LSB (32-63) */
+        bool isHighResolution() const       { return (bool) getProperty ("highResolution", false); }
+        Value getHighResolutionObject()     { return getPropertyAsValue ("highResolution"); }
         
         static ControllerDevice::ControlToggleMode getToggleMode (const String& str)
         {
@@ -153,6 +161,8 @@ public:
             stabilizePropertyPOD (Tags::midiChannel, 0);
             stabilizePropertyPOD ("toggleValue", 64);
             stabilizePropertyPOD ("inverseToggle", false);
+            stabilizePropertyPOD ("smoothing", 0);
+            stabilizePropertyPOD ("highResolution", false);
             stabilizePropertyString ("toggleMode", "eqorhi");
         }
     };
@@ -0,0 +1,77 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "scripting/LuaBytecodeCache.h"
+#include "sol/sol.hpp"
+
+using namespace Element;
+
+class LuaBytecodeCacheTest : public UnitTestBase
+{
+public:
+    LuaBytecodeCacheTest() : UnitTestBase ("Lua Bytecode Cache", "Lua", "bytecode") { }
+    virtual ~LuaBytecodeCacheTest() { }
+
+    void runTest() override
+    {
+        const String source ("value = 40 + 2");
+
+        beginTest ("memory");
+        {
+            LuaBytecodeCache cache;
+            MemoryBlock first, second;
+            expect (cache.compile (source, first).wasOk());
+            expect (cache.compile (source, second).wasOk());
+            expect (first == second);
+            expectEquals (cache.getNumMisses(), 1);
+            expectEquals (cache.getNumHits(), 1);
+        }
+
+        beginTest ("syntax error");
+        {
+            LuaBytecodeCache cache;
+            MemoryBlock bytecode;
+            const auto result = cache.compile ("value = = 1", bytecode);
+            expect (result.failed());
+            expect (result.getErrorMessage().isNotEmpty());
+        }
+
+        beginTest ("load");
+        {
+            LuaBytecodeCache cache;
+            sol::state lua;
+            expect (cache.load (lua.lua_state(), source) == LUA_OK);
+            expect (lua_pcall (lua.lua_state(), 0, 0, 0) == LUA_OK);
+            expectEquals ((int) lua["value"], 42);
+        }
+
+        beginTest ("clear");
+        {
+            LuaBytecodeCache cache;
+            MemoryBlock bytecode;
+            expect (cache.compile (source, bytecode).wasOk());
+            cache.clear();
+            expect (cache.compile (source, bytecode).wasOk());
+            expectEquals (cache.getNumMisses(), 2);
+            expectEquals (cache.getNumHits(), 0);
+        }
+    }
+};
+
+static LuaBytecodeCacheTest sLuaBytecodeCacheTest;
@@ -0,0 +1,156 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "scripting/LuaBindings.h"
+#include "sol/sol.hpp"
+
+using namespace Element;
+
+static const String kernelsScript = R"(
+local audio = require ('kv.audio')
+local dsp   = require ('element.dsp')
+
+local function fill (a, c, value)
+    local v = a:vector (c)
+    for f = 1, a:length() do v[f] = value end
+end
+
+local a = audio.Buffer (2, 64)
+local b = audio.Buffer (2, 64)
+
+-- gain and ramp
+fill (a, 1, 1.0); fill (a, 2, 1.0)
+dsp.gain (a, 0, 0.5)
+gain_1 = a:vector(1)[10]
+gain_2 = a:vector(2)[10]
+
+fill (a, 1, 1.0)
+dsp.ramp (a, 1, 0.0, 1.0)
+ramp_first = a:vector(1)[1]
+ramp_last  = a:vector(1)[64]
+
+-- mix and copy
+fill (a, 1, 1.0); fill (b, 1, 2.0)
+dsp.mix (a, 1, b, 1, 0.5)
+mix_value = a:vector(1)[5]
+dsp.copy (a, 0, b, 1)
+copy_value = a:vector(2)[5]
+
+-- a lowpass passes DC
+local lp = dsp.Biquad (2, 1)
+lp:lowpass (1, 44100, 1000)
+lp:lowpass (2, 44100, 1000)
+for _ = 1, 64 do
+    fill (a, 1, 1.0)
+    lp:process (a, 1)
+end
+lowpass_dc = a:vector(1)[64]
+
+-- delay moves an impulse
+local delay = dsp.Delay (32, 1)
+fill (a, 1, 0.0)
+a:vector(1)[1] = 1.0
+delay:process (a, 1, 10)
+delay_before = a:vector(1)[11]
+delay_after  = a:vector(1)[12]
+
+-- follower rises toward the input
+local env = dsp.Follower (1)
+env:set (44100, 0.1, 100)
+fill (a, 1, 1.0)
+follower_level = env:process (a, 1)
+
+-- fft round trip
+local fft = dsp.FFT (6)
+for f = 1, 64 do a:vector(1)[f] = math.sin (2 * math.pi * 4 * (f - 1) / 64) end
+fft:forward (a, 1)
+local re, im = fft:bin (5)
+fft_peak = math.sqrt (re * re + im * im)
+fill (b, 1, 0.0)
+fft:inverse (b, 1)
+fft_error = 0
+for f = 1, 64 do fft_error = math.max (fft_error, math.abs (a:vector(1)[f] - b:vector(1)[f])) end
+
+-- table lookup squares the input
+local t = dsp.Table (257)
+t:fill (function (x) return x * x end)
+fill (a, 1, 0.5)
+t:lookup (a, 1, 0.0, 1.0)
+lookup_value = a:vector(1)[1]
+
+-- half speed interpolation
+for f = 1, 64 do b:vector(1)[f] = f - 1 end
+interp_phase = dsp.interpolate (a, 1, b, 1, 0.5)
+interp_value = a:vector(1)[4]
+
+-- a negative phase reads around from the end
+dsp.interpolate (a, 1, b, 1, 1.0, -0.5)
+interp_wrapped = a:vector(1)[1]
+)";
+
+class LuaDSPTest : public UnitTestBase
+{
+public:
+    LuaDSPTest() : UnitTestBase ("Lua DSP Kernels", "Lua", "dsp") { }
+    virtual ~LuaDSPTest() { }
+
+    void initialise() override
+    {
+        lua.open_libraries();
+        Element::Lua::openLibs (lua);
+    }
+
+    void shutdown() override
+    {
+        lua.collect_garbage();
+    }
+
+    void runTest() override
+    {
+        beginTest ("kernels");
+        try {
+            lua.script (kernelsScript.toRawUTF8());
+        } catch (const std::exception& e) {
+            expect (false, e.what());
+            return;
+        }
+
+        expectWithinAbsoluteError ((double) lua["gain_1"], 0.5, 1.0e-6);
+        expectWithinAbsoluteError ((double) lua["gain_2"], 0.5, 1.0e-6);
+        expectWithinAbsoluteError ((double) lua["ramp_first"], 0.0, 1.0e-6);
+        expectWithinAbsoluteError ((double) lua["ramp_last"], 1.0, 1.0e-6);
+        expectWithinAbsoluteError ((double) lua["mix_value"], 2.0, 1.0e-6);
+        expectWithinAbsoluteError ((double) lua["copy_value"], 2.0, 1.0e-6);
+        expectWithinAbsoluteError ((double) lua["lowpass_dc"], 1.0, 1.0e-3);
+        expectWithinAbsoluteError ((double) lua["delay_before"], 1.0, 1.0e-6);
+        expectWithinAbsoluteError ((double) lua["delay_after"], 0.0, 1.0e-6);
+        expectGreaterThan ((double) lua["follower_level"], 0.99);
+        expectWithinAbsoluteError ((double) lua["fft_peak"], 32.0, 1.0e-3);
+        expectLessThan ((double) lua["fft_error"], 1.0e-4);
+        expectWithinAbsoluteError ((double) lua["lookup_value"], 0.25, 1.0e-4);
+        expectWithinAbsoluteError ((double) lua["interp_value"], 1.5, 1.0e-6);
+        expectWithinAbsoluteError ((double) lua["interp_phase"], -32.0, 1.0e-6);
+        expectWithinAbsoluteError ((double) lua["interp_wrapped"], 31.5, 1.0e-6);
+    }
+
+private:
+    sol::state lua;
+};
+
+static LuaDSPTest sLuaDSPTest;
@@ -0,0 +1,94 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/AudioFileCache.h"
+
+namespace Element {
+
+class AudioFileCacheTest : public UnitTestBase
+{
+public:
+    AudioFileCacheTest() : UnitTestBase ("Audio File Cache", "engine", "audioFileCache") { }
+    virtual ~AudioFileCacheTest() { }
+
+    void runTest() override
+    {
+        TemporaryFile temp (".wav");
+        writeWaveFile (temp.getFile(), 1000);
+
+        AudioFormatManager formats;
+        formats.registerBasicFormats();
+        AudioFileCache cache (formats);
+
+        beginTest ("miss");
+        expect (cache.find (temp.getFile()) == nullptr);
+        expectEquals ((int) cache.getStats().misses, 1);
+
+        beginTest ("preload");
+        cache.preload (temp.getFile());
+        for (int i = 0; i < 500 && cache.getStats().numEntries == 0; ++i)
+            Thread::sleep (10);
+        auto entry = cache.find (temp.getFile());
+        expect (entry != nullptr);
+        if (entry == nullptr)
+            return;
+        expectEquals ((int) cache.getStats().hits, 1);
+        expectEquals (entry->getBuffer().getNumSamples(), 1000);
+
+        beginTest ("reader");
+        std::unique_ptr<AudioFormatReader> reader (AudioFileCache::createReader (entry));
+        expect (AudioFileCache::isPreloaded (*reader));
+        AudioSampleBuffer buffer (2, 100);
+        reader->read (&buffer, 0, 100, 500, true, true);
+        expectWithinAbsoluteError (buffer.getSample (0, 0), 0.5f, 0.001f);
+        expectWithinAbsoluteError (buffer.getSample (1, 10), -0.51f, 0.001f);
+
+        beginTest ("eviction");
+        cache.setMemoryBudget (0);
+        expectEquals (cache.getStats().numEntries, 1);  // still playing
+        reader = nullptr;
+        entry = nullptr;
+        cache.setMemoryBudget (0);
+        expectEquals (cache.getStats().numEntries, 0);
+        expect (cache.getStats().bytesUsed == 0);
+    }
+
+private:
+    void writeWaveFile (const File& file, int numSamples)
+    {
+        // a ramp from 0 to 1 on the left and its negative on the right
+        AudioSampleBuffer buffer (2, numSamples);
+        for (int i = 0; i < numSamples; ++i)
+        {
+            buffer.setSample (0, i, (float) i / (float) numSamples);
+            buffer.setSample (1, i, -(float) i / (float) numSamples);
+        }
+
+        file.deleteFile();
+        WavAudioFormat wav;
+        std::unique_ptr<AudioFormatWriter> writer (wav.createWriterFor (
+            new FileOutputStream (file), 44100.0, 2, 32, {}, 0));
+        if (writer != nullptr)
+            writer->writeFromAudioSampleBuffer (buffer, 0, numSamples);
+    }
+};
+
+static AudioFileCacheTest sAudioFileCacheTest;
+
+}
@@ -0,0 +1,79 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/AudioFileStreamer.h"
+
+namespace Element {
+
+class AudioFileStreamerTest : public UnitTestBase
+{
+public:
+    AudioFileStreamerTest() : UnitTestBase ("Audio File Streamer", "engine", "audioFileStreamer") { }
+    virtual ~AudioFileStreamerTest() { }
+
+    void runTest() override
+    {
+        TemporaryFile temp (".wav");
+        writeWaveFile (temp.getFile(), 48000.0, 48000);
+
+        SharedResourcePointer<AudioFileStreamer> streamer;
+
+        beginTest ("memory mapped reader");
+        std::unique_ptr<AudioFormatReader> reader (streamer->createReaderFor (temp.getFile()));
+        expect (reader != nullptr);
+        if (reader == nullptr)
+            return;
+        expect (AudioFileStreamer::isMemoryMapped (*reader));
+        expect (reader->lengthInSamples == 48000);
+
+        beginTest ("read ahead");
+        const int small = AudioFileStreamer::getReadAheadSamples (*reader, 48000.0, 64);
+        const int large = AudioFileStreamer::getReadAheadSamples (*reader, 48000.0, 4096);
+        expect (isPowerOfTwo (small) && isPowerOfTwo (large));
+        expect (small >= 4800);
+        expect (large >= 4 * 4096);
+        expect (large >= small);
+
+        // playing a 48k file at 24k reads half as many source samples per block
+        const int slower = AudioFileStreamer::getReadAheadSamples (*reader, 24000.0, 8192);
+        expect (slower >= 4 * 8192 * 2);
+
+        beginTest ("threads");
+        expect (streamer->getNumThreads() > 0);
+        expect (streamer->getThread() != nullptr);
+    }
+
+private:
+    void writeWaveFile (const File& file, double sampleRate, int numSamples)
+    {
+        AudioSampleBuffer buffer (2, numSamples);
+        buffer.clear();
+        file.deleteFile();
+
+        WavAudioFormat wav;
+        std::unique_ptr<AudioFormatWriter> writer (wav.createWriterFor (
+            new FileOutputStream (file), sampleRate, 2, 16, {}, 0));
+        if (writer != nullptr)
+            writer->writeFromAudioSampleBuffer (buffer, 0, numSamples);
+    }
+};
+
+static AudioFileStreamerTest sAudioFileStreamerTest;
+
+}
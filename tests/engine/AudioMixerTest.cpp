@@ -0,0 +1,115 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/MixKernels.h"
+#include "engine/nodes/AudioMixerProcessor.h"
+
+namespace Element {
+
+class AudioMixerTest : public UnitTestBase
+{
+public:
+    AudioMixerTest() : UnitTestBase ("Audio Mixer", "engine", "audioMixer") { }
+    virtual ~AudioMixerTest() { }
+
+    void runTest() override
+    {
+        testKernels();
+        testMixer();
+    }
+
+private:
+    void testKernels()
+    {
+        beginTest ("mix kernels");
+        const int numSamples = 67;
+        HeapBlock<float> src (numSamples), dest (numSamples), expected (numSamples);
+        Random random (1);
+        for (int i = 0; i < numSamples; ++i)
+        {
+            src[i] = random.nextFloat() * 2.f - 1.f;
+            dest[i] = expected[i] = random.nextFloat();
+        }
+
+        float sumOfSquares = 0.f;
+        const float step = (0.25f - 1.f) / (float) numSamples;
+        for (int i = 0; i < numSamples; ++i)
+        {
+            const float y = src[i] * (1.f + step * (float) i);
+            expected[i] += y;
+            sumOfSquares += y * y;
+        }
+
+        const auto sum = MixKernels::mix (dest, src, numSamples, 1.f, 0.25f, false, true);
+        expectWithinAbsoluteError (sum, sumOfSquares, 0.0001f);
+        for (int i = 0; i < numSamples; ++i)
+            expectWithinAbsoluteError (dest[i], expected[i], 0.00001f);
+
+        MixKernels::mix (dest, src, numSamples, 0.5f, 0.5f, true, false);
+        for (int i = 0; i < numSamples; ++i)
+            expectWithinAbsoluteError (dest[i], src[i] * 0.5f, 0.00001f);
+    }
+
+    void testMixer()
+    {
+        // enough tracks to split across workers when there are any
+        beginTest ("mixer sums tracks");
+        const int numTracks = 16, blockSize = 256;
+        AudioMixerProcessor mixer (numTracks, 44100.0, blockSize);
+        expectEquals (mixer.getNumTracks(), numTracks);
+        mixer.prepareToPlay (44100.0, blockSize);
+
+        AudioSampleBuffer audio (mixer.getTotalNumInputChannels(), blockSize);
+        MidiBuffer midi;
+        for (int block = 0; block < 2; ++block)
+        {
+            for (int t = 0; t < numTracks; ++t)
+            {
+                FloatVectorOperations::fill (audio.getWritePointer (t * 2), (float) (t + 1), blockSize);
+                FloatVectorOperations::fill (audio.getWritePointer (t * 2 + 1), (float) -(t + 1), blockSize);
+            }
+            mixer.processBlock (audio, midi);
+        }
+
+        // the master ramps up from silence on the first block only
+        expectWithinAbsoluteError (audio.getSample (0, 100), 136.f, 0.001f);
+        expectWithinAbsoluteError (audio.getSample (1, 200), -136.f, 0.001f);
+
+        beginTest ("mute and gain");
+        mixer.setTrackMuted (15, true);
+        mixer.setTrackGain (0, 0.f);
+        expect (mixer.isTrackMuted (15));
+        for (int block = 0; block < 3; ++block)
+        {
+            for (int t = 0; t < numTracks; ++t)
+            {
+                FloatVectorOperations::fill (audio.getWritePointer (t * 2), (float) (t + 1), blockSize);
+                FloatVectorOperations::fill (audio.getWritePointer (t * 2 + 1), (float) -(t + 1), blockSize);
+            }
+            mixer.processBlock (audio, midi);
+        }
+        expectWithinAbsoluteError (audio.getSample (0, 10), 136.f - 16.f - 1.f, 0.001f);
+
+        mixer.releaseResources();
+    }
+};
+
+static AudioMixerTest sAudioMixerTest;
+
+}
@@ -0,0 +1,95 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/nodes/AudioRouterNode.h"
+
+namespace Element {
+
+class AudioRouterTest : public UnitTestBase
+{
+public:
+    AudioRouterTest() : UnitTestBase ("Audio Router", "engine", "audioRouter") { }
+    virtual ~AudioRouterTest() { }
+
+    void runTest() override
+    {
+        GraphNodePtr node = new AudioRouterNode (4, 4);
+        auto* router = dynamic_cast<AudioRouterNode*> (node.get());
+        router->setFadeLength (0.01);
+        router->prepareToRender (1000.0, blockSize);
+
+        beginTest ("default program");
+        renderBlock (*router);
+        renderBlock (*router);
+        for (int c = 0; c < 4; ++c)
+            expectWithinAbsoluteError (audio.getSample (c, blockSize - 1), (float) (c + 1), 0.0001f);
+
+        beginTest ("continuous gains");
+        router->setGain (0, 0, 0.f);
+        router->setGain (1, 0, 0.5f);
+        router->setGain (3, 2, 0.25f);
+        expectEquals (router->getGain (0, 0), 0.f);
+        expectEquals (router->getGain (1, 0), 0.5f);
+
+        // a 10 frame fade spans the first block into the second
+        renderBlock (*router);
+        expectWithinAbsoluteError (audio.getSample (0, 0), 1.f, 0.0001f);
+        renderBlock (*router);
+        expectWithinAbsoluteError (audio.getSample (0, blockSize - 1), 1.f, 0.0001f);
+        expectWithinAbsoluteError (audio.getSample (1, blockSize - 1), 2.f, 0.0001f);
+        expectWithinAbsoluteError (audio.getSample (2, blockSize - 1), 3.f + 1.f, 0.0001f);
+        expectWithinAbsoluteError (audio.getSample (3, blockSize - 1), 4.f, 0.0001f);
+
+        beginTest ("state restores gains");
+        MemoryBlock state;
+        router->getState (state);
+        GraphNodePtr other = new AudioRouterNode (4, 4);
+        auto* restored = dynamic_cast<AudioRouterNode*> (other.get());
+        restored->setState (state.getData(), (int) state.getSize());
+        expectEquals (restored->getGain (1, 0), 0.5f);
+        expectEquals (restored->getGain (3, 2), 0.25f);
+        expectEquals (restored->getGain (0, 0), 0.f);
+
+        beginTest ("unpatched outputs are silent");
+        router->setMatrixState (MatrixState (4, 4));
+        for (int i = 0; i < 3; ++i)
+            renderBlock (*router);
+        for (int c = 0; c < 4; ++c)
+            expectEquals (audio.getSample (c, 0), 0.f);
+    }
+
+private:
+    static const int blockSize = 8;
+    AudioSampleBuffer audio { 4, blockSize };
+    MidiBuffer midiBuffer;
+
+    void renderBlock (AudioRouterNode& router)
+    {
+        // each input is its channel number plus one
+        for (int c = 0; c < 4; ++c)
+            FloatVectorOperations::fill (audio.getWritePointer (c), (float) (c + 1), blockSize);
+        MidiBuffer* buffers[] = { &midiBuffer };
+        MidiPipe pipe (buffers, 1);
+        router.render (audio, pipe);
+    }
+};
+
+static AudioRouterTest sAudioRouterTest;
+
+}
@@ -0,0 +1,102 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/nodes/CompressorProcessor.h"
+
+namespace Element {
+
+class CompressorTest : public UnitTestBase
+{
+public:
+    CompressorTest() : UnitTestBase ("Compressor", "engine", "compressor") { }
+    virtual ~CompressorTest() { }
+
+    void runTest() override
+    {
+        beginTest ("independent channels");
+        {
+            CompressorProcessor comp (2);
+            setup (comp, 1);
+            run (comp, 1.f, 0.05f);
+            expectWithinAbsoluteError (output.getSample (0, blockSize - 1), std::pow (10.f, -0.75f), 0.002f);
+            expectWithinAbsoluteError (output.getSample (1, blockSize - 1), 0.05f, 0.0001f);
+            expectWithinAbsoluteError (comp.getInputLevelDB(), 0.f, 0.1f);
+            expect (comp.getGainReductionDB() < -14.f);
+        }
+
+        beginTest ("linked channels");
+        {
+            CompressorProcessor comp (2);
+            setup (comp, 0);
+            run (comp, 1.f, 0.05f);
+            const float gain = std::pow (0.525f / 0.1f, 0.25f - 1.f);
+            expectWithinAbsoluteError (output.getSample (0, blockSize - 1), gain, 0.002f);
+            expectWithinAbsoluteError (output.getSample (1, blockSize - 1), 0.05f * gain, 0.0002f);
+        }
+
+        beginTest ("blocks larger than prepared");
+        {
+            CompressorProcessor comp (2);
+            setup (comp, 1);
+            comp.prepareToPlay (44100.0, blockSize / 4);
+            run (comp, 1.f, 0.05f);
+            expectWithinAbsoluteError (output.getSample (0, blockSize - 1), std::pow (10.f, -0.75f), 0.002f);
+        }
+    }
+
+private:
+    static const int blockSize = 512;
+    AudioSampleBuffer output { 4, blockSize };
+
+    void setup (CompressorProcessor& comp, int linkIndex)
+    {
+        // -20 dB threshold at 4:1, so full scale comes out 15 dB down
+        for (auto* param : comp.getParameters())
+        {
+            if (auto* p = dynamic_cast<AudioParameterFloat*> (param))
+            {
+                if (p->paramID == "thresh")  *p = -20.f;
+                if (p->paramID == "ratio")   *p = 4.f;
+            }
+            else if (auto* c = dynamic_cast<AudioParameterChoice*> (param))
+            {
+                *c = linkIndex;
+            }
+        }
+
+        comp.prepareToPlay (44100.0, blockSize);
+    }
+
+    void run (CompressorProcessor& comp, float left, float right)
+    {
+        // a second of DC so the detector settles
+        MidiBuffer midi;
+        for (int block = 0; block < 100; ++block)
+        {
+            output.clear();
+            FloatVectorOperations::fill (output.getWritePointer (0), left, blockSize);
+            FloatVectorOperations::fill (output.getWritePointer (1), right, blockSize);
+            comp.processBlock (output, midi);
+        }
+    }
+};
+
+static CompressorTest sCompressorTest;
+
+}
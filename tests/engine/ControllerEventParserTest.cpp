@@ -0,0 +1,204 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/ControllerEventParser.h"
+
+namespace Element {
+
+class ControllerEventParserTest : public UnitTestBase
+{
+public:
+    ControllerEventParserTest() : UnitTestBase ("Controller Event Parser", "engine", "controllerEventParser") { }
+    virtual ~ControllerEventParserTest() { }
+
+    void runTest() override
+    {
+        testScaling();
+        test14BitController();
+        testNrpn();
+        testRpnNull();
+    }
+
+private:
+    ControllerEventParser parser;
+    Array<ControllerEvent> events;
+
+    double now = 0.0;
+
+    void send (int channel, int number, int value)
+    {
+        parser.process (MidiMessage::controllerEvent (channel, number, value), now,
+            [this](const ControllerEvent& event) { events.add (event); });
+    }
+
+    int count (ControllerEvent::Type type) const
+    {
+        int total = 0;
+        for (const auto& event : events)
+            if (event.type == type)
+                ++total;
+        return total;
+    }
+
+    const ControllerEvent* findLast (ControllerEvent::Type type) const
+    {
+        for (int i = events.size(); --i >= 0;)
+            if (events.getReference(i).type == type)
+                return &events.getReference (i);
+        return nullptr;
+    }
+
+    void testScaling()
+    {
+        beginTest ("scaling");
+        expect (ControllerEvent::scaleTo32Bit (0, 7) == 0u);
+        expect (ControllerEvent::scaleTo32Bit (64, 7) == 0x80000000u);
+        expect (ControllerEvent::scaleTo32Bit (127, 7) == 0xffffffffu);
+        expect (ControllerEvent::scaleTo32Bit (8192, 14) == 0x80000000u);
+        expect (ControllerEvent::scaleTo32Bit (16383, 14) == 0xffffffffu);
+    }
+
+    void test14BitController()
+    {
+        beginTest ("14-bit controller");
+        parser.reset();
+        events.clearQuick();
+
+        send (1, 7, 100);
+        expect (findLast (ControllerEvent::Controller14Bit) == nullptr, "MSB emitted before its LSB");
+        now += 1.0;
+        send (1, 39, 27);
+        expectEquals (count (ControllerEvent::Controller14Bit), 1);
+        auto* event = findLast (ControllerEvent::Controller14Bit);
+        expect (event != nullptr);
+        expectEquals (event->number, 7);
+        expect (event->value == ControllerEvent::scaleTo32Bit ((100 << 7) | 27, 14));
+
+        // plain 7 bit events are still produced
+        expect (findLast (ControllerEvent::Controller) != nullptr);
+
+        beginTest ("14-bit MSB without an LSB");
+        events.clearQuick();
+        send (1, 7, 101);
+        expect (parser.hasHeldControllers());
+        auto collect = [this](const ControllerEvent& e) { events.add (e); };
+        parser.flush (now + ControllerEventParser::lsbTimeoutMs - 1, collect);
+        expect (findLast (ControllerEvent::Controller14Bit) == nullptr);
+
+        // MSB resets the LSB
+        now += ControllerEventParser::lsbTimeoutMs;
+        parser.flush (now, collect);
+        expect (! parser.hasHeldControllers());
+        event = findLast (ControllerEvent::Controller14Bit);
+        expect (event != nullptr && event->value == ControllerEvent::scaleTo32Bit (101 << 7, 14));
+
+        // the next message releases a timed out MSB too
+        events.clearQuick();
+        send (1, 1, 10);
+        now += ControllerEventParser::lsbTimeoutMs;
+        send (1, 64, 0);
+        expectEquals (count (ControllerEvent::Controller14Bit), 1);
+
+        // as does another MSB for the same controller
+        events.clearQuick();
+        send (1, 1, 11);
+        send (1, 1, 12);
+        event = findLast (ControllerEvent::Controller14Bit);
+        expect (event != nullptr && event->value == ControllerEvent::scaleTo32Bit (11 << 7, 14));
+        send (1, 33, 3);
+        event = findLast (ControllerEvent::Controller14Bit);
+        expect (event->value == ControllerEvent::scaleTo32Bit ((12 << 7) | 3, 14));
+        expectEquals (count (ControllerEvent::Controller14Bit), 2);
+
+        // channels are independent
+        send (2, 39, 5);
+        event = findLast (ControllerEvent::Controller14Bit);
+        expectEquals (event->channel, 2);
+        expect (event->value == ControllerEvent::scaleTo32Bit (5, 14));
+    }
+
+    void testNrpn()
+    {
+        beginTest ("NRPN");
+        parser.reset();
+        events.clearQuick();
+
+        send (3, 99, 1);
+        send (3, 98, 2);
+        send (3, 6, 64);
+        expect (findLast (ControllerEvent::NRPN) == nullptr, "data entry MSB emitted before its LSB");
+        send (3, 38, 1);
+        expectEquals (count (ControllerEvent::NRPN), 1);
+        auto* event = findLast (ControllerEvent::NRPN);
+        expect (event != nullptr);
+        expectEquals (event->number, (1 << 7) | 2);
+        expectEquals (event->channel, 3);
+        expect (event->value == ControllerEvent::scaleTo32Bit ((64 << 7) | 1, 14));
+
+        send (3, 96, 0);
+        event = findLast (ControllerEvent::NRPN);
+        expect (event->value == ControllerEvent::scaleTo32Bit ((64 << 7) | 2, 14));
+
+        beginTest ("NRPN data entry without an LSB");
+        events.clearQuick();
+        send (3, 6, 10);
+        auto collect = [this](const ControllerEvent& e) { events.add (e); };
+        parser.flush (now + ControllerEventParser::lsbTimeoutMs - 1, collect);
+        expect (findLast (ControllerEvent::NRPN) == nullptr);
+        now += ControllerEventParser::lsbTimeoutMs;
+        parser.flush (now, collect);
+        event = findLast (ControllerEvent::NRPN);
+        expect (event != nullptr && event->value == ControllerEvent::scaleTo32Bit (10 << 7, 14));
+
+        // selecting another parameter releases it for the old one
+        events.clearQuick();
+        send (3, 6, 11);
+        send (3, 98, 3);
+        event = findLast (ControllerEvent::NRPN);
+        expect (event != nullptr);
+        expectEquals (event->number, (1 << 7) | 2);
+        expect (! parser.hasHeldControllers());
+
+        // data entry isn't also reported as a 14 bit controller
+        expect (findLast (ControllerEvent::Controller14Bit) == nullptr);
+    }
+
+    void testRpnNull()
+    {
+        beginTest ("RPN null");
+        parser.reset();
+        events.clearQuick();
+
+        send (1, 101, 0);
+        send (1, 100, 0);
+        send (1, 6, 2);
+        send (1, 38, 0);
+        expect (findLast (ControllerEvent::RPN) != nullptr);
+
+        events.clearQuick();
+        send (1, 101, 127);
+        send (1, 100, 127);
+        send (1, 6, 2);
+        expect (findLast (ControllerEvent::RPN) == nullptr);
+    }
+};
+
+static ControllerEventParserTest sControllerEventParserTest;
+
+}
@@ -0,0 +1,197 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+#include "engine/nodes/ConvolutionProcessor.h"
+
+namespace Element {
+
+class ConvolutionTest : public UnitTestBase
+{
+public:
+    ConvolutionTest() : UnitTestBase ("Convolution", "engine", "convolution") { }
+    virtual ~ConvolutionTest() { }
+
+    void runTest() override
+    {
+        testConvolver();
+        testResampling();
+        testCache();
+        testProcessor();
+    }
+
+private:
+    void testConvolver()
+    {
+        // long enough for a tail, which runs inline without a worker
+        beginTest ("matches direct convolution");
+        const int length = 3000, numSamples = 6000;
+        Random random (7);
+        AudioSampleBuffer impulse (1, length);
+        for (int i = 0; i < length; ++i)
+            impulse.setSample (0, i, (random.nextFloat() - 0.5f) * std::exp ((float) -i / 800.f));
+
+        HeapBlock<float> input (numSamples), output (numSamples, true), expected (numSamples, true);
+        for (int i = 0; i < numSamples; ++i)
+            input[i] = random.nextFloat() - 0.5f;
+        for (int i = 0; i < numSamples; ++i)
+            for (int j = 0; j < length && j <= i; ++j)
+                expected[i] += impulse.getSample (0, j) * input[i - j];
+
+        auto kernel = ConvolutionKernel::create (impulse, 48000.0);
+        expect (kernel != nullptr);
+        Convolver convolver (kernel, 0);
+        expect (convolver.hasTail());
+
+        // uneven blocks cross both partition sizes
+        const int sizes[] = { 64, 37, 100, 1, 500, 64 };
+        for (int start = 0, block = 0; start < numSamples; ++block)
+        {
+            const int n = jmin (sizes [block % 6], numSamples - start);
+            convolver.process (input + start, output + start, n);
+            start += n;
+        }
+
+        for (int i = 0; i < numSamples; ++i)
+            expectWithinAbsoluteError (output[i], expected[i], 0.0001f);
+        expectEquals (convolver.getNumOverruns(), 0);
+    }
+
+    void testResampling()
+    {
+        beginTest ("resamples to the session rate");
+        AudioSampleBuffer impulse (2, 960);
+        impulse.clear();
+        for (int i = 0; i < 960; ++i)
+            impulse.setSample (0, i, 1.f);
+
+        auto kernel = ImpulseResponseCache::createKernel (impulse, 96000.0, 48000.0);
+        expect (kernel != nullptr);
+        expectEquals (kernel->getLength(), 480);
+        expectEquals (kernel->getNumChannels(), 2);
+        expectEquals (kernel->getSampleRate(), 48000.0);
+
+        // DC through a box keeps its area
+        Convolver convolver (kernel, 0);
+        HeapBlock<float> ones (1024), output (1024, true);
+        FloatVectorOperations::fill (ones, 1.f, 1024);
+        convolver.process (ones, output, 1024);
+        expectWithinAbsoluteError (output[1000], 960.f, 5.f);
+
+        beginTest ("filters before decimating");
+        {
+            // 30 kHz would fold back to 18 kHz at 48 kHz
+            AudioSampleBuffer tone (1, 2000);
+            for (int i = 0; i < 2000; ++i)
+                tone.setSample (0, i, std::sin (2.0f * float_Pi * 30000.f * (float) i / 96000.f));
+
+            auto toneKernel = ImpulseResponseCache::createKernel (tone, 96000.0, 48000.0);
+            Convolver toneConvolver (toneKernel, 0);
+            HeapBlock<float> delta (1000, true), response (1000, true);
+            delta[0] = 1.f;
+            toneConvolver.process (delta, response, 1000);
+
+            // skip where the tone starts and stops
+            float peak = 0.f;
+            for (int i = 200; i < 800; ++i)
+                peak = jmax (peak, std::abs (response[i]));
+            expect (peak < 0.05f, "aliased peak " + String (peak));
+        }
+    }
+
+    void testCache()
+    {
+        beginTest ("identical files share a kernel");
+        const auto file = File::getSpecialLocation (File::tempDirectory)
+            .getChildFile ("ElementConvolutionTest.wav");
+        file.deleteFile();
+        {
+            AudioSampleBuffer impulse (1, 100);
+            impulse.clear();
+            impulse.setSample (0, 0, 1.f);
+            WavAudioFormat wav;
+            std::unique_ptr<AudioFormatWriter> writer (wav.createWriterFor (
+                file.createOutputStream(), 48000.0, 1, 32, {}, 0));
+            expect (writer != nullptr);
+            if (writer != nullptr)
+                writer->writeFromAudioSampleBuffer (impulse, 0, 100);
+        }
+
+        SharedResourcePointer<ImpulseResponseCache> cache;
+        auto first  = cache->getKernel (file, 48000.0);
+        auto second = cache->getKernel (file, 48000.0);
+        auto other  = cache->getKernel (file, 44100.0);
+        expect (first != nullptr && first == second);
+        expect (other != nullptr && other != first);
+        expectEquals (cache->getNumKernels(), 2);
+
+        other = nullptr;
+        cache->getKernel (file, 48000.0);
+        expectEquals (cache->getNumKernels(), 1);
+        first = second = nullptr;
+        file.deleteFile();
+    }
+
+    void testProcessor()
+    {
+        beginTest ("processor convolves each channel");
+        const int blockSize = 64;
+        ConvolutionProcessor node (2);
+        node.prepareToPlay (48000.0, blockSize);
+
+        // a delay of ten samples on the left, inverted on the right
+        AudioSampleBuffer impulse (2, 20);
+        impulse.clear();
+        impulse.setSample (0, 10, 1.f);
+        impulse.setSample (1, 0, -1.f);
+        node.setImpulseResponse (impulse, 48000.0);
+        expectEquals (node.getImpulseLength(), 20);
+
+        AudioSampleBuffer audio (2, blockSize);
+        MidiBuffer midi;
+        for (int block = 0; block < 4; ++block)
+        {
+            for (int i = 0; i < blockSize; ++i)
+            {
+                audio.setSample (0, i, (float) (block * blockSize + i));
+                audio.setSample (1, i, (float) (block * blockSize + i));
+            }
+            node.processBlock (audio, midi);
+        }
+
+        for (int i = 0; i < blockSize; ++i)
+        {
+            const float value = (float) (3 * blockSize + i);
+            expectWithinAbsoluteError (audio.getSample (0, i), value - 10.f, 0.01f);
+            expectWithinAbsoluteError (audio.getSample (1, i), -value, 0.01f);
+        }
+
+        beginTest ("passes through without an impulse response");
+        node.clearImpulseResponse();
+        audio.clear();
+        audio.setSample (0, 5, 1.f);
+        node.processBlock (audio, midi);
+        expectEquals (audio.getSample (0, 5), 1.f);
+        node.releaseResources();
+    }
+};
+
+static ConvolutionTest sConvolutionTest;
+
+}
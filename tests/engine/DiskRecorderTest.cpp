@@ -0,0 +1,144 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/DiskRecorder.h"
+
+namespace Element {
+
+class DiskRecorderTest : public UnitTestBase
+{
+public:
+    DiskRecorderTest() : UnitTestBase ("Disk Recorder", "engine", "diskRecorder") { }
+    virtual ~DiskRecorderTest() { }
+
+    void runTest() override
+    {
+        const auto dir = File::getSpecialLocation (File::tempDirectory)
+            .getChildFile ("ElementDiskRecorderTest");
+        dir.deleteRecursively();
+
+        // the thread isn't started, tests drain with flush()
+        TimeSliceThread thread ("Disk Recorder Test");
+
+        beginTest ("pre-roll and punch");
+        {
+            DiskRecorder recorder (thread);
+            recorder.setDirectory (dir);
+            recorder.setFormat (DiskRecorder::WAV, 32);
+            recorder.setPreRollSeconds (0.1);
+            recorder.prepare (2, 1000.0, blockSize);
+
+            for (int i = 0; i < 10; ++i)
+                writeBlock (recorder);
+            recorder.flush();
+
+            recorder.punchIn (10);
+            midi.addEvent (MidiMessage::noteOn (1, 60, 0.5f), 15);
+            writeBlock (recorder);
+            midi.clear();
+            for (int i = 0; i < 4; ++i)
+                writeBlock (recorder);
+            recorder.punchOut (20);
+            writeBlock (recorder);
+            recorder.flush();
+
+            // 100 samples of pre-roll before 510, up to 770
+            const auto take = recorder.getLastTake();
+            expect (take.existsAsFile());
+            expect (take.withFileExtension ("mid").existsAsFile());
+            expectEquals (recorder.getStats().numTakes, 1);
+
+            WavAudioFormat wav;
+            std::unique_ptr<AudioFormatReader> reader (wav.createReaderFor (take.createInputStream(), true));
+            expect (reader != nullptr);
+            if (reader != nullptr)
+            {
+                expectEquals ((int) reader->lengthInSamples, 360);
+                AudioSampleBuffer buffer (2, 360);
+                reader->read (&buffer, 0, 360, 0, true, true);
+                expectEquals (buffer.getSample (0, 0), 410.f);
+                expectEquals (buffer.getSample (1, 359), -769.f);
+            }
+        }
+
+        beginTest ("overruns");
+        {
+            position = 0;
+            DiskRecorder recorder (thread);
+            recorder.setDirectory (dir);
+            recorder.setFormat (DiskRecorder::WAV, 32);
+            recorder.setPreRollSeconds (0.0);
+            recorder.prepare (2, 1000.0, blockSize);
+
+            // capacity is about four seconds and nothing drains it
+            recorder.punchIn (0);
+            for (int i = 0; i < 100; ++i)
+                writeBlock (recorder);
+            const auto stats = recorder.getStats();
+            expect (stats.overruns > 0);
+            expectEquals (stats.droppedSamples, (int64) stats.overruns * blockSize);
+
+            // the dropped blocks come out as silence, keeping the take in time
+            recorder.flush();
+            writeBlock (recorder);
+            recorder.punchOut (0);
+            recorder.flush();
+
+            WavAudioFormat wav;
+            std::unique_ptr<AudioFormatReader> reader (wav.createReaderFor (recorder.getLastTake().createInputStream(), true));
+            expect (reader != nullptr);
+            if (reader != nullptr)
+            {
+                const int length = 101 * blockSize;
+                const int firstDropped = (100 - stats.overruns) * blockSize;
+                expectEquals ((int) reader->lengthInSamples, length);
+                AudioSampleBuffer buffer (2, length);
+                reader->read (&buffer, 0, length, 0, true, true);
+                expectEquals (buffer.getSample (0, firstDropped - 1), (float) (firstDropped - 1));
+                expectEquals (buffer.getSample (0, firstDropped), 0.f);
+                expectEquals (buffer.getSample (1, length - 1), -(float) (length - 1));
+            }
+        }
+
+        dir.deleteRecursively();
+    }
+
+private:
+    static const int blockSize = 50;
+    int64 position = 0;
+    MidiBuffer midi;
+
+    void writeBlock (DiskRecorder& recorder)
+    {
+        // the sample position on the left, negated on the right
+        AudioSampleBuffer block (2, blockSize);
+        for (int i = 0; i < blockSize; ++i)
+        {
+            block.setSample (0, i, (float) (position + i));
+            block.setSample (1, i, -(float) (position + i));
+        }
+
+        recorder.write (block, midi);
+        position += blockSize;
+    }
+};
+
+static DiskRecorderTest sDiskRecorderTest;
+
+}
@@ -0,0 +1,105 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+#include "engine/nodes/FreqSplitterProcessor.h"
+
+namespace Element {
+
+class FreqSplitterTest : public UnitTestBase
+{
+public:
+    FreqSplitterTest() : UnitTestBase ("Frequency Splitter", "engine", "freqSplitter") { }
+    virtual ~FreqSplitterTest() { }
+
+    void runTest() override
+    {
+        testBands();
+        testState();
+    }
+
+private:
+    static const int blockSize = 500;
+
+    void testBands()
+    {
+        // six channels fill one group of lanes and half of another
+        const int numChannels = 6, numBands = 4;
+        FreqSplitterProcessor splitter (numChannels, numBands);
+        expectEquals (splitter.getNumBands(), numBands);
+        expectEquals (splitter.getBus (false, 0)->getName(), String ("Low"));
+        expectEquals (splitter.getBus (false, 3)->getName(), String ("High"));
+        splitter.prepareToPlay (44100.0, blockSize);
+
+        beginTest ("bands split and sum flat in place");
+        for (float hz : { 60.f, 1000.f, 12000.f })
+        {
+            AudioSampleBuffer buffer (numChannels * numBands, blockSize);
+            MidiBuffer midi;
+            int64 phase = 0;
+            for (int block = 0; block < 40; ++block)
+            {
+                buffer.clear();
+                for (int i = 0; i < blockSize; ++i)
+                    for (int ch = 0; ch < numChannels; ++ch)
+                        buffer.setSample (ch, i, std::sin (MathConstants<float>::twoPi * hz * (float) (phase + i) / 44100.f));
+                phase += blockSize;
+                splitter.processBlock (buffer, midi);
+            }
+
+            AudioSampleBuffer sum (1, blockSize);
+            sum.clear();
+            for (int band = 0; band < numBands; ++band)
+                sum.addFrom (0, 0, buffer, band * numChannels + 5, 0, blockSize);
+            expectWithinAbsoluteError (sum.getRMSLevel (0, 0, blockSize), 0.7071f, 0.01f);
+
+            // the band holding the tone, on every lane alike
+            const int expected = hz < 100.f ? 0 : hz > 10000.f ? 3 : -1;
+            if (expected >= 0)
+                expect (buffer.getRMSLevel (expected * numChannels, 0, blockSize) > 0.69f);
+            for (int band = 0; band < numBands; ++band)
+                expectWithinAbsoluteError (buffer.getSample (band * numChannels + 5, 100),
+                                           buffer.getSample (band * numChannels, 100), 1.0e-6f);
+        }
+    }
+
+    void testState()
+    {
+        beginTest ("restores three band sessions");
+        MemoryBlock block;
+        {
+            ValueTree state (Tags::state);
+            state.setProperty ("lowFreq", 300.f, nullptr)
+                 .setProperty ("highFreq", 4000.f, nullptr);
+            if (auto e = state.createXml())
+                AudioProcessor::copyXmlToBinary (*e, block);
+        }
+
+        FreqSplitterProcessor splitter;
+        splitter.setStateInformation (block.getData(), (int) block.getSize());
+        auto params = splitter.getParameters();
+        expectEquals (params.size(), 2);
+        expectWithinAbsoluteError (dynamic_cast<AudioParameterFloat*> (params[0])->get(), 300.f, 0.5f);
+        expectWithinAbsoluteError (dynamic_cast<AudioParameterFloat*> (params[1])->get(), 4000.f, 0.5f);
+    }
+};
+
+static FreqSplitterTest sFreqSplitterTest;
+
+}
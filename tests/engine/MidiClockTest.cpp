@@ -0,0 +1,175 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/MidiClock.h"
+
+namespace Element {
+
+class MidiClockTest : public UnitTestBase
+{
+public:
+    MidiClockTest() : UnitTestBase ("MIDI Clock", "engine", "midiClock") { }
+    virtual ~MidiClockTest() { }
+
+    void runTest() override
+    {
+        testMasterDrift();
+        testMasterTempoRamp();
+        testSlaveTracking (120.0);
+        testSlaveTracking (97.3);
+        testSlaveTempoChange();
+    }
+
+private:
+    static int countClocks (const MidiBuffer& midi)
+    {
+        int count = 0;
+        MidiBuffer::Iterator iter (midi);
+        MidiMessage msg; int frame = 0;
+        while (iter.getNextEvent (msg, frame))
+            if (msg.isMidiClock())
+                ++count;
+        return count;
+    }
+
+    void testMasterDrift()
+    {
+        beginTest ("master: no drift over one hour");
+        const double sampleRate = 44100.0;
+        const int blockSize = 256;
+        MidiClockMaster master;
+        master.setSampleRate (sampleRate);
+        master.setTempo (120.0);
+        master.reset();
+
+        // 918.75 samples per clock, used to drift when rounded
+        MidiBuffer midi;
+        int64 totalClocks = 0, totalSamples = 0;
+        const int64 numSamples = (int64) sampleRate * 60 * 60;
+        while (totalSamples < numSamples)
+        {
+            midi.clear();
+            master.render (midi, blockSize);
+            totalClocks += countClocks (midi);
+            totalSamples += blockSize;
+        }
+
+        const double expected = (double) totalSamples / ((60.0 * sampleRate) / (24.0 * 120.0));
+        expect (std::abs ((double) totalClocks - expected) <= 1.0,
+            String ("clocks: ") + String (totalClocks) + " expected: " + String (expected));
+    }
+
+    void testMasterTempoRamp()
+    {
+        beginTest ("master: tempo ramp within block");
+        const double sampleRate = 48000.0;
+        MidiClockMaster master;
+        master.setSampleRate (sampleRate);
+        master.setTempo (100.0);
+        master.reset();
+
+        // one large block ramping 100 to 200 bpm, average 150 bpm
+        MidiBuffer midi;
+        const int numSamples = (int) sampleRate * 10;
+        master.setTempo (200.0);
+        master.render (midi, numSamples);
+        const double expected = 24.0 * 150.0 * 10.0 / 60.0;
+        expect (std::abs ((double) countClocks (midi) - expected) <= 1.0);
+
+        // clock spacing should shrink monotonically while ramping up
+        MidiBuffer::Iterator iter (midi);
+        MidiMessage msg; int frame = 0, lastFrame = -1, lastDelta = std::numeric_limits<int>::max();
+        bool shrinking = true;
+        while (iter.getNextEvent (msg, frame))
+        {
+            if (lastFrame >= 0)
+            {
+                const int delta = frame - lastFrame;
+                if (delta > lastDelta + 1)
+                    shrinking = false;
+                lastDelta = delta;
+            }
+            lastFrame = frame;
+        }
+        expect (shrinking);
+    }
+
+    void feedClock (MidiClock& clock, Random& random, double bpm, double& time,
+                    int numTicks, double jitterSeconds)
+    {
+        const double period = 60.0 / (24.0 * bpm);
+        for (int i = 0; i < numTicks; ++i)
+        {
+            time += period;
+            auto msg = MidiMessage::midiClock();
+            msg.setTimeStamp (time + jitterSeconds * (random.nextDouble() - 0.5));
+            clock.process (msg);
+        }
+    }
+
+    void testSlaveTracking (const double bpm)
+    {
+        beginTest (String ("slave: tracks jittery clock at ") + String (bpm, 1) + " bpm");
+        MidiClock clock;
+        clock.reset (44100.0, 256);
+        Random random (1234);
+        double time = 10.0;
+
+        // 1ms peak to peak jitter for ~40 seconds
+        feedClock (clock, random, bpm, time, (int) (bpm * 24.0 * 40.0 / 60.0), 0.001);
+
+        expect (clock.isLocked());
+        expect (std::abs (clock.getTempo() - bpm) < 0.1,
+            String ("tempo: ") + String (clock.getTempo()));
+        expect (std::abs (clock.getDrift()) < 0.0005,
+            String ("drift: ") + String (clock.getDrift()));
+
+        // uniform 1ms p-p jitter has an RMS of ~0.29ms
+        expect (clock.getJitter() > 0.0001 && clock.getJitter() < 0.0006,
+            String ("jitter: ") + String (clock.getJitter()));
+
+        // loop should have narrowed down once locked
+        expect (clock.getBandwidth() < 1.0);
+    }
+
+    void testSlaveTempoChange()
+    {
+        beginTest ("slave: follows tempo change");
+        MidiClock clock;
+        clock.reset (44100.0, 256);
+        Random random (4321);
+        double time = 10.0;
+
+        feedClock (clock, random, 120.0, time, 24 * 60, 0.0005);
+        expect (std::abs (clock.getTempo() - 120.0) < 0.1);
+        feedClock (clock, random, 128.0, time, 24 * 60, 0.0005);
+        expect (clock.isLocked());
+        expect (std::abs (clock.getTempo() - 128.0) < 0.1,
+            String ("tempo: ") + String (clock.getTempo()));
+
+        beginTest ("slave: signal dropped");
+        time += 2.0;
+        feedClock (clock, random, 128.0, time, 1, 0.0);
+        expect (! clock.isLocked());
+    }
+};
+
+static MidiClockTest sMidiClockTest;
+
+}
@@ -0,0 +1,93 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/MidiEngine.h"
+
+namespace Element {
+
+class MidiEngineCallbackTest : public UnitTestBase
+{
+public:
+    MidiEngineCallbackTest() : UnitTestBase ("MIDI Engine Callbacks", "engine", "midiEngineCallbacks") { }
+    virtual ~MidiEngineCallbackTest() { }
+
+    void runTest() override
+    {
+        beginTest ("add and remove while dispatching");
+        MidiEngine engine;
+        Atomic<int> lateCalls { 0 };
+        Atomic<int> calls { 0 };
+
+        Dispatcher dispatcher (engine);
+        dispatcher.startThread();
+
+        for (int i = 0; i < 2000; ++i)
+        {
+            // freed right after removal, a call after that is a late call
+            std::unique_ptr<Callback> callback (new Callback (calls, lateCalls));
+            engine.addMidiInputCallback (String(), callback.get(), (i & 1) != 0);
+            if ((i & 7) == 0)
+                Thread::yield();
+            engine.removeMidiInputCallback (String(), callback.get());
+            callback->removed.set (true);
+        }
+
+        dispatcher.stopThread (1000);
+        expectEquals (lateCalls.get(), 0);
+        logMessage (String (calls.get()) + " calls dispatched");
+    }
+
+private:
+    struct Callback : public MidiInputCallback
+    {
+        Callback (Atomic<int>& c, Atomic<int>& l) : calls (c), lateCalls (l) { }
+
+        void handleIncomingMidiMessage (MidiInput*, const MidiMessage&) override
+        {
+            calls.set (calls.get() + 1);
+            if (removed.get())
+                lateCalls.set (lateCalls.get() + 1);
+        }
+
+        Atomic<bool> removed { false };
+        Atomic<int>& calls;
+        Atomic<int>& lateCalls;
+    };
+
+    struct Dispatcher : public Thread
+    {
+        Dispatcher (MidiEngine& e) : Thread ("MIDI dispatch"), engine (e)
+        {
+            buffer.addEvent (MidiMessage::noteOn (1, 60, 0.5f), 0);
+        }
+
+        void run() override
+        {
+            while (! threadShouldExit())
+                engine.processMidiBuffer (buffer, 64, 44100.0);
+        }
+
+        MidiEngine& engine;
+        MidiBuffer buffer;
+    };
+};
+
+static MidiEngineCallbackTest sMidiEngineCallbackTest;
+
+}
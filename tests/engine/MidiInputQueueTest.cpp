@@ -0,0 +1,198 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/MidiInputQueue.h"
+
+namespace Element {
+
+class MidiInputQueueTest : public UnitTestBase
+{
+public:
+    MidiInputQueueTest() : UnitTestBase ("MIDI Input Queue", "engine", "midiInputQueue") { }
+    virtual ~MidiInputQueueTest() { }
+
+    void runTest() override
+    {
+        testOrdering();
+        testOverflow();
+        testMultipleProducers();
+    }
+
+private:
+    // a millisecond per frame, a block covers the last second
+    static const int blockSize = 1000;
+
+    static double now()     { return Time::getMillisecondCounterHiRes() * 0.001; }
+
+    static MidiMessage stamped (MidiMessage message, double timestamp)
+    {
+        message.setTimeStamp (timestamp);
+        return message;
+    }
+
+    void testOrdering()
+    {
+        beginTest ("ordering");
+        MidiInputQueue queue;
+        queue.prepare (1000.0, blockSize);
+
+        const double base = now() - 0.5;
+        for (int i = 0; i < 10; ++i)
+            expect (queue.addMessageToQueue (stamped (MidiMessage::noteOn (1, 60 + i, 1.f), base + 0.002 * i)));
+        // same time stamp keeps the order they were added in
+        for (int i = 0; i < 4; ++i)
+            queue.addMessageToQueue (stamped (MidiMessage::noteOff (1, 70 + i), base + 0.1));
+        queue.addMessageToQueue (stamped (MidiMessage::noteOn (1, 80, 1.f), now() + 0.5));
+
+        MidiBuffer block;
+        queue.removeNextBlockOfMessages (block, blockSize);
+        expectEquals (block.getNumEvents(), 14);
+
+        MidiBuffer::Iterator iter (block);
+        MidiMessage msg; int frame = 0, lastFrame = -1, index = 0;
+        while (iter.getNextEvent (msg, frame))
+        {
+            expect (frame >= lastFrame, "events out of order");
+            expectEquals (msg.getNoteNumber(), index < 10 ? 60 + index : 70 + index - 10);
+            lastFrame = frame;
+            ++index;
+        }
+
+        beginTest ("ordering across blocks");
+        // the future event waits for the block it falls in
+        block.clear();
+        queue.removeNextBlockOfMessages (block, blockSize);
+        expectEquals (block.getNumEvents(), 1);
+        MidiBuffer::Iterator next (block);
+        next.getNextEvent (msg, frame);
+        expectEquals (msg.getNoteNumber(), 80);
+        expect (frame > 0 && frame < blockSize);
+    }
+
+    void testOverflow()
+    {
+        beginTest ("drops when full");
+        MidiInputQueue queue;
+        queue.prepare (1000.0, blockSize);
+
+        const double past = now() - 0.5;
+        int numAdded = 0;
+        for (int i = 0; i < MidiInputQueue::capacity + 10; ++i)
+            if (queue.addMessageToQueue (stamped (MidiMessage::controllerEvent (1, 1, i % 128), past)))
+                ++numAdded;
+        expectEquals (numAdded, (int) MidiInputQueue::capacity);
+        expectEquals (queue.getNumDropped(), 10);
+
+        MidiBuffer block;
+        queue.removeNextBlockOfMessages (block, blockSize);
+        expectEquals (block.getNumEvents(), (int) MidiInputQueue::capacity);
+
+        // room again once drained
+        expect (queue.addMessageToQueue (stamped (MidiMessage::controllerEvent (1, 1, 0), past)));
+
+        beginTest ("large messages");
+        uint8 data [100];
+        for (int i = 0; i < 100; ++i)
+            data[i] = (uint8) (i & 0x7f);
+        queue.addMessageToQueue (stamped (MidiMessage::createSysExMessage (data, 100), past));
+
+        block.clear();
+        queue.removeNextBlockOfMessages (block, blockSize);
+        expectEquals (block.getNumEvents(), 2);
+
+        bool foundSysEx = false;
+        MidiBuffer::Iterator iter (block);
+        MidiMessage msg; int frame = 0;
+        while (iter.getNextEvent (msg, frame))
+            if (msg.isSysEx())
+                foundSysEx = msg.getSysExDataSize() == 100 && frame == 0;
+        expect (foundSysEx);
+        expectEquals (queue.getNumDropped(), 10);
+    }
+
+    void testMultipleProducers()
+    {
+        beginTest ("multiple producers");
+        MidiInputQueue queue;
+        queue.prepare (1000.0, blockSize);
+
+        enum { numProducers = 4, numEach = 200 };
+        OwnedArray<Producer> producers;
+        for (int i = 0; i < numProducers; ++i)
+            producers.add (new Producer (queue, i + 1, numEach));
+        for (auto* producer : producers)
+            producer->startThread();
+
+        // drain while the producers run
+        int next [numProducers] = { 0 };
+        int received = 0;
+        MidiBuffer block;
+        for (int attempt = 0; attempt < 500 && received < numProducers * numEach; ++attempt)
+        {
+            block.clear();
+            queue.removeNextBlockOfMessages (block, blockSize);
+            MidiBuffer::Iterator iter (block);
+            MidiMessage msg; int frame = 0;
+            while (iter.getNextEvent (msg, frame))
+            {
+                // each producer's events arrive in the order it sent them
+                const int channel = msg.getChannel() - 1;
+                const int index = msg.getControllerNumber() * 128 + msg.getControllerValue();
+                expectEquals (index, next [channel]);
+                next [channel] = index + 1;
+                ++received;
+            }
+            Thread::sleep (1);
+        }
+
+        for (auto* producer : producers)
+            producer->stopThread (1000);
+
+        expectEquals (received, numProducers * numEach);
+        expectEquals (queue.getNumDropped(), 0);
+        for (int i = 0; i < numProducers; ++i)
+            expectEquals (next[i], (int) numEach);
+    }
+
+    struct Producer : public Thread
+    {
+        Producer (MidiInputQueue& q, int c, int n)
+            : Thread ("MIDI producer"), queue (q), channel (c), count (n) { }
+
+        void run() override
+        {
+            // stamped in the past, everything lands on frame zero
+            const double past = now() - 0.5;
+            for (int i = 0; i < count && ! threadShouldExit(); ++i)
+            {
+                queue.addMessageToQueue (stamped (MidiMessage::controllerEvent (
+                    channel, i / 128, i % 128), past));
+                if ((i & 15) == 0)
+                    Thread::yield();
+            }
+        }
+
+        MidiInputQueue& queue;
+        const int channel, count;
+    };
+};
+
+static MidiInputQueueTest sMidiInputQueueTest;
+
+}
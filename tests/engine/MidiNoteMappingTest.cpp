@@ -0,0 +1,97 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/GraphProcessor.h"
+#include "engine/MappingEngine.h"
+#include "engine/MidiEngine.h"
+#include "engine/nodes/VolumeProcessor.h"
+
+namespace Element {
+
+class MidiNoteMappingTest : public UnitTestBase
+{
+public:
+    MidiNoteMappingTest() : UnitTestBase ("MIDI Note Mapping", "engine", "midiNoteMapping") { }
+    virtual ~MidiNoteMappingTest() { }
+
+    void runTest() override
+    {
+        GraphProcessor graph;
+        graph.setPlayConfigDetails (2, 2, 44100.0, blockSize);
+        graph.prepareToPlay (44100.0, blockSize);
+        GraphNodePtr volume = graph.addNode (new VolumeProcessor (-60.0, 12.0, true));
+        auto* const parameter = volume->getParameters()[0];
+        runDispatchLoop (20);
+
+        Node model (Tags::node);
+        model.getValueTree().setProperty (Tags::object, volume.get(), nullptr);
+
+        ControllerDevice device ("Test Controller");
+        ControllerDevice::Control control ("Toggle");
+        control.getValueTree().setProperty ("eventType", "note", nullptr);
+        control.getValueTree().setProperty ("eventId", 60, nullptr);
+        device.getValueTree().appendChild (control.getValueTree(), nullptr);
+
+        MidiEngine midi;
+        MappingEngine mapping;
+        expect (mapping.addInput (device, midi));
+        expect (mapping.addHandler (control, model, 0));
+        mapping.startMapping();
+
+        beginTest ("toggle");
+        parameter->setValue (0.f);
+        toggle (midi, graph);
+        expectWithinAbsoluteError (parameter->getValue(), 1.f, 0.001f);
+        toggle (midi, graph);
+        expectWithinAbsoluteError (parameter->getValue(), 0.f, 0.001f);
+
+        beginTest ("toggle after an external change");
+        // like the editor moving it, the next note toggles from there
+        parameter->setValue (1.f);
+        toggle (midi, graph);
+        expectWithinAbsoluteError (parameter->getValue(), 0.f, 0.001f);
+        parameter->setValue (0.8f);
+        toggle (midi, graph);
+        expectWithinAbsoluteError (parameter->getValue(), 0.f, 0.001f);
+
+        mapping.clear();
+        volume = nullptr;
+        graph.releaseResources();
+        graph.clear();
+    }
+
+private:
+    static const int blockSize = 512;
+
+    void toggle (MidiEngine& midi, GraphProcessor& graph)
+    {
+        MidiBuffer input;
+        input.addEvent (MidiMessage::noteOn (1, 60, (uint8) 100), 0);
+        midi.processMidiBuffer (input, blockSize, 44100.0);
+
+        AudioSampleBuffer audio (2, blockSize);
+        MidiBuffer midiBuffer;
+        audio.clear();
+        graph.processBlock (audio, midiBuffer);
+    }
+};
+
+static MidiNoteMappingTest sMidiNoteMappingTest;
+
+}
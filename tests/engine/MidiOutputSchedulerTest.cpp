@@ -0,0 +1,131 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/MidiOutputScheduler.h"
+
+namespace Element {
+
+class MidiOutputSchedulerTest : public UnitTestBase
+{
+public:
+    MidiOutputSchedulerTest() : UnitTestBase ("MIDI Output Scheduler", "engine", "midiOutputScheduler") { }
+    virtual ~MidiOutputSchedulerTest() { }
+
+    void runTest() override
+    {
+        MidiOutputScheduler scheduler;
+        // a millisecond per sample keeps due times easy to read
+        scheduler.prepare (1000.0, 5);
+        scheduler.setOutputCallback ([this](const MidiMessage& message)
+        {
+            ScopedLock sl (lock);
+            sent.add (message);
+            lateMs.add (Time::getMillisecondCounterHiRes() - message.getTimeStamp());
+        });
+        expect (scheduler.hasOutputs());
+
+        beginTest ("sends in due order");
+        {
+            const double now = Time::getMillisecondCounterHiRes();
+            MidiBuffer later, sooner;
+            later.addEvent (MidiMessage::noteOn (1, 62, 0.5f), 10);
+            later.addEvent (MidiMessage::noteOn (1, 61, 0.5f), 0);
+            sooner.addEvent (MidiMessage::noteOn (1, 60, 0.5f), 0);
+
+            // the later block is handed over first
+            scheduler.schedule (later, 64, now + 40.0);
+            scheduler.schedule (sooner, 64, now + 20.0);
+            waitForSent (3);
+
+            ScopedLock sl (lock);
+            expectEquals (sent.size(), 3);
+            for (int i = 0; i < sent.size(); ++i)
+            {
+                expectEquals (sent.getReference(i).getNoteNumber(), 60 + i);
+                expect (lateMs[i] >= 0.0, "sent before it was due");
+            }
+
+            // callback time, plus latency and the frame
+            expectWithinAbsoluteError (sent.getReference(0).getTimeStamp(), now + 25.0, 0.001);
+            expectWithinAbsoluteError (sent.getReference(2).getTimeStamp(), now + 55.0, 0.001);
+        }
+
+        beginTest ("accumulates timing stats");
+        {
+            auto stats = scheduler.getTimingStats();
+            expectEquals (stats.numSent, (int64) 3);
+            expectEquals (stats.numDropped, 0);
+            expect (stats.meanErrorMs >= 0.0 && stats.maxErrorMs >= stats.meanErrorMs);
+
+            MidiBuffer buffer;
+            buffer.addEvent (MidiMessage::noteOff (1, 60), 0);
+            scheduler.schedule (buffer, 64, Time::getMillisecondCounterHiRes());
+            waitForSent (4);
+            stats = scheduler.getTimingStats();
+            expectEquals (stats.numSent, (int64) 4);
+
+            ScopedLock sl (lock);
+            double maxLate = 0.0;
+            for (auto late : lateMs)
+                maxLate = jmax (maxLate, late);
+            expect (stats.maxErrorMs >= maxLate - 0.5 && stats.maxErrorMs <= maxLate + 0.5);
+        }
+
+        beginTest ("counts dropped blocks");
+        {
+            // more than the FIFO holds, the whole block is dropped
+            MidiBuffer flood;
+            for (int i = 0; i < 3000; ++i)
+                flood.addEvent (MidiMessage::controllerEvent (1, 7, i % 128), i % 64);
+            scheduler.schedule (flood, 64, Time::getMillisecondCounterHiRes());
+            expectEquals (scheduler.getTimingStats().numDropped, 3000);
+
+            scheduler.resetTimingStats();
+            expectEquals (scheduler.getTimingStats().numDropped, 0);
+            for (int i = 0; i < 100 && scheduler.getTimingStats().numSent > 0; ++i)
+                Thread::sleep (5);
+            expectEquals (scheduler.getTimingStats().numSent, (int64) 0);
+        }
+
+        scheduler.setOutputCallback (nullptr);
+        expect (! scheduler.hasOutputs());
+    }
+
+private:
+    CriticalSection lock;
+    Array<MidiMessage> sent;
+    Array<double> lateMs;
+
+    void waitForSent (int count)
+    {
+        for (int i = 0; i < 200; ++i)
+        {
+            {
+                ScopedLock sl (lock);
+                if (sent.size() >= count)
+                    return;
+            }
+            Thread::sleep (5);
+        }
+    }
+};
+
+static MidiOutputSchedulerTest sMidiOutputSchedulerTest;
+
+}
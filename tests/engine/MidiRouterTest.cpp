@@ -0,0 +1,113 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/nodes/MidiRouterNode.h"
+
+namespace Element {
+
+class MidiRouterTest : public UnitTestBase
+{
+public:
+    MidiRouterTest() : UnitTestBase ("MIDI Router", "engine", "midiRouter") { }
+    virtual ~MidiRouterTest() { }
+
+    void runTest() override
+    {
+        GraphNodePtr node = new MidiRouterNode (4, 4);
+        auto* router = dynamic_cast<MidiRouterNode*> (node.get());
+        router->prepareToRender (44100.0, blockSize);
+
+        beginTest ("fan out");
+        MatrixState matrix (4, 4);
+        for (int dst = 0; dst < 4; ++dst)
+            matrix.set (0, dst, true);
+        router->setMatrixState (matrix);
+        buffers[0].addEvent (MidiMessage::noteOn (1, 60, 0.5f), 3);
+        buffers[1].addEvent (MidiMessage::noteOn (2, 62, 0.5f), 4);
+        renderBlock (*router);
+        for (int dst = 0; dst < 4; ++dst)
+        {
+            expectEquals (buffers[dst].getNumEvents(), 1);
+            expect (firstMessage (dst).isNoteOn() && firstMessage (dst).getNoteNumber() == 60);
+        }
+
+        beginTest ("filters");
+        router->setFilter (0, 1, 1 << 1, MidiRouterNode::allKinds);
+        router->setFilter (0, 2, MidiRouterNode::allChannels, 1 << MidiRouterNode::Controller);
+        expectEquals (router->getChannelFilter (0, 1), 1 << 1);
+        clearBuffers();
+        buffers[0].addEvent (MidiMessage::noteOn (1, 60, 0.5f), 0);
+        renderBlock (*router);
+        expectEquals (buffers[0].getNumEvents(), 1);
+        expectEquals (buffers[1].getNumEvents(), 0);
+        expectEquals (buffers[2].getNumEvents(), 0);
+        expectEquals (buffers[3].getNumEvents(), 1);
+
+        beginTest ("channel mapping");
+        router->setChannelMapping (0, 3, 1, 10);
+        expectEquals (router->getChannelMapping (0, 3, 1), 10);
+        clearBuffers();
+        buffers[0].addEvent (MidiMessage::noteOn (1, 60, 0.5f), 0);
+        renderBlock (*router);
+        expectEquals (firstMessage (0).getChannel(), 1);
+        expectEquals (firstMessage (3).getChannel(), 10);
+        expectEquals (firstMessage (3).getNoteNumber(), 60);
+
+        beginTest ("state");
+        MemoryBlock block;
+        router->getState (block);
+        GraphNodePtr otherNode = new MidiRouterNode (4, 4);
+        auto* other = dynamic_cast<MidiRouterNode*> (otherNode.get());
+        other->setState (block.getData(), (int) block.getSize());
+        expectEquals (other->getChannelMapping (0, 3, 1), 10);
+        expectEquals (other->getKindFilter (0, 2), 1 << MidiRouterNode::Controller);
+        expect (other->getMatrixState().connected (0, 3));
+        expect (! other->getMatrixState().connected (1, 1));
+    }
+
+private:
+    static const int blockSize = 64;
+    AudioSampleBuffer audio { 1, blockSize };
+    MidiBuffer buffers [4];
+
+    void clearBuffers()
+    {
+        for (auto& buffer : buffers)
+            buffer.clear();
+    }
+
+    MidiMessage firstMessage (int index)
+    {
+        MidiBuffer::Iterator iter (buffers [index]);
+        MidiMessage msg; int frame = 0;
+        iter.getNextEvent (msg, frame);
+        return msg;
+    }
+
+    void renderBlock (MidiRouterNode& router)
+    {
+        MidiBuffer* pointers[] = { &buffers[0], &buffers[1], &buffers[2], &buffers[3] };
+        MidiPipe pipe (pointers, 4);
+        router.render (audio, pipe);
+    }
+};
+
+static MidiRouterTest sMidiRouterTest;
+
+}
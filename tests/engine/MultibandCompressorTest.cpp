@@ -0,0 +1,139 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/Crossover.h"
+#include "engine/nodes/MultibandCompressorProcessor.h"
+
+namespace Element {
+
+class MultibandCompressorTest : public UnitTestBase
+{
+public:
+    MultibandCompressorTest() : UnitTestBase ("Multiband Compressor", "engine", "multiband") { }
+    virtual ~MultibandCompressorTest() { }
+
+    void runTest() override
+    {
+        testCrossover();
+        testLatency();
+        testCompression();
+    }
+
+private:
+    static const int blockSize = 256;
+
+    static void fillSine (AudioSampleBuffer& buffer, float hz, int64& phase, float level = 0.5f)
+    {
+        for (int i = 0; i < buffer.getNumSamples(); ++i)
+        {
+            const auto x = level * std::sin (MathConstants<float>::twoPi * hz * (float) (phase + i) / 44100.f);
+            for (int ch = 0; ch < buffer.getNumChannels(); ++ch)
+                buffer.setSample (ch, i, x);
+        }
+        phase += buffer.getNumSamples();
+    }
+
+    void testCrossover()
+    {
+        beginTest ("bands sum flat");
+        for (float hz : { 60.f, 450.f, 1000.f, 2200.f, 9000.f })
+        {
+            Crossover crossover;
+            crossover.setup (2, 4);
+            crossover.setSampleRate (44100.0);
+            crossover.reset();
+
+            AudioSampleBuffer input (2, blockSize), bands (8, blockSize);
+            const float* inputs[] = { input.getReadPointer (0), input.getReadPointer (1) };
+            int64 phase = 0;
+            float inputRms = 0.f, sumRms = 0.f;
+
+            for (int block = 0; block < 80; ++block)
+            {
+                fillSine (input, hz, phase);
+                crossover.process (inputs, bands.getArrayOfWritePointers(), blockSize);
+                if (block < 40)
+                    continue;
+                
+                // measure a settled block
+                AudioSampleBuffer sum (1, blockSize);
+                sum.clear();
+                for (int b = 0; b < 4; ++b)
+                    sum.addFrom (0, 0, bands, b * 2, 0, blockSize);
+                inputRms = input.getRMSLevel (0, 0, blockSize);
+                sumRms   = sum.getRMSLevel (0, 0, blockSize);
+            }
+
+            expectWithinAbsoluteError (sumRms, inputRms, 0.01f * inputRms);
+        }
+    }
+
+    void testLatency()
+    {
+        beginTest ("lookahead latency");
+        MultibandCompressorProcessor comp (2, 3);
+        expectEquals (comp.getLatencySamples(), (int) MultibandCompressorProcessor::lookaheadSamples);
+        comp.prepareToPlay (44100.0, blockSize);
+
+        AudioSampleBuffer buffer (2, blockSize);
+        buffer.clear();
+        buffer.setSample (0, 0, 1.f);
+        MidiBuffer midi;
+        comp.processBlock (buffer, midi);
+        
+        const int latency = MultibandCompressorProcessor::lookaheadSamples;
+        expectEquals (buffer.getMagnitude (0, 0, latency), 0.f);
+        expect (buffer.getMagnitude (0, latency, blockSize - latency) > 0.1f);
+    }
+
+    void testCompression()
+    {
+        beginTest ("compresses a band");
+        MultibandCompressorProcessor comp (2, 3);
+        for (auto* param : comp.getParameters())
+        {
+            if (auto* p = dynamic_cast<AudioParameterFloat*> (param))
+            {
+                if (p->paramID == "thresh2")  *p = -30.f;
+                if (p->paramID == "ratio2")   *p = 10.f;
+            }
+        }
+        comp.prepareToPlay (44100.0, blockSize);
+
+        // 1 kHz sits in the middle band with the default crossovers
+        AudioSampleBuffer buffer (2, blockSize);
+        MidiBuffer midi;
+        int64 phase = 0;
+        float rms = 0.f;
+        for (int block = 0; block < 100; ++block)
+        {
+            fillSine (buffer, 1000.f, phase);
+            comp.processBlock (buffer, midi);
+            rms = buffer.getRMSLevel (0, 0, blockSize);
+        }
+
+        expect (rms < 0.25f * 0.5f * std::sqrt (0.5f));
+        expect (comp.getGainReductionDB (1) < -12.f);
+        expectEquals (comp.getGainReductionDB (0), 0.f);
+    }
+};
+
+static MultibandCompressorTest sMultibandCompressorTest;
+
+}
@@ -0,0 +1,220 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/GraphProcessor.h"
+#include "engine/nodes/OSCReceiverNode.h"
+#include "engine/nodes/VolumeProcessor.h"
+
+namespace Element {
+
+class OSCReceiverTest : public UnitTestBase
+{
+public:
+    OSCReceiverTest() : UnitTestBase ("OSC Receiver", "engine", "oscReceiver") { }
+    virtual ~OSCReceiverTest() { }
+
+    void runTest() override
+    {
+        GraphNodePtr node = new OSCReceiverNode();
+        auto* receiver = dynamic_cast<OSCReceiverNode*> (node.get());
+        // the receiver thread isn't running, messages are delivered directly
+        auto& listener = static_cast<OSCReceiver::Listener<OSCReceiver::RealtimeCallback>&> (*receiver);
+        receiver->prepareToRender (44100.0, blockSize);
+        renderBlock (*receiver);
+
+        beginTest ("immediate messages");
+        listener.oscMessageReceived (OSCMessage ("/midi/noteOn", 1, 60, 1.f));
+        listener.oscMessageReceived (OSCMessage ("/unrouted", 1.f));
+        renderBlock (*receiver);
+        expectEquals (buffers[0].getNumEvents(), 1);
+        expectEquals (firstFrame (0), 0);
+        expect (firstMessage (0).isNoteOn() && firstMessage (0).getNoteNumber() == 60);
+
+        beginTest ("timetags");
+        {
+            const int64 target = receiver->getRenderPosition() + 1234;
+            expectEquals (receiver->getPositionForTimeTag (receiver->getTimeTagForPosition (target)), target);
+
+            OSCBundle bundle (receiver->getTimeTagForPosition (target));
+            bundle.addElement (OSCMessage ("/midi/noteOff", 1, 60));
+            OSCBundle nested (receiver->getTimeTagForPosition (target + 10));
+            nested.addElement (OSCMessage ("/midi/noteOff", 1, 61));
+            bundle.addElement (nested);
+            listener.oscBundleReceived (bundle);
+
+            int events = 0;
+            while (receiver->getRenderPosition() + blockSize <= target)
+            {
+                renderBlock (*receiver);
+                events += buffers[0].getNumEvents();
+            }
+            expectEquals (events, 0);
+
+            const int64 blockStart = receiver->getRenderPosition();
+            renderBlock (*receiver);
+            expectEquals (buffers[0].getNumEvents(), 2);
+            expectEquals ((int64) firstFrame (0), target - blockStart);
+            expect (firstMessage (0).isNoteOff() && firstMessage (0).getNoteNumber() == 60);
+            expectEquals (receiver->getNumLate(), 0);
+        }
+
+        beginTest ("late bundles");
+        {
+            OSCBundle bundle (receiver->getTimeTagForPosition (receiver->getRenderPosition() - 100));
+            bundle.addElement (OSCMessage ("/midi/noteOn", 1, 62, 1.f));
+            listener.oscBundleReceived (bundle);
+            renderBlock (*receiver);
+            expectEquals (buffers[0].getNumEvents(), 1);
+            expectEquals (firstFrame (0), 0);
+            expectEquals (receiver->getNumLate(), 1);
+        }
+
+        beginTest ("routes");
+        {
+            Array<OSCReceiverNode::Route> routes;
+            OSCReceiverNode::Route route;
+            route.pattern = "/fader/[1-4]";
+            route.kind = OSCReceiverNode::Route::Controller;
+            route.output = 2;
+            route.channel = 3;
+            route.number = 7;
+            routes.add (route);
+            route.pattern = "/cue/*";
+            route.kind = OSCReceiverNode::Route::Note;
+            route.output = 1;
+            route.number = 36;
+            routes.add (route);
+            route.pattern = "not a pattern";
+            routes.add (route);
+            expect (! receiver->setRoutes (routes));
+            expectEquals (receiver->getRoutes().size(), 2);
+
+            listener.oscMessageReceived (OSCMessage ("/fader/2", 0.5f));
+            listener.oscMessageReceived (OSCMessage ("/fader/5", 0.5f));
+            listener.oscMessageReceived (OSCMessage ("/cue/go", 127));
+            listener.oscMessageReceived (OSCMessage ("/midi/noteOn", 1, 60, 1.f));
+            renderBlock (*receiver);
+            expectEquals (buffers[0].getNumEvents(), 0);
+            expectEquals (buffers[1].getNumEvents(), 1);
+            expectEquals (buffers[2].getNumEvents(), 1);
+            expect (firstMessage (2).isControllerOfType (7));
+            expectEquals (firstMessage (2).getChannel(), 3);
+            expectEquals (firstMessage (2).getControllerValue(), 64);
+            expect (firstMessage (1).isNoteOn() && firstMessage (1).getNoteNumber() == 36);
+        }
+
+        testParameterRoutes();
+
+        beginTest ("state");
+        {
+            MemoryBlock block;
+            receiver->getState (block);
+            GraphNodePtr otherNode = new OSCReceiverNode();
+            auto* other = dynamic_cast<OSCReceiverNode*> (otherNode.get());
+            expectEquals (other->getRoutes().size(), OSCReceiverNode::getDefaultRoutes().size());
+            other->setState (block.getData(), (int) block.getSize());
+            const auto routes = other->getRoutes();
+            expectEquals (routes.size(), 2);
+            expectEquals (routes[0].pattern, String ("/fader/[1-4]"));
+            expect (routes[0].kind == OSCReceiverNode::Route::Controller);
+            expectEquals (routes[0].output, 2);
+            expectEquals (routes[1].number, 36);
+        }
+    }
+
+private:
+    void testParameterRoutes()
+    {
+        beginTest ("parameter routes");
+        GraphProcessor graph;
+        graph.setPlayConfigDetails (2, 2, 44100.0, blockSize);
+        graph.prepareToPlay (44100.0, blockSize);
+
+        GraphNodePtr volume = graph.addNode (new VolumeProcessor (-60.0, 12.0, true));
+        GraphNodePtr node = graph.addNode (new OSCReceiverNode());
+        auto* receiver = dynamic_cast<OSCReceiverNode*> (node.get());
+        auto& listener = static_cast<OSCReceiver::Listener<OSCReceiver::RealtimeCallback>&> (*receiver);
+
+        Array<OSCReceiverNode::Route> routes;
+        OSCReceiverNode::Route route;
+        route.pattern = "/volume";
+        route.kind = OSCReceiverNode::Route::Parameter;
+        route.nodeId = volume->nodeId;
+        route.number = 0;
+        routes.add (route);
+        expect (receiver->setRoutes (routes));
+        runDispatchLoop (20);
+
+        listener.oscMessageReceived (OSCMessage ("/volume", 0.25f));
+        AudioSampleBuffer buffer (2, blockSize);
+        MidiBuffer midiBuffer;
+        buffer.clear();
+        graph.processBlock (buffer, midiBuffer);
+        expectWithinAbsoluteError (volume->getParameters()[0]->getValue(), 0.25f, 0.001f);
+
+        beginTest ("parameter route targets follow the graph");
+        // like undoing a delete, the replacement has the same ID
+        const auto nodeId = volume->nodeId;
+        expect (graph.removeNode (nodeId));
+        GraphNodePtr replaced = graph.addNode (new VolumeProcessor (-60.0, 12.0, true), nodeId);
+        runDispatchLoop (20);
+        listener.oscMessageReceived (OSCMessage ("/volume", 0.75f));
+        graph.processBlock (buffer, midiBuffer);
+        expectWithinAbsoluteError (volume->getParameters()[0]->getValue(), 0.25f, 0.001f);
+        expectWithinAbsoluteError (replaced->getParameters()[0]->getValue(), 0.75f, 0.001f);
+
+        replaced = nullptr;
+
+        volume = nullptr;
+        node = nullptr;
+        graph.releaseResources();
+        graph.clear();
+    }
+
+    static const int blockSize = 512;
+    AudioSampleBuffer audio { 1, blockSize };
+    MidiBuffer buffers [OSCReceiverNode::numMidiOutputs];
+
+    MidiMessage firstMessage (int index)
+    {
+        MidiBuffer::Iterator iter (buffers [index]);
+        MidiMessage msg; int frame = 0;
+        iter.getNextEvent (msg, frame);
+        return msg;
+    }
+
+    int firstFrame (int index)
+    {
+        MidiBuffer::Iterator iter (buffers [index]);
+        MidiMessage msg; int frame = -1;
+        iter.getNextEvent (msg, frame);
+        return frame;
+    }
+
+    void renderBlock (OSCReceiverNode& receiver)
+    {
+        MidiBuffer* pointers[] = { &buffers[0], &buffers[1], &buffers[2], &buffers[3] };
+        MidiPipe pipe (pointers, OSCReceiverNode::numMidiOutputs);
+        receiver.render (audio, pipe);
+    }
+};
+
+static OSCReceiverTest sOSCReceiverTest;
+
+}
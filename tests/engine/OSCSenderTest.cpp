@@ -0,0 +1,172 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+#include "Tests.h"
+#include "engine/nodes/OSCSenderNode.h"
+
+namespace Element {
+
+class OSCSenderTest : public UnitTestBase,
+                      private OSCReceiver::Listener<OSCReceiver::RealtimeCallback>
+{
+public:
+    OSCSenderTest() : UnitTestBase ("OSC Sender", "engine", "oscSender") { }
+    virtual ~OSCSenderTest() { }
+
+    void runTest() override
+    {
+        OSCReceiver receiver;
+        if (! receiver.connect (port))
+        {
+            logMessage ("could not bind the loopback port, skipping");
+            return;
+        }
+        receiver.addListener (this);
+
+        GraphNodePtr node = new OSCSenderNode();
+        auto* sender = dynamic_cast<OSCSenderNode*> (node.get());
+        sender->prepareToRender (1000.0, blockSize);
+        expect (sender->connect ("127.0.0.1", port));
+
+        beginTest ("one bundle per block");
+        midi.addEvent (MidiMessage::noteOn (1, 60, 0.5f), 0);
+        midi.addEvent (MidiMessage::noteOn (1, 64, 0.5f), 0);
+        midi.addEvent (MidiMessage::noteOff (1, 60), 10);
+        renderBlock (*sender);
+        midi.addEvent (MidiMessage::noteOff (1, 64), 5);
+        renderBlock (*sender);
+        waitForMessages (4);
+
+        expectEquals (sender->getNumBundlesSent(), 2);
+        expectEquals (numBundles.get(), 2);
+        expectEquals (numNested.get(), 1);
+        expectEquals ((int) sender->getOscMessages().size(), 4);
+        expect (sender->getOscMessages().empty());
+
+        beginTest ("timetags");
+        expect (sender->getLatencySeconds() >= 2.0 * blockSize / 1000.0);
+        for (int i = 0; i < 8; ++i)
+        {
+            midi.addEvent (MidiMessage::noteOn (1, 60 + i, 0.5f), i);
+            midi.addEvent (MidiMessage::noteOff (1, 60 + i), 20 + i);
+            renderBlock (*sender);
+        }
+        waitForMessages (20);
+        expectEquals (numPastTags.get(), 0);
+        expectEquals (numOutOfOrderTags.get(), 0);
+
+        beginTest ("interval");
+        sender->setSendInterval (200);
+        expectEquals (sender->getSendInterval(), 200);
+        Thread::sleep (250);
+        for (int i = 0; i < 4; ++i)
+        {
+            midi.addEvent (MidiMessage::controllerEvent (1, 7, i), 0);
+            renderBlock (*sender);
+        }
+        waitForMessages (24);
+        expectEquals (numBundles.get(), 11);
+        expectEquals (numNested.get(), 12);
+        expectEquals (numPastTags.get(), 0);
+        expectEquals (numOutOfOrderTags.get(), 0);
+
+        beginTest ("state");
+        MemoryBlock block;
+        sender->getState (block);
+        GraphNodePtr otherNode = new OSCSenderNode();
+        auto* other = dynamic_cast<OSCSenderNode*> (otherNode.get());
+        other->setState (block.getData(), (int) block.getSize());
+        expectEquals (other->getSendInterval(), 200);
+        other->disconnect();
+
+        sender->disconnect();
+        receiver.removeListener (this);
+        receiver.disconnect();
+    }
+
+private:
+    static const int blockSize = 50;
+    static const int port = 9137;
+    AudioSampleBuffer audio { 1, blockSize };
+    MidiBuffer midi;
+    Atomic<int> numMessages { 0 }, numBundles { 0 }, numNested { 0 };
+    Atomic<int> numPastTags { 0 }, numOutOfOrderTags { 0 };
+    uint64 lastTimeTag = 0;     // receiver thread only
+
+    void oscMessageReceived (const OSCMessage&) override
+    {
+        numMessages.set (numMessages.get() + 1);
+    }
+
+    void oscBundleReceived (const OSCBundle& bundle) override
+    {
+        // bundles must arrive ahead of their tags, in the order they are tagged
+        if (bundle.getTimeTag().getRawTimeTag() <= OSCTimeTag (Time::getCurrentTime()).getRawTimeTag())
+            numPastTags.set (numPastTags.get() + 1);
+        checkOrder (bundle);
+        numBundles.set (numBundles.get() + 1);
+        for (const auto& element : bundle)
+        {
+            if (element.isBundle())
+                numNested.set (numNested.get() + 1);
+            countMessages (element);
+        }
+    }
+
+    void checkOrder (const OSCBundle& bundle)
+    {
+        const auto tag = bundle.getTimeTag().getRawTimeTag();
+        if (tag < lastTimeTag)
+            numOutOfOrderTags.set (numOutOfOrderTags.get() + 1);
+        lastTimeTag = tag;
+
+        for (const auto& element : bundle)
+            if (element.isBundle())
+                checkOrder (element.getBundle());
+    }
+
+    void countMessages (const OSCBundle::Element& element)
+    {
+        if (element.isMessage())
+        {
+            numMessages.set (numMessages.get() + 1);
+            return;
+        }
+
+        for (const auto& child : element.getBundle())
+            countMessages (child);
+    }
+
+    void waitForMessages (int count)
+    {
+        for (int i = 0; i < 100 && numMessages.get() < count; ++i)
+            Thread::sleep (10);
+        expectEquals (numMessages.get(), count);
+    }
+
+    void renderBlock (OSCSenderNode& sender)
+    {
+        MidiBuffer* pointers[] = { &midi };
+        MidiPipe pipe (pointers, 1);
+        sender.render (audio, pipe);
+    }
+};
+
+static OSCSenderTest sOSCSenderTest;
+
+}
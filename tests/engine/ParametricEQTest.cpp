@@ -0,0 +1,163 @@
+/*
+    This file is part of Element
+    Copyright (C) 2019  Kushview, LLC.  All rights reserved.
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <https://www.gnu.org/licenses/>.
+*/
+
+
+#include "Tests.h"
+#include "engine/nodes/ParametricEQProcessor.h"
+
+namespace Element {
+
+class ParametricEQTest : public UnitTestBase
+{
+public:
+    ParametricEQTest() : UnitTestBase ("Parametric EQ", "engine", "parametricEQ") { }
+    virtual ~ParametricEQTest() { }
+
+    void runTest() override
+    {
+        testCascade();
+        testProcessor();
+    }
+
+private:
+    static constexpr double sampleRate = 48000.0;
+
+    static void fillSine (float* data, int numSamples, double freq)
+    {
+        for (int i = 0; i < numSamples; ++i)
+            data[i] = (float) std::sin (MathConstants<double>::twoPi * freq * i / sampleRate);
+    }
+
+    static float peak (const float* data, int start, int numSamples)
+    {
+        return FloatVectorOperations::findMaximum (data + start, numSamples - start);
+    }
+
+    void testCascade()
+    {
+        beginTest ("unity sections are skipped");
+        const int numSamples = 4800;
+        BiquadCascade cascade;
+        cascade.prepare (6, 64);
+        cascade.setTarget (3, BiquadCascade::design (EQFilter::Bell, sampleRate, 1000.f, 1.f, 0.f));
+        expect (! cascade.isActive (3));
+
+        beginTest ("lanes match a single channel");
+        cascade.setTarget (0, BiquadCascade::design (EQFilter::LowPass, sampleRate, 1000.f, 0.707f, 0.f));
+        cascade.setTarget (1, BiquadCascade::design (EQFilter::Bell, sampleRate, 5000.f, 2.f, 6.f));
+        cascade.reset();
+        expect (cascade.isActive (0) && cascade.isActive (1));
+
+        AudioSampleBuffer audio (6, numSamples);
+        Random random (3);
+        for (int i = 0; i < numSamples; ++i)
+            audio.setSample (0, i, random.nextFloat() * 2.f - 1.f);
+        for (int ch = 1; ch < 6; ++ch)
+            audio.copyFrom (ch, 0, audio, 0, 0, numSamples);
+
+        BiquadCascade mono;
+        mono.prepare (1, 64);
+        mono.setTarget (0, BiquadCascade::design (EQFilter::LowPass, sampleRate, 1000.f, 0.707f, 0.f));
+        mono.setTarget (1, BiquadCascade::design (EQFilter::Bell, sampleRate, 5000.f, 2.f, 6.f));
+        mono.reset();
+        HeapBlock<float> expected (numSamples);
+        FloatVectorOperations::copy (expected, audio.getReadPointer (0), numSamples);
+        float* const monoChannels[] = { expected.getData() };
+        mono.process (monoChannels, 1, numSamples);
+
+        cascade.process (audio.getArrayOfWritePointers(), 6, numSamples);
+        for (int ch = 0; ch < 6; ++ch)
+            for (int i = 0; i < numSamples; i += 97)
+                expectWithinAbsoluteError (audio.getSample (ch, i), expected[i], 1.0e-6f);
+
+        beginTest ("coefficients glide to the target");
+        BiquadCascade ramp;
+        ramp.prepare (1, 480);
+        const auto target = BiquadCascade::design (EQFilter::Bell, sampleRate, 1000.f, 1.f, 12.f);
+        HeapBlock<float> sine (numSamples);
+        fillSine (sine, numSamples, 1000.0);
+        ramp.setTarget (0, target);
+        float* const rampChannels[] = { sine.getData() };
+        ramp.process (rampChannels, 1, numSamples);
+
+        // +12 dB once settled, and no step at the start
+        expectWithinAbsoluteError (peak (sine, numSamples - 480, numSamples), 3.98f, 0.05f);
+        expect (std::abs (sine[1]) < 0.2f);
+    }
+
+    void testProcessor()
+    {
+        const int blockSize = 512, numBlocks = 20;
+        ParametricEQProcessor eq (2, 8);
+        expectEquals (eq.getNumBands(), 8);
+        expectEquals (ParametricEQProcessor::getNumBandsFor ("element.parametricEQ.12"), 12);
+        eq.prepareToPlay (sampleRate, blockSize);
+
+        beginTest ("flat bands pass audio through");
+        AudioSampleBuffer audio (2, blockSize);
+        MidiBuffer midi;
+        fillSine (audio.getWritePointer (0), blockSize, 440.0);
+        audio.copyFrom (1, 0, audio, 0, 0, blockSize);
+        AudioSampleBuffer dry (audio);
+        eq.processBlock (audio, midi);
+        for (int b = 0; b < eq.getNumBands(); ++b)
+            expect (! eq.isBandActive (b));
+        for (int i = 0; i < blockSize; ++i)
+            expectEquals (audio.getSample (1, i), dry.getSample (1, i));
+
+        beginTest ("a bell boosts its band");
+        auto params = eq.getParameters();
+        auto* freq = dynamic_cast<AudioParameterFloat*> (params [5 * 3 + 2]);
+        auto* gain = dynamic_cast<AudioParameterFloat*> (params [5 * 3 + 4]);
+        expect (freq != nullptr && gain != nullptr);
+        *freq = 2000.f;
+        *gain = 12.f;
+
+        HeapBlock<float> sine (blockSize * numBlocks);
+        fillSine (sine, blockSize * numBlocks, 2000.0);
+        for (int block = 0; block < numBlocks; ++block)
+        {
+            audio.copyFrom (0, 0, sine + block * blockSize, blockSize);
+            audio.copyFrom (1, 0, sine + block * blockSize, blockSize);
+            eq.processBlock (audio, midi);
+        }
+
+        expect (eq.isBandActive (3));
+        expectWithinAbsoluteError (peak (audio.getReadPointer (0), 0, blockSize), 3.98f, 0.1f);
+        expectEquals (audio.getSample (0, 100), audio.getSample (1, 100));
+
+        beginTest ("disabled bands are skipped");
+        auto* on = dynamic_cast<AudioParameterBool*> (params [3 * 5]);
+        expect (on != nullptr);
+        *on = false;
+        for (int block = 0; block < 4; ++block)
+        {
+            audio.copyFrom (0, 0, sine + block * blockSize, blockSize);
+            audio.copyFrom (1, 0, sine + block * blockSize, blockSize);
+            eq.processBlock (audio, midi);
+        }
+
+        expect (! eq.isBandActive (3));
+        expectWithinAbsoluteError (peak (audio.getReadPointer (0), 0, blockSize), 1.f, 0.01f);
+        eq.releaseResources();
+    }
+};
+
+static ParametricEQTest sParametricEQTest;
+
+}
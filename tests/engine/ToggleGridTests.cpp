@@ -29,6 +29,8 @@ public:
     void runTest() override
     {
         testToggleGrid();
+        testLargeGrid();
+        testBuffer();
     }
 
 private:
@@ -66,6 +68,90 @@ private:
         expect (grid4.getNumInputs() == matrix.getNumRows() &&
                 grid4.getNumOutputs() == matrix.getNumColumns());
         expect (grid4.get (3, 3) == matrix.connected (3, 3));
+
+        beginTest ("swapWith sizes");
+        grid4.swapWith (grid3);
+        expect (grid4.getNumInputs() == 3 && grid4.getNumOutputs() == 4);
+        expect (grid3.getNumInputs() == 6 && grid3.getNumOutputs() == 6);
+        expect (grid3.get (3, 3));
+    }
+
+    void testLargeGrid()
+    {
+        ToggleGrid grid (128, 130);
+        expect (grid.getNumWordsPerRow() == 3);
+
+        beginTest ("count and iterate");
+        grid.set (5, 0, true);
+        grid.set (5, 63, true);
+        grid.set (5, 64, true);
+        grid.set (5, 129, true);
+        grid.set (127, 100, true);
+        expect (grid.count() == 5);
+        expect (grid.countRow (5) == 4);
+        expect (grid.isRowEmpty (4) && ! grid.isRowEmpty (127));
+
+        Array<int> outs;
+        grid.forEachOutput (5, [&outs](int out) { outs.add (out); });
+        expect (outs == Array<int> ({ 0, 63, 64, 129 }));
+        expect (grid.nextOutput (5, 1) == 63);
+        expect (grid.nextOutput (5, 65) == 129);
+        expect (grid.nextOutput (5, 130) == -1);
+        expect (grid.nextOutput (6, 0) == -1);
+
+        beginTest ("copy");
+        ToggleGrid same (128, 130);
+        same = grid;
+        expect (same.count() == 5 && same.get (127, 100));
+        ToggleGrid smaller (8, 64);
+        smaller = grid;
+        expect (smaller.getNumInputs() == 8 && smaller.getNumOutputs() == 64);
+        expect (smaller.count() == 2);
+        expect (smaller.get (5, 0) && smaller.get (5, 63));
+
+        beginTest ("clearRow");
+        grid.clearRow (5);
+        expect (grid.isRowEmpty (5) && grid.count() == 1);
+    }
+
+    void testBuffer()
+    {
+        beginTest ("buffer");
+        ToggleGridBuffer buffer (16, 16);
+        expect (! buffer.update());
+        {
+            ScopedLock sl (buffer.getLock());
+            buffer.getPending().set (1, 2, true);
+            buffer.markChanged();
+        }
+        expect (! buffer.getCurrent().get (1, 2));
+        expect (buffer.update());
+        expect (buffer.getCurrent().get (1, 2));
+        expect (! buffer.update());
+
+        beginTest ("buffer resize");
+        {
+            ScopedLock sl (buffer.getLock());
+            buffer.resize (8, 100);
+            buffer.getPending().set (7, 99, true);
+            buffer.markChanged();
+        }
+        expect (buffer.update());
+        expectEquals (buffer.getCurrent().getNumInputs(), 8);
+        expectEquals (buffer.getCurrent().getNumOutputs(), 100);
+        expect (buffer.getCurrent().get (7, 99));
+        expectEquals (buffer.getCurrent().count(), 1);
+        {
+            // pending still holds the resized toggles after the swap
+            ScopedLock sl (buffer.getLock());
+            expect (buffer.getPending().sameSizeAs (buffer.getCurrent()));
+            buffer.getPending().set (0, 0, true);
+            buffer.markChanged();
+        }
+        bool sideState = false;
+        expect (buffer.update ([&sideState]() { sideState = true; }));
+        expect (sideState);
+        expect (buffer.getCurrent().get (7, 99) && buffer.getCurrent().get (0, 0));
     }
 };
 